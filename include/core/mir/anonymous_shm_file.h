@@ -33,7 +33,22 @@ namespace detail
 class AnonymousShmFile : public ShmFile
 {
 public:
+    /// How the pages of the mapping are faulted in
+    enum class Paging
+    {
+        on_demand,      ///< By whichever thread first touches each page
+        prefaulted      ///< By the constructor, as transparent huge pages where allowed,
+                        ///< if the mapping is at least 2MiB (otherwise as on_demand)
+    };
+
     AnonymousShmFile(size_t size);
+
+    /**
+     * Prefaulting costs the constructing thread time, and memory for every page,
+     * so is only for buffers the caller knows will be written in full. It is
+     * skipped for mappings under 2MiB, whatever the caller asks.
+     */
+    AnonymousShmFile(size_t size, Paging paging);
     ~AnonymousShmFile() noexcept;
 
     void* base_ptr() const override;
@@ -0,0 +1,73 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_RENDERER_SW_PIXEL_TARGET_H_
+#define MIR_RENDERER_SW_PIXEL_TARGET_H_
+
+#include "mir/geometry/dimensions.h"
+#include "mir/geometry/size.h"
+
+namespace mir
+{
+namespace geometry { class Rectangles; }
+namespace renderer
+{
+namespace software
+{
+
+/**
+ * Pixels a display buffer can have drawn into directly by the CPU.
+ *
+ * The pixels are 32-bit native-endian 0xAARRGGBB values (that is,
+ * mir_pixel_format_argb_8888 or mir_pixel_format_xrgb_8888).
+ */
+class PixelTarget
+{
+public:
+    virtual ~PixelTarget() = default;
+
+    /// The pixels to draw the next frame into, valid until commit()
+    virtual unsigned char* map_pixels() = 0;
+    virtual geometry::Size size() const = 0;
+    virtual geometry::Stride stride() const = 0;
+
+    /**
+     * How many frames ago the pixels map_pixels() will return were committed
+     * (as EGL_EXT_buffer_age): 1 if they hold the last frame, 0 if their
+     * contents are undefined.
+     */
+    virtual unsigned buffer_age() const = 0;
+
+    /**
+     * Whether the target applies its display buffer's transformation() itself
+     * when committing, so that frames are drawn untransformed.
+     */
+    virtual bool applies_transformation() const = 0;
+
+    /// Present the frame drawn; damage is what changed since the last frame, in target coordinates
+    virtual void commit(geometry::Rectangles const& damage) = 0;
+
+protected:
+    PixelTarget() = default;
+    PixelTarget(PixelTarget const&) = delete;
+    PixelTarget& operator=(PixelTarget const&) = delete;
+};
+
+}
+}
+}
+
+#endif /* MIR_RENDERER_SW_PIXEL_TARGET_H_ */
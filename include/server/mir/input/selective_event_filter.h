@@ -0,0 +1,62 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_INPUT_SELECTIVE_EVENT_FILTER_H_
+#define MIR_INPUT_SELECTIVE_EVENT_FILTER_H_
+
+#include "mir/input/event_filter.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace mir
+{
+namespace input
+{
+
+/// The events an EventFilter wants to be offered
+struct EventInterest
+{
+    static uint32_t const all_input_types = (1u << mir_input_event_types) - 1;
+
+    static constexpr uint32_t bit_for(MirInputEventType type) { return 1u << type; }
+
+    /// A bit_for() each type of input event of interest
+    uint32_t input_types{all_input_types};
+
+    /// Whether events that are not input events (e.g. device state) are of interest
+    bool other_events{true};
+
+    /// The devices whose input events are of interest; empty for every device
+    std::vector<MirInputDeviceId> devices;
+};
+
+/**
+ * An event filter that is only interested in some events
+ *
+ * A CompositeEventFilter reads the interest() of a filter once, when the
+ * filter is added, and then offers it only the events it is interested in.
+ */
+class SelectiveEventFilter : public EventFilter
+{
+public:
+    virtual auto interest() const -> EventInterest = 0;
+};
+
+}
+}
+
+#endif // MIR_INPUT_SELECTIVE_EVENT_FILTER_H_
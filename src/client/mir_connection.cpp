@@ -27,6 +27,7 @@
 #include "mir/client/client_platform.h"
 #include "mir/client/client_platform_factory.h"
 #include "rpc/mir_basic_rpc_channel.h"
+#include "rpc/mir_protobuf_rpc_channel.h"
 #include "mir/dispatch/dispatchable.h"
 #include "mir/dispatch/threaded_dispatcher.h"
 #include "mir/input/input_devices.h"
@@ -63,6 +64,7 @@
 #include <boost/throw_exception.hpp>
 
 namespace mcl = mir::client;
+namespace mclr = mir::client::rpc;
 namespace md = mir::dispatch;
 namespace mircv = mir::input::receiver;
 namespace mev = mir::events;
@@ -108,6 +110,12 @@ size_t get_nbuffers_from_env()
     return 3u;
 }
 
+bool input_event_ring_from_env()
+{
+    const char* ring_opt = getenv("MIR_CLIENT_INPUT_EVENT_RING");
+    return ring_opt && !strcmp(ring_opt, "1");
+}
+
 struct OnScopeExit
 {
     ~OnScopeExit() { f(); }
@@ -118,6 +126,9 @@ mir::protobuf::SurfaceParameters serialize_spec(MirWindowSpec const& spec)
 {
     mp::SurfaceParameters message;
 
+    if (input_event_ring_from_env())
+        message.set_input_event_ring(true);
+
 #define SERIALIZE_OPTION_IF_SET(option) \
     if (spec.option.is_set()) \
         message.set_##option(spec.option.value());
@@ -544,6 +555,9 @@ void MirConnection::released(StreamRelease data)
 
 void MirConnection::released(SurfaceRelease data)
 {
+    if (auto const protobuf_channel = std::dynamic_pointer_cast<mclr::MirProtobufRpcChannel>(channel))
+        protobuf_channel->release_input_event_ring(data.surface->id());
+
     surface_map->erase(mf::BufferStreamId(data.surface->id()));
     surface_map->erase(mf::SurfaceId(data.surface->id()));
     data.callback(data.surface, data.context);
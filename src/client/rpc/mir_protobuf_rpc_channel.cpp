@@ -36,6 +36,7 @@
 #include "mir/events/event_builders.h"
 #include "mir/events/event_private.h"
 #include "mir/events/surface_placement_event.h"
+#include "mir/input/input_event_record_codec.h"
 
 #include "mir_protobuf.pb.h"  // For Buffer frig
 #include "mir_protobuf_wire.pb.h"
@@ -46,7 +47,9 @@
 #include <endian.h>
 
 #include <stdexcept>
+#include <system_error>
 #include <cstring>
+#include <sys/mman.h>
 
 namespace mf = mir::frontend;
 namespace mev = mir::events;
@@ -54,6 +57,28 @@ namespace mcl = mir::client;
 namespace mclr = mir::client::rpc;
 namespace md = mir::dispatch;
 namespace mp = mir::protobuf;
+namespace mi = mir::input;
+
+/* A ring of input events shared with the server for one surface */
+struct mclr::MirProtobufRpcChannel::InputEventRing
+{
+    InputEventRing(mir::Fd const& fd, size_t size) :
+        size{size},
+        mapping{mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)}
+    {
+        if (mapping == MAP_FAILED)
+            BOOST_THROW_EXCEPTION(std::system_error(errno, std::system_category(), "Failed to map input event ring"));
+    }
+
+    ~InputEventRing()
+    {
+        munmap(mapping, size);
+    }
+
+    size_t const size;
+    void* const mapping;
+    mi::InputEventRing ring{mapping, size};
+};
 
 mclr::MirProtobufRpcChannel::MirProtobufRpcChannel(
     std::unique_ptr<mclr::StreamTransport> transport,
@@ -400,6 +425,17 @@ void mclr::MirProtobufRpcChannel::process_event_sequence(std::string const& even
 
     }
 
+    if (seq.has_input_event_ring())
+    {
+        add_input_event_ring(seq);
+    }
+
+    // Anything the server sends alongside the doorbell is newer than the ring contents
+    if (seq.has_input_event_ring_doorbell())
+    {
+        drain_input_event_ring(seq.input_event_ring_doorbell().value());
+    }
+
     int const nevents = seq.event_size();
     for (int i = 0; i != nevents; ++i)
     {
@@ -414,52 +450,7 @@ void mclr::MirProtobufRpcChannel::process_event_sequence(std::string const& even
                 if (e)
                 {
                     rpc_report->event_parsing_succeeded(*e);
-
-                    int window_id = 0;
-                    bool is_window_event = true;
-
-                    switch (e->type())
-                    {
-                    case mir_event_type_window:
-                        window_id = e->to_surface()->id();
-                        break;
-                    case mir_event_type_resize:
-                        window_id = e->to_resize()->surface_id();
-                        break;
-                    case mir_event_type_orientation:
-                        window_id = e->to_orientation()->surface_id();
-                        break;
-                    case mir_event_type_close_window:
-                        window_id = e->to_close_window()->surface_id();
-                        break;
-                    case mir_event_type_keymap:
-                        input_report->received_event(*e);
-                        window_id = e->to_keymap()->surface_id();
-                        break;
-                    case mir_event_type_window_output:
-                        window_id = e->to_window_output()->surface_id();
-                        break;
-                    case mir_event_type_window_placement:
-                        window_id = e->to_window_placement()->id();
-                        break;
-                    case mir_event_type_input:
-                        input_report->received_event(*e);
-                        window_id = e->to_input()->window_id();
-                        break;
-                    case mir_event_type_input_device_state:
-                        input_report->received_event(*e);
-                        window_id = e->to_input_device_state()->window_id();
-                        break;
-                    default:
-                        is_window_event = false;
-                        event_sink->handle_event(*e);
-                    }
-
-                    if (is_window_event)
-                        if (auto map = surface_map.lock())
-                            if (auto surf = map->surface(mf::SurfaceId(window_id)))
-                                surf->handle_event(*e);
-
+                    route_event(*e);
                 }
             }
             catch(...)
@@ -470,6 +461,99 @@ void mclr::MirProtobufRpcChannel::process_event_sequence(std::string const& even
     }
 }
 
+void mclr::MirProtobufRpcChannel::add_input_event_ring(mp::EventSequence& seq)
+{
+    auto const& setup = seq.input_event_ring();
+    std::array<char, 1> dummy;
+    std::vector<mir::Fd> fds(setup.fds_on_side_channel());
+    if (fds.empty())
+        return;
+
+    transport->receive_data(dummy.data(), dummy.size(), fds);
+
+    auto ring = std::make_shared<InputEventRing>(fds[0], setup.size());
+
+    std::lock_guard<decltype(input_event_rings_mutex)> lock{input_event_rings_mutex};
+    input_event_rings[setup.surface_id().value()] = std::move(ring);
+}
+
+void mclr::MirProtobufRpcChannel::release_input_event_ring(int surface_id)
+{
+    std::lock_guard<decltype(input_event_rings_mutex)> lock{input_event_rings_mutex};
+    input_event_rings.erase(surface_id);
+}
+
+void mclr::MirProtobufRpcChannel::drain_input_event_ring(int window_id)
+{
+    std::shared_ptr<InputEventRing> ring;
+    {
+        std::lock_guard<decltype(input_event_rings_mutex)> lock{input_event_rings_mutex};
+        auto const found = input_event_rings.find(window_id);
+        if (found == input_event_rings.end())
+            return;
+        ring = found->second;
+    }
+
+    // The surface may be released by an event handler, but we keep the ring mapped until we're done
+    ring->ring.drain(
+        [this](mi::InputEventRecord const& record)
+        {
+            if (auto const e = mi::decode_input_event(record))
+            {
+                rpc_report->event_parsing_succeeded(*e);
+                route_event(*e);
+            }
+        });
+}
+
+void mclr::MirProtobufRpcChannel::route_event(MirEvent& e)
+{
+    int window_id = 0;
+    bool is_window_event = true;
+
+    switch (e.type())
+    {
+    case mir_event_type_window:
+        window_id = e.to_surface()->id();
+        break;
+    case mir_event_type_resize:
+        window_id = e.to_resize()->surface_id();
+        break;
+    case mir_event_type_orientation:
+        window_id = e.to_orientation()->surface_id();
+        break;
+    case mir_event_type_close_window:
+        window_id = e.to_close_window()->surface_id();
+        break;
+    case mir_event_type_keymap:
+        input_report->received_event(e);
+        window_id = e.to_keymap()->surface_id();
+        break;
+    case mir_event_type_window_output:
+        window_id = e.to_window_output()->surface_id();
+        break;
+    case mir_event_type_window_placement:
+        window_id = e.to_window_placement()->id();
+        break;
+    case mir_event_type_input:
+        input_report->received_event(e);
+        window_id = e.to_input()->window_id();
+        break;
+    case mir_event_type_input_device_state:
+        input_report->received_event(e);
+        window_id = e.to_input_device_state()->window_id();
+        break;
+    default:
+        is_window_event = false;
+        event_sink->handle_event(e);
+    }
+
+    if (is_window_event)
+        if (auto map = surface_map.lock())
+            if (auto surf = map->surface(mf::SurfaceId(window_id)))
+                surf->handle_event(e);
+}
+
 void mclr::MirProtobufRpcChannel::on_data_available()
 {
     /*
@@ -484,6 +568,19 @@ void mclr::MirProtobufRpcChannel::on_data_available()
      */
     std::lock_guard<decltype(read_mutex)> lock(read_mutex);
 
+    /*
+     * The transport reads everything available at once, and won't notify us
+     * again for messages it has already read, so process all of them now.
+     */
+    do
+    {
+        process_next_message();
+    }
+    while (transport->bytes_buffered() > 0);
+}
+
+void mclr::MirProtobufRpcChannel::process_next_message()
+{
     auto result = mcl::make_protobuf_object<mp::wire::Result>();
     try
     {
@@ -554,6 +651,8 @@ void mclr::MirProtobufRpcChannel::on_data_available()
     }
 }
 
+mclr::MirProtobufRpcChannel::~MirProtobufRpcChannel() = default;
+
 void mclr::MirProtobufRpcChannel::on_disconnected()
 {
     notify_disconnected();
@@ -31,6 +31,8 @@
 
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <unordered_map>
 #include <experimental/optional>
 
 namespace mir
@@ -76,7 +78,10 @@ public:
                           std::shared_ptr<ErrorHandler> const& error_handler,
                           std::shared_ptr<EventSink> const& event_sink);
 
-    ~MirProtobufRpcChannel() = default;
+    ~MirProtobufRpcChannel();
+
+    /// Unmap the input event ring of a surface the client has released
+    void release_input_event_ring(int surface_id);
 
     // StreamTransport::Observer
     void on_data_available() override;
@@ -131,6 +136,14 @@ private:
 
     void read_message();
     void process_event_sequence(std::string const& event);
+    void process_next_message();
+    void route_event(MirEvent& event);
+
+    struct InputEventRing;
+    void add_input_event_ring(mir::protobuf::EventSequence& seq);
+    void drain_input_event_ring(int window_id);
+    std::mutex input_event_rings_mutex;
+    std::unordered_map<int, std::shared_ptr<InputEventRing>> input_event_rings;
 
     void notify_disconnected();
 
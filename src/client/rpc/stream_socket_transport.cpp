@@ -21,6 +21,9 @@
 #include "mir/thread_name.h"
 #include "mir/fd_socket_transmission.h"
 
+#include <algorithm>
+#include <cstring>
+#include <iterator>
 #include <system_error>
 
 #include <errno.h>
@@ -46,7 +49,11 @@ void mclr::TransportObservers::on_disconnected()
 }
 
 mclr::StreamSocketTransport::StreamSocketTransport(mir::Fd const& fd)
-    : socket_fd{fd}
+    : socket_fd{fd},
+      read_buffer(64 * 1024),
+      read_begin{0},
+      read_end{0},
+      read_begin_position{0}
 {
 }
 
@@ -67,79 +74,149 @@ void mclr::StreamSocketTransport::unregister_observer(std::shared_ptr<Observer>
 
 void mclr::StreamSocketTransport::receive_data(void* buffer, size_t bytes_requested)
 {
-    /*
-     * Explicitly implement this, rather than delegating to receive_data(buffer, size, fds)
-     * so that we can catch when we discard file descriptors.
-     *
-     * See comment for DISABLED_ReceivingMoreFdsThanExpectedInMultipleChunksRaisesException
-     * test in test_stream_transport.cpp for details.
-     */
+    std::vector<mir::Fd> no_fds;
+    receive_data(buffer, bytes_requested, no_fds);
+}
+
+void mclr::StreamSocketTransport::receive_data(void* buffer, size_t bytes_requested, std::vector<mir::Fd>& fds)
+{
     if (bytes_requested == 0)
     {
         BOOST_THROW_EXCEPTION(std::logic_error("Attempted to receive 0 bytes"));
     }
-    size_t bytes_read{0};
-    while(bytes_read < bytes_requested)
+
+    consume(buffer, bytes_requested);
+
+    // Fds are read along with the byte they were sent with, so any sent with
+    // the data just consumed are already here (and any earlier were rejected)
+    std::vector<mir::Fd> sent_fds;
+    while (!received_fds.empty() && received_fds.front().stream_position < read_begin_position)
     {
-        // Store the data in the buffer requested
-        struct iovec iov;
-        iov.iov_base = static_cast<uint8_t*>(buffer) + bytes_read;
-        iov.iov_len = bytes_requested - bytes_read;
-
-        // Message to read
-        struct msghdr header;
-        header.msg_name = NULL;
-        header.msg_namelen = 0;
-        header.msg_iov = &iov;
-        header.msg_iovlen = 1;
-        header.msg_controllen = 0;
-        header.msg_control = nullptr;
-        header.msg_flags = 0;
-
-        ssize_t const result = recvmsg(socket_fd, &header, MSG_NOSIGNAL | MSG_WAITALL);
-
-        if (result == 0)
-        {
-            observers.on_disconnected();
-            BOOST_THROW_EXCEPTION(std::runtime_error("Failed to read message from server: server has shutdown"));
-        }
-        if (result < 0)
-        {
-            if (socket_error_is_transient(errno))
-            {
-                continue;
-            }
-            if (errno == EPIPE)
-            {
-                observers.on_disconnected();
-                BOOST_THROW_EXCEPTION(
-                            boost::enable_error_info(
-                                socket_disconnected_error("Failed to read message from server"))
-                            << boost::errinfo_errno(errno));
-            }
-            BOOST_THROW_EXCEPTION(
-                        boost::enable_error_info(socket_error("Failed to read message from server"))
-                             << boost::errinfo_errno(errno));
-        }
+        auto& received = received_fds.front().fds;
+        std::move(received.begin(), received.end(), std::back_inserter(sent_fds));
+        received_fds.pop_front();
+    }
 
-        if (header.msg_flags & MSG_CTRUNC)
-        {
-            BOOST_THROW_EXCEPTION(std::runtime_error("Unexpectedly received fds"));
-        }
+    // Any surplus fds close as sent_fds goes out of scope
+    if (sent_fds.size() > fds.size())
+    {
+        BOOST_THROW_EXCEPTION(std::runtime_error(
+            fds.empty() ? "Unexpectedly received fds" : "Received more fds than expected"));
+    }
+    if (sent_fds.size() < fds.size())
+    {
+        BOOST_THROW_EXCEPTION(std::runtime_error("Received fewer fds than expected"));
+    }
+
+    std::move(sent_fds.begin(), sent_fds.end(), fds.begin());
+}
+
+void mclr::StreamSocketTransport::consume(void* buffer, size_t bytes_requested)
+{
+    auto destination = static_cast<uint8_t*>(buffer);
+    while (bytes_requested > 0)
+    {
+        if (read_begin == read_end)
+            read_available();
 
-        bytes_read += result;
+        auto const bytes = std::min(bytes_requested, read_end - read_begin);
+        memcpy(destination, read_buffer.data() + read_begin, bytes);
+
+        read_begin += bytes;
+        read_begin_position += bytes;
+        destination += bytes;
+        bytes_requested -= bytes;
     }
 }
 
-void mclr::StreamSocketTransport::receive_data(void* buffer, size_t bytes_requested, std::vector<mir::Fd>& fds)
-try
+size_t mclr::StreamSocketTransport::bytes_buffered() const
 {
-    mir::receive_data(socket_fd, buffer, bytes_requested, fds);
+    return read_end - read_begin;
 }
-catch (socket_disconnected_error &e)
+
+void mclr::StreamSocketTransport::read_available()
 {
-    observers.on_disconnected();
-    throw e;
+    if (read_begin == read_end)
+    {
+        read_begin = read_end = 0;
+    }
+    else if (read_end == read_buffer.size())
+    {
+        memmove(read_buffer.data(), read_buffer.data() + read_begin, read_end - read_begin);
+        read_end -= read_begin;
+        read_begin = 0;
+    }
+
+    if (read_end == read_buffer.size())
+        BOOST_THROW_EXCEPTION(std::logic_error("Receive buffer full"));
+
+    // Read whatever is available (blocking until there's something), up to
+    // the space we have. The kernel ends a read at data carrying fds, so at
+    // most one set of fds is received with each read, and it belongs to the
+    // last byte read.
+    struct iovec iov;
+    iov.iov_base = read_buffer.data() + read_end;
+    iov.iov_len = read_buffer.size() - read_end;
+
+    static auto const max_fds_per_read = 64;
+    alignas(struct cmsghdr) char control[CMSG_SPACE(max_fds_per_read * sizeof(int))];
+
+    struct msghdr header;
+    header.msg_name = NULL;
+    header.msg_namelen = 0;
+    header.msg_iov = &iov;
+    header.msg_iovlen = 1;
+    header.msg_controllen = sizeof control;
+    header.msg_control = control;
+    header.msg_flags = 0;
+
+    ssize_t result;
+    while ((result = recvmsg(socket_fd, &header, MSG_NOSIGNAL)) < 0 && socket_error_is_transient(errno))
+        ;
+
+    if (result == 0)
+    {
+        observers.on_disconnected();
+        BOOST_THROW_EXCEPTION(std::runtime_error("Failed to read message from server: server has shutdown"));
+    }
+    if (result < 0)
+    {
+        if (errno == EPIPE)
+        {
+            observers.on_disconnected();
+            BOOST_THROW_EXCEPTION(
+                        boost::enable_error_info(
+                            socket_disconnected_error("Failed to read message from server"))
+                        << boost::errinfo_errno(errno));
+        }
+        BOOST_THROW_EXCEPTION(
+                    boost::enable_error_info(socket_error("Failed to read message from server"))
+                         << boost::errinfo_errno(errno));
+    }
+
+    read_end += result;
+
+    ReceivedFds received{read_begin_position + (read_end - read_begin) - 1, {}};
+    for (auto cmsg = CMSG_FIRSTHDR(&header); cmsg; cmsg = CMSG_NXTHDR(&header, cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+            BOOST_THROW_EXCEPTION(fd_reception_error("Invalid control message for receiving file descriptors"));
+
+        int const* const data = reinterpret_cast<int const*>(CMSG_DATA(cmsg));
+        ptrdiff_t const header_size = reinterpret_cast<char const*>(data) - reinterpret_cast<char const*>(cmsg);
+        int const nfds = (cmsg->cmsg_len - header_size) / sizeof(int);
+
+        for (int i = 0; i < nfds; i++)
+            received.fds.emplace_back(mir::IntOwnedFd{data[i]});
+    }
+
+    if (!received.fds.empty())
+        received_fds.push_back(std::move(received));
+
+    if (header.msg_flags & MSG_CTRUNC)
+    {
+        BOOST_THROW_EXCEPTION(std::runtime_error("Received more fds than expected"));
+    }
 }
 
 void mclr::StreamSocketTransport::send_message(
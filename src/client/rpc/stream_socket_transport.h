@@ -24,8 +24,11 @@
 #include "mir/fd.h"
 #include "mir/basic_observers.h"
 
+#include <cstdint>
+#include <deque>
 #include <thread>
 #include <mutex>
+#include <vector>
 
 namespace mir
 {
@@ -56,6 +59,7 @@ public:
 
     void receive_data(void* buffer, size_t bytes_requested) override;
     void receive_data(void* buffer, size_t bytes_requested, std::vector<Fd>& fds) override;
+    size_t bytes_buffered() const override;
     void send_message(std::vector<uint8_t> const& buffer, std::vector<mir::Fd> const& fds) override;
 
     Fd watch_fd() const override;
@@ -63,9 +67,27 @@ public:
     mir::dispatch::FdEvents relevant_events() const override;
 private:
     Fd open_socket(std::string const& path);
+    void read_available();
+    void consume(void* buffer, size_t bytes_requested);
 
     Fd const socket_fd;
 
+    // Fds are sent with a byte of data, and belong to whoever receives that byte
+    struct ReceivedFds
+    {
+        uint64_t stream_position;
+        std::vector<Fd> fds;
+    };
+
+    // Data (and any fds sent with it) read from the socket but not yet
+    // consumed by receive_data(). Only touched by readers, which the caller
+    // serialises.
+    std::vector<uint8_t> read_buffer;
+    size_t read_begin;
+    size_t read_end;
+    uint64_t read_begin_position;   ///< Stream position of read_begin
+    std::deque<ReceivedFds> received_fds;
+
     TransportObservers observers;
 };
 
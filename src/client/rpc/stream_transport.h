@@ -143,6 +143,16 @@ public:
      */
     virtual void receive_data(void* buffer, size_t bytes_requested, std::vector<Fd>& fds) = 0;
 
+    /**
+     * \brief The number of bytes already read from the server but not yet
+     *        returned by receive_data()
+     *
+     * The transport may read ahead of what is requested. Observers are not
+     * notified of data that has already been read, so a reader should keep
+     * reading while this is non-zero.
+     */
+    virtual size_t bytes_buffered() const = 0;
+
     /**
      * \brief Write message to the server
      * \param [in] buffer   Data to send
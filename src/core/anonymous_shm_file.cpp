@@ -27,6 +27,7 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <unistd.h>
 #include <sys/mman.h>
 #include <fcntl.h>
 #include <linux/memfd.h>
@@ -46,6 +47,31 @@ bool error_indicates_tmpfile_not_supported(int error)
                             // that incorrectly returns EINVAL. Yay.
 }
 
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23  // Since Linux 5.14
+#endif
+
+/* Below a huge page the faults are few, and cheaper taken by whoever draws than
+ * paid for every buffer (e.g. cursors) when it is allocated. */
+size_t const min_prefault_size{2 * 1024 * 1024};
+
+void prefault(void* mapping, size_t size)
+{
+    if (size < min_prefault_size)
+        return;
+
+    // Both are only advice: if the kernel won't, we just take the faults later
+    madvise(mapping, size, MADV_HUGEPAGE);
+
+    if (madvise(mapping, size, MADV_POPULATE_WRITE) == 0)
+        return;
+
+    auto const page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    auto const bytes = static_cast<char volatile*>(mapping);
+    for (size_t offset = 0; offset < size; offset += page_size)
+        bytes[offset] = 0;
+}
+
 int memfd_create(char const* name, unsigned int flags)
 {
     return static_cast<int>(syscall(SYS_memfd_create, name, flags));
@@ -99,13 +125,16 @@ mir::Fd create_anonymous_file(size_t size)
 class mir::AnonymousShmFile::MapHandle
 {
 public:
-    MapHandle(int fd, size_t size)
+    MapHandle(int fd, size_t size, Paging paging)
         : size{size},
           mapping{mmap(nullptr, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0)}
     {
         if (mapping == MAP_FAILED)
             BOOST_THROW_EXCEPTION(
                 std::system_error(errno, std::system_category(), "Failed to map file"));
+
+        if (paging == Paging::prefaulted)
+            prefault(mapping, size);
     }
 
     ~MapHandle() noexcept
@@ -130,8 +159,13 @@ private:
  ********************/
 
 mir::AnonymousShmFile::AnonymousShmFile(size_t size)
+    : AnonymousShmFile{size, Paging::on_demand}
+{
+}
+
+mir::AnonymousShmFile::AnonymousShmFile(size_t size, Paging paging)
     : fd_{create_anonymous_file(size)},
-      mapping{new MapHandle(fd_, size)}
+      mapping{new MapHandle(fd_, size, paging)}
 {
 }
 
@@ -76,7 +76,13 @@ struct MirEvent
 protected:
     MirEvent() = default;
 
-    ::capnp::MallocMessageBuilder message;
+    /* Building a message normally callocs an 8KiB first segment. Keyboard and pointer
+     * events (and touch events with a few contacts) fit in a much smaller one, which
+     * we keep inline so creating and copying them needs no further allocation. */
+    static size_t const inline_segment_words = 128;
+    ::capnp::word inline_segment[inline_segment_words]{};   ///< Must be zeroed before the builder uses it
+
+    ::capnp::MallocMessageBuilder message{kj::arrayPtr(inline_segment, inline_segment_words)};
     mir::capnp::Event::Builder event{message.initRoot<mir::capnp::Event>()};
 };
 
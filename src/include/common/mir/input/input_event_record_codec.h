@@ -0,0 +1,185 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_INPUT_INPUT_EVENT_RECORD_CODEC_H_
+#define MIR_INPUT_INPUT_EVENT_RECORD_CODEC_H_
+
+#include "mir/input/input_event_ring.h"
+#include "mir/events/event_builders.h"
+#include "mir/events/input_event.h"
+#include "mir/events/keyboard_event.h"
+#include "mir/events/pointer_event.h"
+#include "mir/events/touch_event.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+namespace mir
+{
+namespace input
+{
+namespace detail
+{
+template<size_t N>
+bool copy_blob(std::vector<uint8_t> const& from, uint8_t (&to)[N], uint32_t& size)
+{
+    if (from.size() > N)
+        return false;
+
+    std::copy(from.begin(), from.end(), to);
+    size = from.size();
+    return true;
+}
+}
+
+/// Encode event in the ring's fixed layout (server side), returning false if it doesn't fit
+inline bool encode_input_event(MirInputEvent const& event, InputEventRecord& record)
+{
+    memset(&record, 0, sizeof record);
+
+    record.input_type = event.input_type();
+    record.window_id = event.window_id();
+    record.device_id = event.device_id();
+    record.event_time_ns = event.event_time().count();
+    record.modifiers = event.modifiers();
+
+    if (!detail::copy_blob(event.cookie(), record.cookie, record.cookie_size))
+        return false;
+
+    switch (event.input_type())
+    {
+    case mir_input_event_type_key:
+    {
+        auto const key = event.to_keyboard();
+        auto const text = key->text();
+        if (text && strlen(text) >= sizeof record.text)
+            return false;
+        if (text)
+            strcpy(record.text, text);
+
+        record.action = key->action();
+        record.key_code = key->key_code();
+        record.scan_code = key->scan_code();
+        return true;
+    }
+
+    case mir_input_event_type_pointer:
+    {
+        auto const pointer = event.to_pointer();
+        if (pointer->dnd_handle())
+            return false;
+
+        record.action = pointer->action();
+        record.buttons = pointer->buttons();
+        record.x = pointer->x();
+        record.y = pointer->y();
+        record.dx = pointer->dx();
+        record.dy = pointer->dy();
+        record.vscroll = pointer->vscroll();
+        record.hscroll = pointer->hscroll();
+        return true;
+    }
+
+    case mir_input_event_type_touch:
+    {
+        auto const touch = event.to_touch();
+        auto const count = touch->pointer_count();
+        if (count > InputEventRecord::max_touches)
+            return false;
+
+        record.touch_count = count;
+        for (size_t i = 0; i != count; ++i)
+        {
+            auto& contact = record.touches[i];
+            contact.id = touch->id(i);
+            contact.action = touch->action(i);
+            contact.tool_type = touch->tool_type(i);
+            contact.x = touch->x(i);
+            contact.y = touch->y(i);
+            contact.pressure = touch->pressure(i);
+            contact.touch_major = touch->touch_major(i);
+            contact.touch_minor = touch->touch_minor(i);
+            // What mir_touch_event_axis_value() reports for mir_touch_axis_size
+            contact.size = std::max(contact.touch_major, contact.touch_minor);
+            contact.orientation = touch->orientation(i);
+        }
+        return true;
+    }
+
+    default:
+        return false;
+    }
+}
+
+/// Rebuild the event a record was encoded from (client side), or null for an unknown input type
+inline EventUPtr decode_input_event(InputEventRecord const& record)
+{
+    std::vector<uint8_t> const cookie{
+        record.cookie,
+        record.cookie + std::min<size_t>(record.cookie_size, InputEventRecord::max_cookie_size)};
+    std::chrono::nanoseconds const event_time{record.event_time_ns};
+    auto const modifiers = static_cast<MirInputEventModifiers>(record.modifiers);
+
+    EventUPtr event;
+
+    switch (record.input_type)
+    {
+    case mir_input_event_type_key:
+    {
+        event = events::make_event(record.device_id, event_time, cookie,
+            static_cast<MirKeyboardAction>(record.action), record.key_code, record.scan_code, modifiers);
+
+        char text[InputEventRecord::max_text_size + 1] = {};
+        memcpy(text, record.text, InputEventRecord::max_text_size);
+        event->to_input()->to_keyboard()->set_text(text);
+        break;
+    }
+
+    case mir_input_event_type_pointer:
+        event = events::make_event(record.device_id, event_time, cookie, modifiers,
+            static_cast<MirPointerAction>(record.action), record.buttons,
+            record.x, record.y, record.hscroll, record.vscroll, record.dx, record.dy);
+        break;
+
+    case mir_input_event_type_touch:
+    {
+        event = events::make_event(record.device_id, event_time, cookie, modifiers);
+
+        auto const count = std::min<size_t>(record.touch_count, InputEventRecord::max_touches);
+        for (size_t i = 0; i != count; ++i)
+        {
+            auto const& contact = record.touches[i];
+            events::add_touch(*event, contact.id, static_cast<MirTouchAction>(contact.action),
+                static_cast<MirTouchTooltype>(contact.tool_type), contact.x, contact.y,
+                contact.pressure, contact.touch_major, contact.touch_minor, contact.size);
+            event->to_input()->to_touch()->set_orientation(i, contact.orientation);
+        }
+        break;
+    }
+
+    default:
+        return nullptr;
+    }
+
+    events::set_window_id(*event, record.window_id);
+    return event;
+}
+}
+}
+
+#endif /* MIR_INPUT_INPUT_EVENT_RECORD_CODEC_H_ */
@@ -0,0 +1,225 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_INPUT_INPUT_EVENT_RING_H_
+#define MIR_INPUT_INPUT_EVENT_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include <boost/throw_exception.hpp>
+
+namespace mir
+{
+namespace input
+{
+/**
+ * The fixed layout in which input events are written to an InputEventRing.
+ *
+ * The layout is shared between server and client processes, so it only uses
+ * fixed-size types and must only ever be extended at the end (bumping
+ * InputEventRing::version).
+ */
+struct InputEventRecord
+{
+    static size_t const max_touches = 10;
+    static size_t const max_cookie_size = 32;
+    static size_t const max_text_size = 8;
+
+    struct Touch
+    {
+        int32_t id;
+        uint32_t action;
+        uint32_t tool_type;
+        float x;
+        float y;
+        float pressure;
+        float touch_major;
+        float touch_minor;
+        float orientation;
+        float size;
+    };
+
+    uint32_t input_type;        ///< MirInputEventType
+    int32_t window_id;
+    int64_t device_id;
+    int64_t event_time_ns;
+    uint32_t modifiers;
+    uint32_t action;            ///< MirKeyboardAction or MirPointerAction
+
+    /* keyboard */
+    int32_t key_code;
+    int32_t scan_code;
+    char text[max_text_size];
+
+    /* pointer */
+    uint32_t buttons;
+    float x;
+    float y;
+    float dx;
+    float dy;
+    float vscroll;
+    float hscroll;
+
+    /* touch */
+    uint32_t touch_count;
+    Touch touches[max_touches];
+
+    uint32_t cookie_size;
+    uint8_t cookie[max_cookie_size];
+};
+
+/**
+ * A single-producer, single-consumer ring of InputEventRecords living in
+ * memory shared between the server (producer) and a client (consumer).
+ *
+ * The socket is only needed as a doorbell: the consumer marks itself idle
+ * when it has drained the ring, and push() reports when the producer should
+ * wake it.
+ */
+class InputEventRing
+{
+public:
+    static uint32_t const magic = 0x4d495252; // "MIRR"
+    static uint32_t const version = 2;
+
+    /// The size of shared memory needed for a ring of capacity records (a power of two)
+    static size_t size_for(uint32_t capacity)
+    {
+        return sizeof(Header) + capacity * sizeof(InputEventRecord);
+    }
+
+    /// Lay out a new, empty ring in memory that is at least size_for(capacity) bytes
+    static void initialise(void* memory, uint32_t capacity)
+    {
+        if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+            BOOST_THROW_EXCEPTION(std::logic_error("InputEventRing capacity must be a power of two"));
+
+        auto const header = new (memory) Header;
+        header->magic = magic;
+        header->version = version;
+        header->capacity = capacity;
+        header->record_size = sizeof(InputEventRecord);
+        header->head.store(0, std::memory_order_relaxed);
+        header->tail.store(0, std::memory_order_relaxed);
+        header->consumer_idle.store(1, std::memory_order_release);
+    }
+
+    /// Attach to a ring previously laid out by initialise() in size bytes of memory
+    InputEventRing(void* memory, size_t size) :
+        header{static_cast<Header*>(memory)},
+        records{reinterpret_cast<InputEventRecord*>(static_cast<char*>(memory) + sizeof(Header))}
+    {
+        if (size < sizeof(Header) ||
+            header->magic != magic ||
+            header->version != version ||
+            header->record_size != sizeof(InputEventRecord) ||
+            size < size_for(header->capacity))
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("Invalid input event ring"));
+        }
+
+        mask = header->capacity - 1;
+    }
+
+    /**
+     * Producer: append a record.
+     *
+     * \param [out] wake_consumer   set if the consumer was idle and needs the doorbell rung
+     * \return                      false if the ring is full (the record is not written)
+     */
+    bool push(InputEventRecord const& record, bool& wake_consumer)
+    {
+        auto const head = header->head.load(std::memory_order_relaxed);
+        auto const tail = header->tail.load(std::memory_order_acquire);
+
+        if (head - tail > mask)
+        {
+            wake_consumer = header->consumer_idle.exchange(0, std::memory_order_acq_rel) != 0;
+            return false;
+        }
+
+        memcpy(&records[head & mask], &record, sizeof record);
+        header->head.store(head + 1, std::memory_order_release);
+
+        wake_consumer = header->consumer_idle.exchange(0, std::memory_order_acq_rel) != 0;
+        return true;
+    }
+
+    /**
+     * Consumer: hand every available record to handler, in order.
+     *
+     * On return the consumer is marked idle; a record published concurrently
+     * with that is either drained here or causes the producer to ring the
+     * doorbell.
+     */
+    template<typename Handler>
+    size_t drain(Handler&& handler)
+    {
+        size_t count{0};
+
+        for (;;)
+        {
+            auto tail = header->tail.load(std::memory_order_relaxed);
+            auto const head = header->head.load(std::memory_order_acquire);
+
+            for (; tail != head; ++tail, ++count)
+            {
+                InputEventRecord record;
+                memcpy(&record, &records[tail & mask], sizeof record);
+                header->tail.store(tail + 1, std::memory_order_release);
+                handler(record);
+            }
+
+            header->consumer_idle.store(1, std::memory_order_seq_cst);
+
+            if (header->head.load(std::memory_order_seq_cst) == tail)
+                return count;
+
+            header->consumer_idle.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    uint32_t capacity() const
+    {
+        return header->capacity;
+    }
+
+private:
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t capacity;
+        uint32_t record_size;
+
+        alignas(64) std::atomic<uint64_t> head;
+        alignas(64) std::atomic<uint64_t> tail;
+        alignas(64) std::atomic<uint32_t> consumer_idle;
+    };
+
+    Header* const header;
+    InputEventRecord* const records;
+    uint64_t mask;
+};
+}
+}
+
+#endif /* MIR_INPUT_INPUT_EVENT_RING_H_ */
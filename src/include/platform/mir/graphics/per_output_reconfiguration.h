@@ -0,0 +1,62 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_GRAPHICS_PER_OUTPUT_RECONFIGURATION_H_
+#define MIR_GRAPHICS_PER_OUTPUT_RECONFIGURATION_H_
+
+#include <functional>
+
+namespace mir
+{
+namespace graphics
+{
+class DisplayConfiguration;
+class DisplaySyncGroup;
+
+/**
+ * Implemented (on their NativeDisplay) by displays that can apply a
+ * configuration to only the outputs it changes. The sync groups of the
+ * other outputs are left as they are, so can keep being composited to.
+ */
+class PerOutputReconfiguration
+{
+public:
+    virtual ~PerOutputReconfiguration() = default;
+
+    /**
+     * Applies conf, replacing only the sync groups of outputs it adds,
+     * removes or changes.
+     *
+     * \param [in] retiring  Called with each sync group that is to be
+     *                       replaced, before it is. Nothing may be posted to
+     *                       the group once this returns.
+     * \param [in] added     Called with each sync group that replaces them,
+     *                       once conf is applied.
+     */
+    virtual void configure_changed_outputs(
+        DisplayConfiguration const& conf,
+        std::function<void(DisplaySyncGroup&)> const& retiring,
+        std::function<void(DisplaySyncGroup&)> const& added) = 0;
+
+protected:
+    PerOutputReconfiguration() = default;
+    PerOutputReconfiguration(PerOutputReconfiguration const&) = delete;
+    PerOutputReconfiguration& operator=(PerOutputReconfiguration const&) = delete;
+};
+}
+}
+
+#endif /* MIR_GRAPHICS_PER_OUTPUT_RECONFIGURATION_H_ */
@@ -42,6 +42,7 @@ extern char const* const legacy_input_report_opt;
 extern char const* const connector_report_opt;
 extern char const* const scene_report_opt;
 extern char const* const input_report_opt;
+extern char const* const input_latency_report_opt;
 extern char const* const seat_report_opt;
 extern char const* const host_socket_opt;
 extern char const* const nested_passthrough_opt;
@@ -54,6 +55,10 @@ extern char const* const enable_key_repeat_opt;
 extern char const* const x11_display_opt;
 extern char const* const wayland_extensions_opt;
 extern char const* const enable_mirclient_opt;
+extern char const* const snapshot_thumbnail_size_opt;
+extern char const* const renderer_opt;
+extern char const* const renderer_threads_opt;
+extern char const* const shader_cache_opt;
 
 extern char const* const name_opt;
 extern char const* const offscreen_opt;
@@ -63,10 +68,13 @@ extern char const* const enable_key_repeat_opt;
 extern char const* const off_opt_value;
 extern char const* const log_opt_value;
 extern char const* const lttng_opt_value;
+extern char const* const gl_renderer_opt_value;
+extern char const* const software_renderer_opt_value;
 
 extern char const* const platform_graphics_lib;
 extern char const* const platform_input_lib;
 extern char const* const platform_path;
+extern char const* const platform_probe_cache;
 
 extern char const* const console_provider;
 extern char const* const logind_console;
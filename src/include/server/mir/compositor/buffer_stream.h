@@ -47,6 +47,8 @@ public:
     virtual auto buffers_ready_for_compositor(void const* user_id) const -> int = 0;
     virtual void drop_old_buffers() = 0;
     virtual auto has_submitted_buffer() const -> bool = 0;
+    /// Incremented by each submit_buffer(); identifies the content of a (reused) buffer
+    virtual auto submission_count() const -> uint64_t = 0;
     virtual auto framedropping() const -> bool = 0;
 };
 
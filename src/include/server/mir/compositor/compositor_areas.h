@@ -0,0 +1,48 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_COMPOSITOR_COMPOSITOR_AREAS_H_
+#define MIR_COMPOSITOR_COMPOSITOR_AREAS_H_
+
+#include "mir/compositor/compositor_id.h"
+#include "mir/geometry/rectangle.h"
+
+namespace mir
+{
+namespace compositor
+{
+/**
+ * Implemented by scenes that can leave out of scene_elements_for() what
+ * can't appear in a compositor's area. Scenes that don't implement it give
+ * every compositor the whole scene.
+ */
+class CompositorAreas
+{
+public:
+    virtual ~CompositorAreas() = default;
+
+    /// Tell the scene the area a registered compositor shows (i.e. its output's view area)
+    virtual void set_compositor_area(CompositorID id, geometry::Rectangle const& area) = 0;
+
+protected:
+    CompositorAreas() = default;
+    CompositorAreas(CompositorAreas const&) = delete;
+    CompositorAreas& operator=(CompositorAreas const&) = delete;
+};
+}
+}
+
+#endif /* MIR_COMPOSITOR_COMPOSITOR_AREAS_H_ */
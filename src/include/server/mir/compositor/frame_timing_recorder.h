@@ -0,0 +1,172 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_COMPOSITOR_FRAME_TIMING_RECORDER_H_
+#define MIR_COMPOSITOR_FRAME_TIMING_RECORDER_H_
+
+#include "mir/graphics/renderable.h"
+#include "mir/time/types.h"
+
+#include <array>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mir
+{
+namespace time
+{
+class Clock;
+}
+namespace compositor
+{
+/// The parts of compositing a frame that are timed
+enum class FrameStage
+{
+    scene_snapshot,     ///< Collecting the scene elements to composite
+    occlusion,          ///< Filtering occluded elements
+    texture_binding,    ///< Uploading or binding client buffers (per surface)
+    gl_submission,      ///< Issuing draw calls and swapping (per surface, where attributable)
+    post,               ///< Posting the frame, excluding any wait for a page flip
+};
+
+char const* name_of(FrameStage stage);
+
+struct FrameTiming
+{
+    static size_t const stage_count = static_cast<size_t>(FrameStage::post) + 1;
+
+    uint64_t frame_number;
+    time::Timestamp started;
+    time::Timestamp presented;
+    /// The vblank the frame had to be posted by
+    time::Timestamp deadline;
+    std::array<time::Duration, stage_count> stage_time;
+
+    /// Set if the frame was posted after its deadline (i.e. missed a vblank)
+    bool missed_deadline;
+    /// For a missed deadline: the stage that took longest...
+    FrameStage blamed_stage;
+    /// ...and, if the stage is per surface, the surface that took longest in it (otherwise nullptr)
+    graphics::Renderable::ID blamed_surface;
+    time::Duration blamed_surface_time;
+};
+
+/**
+ * Records the timing of each frame composited for one output into a ring
+ * buffer of recent frames, attributing any missed deadline to the stage and
+ * surface responsible.
+ *
+ * Timing is driven from the compositing thread: begin_frame() and
+ * end_frame() bracket each frame; while a Scope is active, StageTimers
+ * created on the same thread (including within the renderer) record into
+ * the scoped recorder. history() and dump() may be called from any thread.
+ *
+ * A frame's deadline is the first vblank after it started, given the time
+ * of a recent vblank; without one it is a frame budget after the start.
+ */
+class FrameTimingRecorder
+{
+public:
+    typedef std::function<void(FrameTimingRecorder const& recorder, FrameTiming const& frame)> MissedDeadlineHandler;
+
+    FrameTimingRecorder(
+        std::shared_ptr<time::Clock> const& clock,
+        time::Duration frame_budget,
+        MissedDeadlineHandler const& on_missed_deadline,
+        size_t history_size = 120);
+
+    /// The recorder in scope on this thread, or nullptr
+    static FrameTimingRecorder* current();
+
+    /// Makes recorder the current() one on this thread for its lifetime
+    class Scope
+    {
+    public:
+        explicit Scope(FrameTimingRecorder* recorder);
+        ~Scope();
+
+    private:
+        Scope(Scope const&) = delete;
+        Scope& operator=(Scope const&) = delete;
+        FrameTimingRecorder* const previous;
+    };
+
+    /**
+     * Times its own lifetime as (part of) stage in the current() recorder, if
+     * any. Time spent in StageTimers nested within it is excluded.
+     */
+    class StageTimer
+    {
+    public:
+        explicit StageTimer(FrameStage stage, graphics::Renderable::ID surface = nullptr);
+        ~StageTimer();
+
+    private:
+        StageTimer(StageTimer const&) = delete;
+        StageTimer& operator=(StageTimer const&) = delete;
+        FrameTimingRecorder* const recorder;
+        FrameStage const stage;
+        graphics::Renderable::ID const surface;
+        time::Timestamp const start;
+    };
+
+    void begin_frame();
+    void record(FrameStage stage, time::Duration duration, graphics::Renderable::ID surface = nullptr);
+    /// last_vblank is the most recent page flip on the output, if known
+    void end_frame(time::Timestamp last_vblank = time::Timestamp{});
+
+    time::Timestamp now() const;
+    time::Duration frame_budget() const;
+
+    /// The recorded frames, oldest first
+    std::vector<FrameTiming> history() const;
+    uint64_t missed_deadlines() const;
+
+    void dump(std::ostream& out) const;
+
+private:
+    struct SurfaceTime
+    {
+        graphics::Renderable::ID surface;
+        FrameStage stage;
+        time::Duration time;
+    };
+
+    time::Timestamp deadline_for(time::Timestamp started, time::Timestamp last_vblank) const;
+    void attribute(FrameTiming& frame) const;
+
+    std::shared_ptr<time::Clock> const clock;
+    time::Duration const budget;
+    MissedDeadlineHandler const on_missed_deadline;
+
+    /* Only touched by the compositing thread */
+    FrameTiming in_progress;
+    std::vector<SurfaceTime> surface_times;
+    std::vector<time::Duration> nested_time;    ///< per open StageTimer
+    uint64_t frame_count;
+
+    std::mutex mutable history_mutex;
+    std::vector<FrameTiming> ring;
+    size_t next_slot;
+    uint64_t missed;
+};
+}
+}
+
+#endif /* MIR_COMPOSITOR_FRAME_TIMING_RECORDER_H_ */
@@ -0,0 +1,51 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_COMPOSITOR_SYNC_GROUP_COMPOSITOR_H_
+#define MIR_COMPOSITOR_SYNC_GROUP_COMPOSITOR_H_
+
+namespace mir
+{
+namespace graphics
+{
+class DisplaySyncGroup;
+}
+namespace compositor
+{
+/**
+ * Implemented by compositors that can stop and start compositing to one
+ * display sync group, while they keep compositing to the others.
+ */
+class SyncGroupCompositor
+{
+public:
+    virtual ~SyncGroupCompositor() = default;
+
+    /// Returns once nothing more will be composited to group (if anything was)
+    virtual void stop_compositing_to(graphics::DisplaySyncGroup& group) = 0;
+
+    /// Composites to a group the display has added, if the compositor is started
+    virtual void start_compositing_to(graphics::DisplaySyncGroup& group) = 0;
+
+protected:
+    SyncGroupCompositor() = default;
+    SyncGroupCompositor(SyncGroupCompositor const&) = delete;
+    SyncGroupCompositor& operator=(SyncGroupCompositor const&) = delete;
+};
+}
+}
+
+#endif /* MIR_COMPOSITOR_SYNC_GROUP_COMPOSITOR_H_ */
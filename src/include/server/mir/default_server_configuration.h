@@ -145,6 +145,8 @@ class TouchVisualizer;
 class CursorImages;
 class Seat;
 class KeyMapper;
+class InputLatencyStats;
+class KeyRepeatDispatcher;
 }
 
 namespace logging
@@ -161,6 +163,7 @@ class Configuration;
 namespace report
 {
 class ReportFactory;
+namespace logging { class InputLatencyReport; }
 }
 
 namespace renderer
@@ -258,6 +261,8 @@ public:
      * dependencies of compositor on the rest of the Mir
      *  @{ */
     virtual std::shared_ptr<graphics::GraphicBufferAllocator> the_buffer_allocator();
+    /// Recycles the software buffers the server draws for itself (cursors, decorations, touchspots)
+    virtual std::shared_ptr<graphics::GraphicBufferAllocator> the_recycling_buffer_allocator();
     virtual std::shared_ptr<compositor::Scene>                  the_scene();
     /** @} */
 
@@ -345,6 +350,8 @@ public:
     virtual std::shared_ptr<input::TouchVisualizer> the_touch_visualizer();
     virtual std::shared_ptr<input::Seat> the_seat();
     virtual std::shared_ptr<input::KeyMapper> the_key_mapper();
+    /// Per-stage input latency histograms, or nullptr if not enabled
+    virtual std::shared_ptr<input::InputLatencyStats> the_input_latency_stats();
 
     // new input reading related parts:
     virtual std::shared_ptr<dispatch::MultiplexingDispatchable> the_input_reading_multiplexer();
@@ -418,6 +425,7 @@ protected:
     CachedPtr<input::Seat> seat;
     CachedPtr<graphics::Platform>     graphics_platform;
     CachedPtr<graphics::GraphicBufferAllocator> buffer_allocator;
+    CachedPtr<graphics::GraphicBufferAllocator> recycling_buffer_allocator;
     CachedPtr<graphics::Display>      display;
     CachedPtr<graphics::Cursor>       cursor;
     CachedPtr<graphics::CursorImage>  default_cursor_image;
@@ -469,11 +477,15 @@ protected:
     CachedPtr<scene::ApplicationNotRespondingDetector> application_not_responding_detector;
     CachedPtr<cookie::Authority> cookie_authority;
     CachedPtr<input::KeyMapper> key_mapper;
+    CachedPtr<input::InputLatencyStats> input_latency_stats;
     std::shared_ptr<ConsoleServices> console_services;
 
 private:
     std::shared_ptr<options::Configuration> const configuration_options;
     std::shared_ptr<input::EventFilter> default_filter;
+    std::shared_ptr<report::logging::InputLatencyReport> input_latency_report;
+    // The repeater may be wrapped by a latency recorder, so keep it at hand for the input device hub
+    std::weak_ptr<input::KeyRepeatDispatcher> key_repeat_dispatcher;
     CachedPtr<ObserverMultiplexer<graphics::DisplayConfigurationObserver>>
         display_configuration_observer_multiplexer;
     CachedPtr<ObserverMultiplexer<input::SeatObserver>>
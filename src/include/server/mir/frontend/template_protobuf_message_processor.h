@@ -27,6 +27,7 @@
 #include "mir_protobuf.pb.h"
 
 #include <google/protobuf/stubs/common.h>
+#include <google/protobuf/arena.h>
 #include <boost/exception/diagnostic_information.hpp>
 
 #include <memory>
@@ -47,6 +48,8 @@ template<typename ResultType> struct result_ptr_t
 
 // Boiler plate for unpacking a parameter message, invoking a server function, and
 // sending the result message. Assumes the existence of Self::send_response().
+// The messages are allocated on arena, which the caller may Reset() once the
+// server function has returned.
 template<class Self, class Server, class ServerX, class ParameterMessage, class ResultMessage>
 void invoke(
     Self* self,
@@ -55,12 +58,13 @@ void invoke(
         ParameterMessage const* request,
         ResultMessage* response,
         ::google::protobuf::Closure* done),
-        Invocation const& invocation)
+        Invocation const& invocation,
+        ::google::protobuf::Arena* arena)
 {
-    ParameterMessage parameter_message;
-    if (!parameter_message.ParseFromString(invocation.parameters()))
+    auto const parameter_message = ::google::protobuf::Arena::CreateMessage<ParameterMessage>(arena);
+    if (!parameter_message->ParseFromString(invocation.parameters()))
         BOOST_THROW_EXCEPTION(std::runtime_error("Failed to parse message parameters!"));
-    ResultMessage result_message;
+    auto const result_message = ::google::protobuf::Arena::CreateMessage<ResultMessage>(arena);
 
     try
     {
@@ -72,11 +76,11 @@ void invoke(
                     self,
                     &Self::send_response,
                     invocation.id(),
-                    &result_message));
+                    result_message));
 
         (server->*function)(
-            &parameter_message,
-            &result_message,
+            parameter_message,
+            result_message,
             callback.get());
     }
     catch (mir::cookie::SecurityCheckError const& /*err*/)
@@ -85,17 +89,17 @@ void invoke(
     }
     catch (mir::ClientVisibleError const& error)
     {
-        auto client_error = result_message.mutable_structured_error();
+        auto client_error = result_message->mutable_structured_error();
         client_error->set_code(error.code());
         client_error->set_domain(error.domain());
-        self->send_response(invocation.id(), &result_message);
+        self->send_response(invocation.id(), result_message);
     }
     catch (std::exception const& x)
     {
         using namespace std::literals::string_literals;
-        result_message.set_error("Error processing request: "s +
+        result_message->set_error("Error processing request: "s +
             x.what() + "\nInternal error details: " + boost::diagnostic_information(x));
-        self->send_response(invocation.id(), &result_message);
+        self->send_response(invocation.id(), result_message);
     }
 }
 
@@ -20,9 +20,13 @@
 #define MIR_SCENE_SESSION_CONTAINER_H_
 
 #include <functional>
+#include <list>
 #include <vector>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
+
+#include <sys/types.h>
 
 namespace mir
 {
@@ -39,8 +43,13 @@ public:
     void insert_session(std::shared_ptr<Session> const& session);
     void remove_session(std::shared_ptr<Session> const& session);
 
+    /// Iterates over a snapshot of the sessions, without holding the container lock, so
+    /// f may insert or remove sessions (these changes are not seen by the iteration)
     void for_each(std::function<void(std::shared_ptr<Session> const&)> f) const;
 
+    /// The most recently inserted session for the process, or null if there is none
+    auto session_for_process(pid_t pid) const -> std::shared_ptr<Session>;
+
     // For convenience the successor of the null session is defined as the last session
     // which would be passed to the for_each callback
     auto successor_of(std::shared_ptr<Session> const&) const -> std::shared_ptr<Session> ;
@@ -50,7 +59,21 @@ public:
     SessionContainer& operator=(const SessionContainer&) = delete;
 
 private:
-    std::vector<std::shared_ptr<Session>> apps;
+    using Sessions = std::list<std::shared_ptr<Session>>;
+    using Snapshot = std::vector<std::shared_ptr<Session>>;
+
+    auto position_of(std::shared_ptr<Session> const& session) const -> Sessions::const_iterator;
+
+    struct Entry
+    {
+        Sessions::iterator position;
+        pid_t pid;
+    };
+
+    Sessions apps;  ///< In insertion order
+    std::unordered_map<Session const*, Entry> index;
+    std::unordered_map<pid_t, std::vector<Session const*>> by_process;  ///< In insertion order
+    std::shared_ptr<Snapshot const> mutable snapshot;  ///< Reset when apps changes
     mutable std::mutex guard;
 };
 
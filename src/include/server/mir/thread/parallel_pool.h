@@ -0,0 +1,77 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_THREAD_PARALLEL_POOL_H_
+#define MIR_THREAD_PARALLEL_POOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mir
+{
+namespace thread
+{
+
+/**
+ * Helper threads that share out the iterations of loops run through for_each()
+ *
+ * Loops may be run from several threads at once (e.g. the compositor
+ * threads of different outputs); the helpers work on whichever have
+ * iterations left.
+ */
+class ParallelPool
+{
+public:
+    explicit ParallelPool(unsigned helpers);
+    ~ParallelPool();
+
+    /**
+     * Calls work(i) for each i in [0, count) on the calling thread and any
+     * free helpers, returning once every call has returned.
+     *
+     * Each thread claims the next unclaimed i as it becomes free, so uneven
+     * iterations balance out. If calls throw, the first exception is
+     * rethrown once the rest have finished.
+     */
+    void for_each(size_t count, std::function<void(size_t)> const& work);
+
+    auto helper_count() const -> unsigned;
+
+private:
+    ParallelPool(ParallelPool const&) = delete;
+    ParallelPool& operator=(ParallelPool const&) = delete;
+
+    struct Loop;
+    void help();
+    void work_through(Loop& loop);
+
+    std::mutex mutex;
+    std::condition_variable loops_available;
+    std::condition_variable loop_finished;
+    std::list<Loop*> loops;     ///< Loops that may have unclaimed iterations
+    bool stopping{false};
+
+    std::vector<std::thread> helpers;
+};
+
+}
+}
+
+#endif
@@ -91,13 +91,13 @@ miral::BasicWindowManager::~BasicWindowManager()
 void miral::BasicWindowManager::add_session(std::shared_ptr<scene::Session> const& session)
 {
     Locker lock{this};
-    policy->advise_new_app(app_info[session] = ApplicationInfo(session));
+    policy->advise_new_app(app_info[session.get()] = ApplicationInfo(session));
 }
 
 void miral::BasicWindowManager::remove_session(std::shared_ptr<scene::Session> const& session)
 {
     Locker lock{this};
-    auto info = app_info.find(session);
+    auto info = app_info.find(session.get());
     if (info == app_info.end())
     {
         log_debug(
@@ -107,7 +107,7 @@ void miral::BasicWindowManager::remove_session(std::shared_ptr<scene::Session> c
         return;
     }
     policy->advise_delete_app(info->second);
-    app_info.erase(session);
+    app_info.erase(info);
 }
 
 auto miral::BasicWindowManager::add_surface(
@@ -118,25 +118,43 @@ auto miral::BasicWindowManager::add_surface(
         scene::SurfaceCreationParameters const& params)> const& build)
 -> std::shared_ptr<scene::Surface>
 {
-    Locker lock{this};
+    WindowSpecification spec;
+    scene::SurfaceCreationParameters parameters;
+    bool placed_with_parent{false};
+    {
+        Locker lock{this};
 
-    auto& session_info = info_for(session);
+        spec = policy->place_new_window(info_for(session), place_new_surface(params));
+        placed_with_parent = spec.parent().is_set() && find_window(spec.parent().value()) != this->window_info.end();
 
-    WindowSpecification spec = policy->place_new_window(session_info, place_new_surface(params));
+        if (!spec.depth_layer().is_set() && spec.parent().is_set())
+            if (auto parent_surface = spec.parent().value().lock())
+                spec.depth_layer() = parent_surface->depth_layer();
 
-    if (!spec.depth_layer().is_set() && spec.parent().is_set())
-        if (auto parent_surface = spec.parent().value().lock())
-            spec.depth_layer() = parent_surface->depth_layer();
+        spec.update(parameters);
+    }
 
-    scene::SurfaceCreationParameters parameters;
-    spec.update(parameters);
+    // Building the surface (and adding it to the scene) takes a while: don't hold up input handling meanwhile
     auto const surface = build(session, parameters);
+
+    Locker lock{this};
+
+    if (app_info.find(session.get()) == app_info.end())
+    {
+        // The session was removed while we built the surface: it will take the surface with it
+        return surface;
+    }
+
+    auto& session_info = info_for(session);
     Window const window{session, surface};
-    auto& window_info = this->window_info.emplace(window, WindowInfo{window, spec}).first->second;
+    auto& window_info = this->window_info.emplace(surface.get(), WindowInfo{window, spec}).first->second;
 
-    if (spec.parent().is_set() && spec.parent().value().lock())
+    if (spec.parent().is_set() && find_window(spec.parent().value()) != this->window_info.end())
         window_info.parent(info_for(spec.parent().value()).window());
 
+    // The parent was removed while we built the surface, which was placed relative to it
+    bool const orphaned{placed_with_parent && !window_info.parent()};
+
     if (spec.userdata().is_set())
         window_info.userdata() = spec.userdata().value();
 
@@ -153,7 +171,7 @@ auto miral::BasicWindowManager::add_surface(
     update_attached_and_fullscreen_sets(window_info, window_info.state());
 
     if (window_info.state() == mir_window_state_attached)
-        update_windows_for_outputs();
+        update_windows_for_area(display_area_for(window_info));
 
     policy->advise_new_window(window_info);
 
@@ -171,6 +189,9 @@ auto miral::BasicWindowManager::add_surface(
         mir_surface->placed_relative(relative_placement);
     }
 
+    if (orphaned)
+        ask_client_to_close(window);
+
     return surface;
 }
 
@@ -196,7 +217,7 @@ void miral::BasicWindowManager::remove_surface(
     std::weak_ptr<scene::Surface> const& surface)
 {
     Locker lock{this};
-    if (app_info.find(session) == app_info.end())
+    if (app_info.find(session.get()) == app_info.end())
     {
         log_debug(
             "BasicWindowManager::remove_surface() called with unknown or already removed session %s (PID: %d)",
@@ -232,12 +253,18 @@ void miral::BasicWindowManager::remove_window(Application const& application, mi
     info_for(application).remove_window(info.window());
     mru_active_windows.erase(info.window());
     fullscreen_surfaces.erase(info.window());
-    for (auto& area : display_areas)
-        area->attached_windows.erase(info.window());
-    if (info.state() == mir_window_state_attached &&
-        info.exclusive_rect().is_set())
+    auto const attached = attached_window_areas.find(info.window());
+    if (attached != attached_window_areas.end())
     {
-        update_windows_for_outputs();
+        auto const area = attached->second;
+        area->attached_windows.erase(info.window());
+        attached_window_areas.erase(attached);
+
+        if (info.state() == mir_window_state_attached &&
+            info.exclusive_rect().is_set())
+        {
+            update_windows_for_area(area);
+        }
     }
 
     application->destroy_surface(info.window());
@@ -318,7 +345,9 @@ void miral::BasicWindowManager::erase(miral::WindowInfo const& info)
     for (auto& child : info.children())
         info_for(child).parent({});
 
-    window_info.erase(info.window());
+    auto const found = find_window(info.window());
+    if (found != window_info.end())
+        window_info.erase(found);
 }
 
 #pragma GCC diagnostic push
@@ -506,7 +535,7 @@ auto miral::BasicWindowManager::find_application(std::function<bool(ApplicationI
     {
         if (predicate(info.second))
         {
-            return Application{info.first};
+            return info.second.application();
         }
     }
 
@@ -516,13 +545,32 @@ auto miral::BasicWindowManager::find_application(std::function<bool(ApplicationI
 auto miral::BasicWindowManager::info_for(std::weak_ptr<scene::Session> const& session) const
 -> ApplicationInfo&
 {
-    return const_cast<ApplicationInfo&>(app_info.at(session));
+    return const_cast<ApplicationInfo&>(app_info.at(session.lock().get()));
 }
 
 auto miral::BasicWindowManager::info_for(std::weak_ptr<scene::Surface> const& surface) const
 -> WindowInfo&
 {
-    return const_cast<WindowInfo&>(window_info.at(surface));
+    auto const found = find_window(surface);
+
+    if (found == window_info.end())
+        BOOST_THROW_EXCEPTION(std::out_of_range{"Unknown window"});
+
+    return const_cast<WindowInfo&>(found->second);
+}
+
+auto miral::BasicWindowManager::find_window(std::weak_ptr<scene::Surface> const& surface) const
+-> SurfaceInfoMap::const_iterator
+{
+    if (auto const shared = surface.lock())
+        return window_info.find(shared.get());
+
+    // A surface may expire before it is removed, so then look for it by ownership
+    return std::find_if(window_info.begin(), window_info.end(), [&](SurfaceInfoMap::value_type const& entry)
+        {
+            std::weak_ptr<scene::Surface> const registered = entry.second.window();
+            return !surface.owner_before(registered) && !registered.owner_before(surface);
+        });
 }
 
 auto miral::BasicWindowManager::info_for(Window const& window) const
@@ -699,23 +747,13 @@ auto miral::BasicWindowManager::display_area_for(WindowInfo const& info) const -
 
     if (info.has_output_id())
     {
-        for (auto const& area : display_areas)
-        {
-            if (area->output && area->output->id() == info.output_id())
-            {
-                return area;
-            }
-        }
+        if (auto const area = display_area_for_output_id(info.output_id()))
+            return area;
     }
 
-    for (auto& area : display_areas)
-    {
-        for (auto& area_window : area->attached_windows)
-        {
-            if (area_window == window)
-                return area;
-        }
-    }
+    auto const attached = attached_window_areas.find(window);
+    if (attached != attached_window_areas.end())
+        return attached->second;
 
     // If the window is not explicity attached to any area, find the area it overlaps most with
     Rectangle window_rect{window.top_left(), window.size()};
@@ -756,6 +794,12 @@ auto miral::BasicWindowManager::display_area_for(WindowInfo const& info) const -
         return std::make_shared<DisplayArea>(window_rect);
 }
 
+auto miral::BasicWindowManager::display_area_for_output_id(int output_id) const -> std::shared_ptr<DisplayArea>
+{
+    auto const area = output_display_areas.find(output_id);
+    return area != output_display_areas.end() ? area->second : nullptr;
+}
+
 void miral::BasicWindowManager::focus_next_within_application()
 {
     if (auto const prev = active_window())
@@ -873,8 +917,11 @@ void miral::BasicWindowManager::focus_prev_within_application()
 auto miral::BasicWindowManager::window_at(geometry::Point cursor) const
 -> Window
 {
-    auto surface_at = focus_controller->surface_at(cursor);
-    return surface_at ? info_for(surface_at).window() : Window{};
+    auto const surface_at = focus_controller->surface_at(cursor);
+    auto const info = surface_at ? window_info.find(surface_at.get()) : window_info.end();
+
+    // A surface is in the scene before add_surface() has finished registering it
+    return info != window_info.end() ? info->second.window() : Window{};
 }
 
 auto miral::BasicWindowManager::active_output() -> geometry::Rectangle const
@@ -1030,6 +1077,10 @@ void miral::BasicWindowManager::modify_window(WindowInfo& window_info, WindowSpe
         }
     }
 
+    // The area the window leaves may need its application zone updated as well as the one it joins
+    std::shared_ptr<DisplayArea> const previous_area =
+        application_zones_need_update || modifications.output_id().is_set() ? display_area_for(window_info) : nullptr;
+
     std::swap(window_info_tmp, window_info);
 
     auto& window = window_info.window();
@@ -1146,7 +1197,13 @@ void miral::BasicWindowManager::modify_window(WindowInfo& window_info, WindowSpe
 
     if (application_zones_need_update)
     {
-        update_windows_for_outputs();
+        auto const area = display_area_for(window_info);
+        update_windows_for_area(area);
+        if (previous_area != area)
+            update_windows_for_area(previous_area);
+
+        if (window_info.state() == mir_window_state_fullscreen)
+            update_fullscreen_windows();
     }
 
     if (modifications.confine_pointer().is_set())
@@ -1366,11 +1423,14 @@ void miral::BasicWindowManager::place_and_size_for_state(
 void miral::BasicWindowManager::update_attached_and_fullscreen_sets(WindowInfo& window_info, MirWindowState state)
 {
     auto const window = window_info.window();
-    auto const area = display_area_for(window_info);
 
     fullscreen_surfaces.erase(window);
-    for (auto& area : display_areas)
-        area->attached_windows.erase(window);
+    auto const attached = attached_window_areas.find(window);
+    if (attached != attached_window_areas.end())
+    {
+        attached->second->attached_windows.erase(window);
+        attached_window_areas.erase(attached);
+    }
 
     switch (state)
     {
@@ -1383,8 +1443,13 @@ void miral::BasicWindowManager::update_attached_and_fullscreen_sets(WindowInfo&
     case mir_window_state_horizmaximized:
     case mir_window_state_attached:
     {
+        // With no outputs there's nowhere to attach to (and nothing to reflow)
+        if (display_areas.empty())
+            break;
+
         auto area = display_area_for(window_info);
         area->attached_windows.insert(window);
+        attached_window_areas[window] = area;
         break;
     }
 
@@ -1658,7 +1723,7 @@ auto miral::BasicWindowManager::surface_known(
     std::weak_ptr<scene::Surface> const& surface,
     std::string const& action) -> bool
 {
-    if (window_info.find(surface) != window_info.end())
+    if (find_window(surface) != window_info.end())
     {
         return true;
     }
@@ -1684,11 +1749,11 @@ auto miral::BasicWindowManager::can_activate_window_for_session(miral::Applicati
 {
     miral::Window new_focus;
 
-    mru_active_windows.enumerate([&](miral::Window& window)
+    mru_active_windows.enumerate(session, [&](miral::Window& window)
         {
             // select_active_window() calls set_focus_to() which updates mru_active_windows and changes window
             auto const w = window;
-            return w.application() != session || !(new_focus = select_active_window(w));
+            return !(new_focus = select_active_window(w));
         });
 
     return new_focus;
@@ -1700,14 +1765,11 @@ auto miral::BasicWindowManager::can_activate_window_for_session_in_workspace(
 {
     miral::Window new_focus;
 
-    mru_active_windows.enumerate([&](miral::Window& window)
+    mru_active_windows.enumerate(session, [&](miral::Window& window)
         {
             // select_active_window() calls set_focus_to() which updates mru_active_windows and changes window
             auto const w = window;
 
-            if (w.application() != session)
-                return true;
-
             for (auto const& workspace : workspaces_containing(w))
             {
                 for (auto const& ww : workspaces)
@@ -1733,16 +1795,7 @@ auto miral::BasicWindowManager::place_new_surface(WindowSpecification parameters
 
     std::shared_ptr<DisplayArea> display_area;
     if (parameters.output_id().is_set())
-    {
-        for (auto const& area : display_areas)
-        {
-            if (area->output && area->output->id() == parameters.output_id())
-            {
-                display_area = area;
-                break;
-            }
-        }
-    }
+        display_area = display_area_for_output_id(parameters.output_id().value());
     if (!display_area)
         display_area = active_display_area();
 
@@ -2484,8 +2537,11 @@ void miral::BasicWindowManager::advise_output_create(miral::Output const& output
 
     auto area = std::make_shared<DisplayArea>(output);
     display_areas.push_back(area);
+    output_display_areas[output.id()] = area;
 
-    update_windows_for_outputs();
+    // Only fullscreen windows can be affected by a new output: attached windows stay on their areas
+    update_fullscreen_windows();
+    update_windows_for_area(area);
     policy->advise_output_create(output);
     policy_application_zone_addendum->advise_application_zone_create(area->application_zone);
 }
@@ -2497,16 +2553,24 @@ void miral::BasicWindowManager::advise_output_update(miral::Output const& update
     outputs.remove(original.extents());
     outputs.add(updated.extents());
 
+    std::vector<std::shared_ptr<DisplayArea>> updated_areas;
     for (auto& area : display_areas)
     {
         if (area->output && area->output.value().is_same_output(original))
         {
             area->output = updated;
             area->area = updated.extents();
+            updated_areas.push_back(area);
         }
     }
 
-    update_windows_for_outputs();
+    output_display_areas.erase(original.id());
+    for (auto const& area : updated_areas)
+        output_display_areas[updated.id()] = area;
+
+    update_fullscreen_windows();
+    for (auto const& area : updated_areas)
+        update_windows_for_area(area);
     policy->advise_output_update(updated, original);
 }
 
@@ -2531,23 +2595,33 @@ void miral::BasicWindowManager::advise_output_delete(miral::Output const& output
         display_areas.end());
 
     outputs.remove(output.extents());
+    output_display_areas.erase(output.id());
 
+    // Reattach the orphaned windows, and reflow only the areas they land on
+    std::set<std::shared_ptr<DisplayArea>> affected_areas;
     for (auto const& area : removed_areas)
     {
-        for (auto const& window : area->attached_windows)
+        auto const orphans = area->attached_windows;
+        for (auto const& window : orphans)
         {
-            auto info{info_for(window)};
+            auto& info = info_for(window);
             update_attached_and_fullscreen_sets(info, info.state());
+
+            auto const attached = attached_window_areas.find(window);
+            if (attached != attached_window_areas.end())
+                affected_areas.insert(attached->second);
         }
     }
 
-    update_windows_for_outputs();
+    update_fullscreen_windows();
+    for (auto const& area : affected_areas)
+        update_windows_for_area(area);
     for (auto& area : removed_areas)
         policy_application_zone_addendum->advise_application_zone_delete(area->application_zone);
     policy->advise_output_delete(output);
 }
 
-void miral::BasicWindowManager::update_windows_for_outputs()
+void miral::BasicWindowManager::update_fullscreen_windows()
 {
     for (auto const& window : fullscreen_surfaces)
     {
@@ -2559,56 +2633,60 @@ void miral::BasicWindowManager::update_windows_for_outputs()
             place_and_size(info, rect.top_left, rect.size);
         }
     }
+}
 
-    for (auto& area : display_areas)
-    {
-        Rectangle zone_rect = area->area;
-
-        /// The first pass will modify the application zone as it goes
-        /// The second pass will use the final application zone
-        std::vector<WindowInfo*> first_pass;
-        std::vector<WindowInfo*> second_pass;
+void miral::BasicWindowManager::update_windows_for_area(std::shared_ptr<DisplayArea> const& area)
+{
+    // Ignore the temporary areas made up for windows that are not on any output
+    if (std::find(display_areas.begin(), display_areas.end(), area) == display_areas.end())
+        return;
 
-        for (auto const& window : area->attached_windows)
-        {
-            if (window)
-            {
-                auto& info = info_for(window);
+    Rectangle zone_rect = area->area;
 
-                if (info.state() == mir_window_state_attached && info.exclusive_rect().is_set())
-                    first_pass.push_back(&info);
-                else
-                    second_pass.push_back(&info);
-            }
-        }
+    /// The first pass will modify the application zone as it goes
+    /// The second pass will use the final application zone
+    std::vector<WindowInfo*> first_pass;
+    std::vector<WindowInfo*> second_pass;
 
-        for (auto info_ptr : first_pass)
+    for (auto const& window : area->attached_windows)
+    {
+        if (window)
         {
-            place_attached_to_zone(*info_ptr, zone_rect, area->area);
+            auto& info = info_for(window);
 
-            auto& info = *info_ptr;
             if (info.state() == mir_window_state_attached && info.exclusive_rect().is_set())
-            {
-                auto edges = info.attached_edges();
-                Rectangle exclusive_rect{
-                    info.exclusive_rect().value().top_left + as_displacement(info.window().top_left()),
-                    info.exclusive_rect().value().size};
-
-                zone_rect = apply_exclusive_rect_to_application_zone(zone_rect, exclusive_rect, edges);
-            }
+                first_pass.push_back(&info);
+            else
+                second_pass.push_back(&info);
         }
+    }
 
-        for (auto info_ptr : second_pass)
-        {
-            place_attached_to_zone(*info_ptr, zone_rect, area->area);
-        }
+    for (auto info_ptr : first_pass)
+    {
+        place_attached_to_zone(*info_ptr, zone_rect, area->area);
 
-        Zone new_zone{area->application_zone};
-        new_zone.extents(zone_rect);
-        if (!(new_zone == area->application_zone))
+        auto& info = *info_ptr;
+        if (info.state() == mir_window_state_attached && info.exclusive_rect().is_set())
         {
-            policy_application_zone_addendum->advise_application_zone_update(new_zone, area->application_zone);
-            area->application_zone = new_zone;
+            auto edges = info.attached_edges();
+            Rectangle exclusive_rect{
+                info.exclusive_rect().value().top_left + as_displacement(info.window().top_left()),
+                info.exclusive_rect().value().size};
+
+            zone_rect = apply_exclusive_rect_to_application_zone(zone_rect, exclusive_rect, edges);
         }
     }
+
+    for (auto info_ptr : second_pass)
+    {
+        place_attached_to_zone(*info_ptr, zone_rect, area->area);
+    }
+
+    Zone new_zone{area->application_zone};
+    new_zone.extents(zone_rect);
+    if (!(new_zone == area->application_zone))
+    {
+        policy_application_zone_addendum->advise_application_zone_update(new_zone, area->application_zone);
+        area->application_zone = new_zone;
+    }
 }
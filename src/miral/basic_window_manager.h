@@ -41,6 +41,7 @@
 
 #include <map>
 #include <mutex>
+#include <unordered_map>
 
 namespace mir
 {
@@ -218,8 +219,9 @@ private:
         std::set<Window> attached_windows; ///< Maximized/anchored/etc windows attached to this area
     };
 
-    using SurfaceInfoMap = std::map<std::weak_ptr<mir::scene::Surface>, WindowInfo, std::owner_less<std::weak_ptr<mir::scene::Surface>>>;
-    using SessionInfoMap = std::map<std::weak_ptr<mir::scene::Session>, ApplicationInfo, std::owner_less<std::weak_ptr<mir::scene::Session>>>;
+    // Keyed by the (stable) addresses of the surfaces and sessions: entries are removed before these die
+    using SurfaceInfoMap = std::unordered_map<mir::scene::Surface const*, WindowInfo>;
+    using SessionInfoMap = std::unordered_map<mir::scene::Session const*, ApplicationInfo>;
 
     mir::shell::FocusController* const focus_controller;
     std::shared_ptr<mir::shell::DisplayLayout> const display_layout;
@@ -248,6 +250,9 @@ private:
     bool allow_active_window = true;
     std::set<Window> fullscreen_surfaces;
     std::vector<std::shared_ptr<DisplayArea>> display_areas; ///< For now these will map 1:1 to outputs, but this should not be assumed
+    /// Indexes of display_areas and their attached_windows, so placement needn't scan every area and window
+    std::map<int, std::shared_ptr<DisplayArea>> output_display_areas;
+    std::map<Window, std::shared_ptr<DisplayArea>> attached_window_areas;
 
     friend class Workspace;
     using wwbimap_t = boost::bimap<
@@ -266,6 +271,7 @@ private:
     void update_event_timestamp(MirInputEvent const* iev);
 
     auto surface_known(std::weak_ptr<mir::scene::Surface> const& surface, std::string const& action) -> bool;
+    auto find_window(std::weak_ptr<mir::scene::Surface> const& surface) const -> SurfaceInfoMap::const_iterator;
 
     auto can_activate_window_for_session(miral::Application const& session) -> bool;
     auto can_activate_window_for_session_in_workspace(
@@ -293,6 +299,7 @@ private:
     auto workspaces_containing(Window const& window) const -> std::vector<std::shared_ptr<Workspace>>;
     auto active_display_area() const -> std::shared_ptr<DisplayArea>;
     auto display_area_for(WindowInfo const& info) const -> std::shared_ptr<DisplayArea>;
+    auto display_area_for_output_id(int output_id) const -> std::shared_ptr<DisplayArea>;
     /// Returns the application zone area after shrinking it for the exclusive zone if needed
     static auto apply_exclusive_rect_to_application_zone(
         mir::geometry::Rectangle const& original_zone,
@@ -302,7 +309,9 @@ private:
     void advise_output_create(Output const& output) override;
     void advise_output_update(Output const& updated, Output const& original) override;
     void advise_output_delete(Output const& output) override;
-    void update_windows_for_outputs();
+    void update_fullscreen_windows();
+    /// Reflows the windows attached to area and updates its application zone
+    void update_windows_for_area(std::shared_ptr<DisplayArea> const& area);
 };
 }
 
@@ -18,6 +18,7 @@
 
 #include "mru_window_list.h"
 
+#include <mir/scene/session.h>
 #include <mir/scene/surface.h>
 
 #include <algorithm>
@@ -29,29 +30,86 @@ bool visible(miral::Window const& window)
     std::shared_ptr<mir::scene::Surface> const& surface{window};
     return surface->state() != mir_window_state_hidden;
 }
+
+void enumerate_visible(std::list<miral::Window> const& windows, miral::MRUWindowList::Enumerator const& enumerator)
+{
+    // The enumerator may push() a window, which moves it to the front but keeps our iterators valid
+    for (auto i = windows.begin(); i != windows.end();)
+    {
+        auto& window = const_cast<miral::Window&>(*i++);
+        if (visible(window))
+            if (!enumerator(window))
+                break;
+    }
+}
+}
+
+auto miral::MRUWindowList::find(Window const& window) -> decltype(index)::iterator
+{
+    if (std::shared_ptr<mir::scene::Surface> const surface{window})
+        return index.find(surface.get());
+
+    // Once the surface has gone we can't look it up by address
+    return std::find_if(index.begin(), index.end(), [&](decltype(index)::value_type const& entry)
+        { return *entry.second.in_all == window; });
 }
 
 void miral::MRUWindowList::push(Window const& window)
 {
-    windows.erase(remove(begin(windows), end(windows), window), end(windows));
-    windows.push_back(window);
+    auto const existing = find(window);
+
+    if (existing != index.end())
+    {
+        auto& entry = existing->second;
+        windows.splice(windows.begin(), windows, entry.in_all);
+
+        auto& same_application = application_windows[entry.application];
+        same_application.splice(same_application.begin(), same_application, entry.in_application);
+        return;
+    }
+
+    std::shared_ptr<mir::scene::Surface> const surface{window};
+    auto const application = window.application().get();
+    auto& same_application = application_windows[application];
+
+    windows.push_front(window);
+    same_application.push_front(window);
+    index[surface.get()] = Entry{windows.begin(), same_application.begin(), application};
 }
 
 void miral::MRUWindowList::erase(Window const& window)
 {
-    windows.erase(remove(begin(windows), end(windows), window), end(windows));
+    auto const existing = find(window);
+
+    if (existing == index.end())
+        return;
+
+    auto const& entry = existing->second;
+    auto const same_application = application_windows.find(entry.application);
+
+    windows.erase(entry.in_all);
+    same_application->second.erase(entry.in_application);
+    if (same_application->second.empty())
+        application_windows.erase(same_application);
+
+    index.erase(existing);
 }
 
 auto miral::MRUWindowList::top() const -> Window
 {
-    auto const& found = std::find_if(rbegin(windows), rend(windows), visible);
-    return (found != rend(windows)) ? *found: Window{};
+    auto const& found = std::find_if(begin(windows), end(windows), visible);
+    return (found != end(windows)) ? *found: Window{};
 }
 
 void miral::MRUWindowList::enumerate(Enumerator const& enumerator) const
 {
-    for (auto i = windows.rbegin(); i != windows.rend(); ++i)
-        if (visible(*i))
-            if (!enumerator(const_cast<Window&>(*i)))
-                break;
+    enumerate_visible(windows, enumerator);
+}
+
+void miral::MRUWindowList::enumerate(Application const& application, Enumerator const& enumerator) const
+{
+    auto const same_application = application_windows.find(application.get());
+
+    if (same_application != application_windows.end())
+        enumerate_visible(same_application->second, enumerator);
 }
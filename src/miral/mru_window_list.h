@@ -19,13 +19,18 @@
 #ifndef MIRAL_MRU_WINDOW_LIST_H
 #define MIRAL_MRU_WINDOW_LIST_H
 
+#include <miral/application.h>
 #include <miral/window.h>
 
 #include <functional>
-#include <vector>
+#include <list>
+#include <unordered_map>
+
+namespace mir { namespace scene { class Session; class Surface; } }
 
 namespace miral
 {
+/// The windows, most recently pushed first, with an index so that push() and erase() take constant time
 class MRUWindowList
 {
 public:
@@ -38,8 +43,24 @@ public:
 
     void enumerate(Enumerator const& enumerator) const;
 
+    /// Enumerates just the windows of application, without visiting those of other applications
+    void enumerate(Application const& application, Enumerator const& enumerator) const;
+
 private:
-    std::vector<Window> windows;
+    using Windows = std::list<Window>;
+
+    struct Entry
+    {
+        Windows::iterator in_all;
+        Windows::iterator in_application;
+        mir::scene::Session const* application;
+    };
+
+    auto find(Window const& window) -> std::unordered_map<mir::scene::Surface const*, Entry>::iterator;
+
+    Windows windows;
+    std::unordered_map<mir::scene::Session const*, Windows> application_windows;
+    std::unordered_map<mir::scene::Surface const*, Entry> index;    ///< by the window's surface
 };
 }
 
@@ -39,6 +39,7 @@ char const* const mo::legacy_input_report_opt     = "legacy-input-report";
 char const* const mo::connector_report_opt        = "connector-report";
 char const* const mo::scene_report_opt            = "scene-report";
 char const* const mo::input_report_opt            = "input-report";
+char const* const mo::input_latency_report_opt    = "input-latency-report";
 char const* const mo::seat_report_opt            = "seat-report";
 char const* const mo::shared_library_prober_report_opt = "shared-library-prober-report";
 char const* const mo::shell_report_opt            = "shell-report";
@@ -55,14 +56,21 @@ char const* const mo::enable_key_repeat_opt       = "enable-key-repeat";
 char const* const mo::x11_display_opt             = "enable-x11";
 char const* const mo::wayland_extensions_opt      = "wayland-extensions";
 char const* const mo::enable_mirclient_opt        = "enable-mirclient";
+char const* const mo::snapshot_thumbnail_size_opt = "snapshot-thumbnail-size";
+char const* const mo::renderer_opt                = "renderer";
+char const* const mo::renderer_threads_opt        = "renderer-threads";
+char const* const mo::shader_cache_opt            = "shader-cache";
 
 char const* const mo::off_opt_value = "off";
 char const* const mo::log_opt_value = "log";
 char const* const mo::lttng_opt_value = "lttng";
+char const* const mo::gl_renderer_opt_value = "gl";
+char const* const mo::software_renderer_opt_value = "software";
 
 char const* const mo::platform_graphics_lib = "platform-graphics-lib";
 char const* const mo::platform_input_lib = "platform-input-lib";
 char const* const mo::platform_path = "platform-path";
+char const* const mo::platform_probe_cache = "platform-probe-cache";
 
 char const* const mo::console_provider = "console-provider";
 char const* const mo::logind_console = "logind";
@@ -162,6 +170,9 @@ mo::DefaultConfiguration::DefaultConfiguration(
             "Library to use for platform input support (default: input-stub.so)")
         (platform_path, po::value<std::string>()->default_value(MIR_SERVER_PLATFORM_PATH),
             "Directory to look for platform libraries (default: " MIR_SERVER_PLATFORM_PATH ")")
+        (platform_probe_cache, po::value<std::string>(),
+            "File in which to remember graphics platform probe results between runs,"
+            " so that unchanged platforms need not be probed at startup (default: probe every time)")
         (enable_input_opt, po::value<bool>()->default_value(enable_input_default),
             "Enable input.")
         (compositor_report_opt, po::value<std::string>()->default_value(off_opt_value),
@@ -172,6 +183,8 @@ mo::DefaultConfiguration::DefaultConfiguration(
             "How to handle the Display report. [{log,lttng,off}]")
         (input_report_opt, po::value<std::string>()->default_value(off_opt_value),
             "How to handle to Input report. [{log,lttng,off}]")
+        (input_latency_report_opt, po::value<std::string>()->default_value(off_opt_value),
+            "Periodically log per-stage input latency histograms. [{log,off}]")
         (legacy_input_report_opt, po::value<std::string>()->default_value(off_opt_value),
             "How to handle the Legacy Input report. [{log,off}]")
         (seat_report_opt, po::value<std::string>()->default_value(off_opt_value),
@@ -205,6 +218,20 @@ mo::DefaultConfiguration::DefaultConfiguration(
             "Cursor (mouse pointer) to use [{auto,null,software}]")
         (enable_key_repeat_opt, po::value<bool>()->default_value(true),
              "Enable server generated key repeat")
+        (renderer_opt, po::value<std::string>()->default_value(gl_renderer_opt_value),
+            "How to composite outputs [{gl,software}]. software composites on the CPU, "
+            "redrawing only what changed, for outputs that support it (currently --offscreen) "
+            "and uses gl for the rest.")
+        (renderer_threads_opt, po::value<int>()->default_value(0),
+            "How many threads the software renderer draws each frame with, in bands of rows. "
+            "Default: 0 means one per CPU core.")
+        (shader_cache_opt, po::value<std::string>(),
+            "Directory in which to keep the gl renderer's linked shader programs between runs, "
+            "where the driver supports GL_OES_get_program_binary, so they need not be compiled "
+            "again (default: compile shaders every time)")
+        (snapshot_thumbnail_size_opt, po::value<std::string>(),
+            "Scale surface snapshots down on the GPU to fit within this size [string:<width>x<height>] "
+            "(default: snapshots are full size)")
         (fatal_except_opt, "On \"fatal error\" conditions [e.g. drivers behaving "
             "in unexpected ways] throw an exception (instead of a core dump)")
         (debug_opt, "Enable extra development debugging. "
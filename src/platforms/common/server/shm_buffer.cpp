@@ -169,6 +169,9 @@ void mgc::ShmBuffer::write(unsigned char const* data, size_t data_size)
     if (data_size != stride_.as_uint32_t()*size().height.as_uint32_t())
         BOOST_THROW_EXCEPTION(std::logic_error("Size is not equal to number of pixels in buffer"));
     memcpy(pixels, data, data_size);
+
+    std::lock_guard<decltype(tex_id_mutex)> lock{tex_id_mutex};
+    texture_stale = true;
 }
 
 void mgc::ShmBuffer::read(std::function<void(unsigned char const*)> const& do_with_pixels)
@@ -216,12 +219,17 @@ void mgc::ShmBuffer::tex_bind()
     glBindTexture(GL_TEXTURE_2D, tex_id);
     if (needs_initialisation)
     {
-        // The ShmBuffer *should* be immutable, so we can just upload once.
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    // Client pixels are immutable, so are uploaded once. Only a (recycled) buffer
+    // the server write()s to again needs uploading again.
+    if (texture_stale)
+    {
         gl_bind_to_texture();
+        texture_stale = false;
     }
 }
 
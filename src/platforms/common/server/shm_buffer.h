@@ -129,6 +129,7 @@ private:
     void* const pixels;
     std::mutex tex_id_mutex;
     GLuint tex_id{0};
+    bool texture_stale{true};   ///< Set when write() changes the pixels after they were uploaded
 };
 
 }
@@ -332,7 +332,9 @@ std::shared_ptr<mg::Buffer> mgm::BufferAllocator::alloc_software_buffer(
     auto const stride = geom::Stride{MIR_BYTES_PER_PIXEL(format) * size.width.as_uint32_t()};
     size_t const size_in_bytes = stride.as_int() * size.height.as_int();
     return std::make_shared<mgm::SoftwareBuffer>(
-        std::make_unique<mir::AnonymousShmFile>(size_in_bytes), size, format);
+        std::make_unique<mir::AnonymousShmFile>(size_in_bytes, mir::AnonymousShmFile::Paging::prefaulted),
+        size,
+        format);
 }
 
 std::vector<MirPixelFormat> mgm::BufferAllocator::supported_pixel_formats()
@@ -441,6 +441,68 @@ void add_to_drm_device_group(
         grouping.push_back(std::vector<std::shared_ptr<mgm::KMSOutput>>{std::move(output)});
     }
 }
+
+/*
+ * The KMS outputs of the groups that conf leaves exactly as they are in
+ * current, so whose DisplayBuffers can be kept as they are.
+ */
+std::vector<std::shared_ptr<mgm::KMSOutput>> outputs_of_unchanged_groups(
+    mgm::RealKMSDisplayConfiguration const& current,
+    mgm::RealKMSDisplayConfiguration const& conf)
+{
+    auto const groups_of = [](mg::DisplayConfiguration const& conf)
+        {
+            std::vector<std::vector<mg::DisplayConfigurationOutput>> groups;
+            mg::OverlappingOutputGrouping{conf}.for_each_group(
+                [&](mg::OverlappingOutputGroup const& group)
+                {
+                    groups.emplace_back();
+                    group.for_each_output(
+                        [&](mg::DisplayConfigurationOutput const& conf_output)
+                        {
+                            groups.back().push_back(conf_output);
+                        });
+                    std::sort(groups.back().begin(), groups.back().end(),
+                        [](mg::DisplayConfigurationOutput const& a, mg::DisplayConfigurationOutput const& b)
+                        {
+                            return a.id.as_value() < b.id.as_value();
+                        });
+                });
+            return groups;
+        };
+
+    auto const unchanged = [](mg::DisplayConfigurationOutput const& a, mg::DisplayConfigurationOutput const& b)
+        {
+            return a == b &&
+                   a.current_format == b.current_format &&
+                   a.power_mode == b.power_mode &&
+                   a.subpixel_arrangement == b.subpixel_arrangement &&
+                   a.gamma.red == b.gamma.red &&
+                   a.gamma.green == b.gamma.green &&
+                   a.gamma.blue == b.gamma.blue &&
+                   a.edid == b.edid;
+        };
+
+    auto const current_groups = groups_of(current);
+    std::vector<std::shared_ptr<mgm::KMSOutput>> kept;
+
+    for (auto const& group : groups_of(conf))
+    {
+        auto const same_group = [&](std::vector<mg::DisplayConfigurationOutput> const& current_group)
+            {
+                return std::equal(group.begin(), group.end(),
+                                  current_group.begin(), current_group.end(), unchanged);
+            };
+
+        if (std::any_of(current_groups.begin(), current_groups.end(), same_group))
+        {
+            for (auto const& conf_output : group)
+                kept.push_back(current.get_output_for(conf_output.id));
+        }
+    }
+
+    return kept;
+}
 }
 
 void mgm::Display::configure_locked(
@@ -484,11 +546,14 @@ void mgm::Display::configure_locked(
     grouping.for_each_group(
         [&](OverlappingOutputGroup const& group)
         {
+            if (!comp)
+            {
+                add_display_buffers_for(group, kms_conf, display_buffers_new);
+                return;
+            }
+
             auto bounding_rect = group.bounding_rectangle();
-            // Each vector<KMSOutput> is a single GPU memory domain
-            std::vector<std::vector<std::shared_ptr<KMSOutput>>> kms_output_groups;
             glm::mat2 transformation;
-            geom::Size current_mode_resolution;
 
             group.for_each_output(
                 [&](DisplayConfigurationOutput const& conf_output)
@@ -498,65 +563,16 @@ void mgm::Display::configure_locked(
                     auto const mode_index = kms_conf.get_kms_mode_index(conf_output.id,
                                                                   conf_output.current_mode_index);
                     kms_output->configure(conf_output.top_left - bounding_rect.top_left, mode_index);
-                    if (!comp)
-                    {
-                        kms_output->set_power_mode(conf_output.power_mode);
-                        kms_output->set_gamma(conf_output.gamma);
-                        add_to_drm_device_group(kms_output_groups, std::move(kms_output));
-                    }
 
                     /*
                      * Presently OverlappingOutputGroup guarantees all grouped
                      * outputs have the same transformation.
                      */
                     transformation = conf_output.transformation();
-                    if (conf_output.current_mode_index < conf_output.modes.size())
-                        current_mode_resolution = conf_output.modes[conf_output.current_mode_index].size;
                 });
 
-            if (comp)
-            {
-                display_buffers[group_idx++]->set_transformation(transformation,
-                                                                 bounding_rect);
-            }
-            else
-            {
-                uint32_t const width  = current_mode_resolution.width.as_uint32_t();
-                uint32_t const height = current_mode_resolution.height.as_uint32_t();
-
-                for (auto const& group : kms_output_groups)
-                {
-                    /*
-                     * In a hybrid setup a scanout surface needs to be allocated differently if it
-                     * needs to be able to be shared across GPUs. This likely reduces performance.
-                     *
-                     * As a first cut, assume every scanout buffer in a hybrid setup might need
-                     * to be shared.
-                     */
-                    auto surface = gbm->create_scanout_surface(width, height, drm.size() != 1);
-                    auto const raw_surface = surface.get();
-
-                    auto db = std::make_unique<DisplayBuffer>(
-                        bypass_option,
-                        listener,
-                        group,
-                        GBMOutputSurface{
-                            group.front()->drm_fd(),
-                            std::move(surface),
-                            width, height,
-                            helpers::EGLHelper{
-                                *gl_config,
-                                *gbm,
-                                raw_surface,
-                                shared_egl.context()
-                            }
-                        },
-                        bounding_rect,
-                        transformation);
-
-                    display_buffers_new.push_back(std::move(db));
-                }
-            }
+            display_buffers[group_idx++]->set_transformation(transformation,
+                                                             bounding_rect);
         });
 
     if (!comp)
@@ -569,3 +585,187 @@ void mgm::Display::configure_locked(
         /* Clear connected but unused outputs */
         clear_connected_unused_outputs();
 }
+
+void mgm::Display::add_display_buffers_for(
+    OverlappingOutputGroup const& group,
+    RealKMSDisplayConfiguration const& kms_conf,
+    std::vector<std::unique_ptr<DisplayBuffer>>& into)
+{
+    auto bounding_rect = group.bounding_rectangle();
+    // Each vector<KMSOutput> is a single GPU memory domain
+    std::vector<std::vector<std::shared_ptr<KMSOutput>>> kms_output_groups;
+    glm::mat2 transformation;
+    geom::Size current_mode_resolution;
+
+    group.for_each_output(
+        [&](DisplayConfigurationOutput const& conf_output)
+        {
+            auto kms_output = current_display_configuration.get_output_for(conf_output.id);
+
+            auto const mode_index = kms_conf.get_kms_mode_index(conf_output.id,
+                                                          conf_output.current_mode_index);
+            kms_output->configure(conf_output.top_left - bounding_rect.top_left, mode_index);
+            kms_output->set_power_mode(conf_output.power_mode);
+            kms_output->set_gamma(conf_output.gamma);
+            add_to_drm_device_group(kms_output_groups, std::move(kms_output));
+
+            /*
+             * Presently OverlappingOutputGroup guarantees all grouped
+             * outputs have the same transformation.
+             */
+            transformation = conf_output.transformation();
+            if (conf_output.current_mode_index < conf_output.modes.size())
+                current_mode_resolution = conf_output.modes[conf_output.current_mode_index].size;
+        });
+
+    uint32_t const width  = current_mode_resolution.width.as_uint32_t();
+    uint32_t const height = current_mode_resolution.height.as_uint32_t();
+
+    for (auto const& kms_output_group : kms_output_groups)
+    {
+        /*
+         * In a hybrid setup a scanout surface needs to be allocated differently if it
+         * needs to be able to be shared across GPUs. This likely reduces performance.
+         *
+         * As a first cut, assume every scanout buffer in a hybrid setup might need
+         * to be shared.
+         */
+        auto surface = gbm->create_scanout_surface(width, height, drm.size() != 1);
+        auto const raw_surface = surface.get();
+
+        auto db = std::make_unique<DisplayBuffer>(
+            bypass_option,
+            listener,
+            kms_output_group,
+            GBMOutputSurface{
+                kms_output_group.front()->drm_fd(),
+                std::move(surface),
+                width, height,
+                helpers::EGLHelper{
+                    *gl_config,
+                    *gbm,
+                    raw_surface,
+                    shared_egl.context()
+                }
+            },
+            bounding_rect,
+            transformation);
+
+        into.push_back(std::move(db));
+    }
+}
+
+void mgm::Display::configure_changed_outputs(
+    mg::DisplayConfiguration const& conf,
+    std::function<void(mg::DisplaySyncGroup&)> const& retiring,
+    std::function<void(mg::DisplaySyncGroup&)> const& added)
+{
+    if (!conf.valid())
+    {
+        BOOST_THROW_EXCEPTION(
+            std::logic_error("Invalid or inconsistent display configuration"));
+    }
+
+    auto const& new_kms_conf = dynamic_cast<RealKMSDisplayConfiguration const&>(conf);
+
+    std::vector<std::shared_ptr<KMSOutput>> kept_outputs;
+    std::vector<DisplayBuffer*> retired;
+
+    auto const kept = [&](std::shared_ptr<KMSOutput> const& kms_output)
+        {
+            return std::find(kept_outputs.begin(), kept_outputs.end(), kms_output) != kept_outputs.end();
+        };
+
+    {
+        std::lock_guard<decltype(configuration_mutex)> lock{configuration_mutex};
+
+        kept_outputs = outputs_of_unchanged_groups(current_display_configuration, new_kms_conf);
+
+        for (auto const& db : display_buffers)
+        {
+            auto const& outputs = db->kms_outputs();
+            if (!std::all_of(outputs.begin(), outputs.end(), kept))
+                retired.push_back(db.get());
+        }
+    }
+
+    /*
+     * Called without holding the configuration_mutex: whoever is posting to
+     * the retiring groups may need it (e.g. for the cursor) to finish.
+     */
+    for (auto const db : retired)
+        retiring(*db);
+
+    std::vector<DisplayBuffer*> replacements;
+
+    {
+        std::lock_guard<decltype(configuration_mutex)> lock{configuration_mutex};
+
+        /*
+         * As in configure_locked(), the new DisplayBuffers take over the
+         * outputs before the retired ones are destroyed, so let their pending
+         * page flips finish first.
+         */
+        for (auto const db : retired)
+            db->wait_for_page_flip();
+
+        /* Reset the state of the outputs that are not kept as they are */
+        new_kms_conf.for_each_output(
+            [&](DisplayConfigurationOutput const& conf_output)
+            {
+                auto kms_output = current_display_configuration.get_output_for(conf_output.id);
+                if (!kept(kms_output))
+                {
+                    kms_output->clear_cursor();
+                    kms_output->reset();
+                }
+            });
+
+        std::vector<std::unique_ptr<DisplayBuffer>> display_buffers_new;
+        OverlappingOutputGrouping grouping{new_kms_conf};
+
+        grouping.for_each_group(
+            [&](OverlappingOutputGroup const& group)
+            {
+                std::vector<std::shared_ptr<KMSOutput>> group_outputs;
+                group.for_each_output(
+                    [&](DisplayConfigurationOutput const& conf_output)
+                    {
+                        group_outputs.push_back(current_display_configuration.get_output_for(conf_output.id));
+                    });
+
+                if (std::all_of(group_outputs.begin(), group_outputs.end(), kept))
+                {
+                    for (auto& db : display_buffers)
+                    {
+                        if (db && std::find(group_outputs.begin(), group_outputs.end(),
+                                            db->kms_outputs().front()) != group_outputs.end())
+                        {
+                            display_buffers_new.push_back(std::move(db));
+                        }
+                    }
+                }
+                else
+                {
+                    auto const first_added = display_buffers_new.size();
+                    add_display_buffers_for(group, new_kms_conf, display_buffers_new);
+
+                    for (auto i = first_added; i != display_buffers_new.size(); ++i)
+                        replacements.push_back(display_buffers_new[i].get());
+                }
+            });
+
+        display_buffers = std::move(display_buffers_new);
+
+        /* Store applied configuration */
+        current_display_configuration = new_kms_conf;
+
+        /* Clear connected but unused outputs */
+        clear_connected_unused_outputs();
+    }
+
+    if (auto c = cursor.lock()) c->resume();
+
+    for (auto const db : replacements)
+        added(*db);
+}
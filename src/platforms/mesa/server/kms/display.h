@@ -20,6 +20,7 @@
 #define MIR_GRAPHICS_MESA_DISPLAY_H_
 
 #include "mir/graphics/display.h"
+#include "mir/graphics/per_output_reconfiguration.h"
 #include "mir/renderer/gl/context_source.h"
 #include "real_kms_output_container.h"
 #include "real_kms_display_configuration.h"
@@ -45,6 +46,7 @@ class DisplayReport;
 class DisplayBuffer;
 class DisplayConfigurationPolicy;
 class EventHandlerRegister;
+class OverlappingOutputGroup;
 class GLConfig;
 
 namespace mesa
@@ -62,6 +64,7 @@ class Cursor;
 
 class Display : public graphics::Display,
                 public graphics::NativeDisplay,
+                public graphics::PerOutputReconfiguration,
                 public renderer::gl::ContextSource
 {
 public:
@@ -81,6 +84,10 @@ public:
     std::unique_ptr<DisplayConfiguration> configuration() const override;
     bool apply_if_configuration_preserves_display_buffers(DisplayConfiguration const& conf) override;
     void configure(DisplayConfiguration const& conf) override;
+    void configure_changed_outputs(
+        DisplayConfiguration const& conf,
+        std::function<void(graphics::DisplaySyncGroup&)> const& retiring,
+        std::function<void(graphics::DisplaySyncGroup&)> const& added) override;
 
     void register_configuration_change_handler(
         EventHandlerRegister& handlers,
@@ -121,6 +128,11 @@ private:
         RealKMSDisplayConfiguration const& conf,
         std::lock_guard<decltype(configuration_mutex)> const&);
 
+    void add_display_buffers_for(
+        OverlappingOutputGroup const& group,
+        RealKMSDisplayConfiguration const& kms_conf,
+        std::vector<std::unique_ptr<DisplayBuffer>>& into);
+
     BypassOption bypass_option;
     std::weak_ptr<Cursor> cursor;
     std::shared_ptr<GLConfig> const gl_config;
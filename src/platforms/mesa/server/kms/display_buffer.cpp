@@ -744,6 +744,11 @@ void mgm::DisplayBuffer::schedule_set_crtc()
     needs_set_crtc = true;
 }
 
+std::vector<std::shared_ptr<mgm::KMSOutput>> const& mgm::DisplayBuffer::kms_outputs() const
+{
+    return outputs;
+}
+
 mg::NativeDisplayBuffer* mgm::DisplayBuffer::native_display_buffer()
 {
     return this;
@@ -125,6 +125,7 @@ public:
     void set_transformation(glm::mat2 const& t, geometry::Rectangle const& a);
     void schedule_set_crtc();
     void wait_for_page_flip();
+    std::vector<std::shared_ptr<KMSOutput>> const& kms_outputs() const;
 
 private:
     bool schedule_page_flip(FBHandle const& bufobj);
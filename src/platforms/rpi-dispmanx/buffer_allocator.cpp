@@ -112,7 +112,9 @@ auto mg::rpi::BufferAllocator::alloc_software_buffer(
             geom::Size size,
             MirPixelFormat const& pixelFormat) :
             ShmBuffer(
-                std::make_unique<mir::AnonymousShmFile>(size_in_bytes(size, pixelFormat)),
+                std::make_unique<mir::AnonymousShmFile>(
+                    size_in_bytes(size, pixelFormat),
+                    mir::AnonymousShmFile::Paging::prefaulted),
                 size,
                 pixelFormat)
         {
@@ -111,7 +111,7 @@ std::shared_ptr<mg::Buffer> mgw::BufferAllocator::alloc_software_buffer(geom::Si
     auto const stride = geom::Stride{ MIR_BYTES_PER_PIXEL(format) * size.width.as_uint32_t() };
     size_t const size_in_bytes = stride.as_int() * size.height.as_int();
     return std::make_shared<SoftwareBuffer>(
-        std::make_unique<AnonymousShmFile>(size_in_bytes), size, format);
+        std::make_unique<AnonymousShmFile>(size_in_bytes, AnonymousShmFile::Paging::prefaulted), size, format);
 }
 
 std::vector<MirPixelFormat> mgw::BufferAllocator::supported_pixel_formats()
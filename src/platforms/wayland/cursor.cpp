@@ -18,51 +18,26 @@
 
 #include "cursor.h"
 #include "displayclient.h"
-
-#include <mir/fd.h>
+#include "shm_pool.h"
 
 #include <wayland-client.h>
 
-#include <boost/throw_exception.hpp>
-
-#include <fcntl.h>
-#include <unistd.h>
 #include <sys/mman.h>
 
+#include <algorithm>
 #include <cstring>
-#include <system_error>
 
 namespace mpw = mir::platform::wayland;
 
 namespace
 {
-struct wl_shm_pool* make_shm_pool(struct wl_shm* shm, int size, void **data)
+// FNV-1a: cheap enough to run over every cursor image we're asked to show
+uint64_t hash_of(void const* data, size_t size)
 {
-    // As we're a Wayland client, create the shm file like Wayland clients.
-    // While using O_TMPFILE would be more elegant, this works with Snap-confined servers.
-    static auto const template_filename =
-        std::string{getenv("XDG_RUNTIME_DIR")} + "/wayland-cursor-shared-XXXXXX";
-
-    auto const filename = strdup(template_filename.c_str());
-    mir::Fd const fd{mkostemp(filename, O_CLOEXEC)};
-    unlink(filename);
-    free(filename);
-
-    if (fd < 0) {
-        BOOST_THROW_EXCEPTION((std::system_error{errno, std::system_category(), "Failed to open shm buffer"}));
-    }
-
-    if (auto error = posix_fallocate(fd, 0, size))
-    {
-        BOOST_THROW_EXCEPTION((std::system_error{error, std::system_category(), "Failed to allocate shm buffer"}));
-    }
-
-    if ((*data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
-    {
-        BOOST_THROW_EXCEPTION((std::system_error{errno, std::system_category(), "Failed to mmap buffer"}));
-    }
-
-    return wl_shm_create_pool(shm, fd, size);
+    auto hash = UINT64_C(14695981039346656037);
+    for (auto byte = static_cast<unsigned char const*>(data), end = byte + size; byte != end; ++byte)
+        hash = (hash ^ *byte) * UINT64_C(1099511628211);
+    return hash;
 }
 }
 
@@ -78,33 +53,78 @@ mpw::Cursor::~Cursor()
     wl_surface_destroy(surface);
 
     std::lock_guard<decltype(mutex)> lock{mutex};
-    if (buffer) wl_buffer_destroy(buffer);
+    for (auto const& cached : cache)
+    {
+        wl_buffer_destroy(cached.buffer);
+        munmap(cached.data, 4 * cached.size.width.as_uint32_t() * cached.size.height.as_uint32_t());
+    }
 }
 
 void mpw::Cursor::move_to(geometry::Point)
 {
 }
 
+auto mpw::Cursor::buffer_for(graphics::CursorImage const& cursor_image) -> wl_buffer*
+{
+    auto const size = cursor_image.size();
+    auto const width = size.width.as_uint32_t();
+    auto const height = size.height.as_uint32_t();
+    auto const data_size = 4 * width * height;
+    auto const hash = hash_of(cursor_image.as_argb_8888(), data_size);
+
+    for (auto& cached : cache)
+    {
+        if (cached.hash == hash && cached.size == size &&
+            memcmp(cached.data, cursor_image.as_argb_8888(), data_size) == 0)
+        {
+            cached.last_used = ++use_count;
+            return cached.buffer;
+        }
+    }
+
+    if (cache.size() == max_cached_buffers)
+    {
+        // Evict the least recently used image (which can't be the one on screen: that was used last)
+        auto const victim = std::min_element(cache.begin(), cache.end(),
+            [](CachedBuffer const& lhs, CachedBuffer const& rhs) { return lhs.last_used < rhs.last_used; });
+
+        wl_buffer_destroy(victim->buffer);
+        munmap(victim->data, 4 * victim->size.width.as_uint32_t() * victim->size.height.as_uint32_t());
+        cache.erase(victim);
+    }
+
+    void* data_buffer;
+    auto const shm_pool = mpw::make_shm_pool(shm, data_size, &data_buffer);
+    memcpy(data_buffer, cursor_image.as_argb_8888(), data_size);
+    auto const new_buffer = wl_shm_pool_create_buffer(shm_pool, 0, width, height, 4 * width, WL_SHM_FORMAT_ARGB8888);
+    wl_shm_pool_destroy(shm_pool);
+
+    cache.push_back(CachedBuffer{hash, size, data_buffer, new_buffer, ++use_count});
+    return new_buffer;
+}
+
 void mpw::Cursor::show(graphics::CursorImage const& cursor_image)
 {
     {
         std::lock_guard<decltype(mutex)> lock{mutex};
-        if (buffer) wl_buffer_destroy(buffer);
 
-        auto const width = cursor_image.size().width.as_uint32_t();
-        auto const height = cursor_image.size().height.as_uint32_t();
         auto const hotspot_x = cursor_image.hotspot().dx.as_uint32_t();
         auto const hotspot_y = cursor_image.hotspot().dy.as_uint32_t();
-        void* data_buffer;
-        auto const shm_pool = make_shm_pool(shm, 4 * width * height, &data_buffer);
-        memcpy(data_buffer, cursor_image.as_argb_8888(), 4 * width * height);
-        buffer = wl_shm_pool_create_buffer(shm_pool, 0, width, height, 4 * width, WL_SHM_FORMAT_ARGB8888);
-        wl_surface_attach(surface, buffer, 0, 0);
-        wl_surface_commit(surface);
-        wl_shm_pool_destroy(shm_pool);
+        auto const new_buffer = buffer_for(cursor_image);
+
+        if (new_buffer != buffer)
+        {
+            buffer = new_buffer;
+            wl_surface_attach(surface, buffer, 0, 0);
+            wl_surface_damage(surface, 0, 0, INT32_MAX, INT32_MAX);
+            wl_surface_commit(surface);
+        }
+
         if (pointer) wl_pointer_set_cursor(pointer, 0, surface, hotspot_x, hotspot_y);
     }
-    wl_display_roundtrip(display);
+
+    // Don't wait for the host to process the update: the nested input thread calls us
+    wl_display_flush(display);
 }
 
 void mpw::Cursor::show()
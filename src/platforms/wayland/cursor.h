@@ -24,7 +24,9 @@
 
 #include <wayland-client.h>
 
+#include <cstdint>
 #include <mutex>
+#include <vector>
 
 namespace mir
 {
@@ -52,12 +54,28 @@ public:
     void leave(wl_pointer* pointer);
 
 private:
+    /// A host buffer holding one cursor image, kept so that images we switch back to needn't be uploaded again
+    struct CachedBuffer
+    {
+        uint64_t hash;
+        geometry::Size size;
+        void* data;
+        wl_buffer* buffer;
+        uint64_t last_used;
+    };
+
+    static size_t const max_cached_buffers = 8;
+
+    auto buffer_for(graphics::CursorImage const& image) -> wl_buffer*;
+
     wl_display* const display;
     wl_shm* const shm;
 
     wl_surface* surface;
 
     std::mutex mutable mutex;
+    std::vector<CachedBuffer> cache;
+    uint64_t use_count{0};
     wl_buffer* buffer{nullptr};
     wl_pointer* pointer{nullptr};
 };
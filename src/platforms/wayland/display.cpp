@@ -85,8 +85,9 @@ mgw::Display::Display(
     wl_display* const wl_display,
     std::shared_ptr<GLConfig> const& gl_config,
     std::shared_ptr<DisplayReport> const& report,
-    std::shared_ptr<DisplayConfigurationPolicy> const& initial_conf_policy) :
-    DisplayClient{wl_display, gl_config},
+    std::shared_ptr<DisplayConfigurationPolicy> const& initial_conf_policy,
+    bool passthrough) :
+    DisplayClient{wl_display, gl_config, passthrough},
     report{report},
     shutdown_signal{::eventfd(0, EFD_CLOEXEC)},
     keyboard_sink{std::make_shared<NullKeyboardInput>()},
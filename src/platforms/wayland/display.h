@@ -62,7 +62,8 @@ public:
         wl_display* const wl_display,
         std::shared_ptr<GLConfig> const& gl_config,
         std::shared_ptr<DisplayReport> const& report,
-	std::shared_ptr<DisplayConfigurationPolicy> const& initial_conf_policy);
+	std::shared_ptr<DisplayConfigurationPolicy> const& initial_conf_policy,
+        bool passthrough);
 
     ~Display();
 
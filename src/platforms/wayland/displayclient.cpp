@@ -16,7 +16,11 @@
  */
 
 #include "displayclient.h"
+#include "passthrough_surface.h"
 #include "mir/graphics/egl_error.h"
+#include "mir/graphics/buffer.h"
+#include "mir/graphics/renderable.h"
+#include "mir/renderer/sw/pixel_source.h"
 #include <mir/graphics/pixel_format_utils.h>
 
 #include <wayland-client.h>
@@ -111,6 +115,13 @@ public:
     void release_current() override;
     void swap_buffers() override;
     void bind() override;
+
+private:
+    auto can_pass_through(Renderable const& renderable) const -> bool;
+    void end_passthrough();
+
+    /// The host subsurfaces showing client buffers, bottom to top, as of the last overlay()
+    std::vector<std::unique_ptr<PassthroughSurface>> passthroughs;
 };
 
 namespace
@@ -122,6 +133,46 @@ static EGLint const ctxattribs[] =
 #endif
         EGL_NONE
     };
+
+// Waits (briefly) for the host to show a commit to surface, rather than blocking in eglSwapBuffers()
+struct FrameSync
+{
+    explicit FrameSync(wl_surface* surface) :
+        callback{wl_surface_frame(surface)}
+    {
+        static struct wl_callback_listener const frame_listener =
+            {
+                [](void* data, auto... args)
+                    { static_cast<FrameSync*>(data)->frame_done(args...); },
+            };
+
+        wl_callback_add_listener(callback, &frame_listener, this);
+    }
+
+    ~FrameSync()
+    {
+        wl_callback_destroy(callback);
+    }
+
+    void frame_done(wl_callback*, uint32_t)
+    {
+        std::lock_guard<decltype(mutex)> lock{mutex};
+        posted = true;
+        cv.notify_all();
+    }
+
+    void wait_for_done()
+    {
+        std::unique_lock<decltype(mutex)> lock{mutex};
+        cv.wait_for(lock, std::chrono::milliseconds{100}, [this]{ return posted; });
+    }
+
+    std::mutex mutex;
+    bool posted = false;
+    std::condition_variable cv;
+
+    wl_callback* const callback;
+};
 }
 
 void mgw::DisplayClient::Output::geometry(
@@ -243,6 +294,8 @@ mgw::DisplayClient::Output::Output(
 
 mgw::DisplayClient::Output::~Output()
 {
+    passthroughs.clear();
+
     if (output)
         wl_output_destroy(output);
 
@@ -312,9 +365,86 @@ auto mgw::DisplayClient::Output::view_area() const -> geometry::Rectangle
     return dcout.extents();
 }
 
-bool mgw::DisplayClient::Output::overlay(mir::graphics::RenderableList const&)
+auto mgw::DisplayClient::Output::can_pass_through(Renderable const& renderable) const -> bool
+{
+    auto const buffer = renderable.buffer();
+    auto const format = buffer->pixel_format();
+
+    return renderable.alpha() == 1.0f &&
+           renderable.transformation() == glm::mat4{1} &&
+           !renderable.clip_area() &&
+           view_area().contains(renderable.screen_position()) &&
+           renderable.screen_position().size == buffer->size() &&
+           (format == mir_pixel_format_argb_8888 || format == mir_pixel_format_xrgb_8888) &&
+           dynamic_cast<renderer::software::PixelSource*>(buffer->native_buffer_base());
+}
+
+bool mgw::DisplayClient::Output::overlay(mir::graphics::RenderableList const& renderlist)
+{
+    // The host can only show what we forward over our last composited frame, so passthrough
+    // needs a client that covers the whole output (as in a kiosk), with anything else on top
+    if (!owner->passthrough || !owner->subcompositor || !window ||
+        renderlist.empty() || renderlist.front()->screen_position() != view_area() ||
+        !std::all_of(renderlist.begin(), renderlist.end(),
+            [this](std::shared_ptr<Renderable> const& renderable) { return can_pass_through(*renderable); }))
+    {
+        end_passthrough();
+        return false;
+    }
+
+    auto const existing_for = [this](Renderable const& renderable)
+        {
+            return std::find_if(passthroughs.begin(), passthroughs.end(),
+                [&](std::unique_ptr<PassthroughSurface> const& p) { return p && p->id == renderable.id(); });
+        };
+
+    // If the host still holds both copies of a client's previous frames we can't show its new
+    // frame yet, and it may not send another: composite this frame instead of leaving it stale
+    if (!std::all_of(renderlist.begin(), renderlist.end(),
+            [&](std::shared_ptr<Renderable> const& renderable)
+            {
+                auto const existing = existing_for(*renderable);
+                return existing == passthroughs.end() || (*existing)->can_show(*renderable->buffer());
+            }))
+    {
+        end_passthrough();
+        return false;
+    }
+
+    decltype(passthroughs) updated;
+    auto below = surface;
+
+    for (auto const& renderable : renderlist)
+    {
+        auto const existing = existing_for(*renderable);
+
+        if (existing != passthroughs.end())
+            updated.push_back(std::move(*existing));
+        else
+            updated.push_back(std::make_unique<PassthroughSurface>(
+                owner->compositor, owner->subcompositor, surface, round(dcout.scale), renderable->id()));
+
+        updated.back()->update(
+            owner->shm, *renderable->buffer(), renderable->screen_position().top_left - view_area().top_left, below);
+        below = updated.back()->surface;
+    }
+
+    // Destroys the subsurfaces of renderables that are no longer shown
+    passthroughs = std::move(updated);
+
+    // Subsurface state is applied when the parent surface commits
+    FrameSync frame_sync{surface};
+    wl_surface_commit(surface);
+    wl_display_flush(owner->display);
+    frame_sync.wait_for_done();
+
+    return true;
+}
+
+void mgw::DisplayClient::Output::end_passthrough()
 {
-    return false;
+    // The subsurfaces are unmapped now; our next composited frame replaces them
+    passthroughs.clear();
 }
 
 auto mgw::DisplayClient::Output::transformation() const -> glm::mat2
@@ -343,44 +473,7 @@ void mgw::DisplayClient::Output::release_current()
 
 void mgw::DisplayClient::Output::swap_buffers()
 {
-    struct FrameSync
-    {
-        explicit FrameSync(wl_surface* surface) :
-            callback{wl_surface_frame(surface)}
-        {
-            static struct wl_callback_listener const frame_listener =
-                {
-                    [](void* data, auto... args)
-                        { static_cast<FrameSync*>(data)->frame_done(args...); },
-                };
-
-            wl_callback_add_listener(callback, &frame_listener, this);
-        }
-
-        ~FrameSync()
-        {
-            wl_callback_destroy(callback);
-        }
-
-        void frame_done(wl_callback*, uint32_t)
-        {
-            std::lock_guard<decltype(mutex)> lock{mutex};
-            posted = true;
-            cv.notify_all();
-        }
-
-        void wait_for_done()
-        {
-            std::unique_lock<decltype(mutex)> lock{mutex};
-            cv.wait_for(lock, std::chrono::milliseconds{100}, [this]{ return posted; });
-        }
-
-        std::mutex mutex;
-        bool posted = false;
-        std::condition_variable cv;
-
-        wl_callback* const callback;
-    } frame_sync{surface};
+    FrameSync frame_sync{surface};
 
     // Avoid throttling compositing by blocking in eglSwapBuffers().
     // Instead we use the frame "done" notification.
@@ -398,8 +491,10 @@ void mgw::DisplayClient::Output::bind()
 
 mgw::DisplayClient::DisplayClient(
     wl_display* display,
-    std::shared_ptr<GLConfig> const& gl_config) :
+    std::shared_ptr<GLConfig> const& gl_config,
+    bool passthrough) :
     display{display},
+    passthrough{passthrough},
     keyboard_context_{xkb_context_new(XKB_CONTEXT_NO_FLAGS)},
     registry{nullptr, [](auto){}}
 {
@@ -529,6 +624,11 @@ void mgw::DisplayClient::new_global(
     {
         self->shell = static_cast<decltype(self->shell)>(wl_registry_bind(registry, id, &wl_shell_interface, std::min(version, 1u)));
     }
+    else if (strcmp(interface, "wl_subcompositor") == 0)
+    {
+        self->subcompositor = static_cast<decltype(self->subcompositor)>(
+            wl_registry_bind(registry, id, &wl_subcompositor_interface, std::min(version, 1u)));
+    }
 }
 
 void mgw::DisplayClient::remove_global(
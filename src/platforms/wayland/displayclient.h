@@ -49,7 +49,8 @@ class DisplayClient
 {
 public:
     DisplayClient(wl_display* display,
-    std::shared_ptr<GLConfig> const& gl_config);
+    std::shared_ptr<GLConfig> const& gl_config,
+    bool passthrough);
 
     virtual ~DisplayClient();
 
@@ -133,6 +134,10 @@ protected:
     wl_shell* shell = nullptr;
     wl_seat* seat = nullptr;
     wl_shm* shm = nullptr;
+    wl_subcompositor* subcompositor = nullptr;
+
+    /// Whether outputs may forward client buffers to the host as subsurfaces (if it has wl_subcompositor)
+    bool const passthrough;
 
     static void new_global(
         void* data,
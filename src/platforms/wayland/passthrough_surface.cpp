@@ -0,0 +1,124 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "passthrough_surface.h"
+#include "shm_pool.h"
+#include "mir/graphics/buffer.h"
+#include "mir/renderer/sw/pixel_source.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace mgw = mir::graphics::wayland;
+namespace geom = mir::geometry;
+
+mgw::PassthroughSurface::PassthroughSurface(
+    wl_compositor* compositor,
+    wl_subcompositor* subcompositor,
+    wl_surface* parent,
+    int32_t scale,
+    Renderable::ID id) :
+    id{id},
+    surface{wl_compositor_create_surface(compositor)},
+    subsurface{wl_subcompositor_get_subsurface(subcompositor, surface, parent)}
+{
+    wl_surface_set_buffer_scale(surface, scale);
+}
+
+mgw::PassthroughSurface::~PassthroughSurface()
+{
+    wl_subsurface_destroy(subsurface);
+    wl_surface_destroy(surface);
+}
+
+auto mgw::PassthroughSurface::can_show(Buffer const& buffer) const -> bool
+{
+    return buffer.id() == shown ||
+        std::any_of(std::begin(host_buffers), std::end(host_buffers),
+            [](HostBuffer const& host_buffer) { return !host_buffer.busy; });
+}
+
+void mgw::PassthroughSurface::update(wl_shm* shm, Buffer& buffer, geom::Displacement offset, wl_surface* below)
+{
+    wl_subsurface_set_position(subsurface, offset.dx.as_int(), offset.dy.as_int());
+    wl_subsurface_place_above(subsurface, below);
+
+    if (buffer.id() != shown)
+    {
+        if (auto const host_buffer = free_host_buffer())
+        {
+            host_buffer->copy_from(shm, buffer);
+            wl_surface_attach(surface, host_buffer->buffer, 0, 0);
+            wl_surface_damage(surface, 0, 0, INT32_MAX, INT32_MAX);
+            shown = buffer.id();
+        }
+    }
+
+    wl_surface_commit(surface);
+}
+
+auto mgw::PassthroughSurface::free_host_buffer() -> HostBuffer*
+{
+    auto const free = std::find_if(std::begin(host_buffers), std::end(host_buffers),
+        [](HostBuffer const& host_buffer) { return !host_buffer.busy; });
+
+    return free != std::end(host_buffers) ? free : nullptr;
+}
+
+mgw::PassthroughSurface::HostBuffer::~HostBuffer()
+{
+    release();
+}
+
+void mgw::PassthroughSurface::HostBuffer::release()
+{
+    if (buffer) wl_buffer_destroy(buffer);
+    if (data) munmap(data, size);
+    buffer = nullptr;
+    data = nullptr;
+}
+
+void mgw::PassthroughSurface::HostBuffer::copy_from(wl_shm* shm, Buffer& client_buffer)
+{
+    auto const pixels = dynamic_cast<renderer::software::PixelSource*>(client_buffer.native_buffer_base());
+    auto const stride = pixels->stride().as_int();
+    auto const height = client_buffer.size().height.as_int();
+    uint32_t const format = client_buffer.pixel_format() == mir_pixel_format_argb_8888 ?
+        WL_SHM_FORMAT_ARGB8888 : WL_SHM_FORMAT_XRGB8888;
+
+    if (!buffer || client_buffer.size() != buffer_size || stride != buffer_stride || format != buffer_format)
+    {
+        release();
+        size = stride * height;
+        auto const pool = platform::wayland::make_shm_pool(shm, size, &data);
+        buffer = wl_shm_pool_create_buffer(pool, 0, client_buffer.size().width.as_int(), height, stride, format);
+        wl_shm_pool_destroy(pool);
+        buffer_size = client_buffer.size();
+        buffer_stride = stride;
+        buffer_format = format;
+
+        static wl_buffer_listener const release_listener{
+            [](void* data, wl_buffer*) { static_cast<HostBuffer*>(data)->busy = false; }
+        };
+        wl_buffer_add_listener(buffer, &release_listener, this);
+    }
+
+    pixels->read([this](unsigned char const* client_pixels) { memcpy(data, client_pixels, size); });
+    busy = true;
+}
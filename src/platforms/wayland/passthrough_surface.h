@@ -0,0 +1,94 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_PLATFORM_WAYLAND_PASSTHROUGH_SURFACE_H_
+#define MIR_PLATFORM_WAYLAND_PASSTHROUGH_SURFACE_H_
+
+#include "mir/graphics/buffer_id.h"
+#include "mir/graphics/renderable.h"
+#include "mir/geometry/displacement.h"
+#include "mir/geometry/size.h"
+
+#include <wayland-client.h>
+
+#include <atomic>
+
+namespace mir
+{
+namespace graphics
+{
+class Buffer;
+
+namespace wayland
+{
+/**
+ * A host subsurface showing a copy of one client's buffer.
+ *
+ * Client buffers are copied into one of a pair of host wl_shm buffers (our
+ * wl_shm buffers don't expose their fds, so can't be shared with the host).
+ * A host buffer is re-used only once the host has released it.
+ */
+class PassthroughSurface
+{
+public:
+    PassthroughSurface(
+        wl_compositor* compositor,
+        wl_subcompositor* subcompositor,
+        wl_surface* parent,
+        int32_t scale,
+        Renderable::ID id);
+    ~PassthroughSurface();
+
+    /// Whether update() can show buffer now: it is already shown, or there's a host buffer free for it
+    auto can_show(Buffer const& buffer) const -> bool;
+
+    /// Places the subsurface at offset above below, showing buffer (which must satisfy can_show())
+    void update(wl_shm* shm, Buffer& buffer, geometry::Displacement offset, wl_surface* below);
+
+    Renderable::ID const id;
+    wl_surface* const surface;
+
+private:
+    PassthroughSurface(PassthroughSurface const&) = delete;
+    PassthroughSurface& operator=(PassthroughSurface const&) = delete;
+
+    struct HostBuffer
+    {
+        ~HostBuffer();
+
+        void release();
+        void copy_from(wl_shm* shm, Buffer& client_buffer);
+
+        wl_buffer* buffer{nullptr};
+        void* data{nullptr};
+        size_t size{0};
+        geometry::Size buffer_size;
+        int buffer_stride{0};
+        uint32_t buffer_format{0};
+        std::atomic<bool> busy{false};   ///< Attached, and not yet released by the host
+    };
+
+    auto free_host_buffer() -> HostBuffer*;
+
+    wl_subsurface* const subsurface;
+    HostBuffer host_buffers[2];
+    BufferID shown{0};
+};
+}
+}
+}
+
+#endif //MIR_PLATFORM_WAYLAND_PASSTHROUGH_SURFACE_H_
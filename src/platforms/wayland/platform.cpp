@@ -35,9 +35,13 @@ namespace mg = mir::graphics;
 namespace mgw = mir::graphics::wayland;
 using namespace std::literals;
 
-mgw::Platform::Platform(struct wl_display* const wl_display, std::shared_ptr<mg::DisplayReport> const& report) :
+mgw::Platform::Platform(
+    struct wl_display* const wl_display,
+    std::shared_ptr<mg::DisplayReport> const& report,
+    bool passthrough) :
     wl_display{wl_display},
-    report{report}
+    report{report},
+    passthrough{passthrough}
 {
     if (!wl_display)
     {
@@ -49,7 +53,7 @@ mir::UniqueModulePtr<mg::Display> mgw::Platform::create_display(
     std::shared_ptr<DisplayConfigurationPolicy> const& initial_conf_policy,
     std::shared_ptr<GLConfig> const& gl_config)
 {
-  return mir::make_module_ptr<mgw::Display>(wl_display, gl_config, report, initial_conf_policy);
+  return mir::make_module_ptr<mgw::Display>(wl_display, gl_config, report, initial_conf_policy, passthrough);
 }
 
 mg::NativeDisplayPlatform* mgw::Platform::native_display_platform()
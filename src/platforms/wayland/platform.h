@@ -43,7 +43,7 @@ class Platform : public graphics::Platform,
                  public mir::renderer::gl::EGLPlatform
 {
 public:
-    Platform(struct wl_display* const wl_display, std::shared_ptr<DisplayReport> const& report);
+    Platform(struct wl_display* const wl_display, std::shared_ptr<DisplayReport> const& report, bool passthrough);
     ~Platform() = default;
 
     UniqueModulePtr<GraphicBufferAllocator> create_buffer_allocator(Display const& output) override;
@@ -62,6 +62,7 @@ public:
 private:
     struct wl_display* const wl_display;
     std::shared_ptr<DisplayReport> const report;
+    bool const passthrough;
 };
 }
 }
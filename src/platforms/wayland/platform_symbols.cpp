@@ -49,7 +49,7 @@ mir::UniqueModulePtr<mg::Platform> create_host_platform(
     std::shared_ptr<mir::logging::Logger> const&)
 {
     mir::assert_entry_point_signature<mg::CreateHostPlatform>(&create_host_platform);
-    return mir::make_module_ptr<mgw::Platform>(mpw::connection(*options), report);
+    return mir::make_module_ptr<mgw::Platform>(mpw::connection(*options), report, mpw::passthrough_enabled(*options));
 }
 
 void add_graphics_platform_options(boost::program_options::options_description& config)
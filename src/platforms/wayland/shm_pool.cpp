@@ -0,0 +1,61 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "shm_pool.h"
+
+#include <mir/fd.h>
+
+#include <boost/throw_exception.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <system_error>
+
+namespace mpw = mir::platform::wayland;
+
+auto mpw::make_shm_pool(wl_shm* shm, int size, void** data) -> wl_shm_pool*
+{
+    // As we're a Wayland client, create the shm file like Wayland clients.
+    // While using O_TMPFILE would be more elegant, this works with Snap-confined servers.
+    static auto const template_filename =
+        std::string{getenv("XDG_RUNTIME_DIR")} + "/wayland-shared-XXXXXX";
+
+    auto const filename = strdup(template_filename.c_str());
+    mir::Fd const fd{mkostemp(filename, O_CLOEXEC)};
+    unlink(filename);
+    free(filename);
+
+    if (fd < 0) {
+        BOOST_THROW_EXCEPTION((std::system_error{errno, std::system_category(), "Failed to open shm buffer"}));
+    }
+
+    if (auto error = posix_fallocate(fd, 0, size))
+    {
+        BOOST_THROW_EXCEPTION((std::system_error{error, std::system_category(), "Failed to allocate shm buffer"}));
+    }
+
+    if ((*data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+    {
+        BOOST_THROW_EXCEPTION((std::system_error{errno, std::system_category(), "Failed to mmap buffer"}));
+    }
+
+    return wl_shm_create_pool(shm, fd, size);
+}
@@ -36,6 +36,10 @@ struct WaylandDisplay
 
 char const* wayland_host_option_name{"wayland-host"};
 char const* wayland_host_option_description{"Socket name for host compositor"};
+char const* wayland_passthrough_option_name{"wayland-host-passthrough"};
+char const* wayland_passthrough_option_description{
+    "Forward fullscreen client buffers (with any wl_shm surfaces above them) to the host as subsurfaces"
+    " instead of compositing them"};
 }
 
 void mpw::add_connection_options(boost::program_options::options_description& config)
@@ -43,7 +47,10 @@ void mpw::add_connection_options(boost::program_options::options_description& co
     config.add_options()
         (wayland_host_option_name,
          boost::program_options::value<std::string>(),
-         wayland_host_option_description);
+         wayland_host_option_description)
+        (wayland_passthrough_option_name,
+         boost::program_options::value<bool>()->default_value(false),
+         wayland_passthrough_option_description);
 }
 
 auto mpw::connection(options::Option const& options) -> struct wl_display*
@@ -58,3 +65,8 @@ auto mir::platform::wayland::connection_options_supplied(mir::options::Option co
 {
     return options.is_set(wayland_host_option_name);
 }
+
+auto mir::platform::wayland::passthrough_enabled(mir::options::Option const& options) -> bool
+{
+    return options.is_set(wayland_passthrough_option_name) && options.get<bool>(wayland_passthrough_option_name);
+}
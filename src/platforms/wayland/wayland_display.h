@@ -32,6 +32,9 @@ namespace wayland
 void add_connection_options(boost::program_options::options_description& config);
 auto connection_options_supplied(mir::options::Option const& options) -> bool;
 auto connection(mir::options::Option const& options) -> wl_display*;
+
+/// Whether client buffers may be forwarded to the host as subsurfaces rather than composited
+auto passthrough_enabled(mir::options::Option const& options) -> bool;
 }
 }
 }
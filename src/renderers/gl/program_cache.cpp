@@ -0,0 +1,267 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define MIR_LOG_COMPONENT "GLRenderer"
+
+#include "program_cache.h"
+#include "mir/log.h"
+
+#include <EGL/egl.h>
+#include <boost/throw_exception.hpp>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <system_error>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mrg = mir::renderer::gl;
+
+namespace
+{
+// GL_PROGRAM_BINARY_LENGTH_OES and GL_NUM_PROGRAM_BINARY_FORMATS_OES (the same
+// values as desktop GL's GL_PROGRAM_BINARY_LENGTH and GL_NUM_PROGRAM_BINARY_FORMATS)
+GLenum const program_binary_length = 0x8741;
+GLenum const num_program_binary_formats = 0x87FE;
+
+char const magic[8] = {'M', 'I', 'R', 'P', 'R', 'O', 'G', '1'};
+char const suffix[] = ".bin";
+
+auto has_extension(char const* extensions, char const* name) -> bool
+{
+    auto const length = strlen(name);
+    for (auto found = strstr(extensions, name); found; found = strstr(found + length, name))
+    {
+        if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0'))
+            return true;
+    }
+    return false;
+}
+
+/// FNV-1a, which unlike std::hash is the same from one build to the next
+void hash_into(uint64_t& hash, char const* string)
+{
+    for (auto c = string; ; ++c)
+    {
+        hash ^= static_cast<unsigned char>(*c);
+        hash *= 0x100000001b3;
+        if (!*c)
+            break;
+    }
+}
+
+auto gl_string(GLenum name) -> char const*
+{
+    auto const value = reinterpret_cast<char const*>(glGetString(name));
+    return value ? value : "";
+}
+}
+
+mrg::ProgramCache::ProgramCache(std::string const& directory) :
+    directory{directory}
+{
+    directory_read = std::async(std::launch::async, [this] { read_directory(); });
+}
+
+mrg::ProgramCache::~ProgramCache()
+{
+    // The reader fills binaries, which is destroyed before directory_read
+    directory_read.wait();
+}
+
+auto mrg::ProgramCache::load(GLchar const* vertex_src, GLchar const* fragment_src) -> GLuint
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    directory_read.wait();
+
+    if (!supported())
+        return 0;
+
+    auto const key = key_for(vertex_src, fragment_src);
+    auto const found = binaries.find(key);
+    if (found == binaries.end())
+        return 0;
+
+    auto const& binary = found->second;
+    auto const program = glCreateProgram();
+    program_binary(program, binary.format, binary.data.data(), binary.data.size());
+
+    GLint ok = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok)
+    {
+        // Most likely the driver changed without changing its version string
+        glDeleteProgram(program);
+        forget(key);
+        return 0;
+    }
+
+    return program;
+}
+
+void mrg::ProgramCache::store(GLuint program, GLchar const* vertex_src, GLchar const* fragment_src)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    directory_read.wait();
+
+    if (!supported())
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(program, program_binary_length, &length);
+    if (length <= 0)
+        return;
+
+    Binary binary{0, std::vector<char>(length)};
+    GLsizei written = 0;
+    get_program_binary(program, length, &written, &binary.format, binary.data.data());
+    if (written <= 0)
+        return;
+    binary.data.resize(written);
+
+    auto const key = key_for(vertex_src, fragment_src);
+    try
+    {
+        save(key, binary);
+    }
+    catch (std::exception const& error)
+    {
+        mir::log_warning("Failed to save shader program: %s", error.what());
+    }
+    binaries[key] = std::move(binary);
+}
+
+auto mrg::ProgramCache::supported() -> bool
+{
+    auto const extensions = reinterpret_cast<char const*>(glGetString(GL_EXTENSIONS));
+    if (!extensions)
+        return false;
+
+    char const* get_name;
+    char const* set_name;
+    if (has_extension(extensions, "GL_OES_get_program_binary"))
+    {
+        get_name = "glGetProgramBinaryOES";
+        set_name = "glProgramBinaryOES";
+    }
+    else if (has_extension(extensions, "GL_ARB_get_program_binary"))
+    {
+        get_name = "glGetProgramBinary";
+        set_name = "glProgramBinary";
+    }
+    else
+    {
+        return false;
+    }
+
+    // Drivers may advertise the extension yet offer no format to save programs in
+    GLint formats = 0;
+    glGetIntegerv(num_program_binary_formats, &formats);
+    if (formats < 1)
+        return false;
+
+    if (!get_program_binary || !program_binary)
+    {
+        get_program_binary = reinterpret_cast<GetProgramBinary>(eglGetProcAddress(get_name));
+        program_binary = reinterpret_cast<ProgramBinary>(eglGetProcAddress(set_name));
+    }
+
+    return get_program_binary && program_binary;
+}
+
+auto mrg::ProgramCache::key_for(GLchar const* vertex_src, GLchar const* fragment_src) const -> uint64_t
+{
+    uint64_t hash = 0xcbf29ce484222325;
+    for (auto const name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+        hash_into(hash, gl_string(name));
+    hash_into(hash, vertex_src);
+    hash_into(hash, fragment_src);
+    return hash;
+}
+
+auto mrg::ProgramCache::path_for(uint64_t key) const -> std::string
+{
+    char name[17];
+    snprintf(name, sizeof name, "%016llx", static_cast<unsigned long long>(key));
+    return directory + "/" + name + suffix;
+}
+
+void mrg::ProgramCache::read_directory()
+{
+    struct Closedir { void operator()(DIR* dir) const { closedir(dir); } };
+    std::unique_ptr<DIR, Closedir> const dir{opendir(directory.c_str())};
+    if (!dir)
+        return;
+
+    while (auto const entry = readdir(dir.get()))
+    {
+        std::string const path = directory + "/" + entry->d_name;
+        if (path.size() < sizeof suffix || path.compare(path.size() - (sizeof suffix - 1), std::string::npos, suffix) != 0)
+            continue;
+
+        std::ifstream in{path, std::ios::binary};
+        char file_magic[sizeof magic];
+        uint64_t key;
+        uint32_t format;
+        if (!in.read(file_magic, sizeof file_magic) || memcmp(file_magic, magic, sizeof magic) != 0 ||
+            !in.read(reinterpret_cast<char*>(&key), sizeof key) ||
+            !in.read(reinterpret_cast<char*>(&format), sizeof format) ||
+            path_for(key) != path)
+        {
+            continue;
+        }
+
+        std::vector<char> data{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+        if (!data.empty())
+            binaries[key] = Binary{format, std::move(data)};
+    }
+}
+
+void mrg::ProgramCache::save(uint64_t key, Binary const& binary) const
+{
+    if (mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST)
+        BOOST_THROW_EXCEPTION((std::system_error{errno, std::system_category(), "Failed to create " + directory}));
+
+    // Write a new file and rename it over the old, so another server never reads half a file
+    auto const path = path_for(key);
+    auto const temporary = path + ".new";
+    {
+        std::ofstream out{temporary, std::ios::binary | std::ios::trunc};
+        uint32_t const format = binary.format;
+        out.write(magic, sizeof magic);
+        out.write(reinterpret_cast<char const*>(&key), sizeof key);
+        out.write(reinterpret_cast<char const*>(&format), sizeof format);
+        out.write(binary.data.data(), binary.data.size());
+
+        if (!out.flush())
+            BOOST_THROW_EXCEPTION((std::system_error{errno, std::system_category(), "Failed to write " + temporary}));
+    }
+
+    if (rename(temporary.c_str(), path.c_str()) != 0)
+        BOOST_THROW_EXCEPTION((std::system_error{errno, std::system_category(), "Failed to replace " + path}));
+}
+
+void mrg::ProgramCache::forget(uint64_t key)
+{
+    binaries.erase(key);
+    unlink(path_for(key).c_str());
+}
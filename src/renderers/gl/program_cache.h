@@ -0,0 +1,92 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_RENDERER_GL_PROGRAM_CACHE_H_
+#define MIR_RENDERER_GL_PROGRAM_CACHE_H_
+
+#include MIR_SERVER_GL_H
+
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mir
+{
+namespace renderer
+{
+namespace gl
+{
+
+/**
+ * Keeps the binaries of linked GL programs in a directory (using
+ * GL_OES_get_program_binary), so that later runs - and renderers created
+ * when outputs are reconfigured - needn't compile the same shaders again.
+ *
+ * Programs are keyed by the GL vendor, renderer and version strings and the
+ * shader sources, so a driver update or a changed shader misses the cache.
+ * Whatever the directory holds is read in the background from construction,
+ * so that it's ready by the time the first renderer needs it.
+ *
+ * load() and store() must be called with a current GL context; without
+ * driver support they do nothing.
+ */
+class ProgramCache
+{
+public:
+    explicit ProgramCache(std::string const& directory);
+    ~ProgramCache();
+
+    /// A new program linked from a cached binary, or 0 if there's none (or the driver rejects it)
+    auto load(GLchar const* vertex_src, GLchar const* fragment_src) -> GLuint;
+
+    /// Saves the binary of a successfully linked program
+    void store(GLuint program, GLchar const* vertex_src, GLchar const* fragment_src);
+
+private:
+    struct Binary
+    {
+        GLenum format;
+        std::vector<char> data;
+    };
+
+    using GetProgramBinary = void (*)(GLuint, GLsizei, GLsizei*, GLenum*, void*);
+    using ProgramBinary = void (*)(GLuint, GLenum, void const*, GLint);
+
+    /// Resolves the extension functions, if the current context has them
+    auto supported() -> bool;
+    auto key_for(GLchar const* vertex_src, GLchar const* fragment_src) const -> uint64_t;
+    auto path_for(uint64_t key) const -> std::string;
+    void read_directory();
+    void save(uint64_t key, Binary const& binary) const;
+    void forget(uint64_t key);
+
+    std::string const directory;
+
+    std::mutex mutex;
+    std::future<void> directory_read;
+    std::unordered_map<uint64_t, Binary> binaries;
+    GetProgramBinary get_program_binary{nullptr};
+    ProgramBinary program_binary{nullptr};
+};
+
+}
+}
+}
+
+#endif // MIR_RENDERER_GL_PROGRAM_CACHE_H_
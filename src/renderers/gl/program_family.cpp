@@ -17,6 +17,7 @@
  */
 
 #include "program_family.h"
+#include "program_cache.h"
 #include MIR_SERVER_GL_H
 #include MIR_SERVER_GLEXT_H
 #include <mutex>
@@ -53,6 +54,11 @@ void ProgramFamily::Shader::init(GLenum type, const GLchar* src)
     }
 }
 
+ProgramFamily::ProgramFamily(std::shared_ptr<ProgramCache> const& cache)
+    : cache{cache}
+{
+}
+
 ProgramFamily::~ProgramFamily() noexcept
 {
     // shader and program lifetimes are managed manually, so that we don't
@@ -65,6 +71,12 @@ ProgramFamily::~ProgramFamily() noexcept
             glDeleteProgram(p.second.id);
     }
 
+    for (auto& p : cached_program)
+    {
+        if (p.second.id)
+            glDeleteProgram(p.second.id);
+    }
+
     for (auto& v : vshader)
     {
         if (v.second.id)
@@ -89,6 +101,13 @@ GLuint ProgramFamily::add_program(const GLchar* const vshader_src,
     static std::mutex lp1416482_mutex;
     std::lock_guard<decltype(lp1416482_mutex)> lock{lp1416482_mutex};
 
+    if (cache)
+    {
+        auto& c = cached_program[{vshader_src, fshader_src}];
+        if (!c.id) c.id = cache->load(vshader_src, fshader_src);
+        if (c.id) return c.id;
+    }
+
     auto& v = vshader[vshader_src];
     if (!v.id) v.init(GL_VERTEX_SHADER, vshader_src);
 
@@ -113,6 +132,9 @@ GLuint ProgramFamily::add_program(const GLchar* const vshader_src,
             p.id = 0;
             throw std::runtime_error(std::string("Link failed: ")+log);
         }
+
+        if (cache)
+            cache->store(p.id, vshader_src, fshader_src);
     }
 
     return p.id;
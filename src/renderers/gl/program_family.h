@@ -22,6 +22,7 @@
 #include MIR_SERVER_GL_H
 #include <utility>
 #include <map>
+#include <memory>
 #include <unordered_map>
 
 namespace mir
@@ -30,6 +31,7 @@ namespace renderer
 {
 namespace gl
 {
+class ProgramCache;
 
 /**
  * ProgramFamily represents a set of GLSL programs that are closely
@@ -38,11 +40,14 @@ namespace gl
  *   A secondary intention is that this class may be extended to allow the
  * different programs within the family to share common patterns of uniform
  * usage too.
+ *   Given a ProgramCache, programs are linked from cached binaries where
+ * possible (and don't need their shaders compiled at all).
  */
 class ProgramFamily
 {
 public:
     ProgramFamily() = default;
+    explicit ProgramFamily(std::shared_ptr<ProgramCache> const& cache);
     ProgramFamily(ProgramFamily const&) = delete;
     ProgramFamily& operator=(ProgramFamily const&) = delete;
     ~ProgramFamily() noexcept;
@@ -65,6 +70,10 @@ private:
         GLuint id = 0;
     };
     std::map<ShaderPair, Program> program;
+
+    std::shared_ptr<ProgramCache> const cache;
+    typedef std::pair<const GLchar*, const GLchar*> SourcePair;
+    std::map<SourcePair, Program> cached_program;
 };
 
 }
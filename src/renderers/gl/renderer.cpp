@@ -19,7 +19,9 @@
 #define MIR_LOG_COMPONENT "GLRenderer"
 
 #include "renderer.h"
+#include "program_cache.h"
 #include "mir/compositor/buffer_stream.h"
+#include "mir/compositor/frame_timing_recorder.h"
 #include "mir/gl/default_program_factory.h"
 #include "mir/graphics/renderable.h"
 #include "mir/graphics/buffer.h"
@@ -44,6 +46,7 @@
 #include <cmath>
 #include <sstream>
 
+namespace mc = mir::compositor;
 namespace mg = mir::graphics;
 namespace mgl = mir::gl;
 namespace mrg = mir::renderer::gl;
@@ -199,9 +202,11 @@ class mrg::Renderer::ProgramFactory : public mir::graphics::gl::ProgramFactory
 {
 public:
     // NOTE: This must be called with a current GL context
-    ProgramFactory()
-        : vertex_shader{compile_shader(GL_VERTEX_SHADER, vertex_shader_src)}
+    ProgramFactory(std::shared_ptr<ProgramCache> const& cache)
+        : cache{cache}
     {
+        if (!cache)
+            vertex_shader = std::make_unique<ShaderHandle>(compile_shader(GL_VERTEX_SHADER, vertex_shader_src));
     }
 
     mir::graphics::gl::Program&
@@ -260,22 +265,40 @@ public:
         // GL shader compilation is *not* threadsafe, and requires external synchronisation
         std::lock_guard<std::mutex> lock{compilation_mutex};
 
-        ShaderHandle const opaque_shader{
-            compile_shader(GL_FRAGMENT_SHADER, opaque_fragment.str().c_str())};
-        ShaderHandle const alpha_shader{
-            compile_shader(GL_FRAGMENT_SHADER, alpha_fragment.str().c_str())};
+        auto opaque_program = program_for(opaque_fragment.str());
+        auto alpha_program = program_for(alpha_fragment.str());
 
         programs.emplace_back(id, std::make_unique<::Program>(
-            link_shader(vertex_shader, opaque_shader),
-            link_shader(vertex_shader, alpha_shader)));
+            std::move(opaque_program),
+            std::move(alpha_program)));
 
         return *programs.back().second;
-
-        // We delete opaque_shader and alpha_shader here. This is fine; it only marks them
-        // for deletion. GL will only delete them once the GL Program they're linked in is destroyed.
     }
 
 private:
+    /// Links a program from the cache if it's there; otherwise compiles (and caches) it
+    ProgramHandle program_for(std::string const& fragment_src)
+    {
+        if (cache)
+        {
+            if (auto const cached = cache->load(vertex_shader_src, fragment_src.c_str()))
+                return ProgramHandle{cached};
+        }
+
+        if (!vertex_shader)
+            vertex_shader = std::make_unique<ShaderHandle>(compile_shader(GL_VERTEX_SHADER, vertex_shader_src));
+
+        ShaderHandle const fragment_shader{compile_shader(GL_FRAGMENT_SHADER, fragment_src.c_str())};
+        auto program = link_shader(*vertex_shader, fragment_shader);
+
+        if (cache)
+            cache->store(program, vertex_shader_src, fragment_src.c_str());
+
+        // We delete fragment_shader on return. This is fine; it only marks it for deletion.
+        // GL will only delete it once the GL Program it's linked in is destroyed.
+        return program;
+    }
+
     static GLuint compile_shader(GLenum type, GLchar const* src)
     {
         GLuint id = glCreateShader(type);
@@ -324,7 +347,9 @@ private:
         return program;
     }
 
-    ShaderHandle const vertex_shader;
+    std::shared_ptr<ProgramCache> const cache;
+    /// Compiled when first needed: with a cache it may never be
+    std::unique_ptr<ShaderHandle> vertex_shader;
     std::vector<std::pair<void*, std::unique_ptr<::Program>>> programs;
     // GL requires us to synchronise multi-threaded access to the shader APIs.
     std::mutex compilation_mutex;
@@ -351,11 +376,17 @@ mrg::Renderer::Program::Program(GLuint program_id)
 }
 
 mrg::Renderer::Renderer(graphics::DisplayBuffer& display_buffer)
+    : Renderer(display_buffer, nullptr)
+{
+}
+
+mrg::Renderer::Renderer(graphics::DisplayBuffer& display_buffer, std::shared_ptr<ProgramCache> const& program_cache)
     : render_target(&display_buffer),
       clear_color{0.0f, 0.0f, 0.0f, 0.0f},
+      family{program_cache},
       default_program(family.add_program(vshader, default_fshader)),
       alpha_program(family.add_program(vshader, alpha_fshader)),
-      program_factory{std::make_unique<ProgramFactory>()},
+      program_factory{std::make_unique<ProgramFactory>(program_cache)},
       texture_cache(mgl::DefaultProgramFactory().create_texture_cache()),
       display_transform(1)
 {
@@ -434,10 +465,14 @@ void mrg::Renderer::render(mg::RenderableList const& renderables) const
     ++frameno;
     for (auto const& r : renderables)
     {
+        mc::FrameTimingRecorder::StageTimer const timer{mc::FrameStage::gl_submission, r->id()};
         draw(*r);
     }
 
-    render_target.swap_buffers();
+    {
+        mc::FrameTimingRecorder::StageTimer const timer{mc::FrameStage::gl_submission};
+        render_target.swap_buffers();
+    }
 
     // Deleting unused textures only requires the GL context. This clean-up
     // does not affect screen contents so can happen after swap_buffers...
@@ -471,6 +506,7 @@ void mrg::Renderer::draw(mg::Renderable const& renderable) const
         {
             if (need_fallback)
             {
+                mc::FrameTimingRecorder::StageTimer const timer{mc::FrameStage::texture_binding, renderable.id()};
                 try
                 {
                     return texture_cache->load(renderable);
@@ -601,13 +637,16 @@ void mrg::Renderer::draw(mg::Renderable const& renderable) const
             BlendSeparate blend;
 
             blend = client_blend;
-            if (surface_tex)
             {
-                surface_tex->bind();
-            }
-            else
-            {
-                texture->bind();
+                mc::FrameTimingRecorder::StageTimer const timer{mc::FrameStage::texture_binding, renderable.id()};
+                if (surface_tex)
+                {
+                    surface_tex->bind();
+                }
+                else
+                {
+                    texture->bind();
+                }
             }
 
             glVertexAttribPointer(prog.position_attr, 3, GL_FLOAT,
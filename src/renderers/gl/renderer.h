@@ -41,6 +41,7 @@ namespace renderer
 {
 namespace gl
 {
+class ProgramCache;
 
 class CurrentRenderTarget
 {
@@ -60,6 +61,8 @@ class Renderer : public renderer::Renderer
 {
 public:
     Renderer(graphics::DisplayBuffer& display_buffer);
+    /// Links programs from (and saves them to) program_cache, if not null
+    Renderer(graphics::DisplayBuffer& display_buffer, std::shared_ptr<ProgramCache> const& program_cache);
     virtual ~Renderer();
 
     // These are called with a valid GL context:
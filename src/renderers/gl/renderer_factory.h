@@ -27,12 +27,20 @@ namespace renderer
 {
 namespace gl
 {
+class ProgramCache;
 
 class RendererFactory : public renderer::RendererFactory
 {
 public:
+    RendererFactory() = default;
+    /// The renderers created share program_cache
+    explicit RendererFactory(std::shared_ptr<ProgramCache> const& program_cache);
+
     std::unique_ptr<renderer::Renderer> create_renderer_for(
         graphics::DisplayBuffer& display_buffer) override;
+
+private:
+    std::shared_ptr<ProgramCache> const program_cache;
 };
 
 }
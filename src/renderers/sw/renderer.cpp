@@ -0,0 +1,450 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "renderer.h"
+#include "mir/renderer/sw/pixel_source.h"
+#include "mir/renderer/sw/pixel_target.h"
+#include "mir/compositor/frame_timing_recorder.h"
+#include "mir/graphics/buffer.h"
+#include "mir/thread/parallel_pool.h"
+#include "mir/log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace mg = mir::graphics;
+namespace mc = mir::compositor;
+namespace mrs = mir::renderer::software;
+namespace geom = mir::geometry;
+
+namespace
+{
+/// Damage is remembered for targets with up to this many buffers
+size_t const max_buffer_age{3};
+
+/// Beyond this many rectangles damage is repaired as their bounding rectangle
+size_t const max_damage_rectangles{16};
+
+/// The height of the bands damage is split into to draw in parallel
+int const rows_per_band{32};
+
+/// Adds rect to damage, merging it with any rectangles it overlaps so that no pixel is drawn twice
+void add_damage(geom::Rectangles& damage, geom::Rectangle rect)
+{
+    if (rect.size.width.as_int() <= 0 || rect.size.height.as_int() <= 0)
+        return;
+
+    for (auto merged = true; merged;)
+    {
+        merged = false;
+        for (auto const existing : damage)
+        {
+            if (existing.overlaps(rect))
+            {
+                rect = geom::Rectangles{existing, rect}.bounding_rectangle();
+                damage.remove(existing);
+                merged = true;
+                break;
+            }
+        }
+    }
+
+    damage.add(rect);
+
+    if (damage.size() > max_damage_rectangles)
+        damage = geom::Rectangles{damage.bounding_rectangle()};
+}
+
+/// Scales each channel of a packed pixel by factor/256, two channels per multiply
+inline uint32_t scaled(uint32_t pixel, uint32_t factor)
+{
+    auto const rb = (((pixel & 0x00ff00ffu) * factor) >> 8) & 0x00ff00ffu;
+    auto const ag = (((pixel >> 8) & 0x00ff00ffu) * factor) & 0xff00ff00u;
+    return rb | ag;
+}
+
+inline uint32_t swapped_red_blue(uint32_t pixel)
+{
+    return (pixel & 0xff00ff00u) | ((pixel & 0x00ff0000u) >> 16) | ((pixel & 0x000000ffu) << 16);
+}
+
+// The blend functions match those the GL renderer uses (and, like it, leave
+// the destination alpha alone for sources without an alpha channel).
+
+/// An opaque source without alpha: GL_ONE, GL_ZERO
+void copy_row(uint32_t* dest, uint32_t const* src, int width)
+{
+    for (int i = 0; i != width; ++i)
+        dest[i] = (src[i] & 0x00ffffffu) | (dest[i] & 0xff000000u);
+}
+
+/// A translucent source without alpha: GL_ONE (of the faded source), GL_ONE_MINUS_CONSTANT_ALPHA
+void fade_row(uint32_t* dest, uint32_t const* src, int width, uint32_t alpha)
+{
+    auto const dest_factor = 256 - alpha;
+    for (int i = 0; i != width; ++i)
+    {
+        auto const rgb = scaled(src[i], alpha) + scaled(dest[i], dest_factor);
+        dest[i] = (rgb & 0x00ffffffu) | (dest[i] & 0xff000000u);
+    }
+}
+
+/// A premultiplied source with alpha: GL_ONE, GL_ONE_MINUS_SRC_ALPHA
+void over_row(uint32_t* dest, uint32_t const* src, int width, uint32_t alpha)
+{
+    if (alpha == 256)
+    {
+        for (int i = 0; i != width; ++i)
+            dest[i] = src[i] + scaled(dest[i], 256 - (src[i] >> 24));
+    }
+    else
+    {
+        for (int i = 0; i != width; ++i)
+        {
+            auto const faded = scaled(src[i], alpha);
+            dest[i] = faded + scaled(dest[i], 256 - (faded >> 24));
+        }
+    }
+}
+
+auto in_target(geom::Rectangle const& rect, geom::Rectangle const& viewport) -> geom::Rectangle
+{
+    return {
+        {rect.left().as_int() - viewport.left().as_int(), rect.top().as_int() - viewport.top().as_int()},
+        rect.size};
+}
+}
+
+mrs::Renderer::Renderer(PixelTarget& target, std::shared_ptr<thread::ParallelPool> const& pool) :
+    target(target),
+    pool{pool},
+    viewport{{0, 0}, target.size()}
+{
+}
+
+void mrs::Renderer::set_viewport(geom::Rectangle const& rect)
+{
+    auto const clipped = rect.intersection_with({rect.top_left, target.size()});
+    if (clipped == viewport)
+        return;
+
+    viewport = clipped;
+    last_frame.clear();
+    damage_history.clear();
+    history_valid = false;
+}
+
+void mrs::Renderer::set_output_transform(glm::mat2 const& t)
+{
+    if (t != glm::mat2{1} && !target.applies_transformation() && !warned_about_transformations)
+    {
+        mir::log_warning("The software renderer does not support rotated or reflected outputs");
+        warned_about_transformations = true;
+    }
+}
+
+void mrs::Renderer::suspend()
+{
+    // Whatever was on the target while we were suspended, we didn't draw it
+    history_valid = false;
+}
+
+void mrs::Renderer::render(mg::RenderableList const& renderables) const
+{
+    std::vector<Drawn> next;
+    next.reserve(renderables.size());
+    for (auto const& renderable : renderables)
+        next.push_back(drawn(*renderable));
+
+    auto const frame_damage = history_valid ? damage_since(last_frame, next) : geom::Rectangles{viewport};
+    auto const repair = damage_to_repair(frame_damage);
+
+    if (repair.size())
+    {
+        std::vector<Source> sources;
+        for (size_t i = 0; i != renderables.size(); ++i)
+        {
+            auto const needs_drawing = std::any_of(
+                repair.begin(), repair.end(), [&](auto const& region) { return region.overlaps(next[i].area); });
+
+            if (needs_drawing)
+            {
+                auto source = source_for(*renderables[i], next[i]);
+                if (source.pixel_source)
+                    sources.push_back(std::move(source));
+            }
+        }
+
+        std::vector<geom::Rectangle> bands;
+        for (auto const& region : repair)
+        {
+            for (auto y = region.top().as_int(); y < region.bottom().as_int(); y += rows_per_band)
+            {
+                auto const rows = std::min(rows_per_band, region.bottom().as_int() - y);
+                bands.push_back({{region.left(), geom::Y{y}}, {region.size.width, geom::Height{rows}}});
+            }
+        }
+
+        auto const pixels = target.map_pixels();
+        auto const stride = target.stride().as_int();
+
+        read_sources(sources, [&]
+            {
+                mc::FrameTimingRecorder::StageTimer const timer{mc::FrameStage::gl_submission};
+                pool->for_each(bands.size(), [&](size_t band)
+                    {
+                        auto const in_pixels = in_target(bands[band], viewport);
+                        auto const row_bytes = in_pixels.size.width.as_int() * 4;
+                        for (auto y = in_pixels.top().as_int(); y != in_pixels.bottom().as_int(); ++y)
+                            memset(pixels + y * stride + in_pixels.left().as_int() * 4, 0, row_bytes);
+
+                        for (auto const& source : sources)
+                        {
+                            auto const to_draw = source.area.intersection_with(bands[band]);
+                            if (to_draw.size.width.as_int() > 0 && to_draw.size.height.as_int() > 0)
+                                draw(source, to_draw, pixels);
+                        }
+                    });
+            });
+    }
+
+    damage_history.push_front(frame_damage);
+    if (damage_history.size() > max_buffer_age)
+        damage_history.pop_back();
+    last_frame = std::move(next);
+    history_valid = true;
+
+    geom::Rectangles target_damage;
+    for (auto const& rect : frame_damage)
+        target_damage.add(in_target(rect, viewport));
+
+    mc::FrameTimingRecorder::StageTimer const timer{mc::FrameStage::gl_submission};
+    target.commit(target_damage);
+}
+
+auto mrs::Renderer::drawn(mg::Renderable const& renderable) const -> Drawn
+{
+    auto area = renderable.screen_position().intersection_with(viewport);
+    if (auto const clip_area = renderable.clip_area())
+        area = area.intersection_with(clip_area.value());
+
+    if (renderable.transformation() != glm::mat4{1} && !warned_about_transformations)
+    {
+        mir::log_warning("The software renderer does not support surface transformations");
+        warned_about_transformations = true;
+    }
+
+    auto const buffer = renderable.buffer();
+    return {
+        renderable.id(),
+        buffer ? buffer->id() : mg::BufferID{},
+        area,
+        renderable.alpha(),
+        renderable.shaped()};
+}
+
+auto mrs::Renderer::damage_since(std::vector<Drawn> const& last, std::vector<Drawn> const& next) const
+-> geom::Rectangles
+{
+    geom::Rectangles damage;
+
+    std::unordered_map<mg::Renderable::ID, size_t> last_index;
+    for (size_t i = 0; i != last.size(); ++i)
+        last_index[last[i].id] = i;
+
+    std::vector<bool> still_present(last.size(), false);
+    size_t highest_index_so_far = 0;
+
+    for (auto const& now : next)
+    {
+        auto const found = last_index.find(now.id);
+        if (found == last_index.end())
+        {
+            add_damage(damage, now.area);
+            continue;
+        }
+
+        auto const& before = last[found->second];
+        still_present[found->second] = true;
+
+        // Anything that was below something it is now above needs redrawing
+        auto const restacked = found->second < highest_index_so_far;
+        highest_index_so_far = std::max(highest_index_so_far, found->second);
+
+        if (restacked ||
+            before.buffer != now.buffer ||
+            before.area != now.area ||
+            before.alpha != now.alpha ||
+            before.shaped != now.shaped)
+        {
+            add_damage(damage, before.area);
+            add_damage(damage, now.area);
+        }
+    }
+
+    for (size_t i = 0; i != last.size(); ++i)
+    {
+        if (!still_present[i])
+            add_damage(damage, last[i].area);
+    }
+
+    return damage;
+}
+
+auto mrs::Renderer::damage_to_repair(geom::Rectangles const& frame_damage) const -> geom::Rectangles
+{
+    // The target's pixels are from buffer_age frames ago, so need the damage of every frame since
+    auto const age = target.buffer_age();
+    if (!history_valid || age == 0 || age - 1 > damage_history.size())
+        return geom::Rectangles{viewport};
+
+    geom::Rectangles repair;
+    for (auto const& rect : frame_damage)
+        add_damage(repair, rect);
+
+    for (unsigned frame = 0; frame + 1 < age; ++frame)
+    {
+        for (auto const& rect : damage_history[frame])
+            add_damage(repair, rect);
+    }
+
+    return repair;
+}
+
+auto mrs::Renderer::source_for(mg::Renderable const& renderable, Drawn const& drawn) const -> Source
+{
+    auto const buffer = renderable.buffer();
+    auto const pixel_source = buffer ? dynamic_cast<PixelSource*>(buffer->native_buffer_base()) : nullptr;
+    auto const format = buffer ? buffer->pixel_format() : mir_pixel_format_invalid;
+
+    bool const readable =
+        pixel_source &&
+        (format == mir_pixel_format_argb_8888 || format == mir_pixel_format_xrgb_8888 ||
+         format == mir_pixel_format_abgr_8888 || format == mir_pixel_format_xbgr_8888);
+
+    if (!readable)
+    {
+        if (!warned_about_unreadable_buffers)
+        {
+            mir::log_warning("The software renderer can only draw 32-bit software buffers; skipping others");
+            warned_about_unreadable_buffers = true;
+        }
+        return {};
+    }
+
+    auto const alpha = static_cast<uint32_t>(std::lround(std::min(std::max(renderable.alpha(), 0.0f), 1.0f) * 256));
+    auto const buffer_size = buffer->size();
+    if (alpha == 0 || buffer_size.width.as_int() <= 0 || buffer_size.height.as_int() <= 0)
+        return {};
+
+    return {
+        buffer,
+        pixel_source,
+        nullptr,
+        drawn.area,
+        renderable.screen_position(),
+        alpha,
+        renderable.shaped(),
+        format == mir_pixel_format_abgr_8888 || format == mir_pixel_format_xbgr_8888};
+}
+
+void mrs::Renderer::read_sources(std::vector<Source>& sources, std::function<void()> const& then) const
+{
+    // Reading may lock a buffer, and other outputs' compositors may be reading the same buffers.
+    // Taking them in address order means no two compositors can each hold one the other waits for,
+    // and a buffer shown more than once is read (and locked) only once.
+    std::vector<PixelSource*> to_read;
+    for (auto const& source : sources)
+        to_read.push_back(source.pixel_source);
+
+    std::sort(to_read.begin(), to_read.end(), std::less<PixelSource*>{});
+    to_read.erase(std::unique(to_read.begin(), to_read.end()), to_read.end());
+
+    read_sources(to_read, 0, sources, then);
+}
+
+void mrs::Renderer::read_sources(
+    std::vector<PixelSource*> const& to_read,
+    size_t from,
+    std::vector<Source>& sources,
+    std::function<void()> const& then) const
+{
+    if (from == to_read.size())
+    {
+        then();
+        return;
+    }
+
+    // Read each buffer once per frame, rather than once per band
+    to_read[from]->read(
+        [&](unsigned char const* pixels)
+        {
+            for (auto& source : sources)
+            {
+                if (source.pixel_source == to_read[from])
+                    source.pixels = pixels;
+            }
+            read_sources(to_read, from + 1, sources, then);
+        });
+}
+
+void mrs::Renderer::draw(Source const& source, geom::Rectangle const& region, unsigned char* pixels) const
+{
+    auto const& position = source.position;
+    auto const buffer_size = source.buffer->size();
+    auto const width = region.size.width.as_int();
+    auto const stretched = buffer_size != position.size;
+    auto const target_stride = target.stride().as_int();
+    auto const source_stride = source.pixel_source->stride().as_int();
+    auto const in_pixels = in_target(region, viewport);
+
+    // Rows needing conversion are converted here before blending
+    std::vector<uint32_t> converted(source.swap_red_blue || stretched ? width : 0);
+
+    for (auto y = region.top().as_int(); y != region.bottom().as_int(); ++y)
+    {
+        auto const source_y =
+            (y - position.top().as_int()) * buffer_size.height.as_int() / position.size.height.as_int();
+        auto const source_row = reinterpret_cast<uint32_t const*>(source.pixels + source_y * source_stride);
+        auto const left_in_source = region.left().as_int() - position.left().as_int();
+
+        uint32_t const* src = source_row + left_in_source;
+        if (!converted.empty())
+        {
+            for (int i = 0; i != width; ++i)
+            {
+                auto const source_x = stretched ?
+                    (left_in_source + i) * buffer_size.width.as_int() / position.size.width.as_int() :
+                    left_in_source + i;
+                auto const pixel = source_row[source_x];
+                converted[i] = source.swap_red_blue ? swapped_red_blue(pixel) : pixel;
+            }
+            src = converted.data();
+        }
+
+        auto const dest_y = y - region.top().as_int() + in_pixels.top().as_int();
+        auto const dest = reinterpret_cast<uint32_t*>(pixels + dest_y * target_stride) + in_pixels.left().as_int();
+
+        if (source.shaped)
+            over_row(dest, src, width, source.alpha);
+        else if (source.alpha == 256)
+            copy_row(dest, src, width);
+        else
+            fade_row(dest, src, width, source.alpha);
+    }
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_RENDERER_SW_RENDERER_H_
+#define MIR_RENDERER_SW_RENDERER_H_
+
+#include <mir/renderer/renderer.h>
+#include <mir/geometry/rectangle.h>
+#include <mir/geometry/rectangles.h>
+#include <mir/graphics/buffer_id.h>
+#include <mir/graphics/renderable.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace mir
+{
+namespace thread { class ParallelPool; }
+namespace renderer
+{
+namespace software
+{
+class PixelSource;
+class PixelTarget;
+
+/**
+ * Composites on the CPU, straight into a PixelTarget.
+ *
+ * Only the parts of the output that changed are redrawn: a renderable is
+ * taken to be unchanged while its buffer, position, clip, alpha and stacking
+ * are. (Wayland and mirclient buffers may not be written to while they are
+ * held by the compositor, so the buffer ID is enough to identify content.)
+ * Damage from previous frames is added according to the target's
+ * buffer_age().
+ *
+ * What needs redrawing is split into bands of rows, which are drawn in
+ * parallel on the threads of the pool.
+ *
+ * Buffers that are not PixelSources (i.e. hardware buffers) can't be read
+ * and aren't drawn, and neither output nor renderable transformations are
+ * applied.
+ */
+class Renderer : public renderer::Renderer
+{
+public:
+    Renderer(PixelTarget& target, std::shared_ptr<thread::ParallelPool> const& pool);
+
+    void set_viewport(geometry::Rectangle const& rect) override;
+    void set_output_transform(glm::mat2 const&) override;
+    void render(graphics::RenderableList const&) const override;
+    void suspend() override;
+
+private:
+    /// What was drawn of a renderable, as far as damage is concerned
+    struct Drawn
+    {
+        graphics::Renderable::ID id;
+        graphics::BufferID buffer;
+        geometry::Rectangle area;   ///< Screen coordinates, clipped to the viewport
+        float alpha;
+        bool shaped;
+    };
+
+    /// A renderable to be drawn, with its pixels once they've been read
+    struct Source
+    {
+        std::shared_ptr<graphics::Buffer> buffer;
+        PixelSource* pixel_source;
+        unsigned char const* pixels;
+        geometry::Rectangle area;   ///< As Drawn::area
+        geometry::Rectangle position;
+        uint32_t alpha;             ///< Out of 256
+        bool shaped;
+        bool swap_red_blue;
+    };
+
+    auto drawn(graphics::Renderable const& renderable) const -> Drawn;
+    auto damage_since(std::vector<Drawn> const& last, std::vector<Drawn> const& next) const -> geometry::Rectangles;
+    auto damage_to_repair(geometry::Rectangles const& frame_damage) const -> geometry::Rectangles;
+    auto source_for(graphics::Renderable const& renderable, Drawn const& drawn) const -> Source;
+    /// Reads the pixels of every source and, while they are readable, calls then()
+    void read_sources(std::vector<Source>& sources, std::function<void()> const& then) const;
+    /// Reads to_read[from] onwards (nested, in that order) into the sources they back, then calls then()
+    void read_sources(
+        std::vector<PixelSource*> const& to_read,
+        size_t from,
+        std::vector<Source>& sources,
+        std::function<void()> const& then) const;
+    void draw(Source const& source, geometry::Rectangle const& region, unsigned char* pixels) const;
+
+    PixelTarget& target;
+    std::shared_ptr<thread::ParallelPool> const pool;
+    geometry::Rectangle viewport;
+
+    mutable std::vector<Drawn> last_frame;
+    mutable std::deque<geometry::Rectangles> damage_history;  ///< Most recent frame first
+    mutable bool history_valid{false};
+
+    mutable bool warned_about_unreadable_buffers{false};
+    mutable bool warned_about_transformations{false};
+};
+
+}
+}
+}
+
+#endif // MIR_RENDERER_SW_RENDERER_H_
@@ -166,10 +166,25 @@ mc::CompositingScreencast::CompositingScreencast(
     std::shared_ptr<mg::Display> const& display,
     std::shared_ptr<mg::GraphicBufferAllocator> const& buffer_allocator,
     std::shared_ptr<DisplayBufferCompositorFactory> const& db_compositor_factory)
+#ifdef MIR_EGL_SUPPORTED
+    : CompositingScreencast{scene, display, buffer_allocator, db_compositor_factory, mg::BufferUsage::hardware}
+#else
+    : CompositingScreencast{scene, display, buffer_allocator, db_compositor_factory, mg::BufferUsage::software}
+#endif
+{
+}
+
+mc::CompositingScreencast::CompositingScreencast(
+    std::shared_ptr<Scene> const& scene,
+    std::shared_ptr<mg::Display> const& display,
+    std::shared_ptr<mg::GraphicBufferAllocator> const& buffer_allocator,
+    std::shared_ptr<DisplayBufferCompositorFactory> const& db_compositor_factory,
+    mg::BufferUsage buffer_usage)
     : scene{scene},
       display{display},
       buffer_allocator{buffer_allocator},
-      db_compositor_factory{db_compositor_factory}
+      db_compositor_factory{db_compositor_factory},
+      buffer_usage{buffer_usage}
 {
 }
 
@@ -180,12 +195,6 @@ mf::ScreencastSessionId mc::CompositingScreencast::create_session(
     int nbuffers,
     MirMirrorMode mirror_mode)
 {
-#ifdef MIR_EGL_SUPPORTED
-    static auto const buffer_usage = mg::BufferUsage::hardware;
-#else
-    static auto const buffer_usage = mg::BufferUsage::software;
-#endif
-    
     if (size.width.as_int() == 0 ||
         size.height.as_int() == 0 ||
         region.size.width.as_int() == 0 ||
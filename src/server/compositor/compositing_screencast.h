@@ -20,6 +20,7 @@
 #define MIR_COMPOSITOR_COMPOSITING_SCREENCAST_H_
 
 #include "mir/frontend/screencast.h"
+#include "mir/graphics/buffer_properties.h"
 
 #include <unordered_map>
 #include <mutex>
@@ -49,6 +50,14 @@ public:
         std::shared_ptr<graphics::GraphicBufferAllocator> const& buffer_allocator,
         std::shared_ptr<DisplayBufferCompositorFactory> const& db_compositor_factory);
 
+    /// buffer_usage is what the buffers create_session() allocates must support being drawn into by
+    CompositingScreencast(
+        std::shared_ptr<Scene> const& scene,
+        std::shared_ptr<graphics::Display> const& display,
+        std::shared_ptr<graphics::GraphicBufferAllocator> const& buffer_allocator,
+        std::shared_ptr<DisplayBufferCompositorFactory> const& db_compositor_factory,
+        graphics::BufferUsage buffer_usage);
+
     frontend::ScreencastSessionId create_session(
         geometry::Rectangle const& region,
         geometry::Size const& size,
@@ -73,6 +82,7 @@ private:
     std::shared_ptr<graphics::Display> const display;
     std::shared_ptr<graphics::GraphicBufferAllocator> const buffer_allocator;
     std::shared_ptr<DisplayBufferCompositorFactory> const db_compositor_factory;
+    graphics::BufferUsage const buffer_usage;
 
     std::unordered_map<frontend::ScreencastSessionId,
                        std::shared_ptr<detail::ScreencastSessionContext>> session_contexts;
@@ -23,15 +23,23 @@
 #include "default_display_buffer_compositor_factory.h"
 #include "multi_threaded_compositor.h"
 #include "gl/renderer_factory.h"
+#include "gl/program_cache.h"
+#include "sw/renderer_factory.h"
 #include "compositing_screencast.h"
 #include "mir/main_loop.h"
+#include "mir/thread/parallel_pool.h"
 
 #include "mir/frontend/screencast.h"
 #include "mir/options/configuration.h"
+#include "mir/abnormal_exit.h"
 
 #include <boost/throw_exception.hpp>
 
+#include <algorithm>
+#include <thread>
+
 namespace mc = mir::compositor;
+namespace mg = mir::graphics;
 namespace ms = mir::scene;
 namespace mf = mir::frontend;
 
@@ -72,6 +80,11 @@ mir::DefaultServerConfiguration::the_compositor()
             std::chrono::milliseconds const composite_delay(
                 the_options()->get<int>(options::composite_delay_opt));
 
+            // Per-frame timings (and missed deadline attribution) are logged along with the compositor report
+            auto const frame_timing_clock =
+                the_options()->get<std::string>(options::compositor_report_opt) == options::log_opt_value ?
+                the_clock() : nullptr;
+
             return std::make_shared<mc::MultiThreadedCompositor>(
                 the_display(),
                 the_scene(),
@@ -79,16 +92,41 @@ mir::DefaultServerConfiguration::the_compositor()
                 the_shell(),
                 the_compositor_report(),
                 composite_delay,
-                !the_options()->is_set(options::host_socket_opt));
+                !the_options()->is_set(options::host_socket_opt),
+                frame_timing_clock);
         });
 }
 
 std::shared_ptr<mir::renderer::RendererFactory> mir::DefaultServerConfiguration::the_renderer_factory()
 {
     return renderer_factory(
-        []()
+        [this]() -> std::shared_ptr<mir::renderer::RendererFactory>
         {
-            return std::make_shared<mir::renderer::gl::RendererFactory>();
+            std::shared_ptr<mir::renderer::gl::ProgramCache> program_cache;
+            if (the_options()->is_set(options::shader_cache_opt))
+            {
+                program_cache = std::make_shared<mir::renderer::gl::ProgramCache>(
+                    the_options()->get<std::string>(options::shader_cache_opt));
+            }
+            auto const gl_factory = std::make_shared<mir::renderer::gl::RendererFactory>(program_cache);
+
+            auto const renderer = the_options()->get<std::string>(options::renderer_opt);
+            if (renderer == options::software_renderer_opt_value)
+            {
+                auto threads = the_options()->get<int>(options::renderer_threads_opt);
+                if (threads <= 0)
+                    threads = std::max(1u, std::thread::hardware_concurrency());
+
+                // The compositor thread drawing a frame is one of the threads drawing it
+                return std::make_shared<mir::renderer::software::RendererFactory>(
+                    gl_factory,
+                    std::make_shared<mir::thread::ParallelPool>(threads - 1));
+            }
+            if (renderer != options::gl_renderer_opt_value)
+                BOOST_THROW_EXCEPTION(mir::AbnormalExit(
+                    std::string{"Invalid "} + options::renderer_opt + " value: " + renderer));
+
+            return gl_factory;
         });
 }
 
@@ -97,6 +135,17 @@ std::shared_ptr<mf::Screencast> mir::DefaultServerConfiguration::the_screencast(
     return screencast(
         [this]()
         {
+            // The software renderer can only draw into buffers the CPU can write
+            if (the_options()->get<std::string>(options::renderer_opt) == options::software_renderer_opt_value)
+            {
+                return std::make_shared<mc::CompositingScreencast>(
+                    the_scene(),
+                    the_display(),
+                    the_buffer_allocator(),
+                    the_display_buffer_compositor_factory(),
+                    mg::BufferUsage::software);
+            }
+
             return std::make_shared<mc::CompositingScreencast>(
                 the_scene(),
                 the_display(),
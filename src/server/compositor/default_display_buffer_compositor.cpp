@@ -26,6 +26,7 @@
 #include "mir/graphics/buffer.h"
 #include "mir/compositor/buffer_stream.h"
 #include "mir/renderer/renderer.h"
+#include "mir/compositor/frame_timing_recorder.h"
 #include "occlusion.h"
 #include <mutex>
 #include <cstdlib>
@@ -49,10 +50,14 @@ void mc::DefaultDisplayBufferCompositor::composite(mc::SceneElementSequence&& sc
     report->began_frame(this);
 
     auto const& view_area = display_buffer.view_area();
-    auto const& occlusions = mc::filter_occlusions_from(scene_elements, view_area);
 
-    for (auto const& element : occlusions)
-        element->occluded();
+    {
+        FrameTimingRecorder::StageTimer const timer{FrameStage::occlusion};
+        auto const& occlusions = mc::filter_occlusions_from(scene_elements, view_area);
+
+        for (auto const& element : occlusions)
+            element->occluded();
+    }
 
     mg::RenderableList renderable_list;
     renderable_list.reserve(scene_elements.size());
@@ -0,0 +1,251 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mir/compositor/frame_timing_recorder.h"
+#include "mir/time/clock.h"
+
+#include <boost/throw_exception.hpp>
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+
+namespace mc = mir::compositor;
+namespace mg = mir::graphics;
+namespace mt = mir::time;
+
+namespace
+{
+thread_local mc::FrameTimingRecorder* current_recorder{nullptr};
+
+double as_ms(mt::Duration duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+}
+
+char const* mc::name_of(FrameStage stage)
+{
+    switch (stage)
+    {
+    case FrameStage::scene_snapshot: return "scene_snapshot";
+    case FrameStage::occlusion: return "occlusion";
+    case FrameStage::texture_binding: return "texture_binding";
+    case FrameStage::gl_submission: return "gl_submission";
+    case FrameStage::post: return "post";
+    }
+
+    return "unknown";
+}
+
+mc::FrameTimingRecorder::FrameTimingRecorder(
+    std::shared_ptr<time::Clock> const& clock,
+    time::Duration frame_budget,
+    MissedDeadlineHandler const& on_missed_deadline,
+    size_t history_size) :
+    clock{clock},
+    budget{frame_budget},
+    on_missed_deadline{on_missed_deadline},
+    in_progress{},
+    frame_count{0},
+    next_slot{0},
+    missed{0}
+{
+    if (history_size == 0)
+        BOOST_THROW_EXCEPTION(std::logic_error("FrameTimingRecorder needs a history of at least one frame"));
+
+    ring.reserve(history_size);
+}
+
+mc::FrameTimingRecorder* mc::FrameTimingRecorder::current()
+{
+    return current_recorder;
+}
+
+mc::FrameTimingRecorder::Scope::Scope(FrameTimingRecorder* recorder) :
+    previous{current_recorder}
+{
+    current_recorder = recorder;
+}
+
+mc::FrameTimingRecorder::Scope::~Scope()
+{
+    current_recorder = previous;
+}
+
+mc::FrameTimingRecorder::StageTimer::StageTimer(FrameStage stage, mg::Renderable::ID surface) :
+    recorder{current_recorder},
+    stage{stage},
+    surface{surface},
+    start{recorder ? recorder->now() : time::Timestamp{}}
+{
+    if (recorder)
+        recorder->nested_time.push_back(time::Duration::zero());
+}
+
+mc::FrameTimingRecorder::StageTimer::~StageTimer()
+{
+    if (!recorder)
+        return;
+
+    auto const elapsed = recorder->now() - start;
+    auto const nested = recorder->nested_time.back();
+    recorder->nested_time.pop_back();
+
+    if (!recorder->nested_time.empty())
+        recorder->nested_time.back() += elapsed;
+
+    recorder->record(stage, elapsed - nested, surface);
+}
+
+void mc::FrameTimingRecorder::begin_frame()
+{
+    in_progress = FrameTiming{};
+    in_progress.frame_number = ++frame_count;
+    in_progress.started = now();
+    surface_times.clear();
+}
+
+void mc::FrameTimingRecorder::record(FrameStage stage, time::Duration duration, mg::Renderable::ID surface)
+{
+    in_progress.stage_time[static_cast<size_t>(stage)] += duration;
+
+    if (!surface)
+        return;
+
+    auto const existing = std::find_if(surface_times.begin(), surface_times.end(),
+        [&](SurfaceTime const& entry) { return entry.surface == surface && entry.stage == stage; });
+
+    if (existing != surface_times.end())
+        existing->time += duration;
+    else
+        surface_times.push_back({surface, stage, duration});
+}
+
+void mc::FrameTimingRecorder::end_frame(time::Timestamp last_vblank)
+{
+    in_progress.presented = now();
+    in_progress.deadline = deadline_for(in_progress.started, last_vblank);
+    in_progress.missed_deadline = in_progress.presented > in_progress.deadline;
+
+    if (in_progress.missed_deadline)
+        attribute(in_progress);
+
+    {
+        std::lock_guard<decltype(history_mutex)> lock{history_mutex};
+
+        if (ring.size() < ring.capacity())
+            ring.push_back(in_progress);
+        else
+            ring[next_slot] = in_progress;
+
+        next_slot = (next_slot + 1) % ring.capacity();
+
+        if (in_progress.missed_deadline)
+            ++missed;
+    }
+
+    if (in_progress.missed_deadline && on_missed_deadline)
+        on_missed_deadline(*this, in_progress);
+}
+
+mt::Timestamp mc::FrameTimingRecorder::deadline_for(time::Timestamp started, time::Timestamp last_vblank) const
+{
+    if (last_vblank == time::Timestamp{})
+        return started + budget;
+
+    // A frame started before the flip it was posted after (e.g. one post() waited on) makes the next vblank
+    if (started <= last_vblank)
+        return last_vblank + budget;
+
+    // Otherwise flips stay in phase with last_vblank, even if the output has been idle since
+    auto const intervals_since_vblank = (started - last_vblank) / budget;
+    return last_vblank + budget * (intervals_since_vblank + 1);
+}
+
+void mc::FrameTimingRecorder::attribute(FrameTiming& frame) const
+{
+    auto const worst_stage = std::max_element(frame.stage_time.begin(), frame.stage_time.end());
+    frame.blamed_stage = static_cast<FrameStage>(worst_stage - frame.stage_time.begin());
+
+    frame.blamed_surface = nullptr;
+    frame.blamed_surface_time = time::Duration::zero();
+
+    for (auto const& entry : surface_times)
+    {
+        if (entry.stage == frame.blamed_stage && entry.time > frame.blamed_surface_time)
+        {
+            frame.blamed_surface = entry.surface;
+            frame.blamed_surface_time = entry.time;
+        }
+    }
+}
+
+mt::Timestamp mc::FrameTimingRecorder::now() const
+{
+    return clock->now();
+}
+
+mt::Duration mc::FrameTimingRecorder::frame_budget() const
+{
+    return budget;
+}
+
+std::vector<mc::FrameTiming> mc::FrameTimingRecorder::history() const
+{
+    std::lock_guard<decltype(history_mutex)> lock{history_mutex};
+
+    if (ring.size() < ring.capacity())
+        return ring;
+
+    std::vector<FrameTiming> result;
+    result.reserve(ring.size());
+    result.insert(result.end(), ring.begin() + next_slot, ring.end());
+    result.insert(result.end(), ring.begin(), ring.begin() + next_slot);
+    return result;
+}
+
+uint64_t mc::FrameTimingRecorder::missed_deadlines() const
+{
+    std::lock_guard<decltype(history_mutex)> lock{history_mutex};
+    return missed;
+}
+
+void mc::FrameTimingRecorder::dump(std::ostream& out) const
+{
+    auto const frames = history();
+
+    out << std::fixed << std::setprecision(2);
+
+    for (auto const& frame : frames)
+    {
+        out << "frame=" << frame.frame_number
+            << " total=" << as_ms(frame.presented - frame.started);
+
+        for (auto i = 0u; i != FrameTiming::stage_count; ++i)
+            out << ' ' << name_of(static_cast<FrameStage>(i)) << '=' << as_ms(frame.stage_time[i]);
+
+        if (frame.missed_deadline)
+        {
+            out << " MISSED blame=" << name_of(frame.blamed_stage);
+            if (frame.blamed_surface)
+                out << " surface=" << frame.blamed_surface << " (" << as_ms(frame.blamed_surface_time) << ")";
+        }
+
+        out << " (ms)\n";
+    }
+}
@@ -23,7 +23,10 @@
 #include "mir/compositor/display_buffer_compositor_factory.h"
 #include "mir/compositor/display_listener.h"
 #include "mir/compositor/scene.h"
+#include "mir/compositor/compositor_areas.h"
 #include "mir/compositor/compositor_report.h"
+#include "mir/compositor/frame_timing_recorder.h"
+#include "mir/graphics/display_configuration.h"
 #include "mir/scene/legacy_scene_change_notification.h"
 #include "mir/scene/surface_observer.h"
 #include "mir/scene/surface.h"
@@ -31,6 +34,10 @@
 #include "mir/raii.h"
 #include "mir/unwind_helpers.h"
 #include "mir/thread_name.h"
+#include "mir/time/clock.h"
+#include "mir/time/posix_timestamp.h"
+#include "mir/graphics/frame.h"
+#include "mir/log.h"
 
 #include <thread>
 #include <chrono>
@@ -43,11 +50,77 @@ namespace mc = mir::compositor;
 namespace mg = mir::graphics;
 namespace ms = mir::scene;
 
+namespace
+{
+auto const default_frame_budget = std::chrono::microseconds{16667};
+
+/// The vblank time the display reports for output_id, on clock
+auto last_vblank_on(
+    std::shared_ptr<mg::Display> const& display,
+    std::shared_ptr<mir::time::Clock> const& clock,
+    mg::DisplayConfigurationOutputId output_id) -> std::function<mir::time::Timestamp()>
+{
+    return [display, clock, output_id]
+        {
+            auto const ust = display->last_frame_on(output_id.as_value()).ust;
+            if (ust.nanoseconds == std::chrono::nanoseconds::zero())
+                return mir::time::Timestamp{};
+
+            auto const age = mir::time::PosixTimestamp::now(ust.clock_id) - ust;
+            return clock->now() - std::chrono::duration_cast<mir::time::Duration>(age);
+        };
+}
+
+/// Log missed deadlines, at most once a second per output
+mc::FrameTimingRecorder::MissedDeadlineHandler missed_deadline_logger(mir::geometry::Rectangle const& output)
+{
+    return [output, last_logged = mir::time::Timestamp{}, unlogged = 0]
+        (mc::FrameTimingRecorder const& recorder, mc::FrameTiming const& frame) mutable
+        {
+            ++unlogged;
+
+            if (frame.presented - last_logged < std::chrono::seconds{1})
+                return;
+
+            auto const as_ms = [](mir::time::Duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+            auto const blamed_time = frame.stage_time[static_cast<size_t>(frame.blamed_stage)];
+
+            char surface_detail[64] = "";
+            if (frame.blamed_surface)
+            {
+                snprintf(surface_detail, sizeof surface_detail, " (%.2fms for renderable %p)",
+                    as_ms(frame.blamed_surface_time), frame.blamed_surface);
+            }
+
+            mir::log(mir::logging::Severity::informational, "compositor",
+                "Output %dx%d%+d%+d missed %d frame deadline(s): frame %llu took %.2fms, %.2fms past its vblank "
+                "(budget %.2fms), most in %s: %.2fms%s",
+                output.size.width.as_int(), output.size.height.as_int(),
+                output.top_left.x.as_int(), output.top_left.y.as_int(),
+                unlogged, static_cast<unsigned long long>(frame.frame_number),
+                as_ms(frame.presented - frame.started), as_ms(frame.presented - frame.deadline),
+                as_ms(recorder.frame_budget()),
+                mc::name_of(frame.blamed_stage), as_ms(blamed_time), surface_detail);
+
+            last_logged = frame.presented;
+            unlogged = 0;
+        };
+}
+}
+
 namespace mir
 {
 namespace compositor
 {
 
+/// What a FrameTimingRecorder needs to know about its output
+struct OutputFrameTiming
+{
+    time::Duration budget;
+    /// The most recent page flip on the output, or a default Timestamp if unknown
+    std::function<time::Timestamp()> last_vblank;
+};
+
 class CompositingFunctor
 {
 public:
@@ -57,15 +130,20 @@ public:
         std::shared_ptr<mc::Scene> const& scene,
         std::shared_ptr<DisplayListener> const& display_listener,
         std::chrono::milliseconds fixed_composite_delay,
-        std::shared_ptr<CompositorReport> const& report) :
+        std::shared_ptr<CompositorReport> const& report,
+        std::shared_ptr<time::Clock> const& frame_timing_clock,
+        std::function<OutputFrameTiming(geometry::Rectangle const&)> const& frame_timing_for) :
         compositor_factory{db_compositor_factory},
         group(group),
         scene(scene),
+        scene_areas{std::dynamic_pointer_cast<mc::CompositorAreas>(scene)},
         running{true},
         frames_scheduled{0},
         force_sleep{fixed_composite_delay},
         display_listener{display_listener},
         report{report},
+        frame_timing_clock{frame_timing_clock},
+        frame_timing_for{frame_timing_for},
         started_future{started.get_future()}
     {
     }
@@ -75,14 +153,35 @@ public:
     {
         mir::set_thread_name("Mir/Comp");
 
-        std::vector<std::tuple<mg::DisplayBuffer*, std::unique_ptr<mc::DisplayBufferCompositor>>> compositors;
+        std::vector<std::tuple<
+            mg::DisplayBuffer*,
+            std::unique_ptr<mc::DisplayBufferCompositor>,
+            std::unique_ptr<mc::FrameTimingRecorder>,
+            std::function<time::Timestamp()>,
+            geometry::Rectangle /* the area last given to the scene */>> compositors;
         group.for_each_display_buffer(
         [this, &compositors](mg::DisplayBuffer& buffer)
         {
+            auto const& r = buffer.view_area();
+
+            std::unique_ptr<mc::FrameTimingRecorder> frame_timing;
+            std::function<time::Timestamp()> last_vblank;
+            if (frame_timing_clock)
+            {
+                auto const output_timing = frame_timing_for(r);
+                frame_timing = std::make_unique<mc::FrameTimingRecorder>(
+                    frame_timing_clock, output_timing.budget, missed_deadline_logger(r));
+                last_vblank = output_timing.last_vblank;
+            }
+
             compositors.emplace_back(
-                std::make_tuple(&buffer, compositor_factory->create_compositor_for(buffer)));
+                std::make_tuple(
+                    &buffer,
+                    compositor_factory->create_compositor_for(buffer),
+                    std::move(frame_timing),
+                    std::move(last_vblank),
+                    r));
 
-            auto const& r = buffer.view_area();
             auto const comp_id = std::get<1>(compositors.back()).get();
             report->added_display(r.size.width.as_int(), r.size.height.as_int(),
                                   r.top_left.x.as_int(), r.top_left.y.as_int(),
@@ -101,7 +200,12 @@ public:
             [this,&compositors]
             {
                 for (auto& compositor : compositors)
-                    scene->register_compositor(std::get<1>(compositor).get());
+                {
+                    auto const comp_id = std::get<1>(compositor).get();
+                    scene->register_compositor(comp_id);
+                    if (scene_areas)
+                        scene_areas->set_compositor_area(comp_id, std::get<4>(compositor));
+                }
             },
             [this,&compositors]{
                 for (auto& compositor : compositors)
@@ -138,10 +242,63 @@ public:
                     for (auto& tuple : compositors)
                     {
                         auto& compositor = std::get<1>(tuple);
-                        compositor->composite(scene->scene_elements_for(compositor.get()));
+                        auto const frame_timing = std::get<2>(tuple).get();
+
+                        /*
+                         * Display changes applied in place (e.g. orientation)
+                         * keep this compositor but move its output's view area.
+                         */
+                        auto const area = std::get<0>(tuple)->view_area();
+                        if (scene_areas && area != std::get<4>(tuple))
+                        {
+                            std::get<4>(tuple) = area;
+                            scene_areas->set_compositor_area(compositor.get(), area);
+                        }
+
+                        if (frame_timing)
+                            frame_timing->begin_frame();
+
+                        mc::FrameTimingRecorder::Scope const timing_scope{frame_timing};
+                        mc::SceneElementSequence scene_elements;
+                        {
+                            mc::FrameTimingRecorder::StageTimer const timer{mc::FrameStage::scene_snapshot};
+                            scene_elements = scene->scene_elements_for(compositor.get());
+                        }
+                        compositor->composite(std::move(scene_elements));
                     }
+
+                    auto const post_started = frame_timing_clock ? frame_timing_clock->now() : time::Timestamp{};
                     group.post();
 
+                    if (frame_timing_clock)
+                    {
+                        auto const post_ended = frame_timing_clock->now();
+
+                        /*
+                         * post() may block on a page flip (this frame's, or the
+                         * previous one's). That wait is idle time, not work, so
+                         * only charge post() from the last flip it saw onwards.
+                         */
+                        std::vector<time::Timestamp> last_vblanks;
+                        auto busy_from = post_started;
+                        for (auto& tuple : compositors)
+                        {
+                            last_vblanks.push_back(std::get<3>(tuple)());
+                            if (last_vblanks.back() > busy_from && last_vblanks.back() <= post_ended)
+                                busy_from = last_vblanks.back();
+                        }
+
+                        // The group posts its outputs together, so they share its post() time
+                        auto const post_time = (post_ended - busy_from) / compositors.size();
+
+                        for (size_t i = 0; i != compositors.size(); ++i)
+                        {
+                            auto& frame_timing = std::get<2>(compositors[i]);
+                            frame_timing->record(mc::FrameStage::post, post_time);
+                            frame_timing->end_frame(last_vblanks[i]);
+                        }
+                    }
+
                     /*
                      * "Predictive bypass" optimization: If the last frame was
                      * bypassed/overlayed or you simply have a fast GPU, it is
@@ -222,6 +379,11 @@ public:
         run_cv.notify_one();
     }
 
+    bool composites_to(mg::DisplaySyncGroup const& other) const
+    {
+        return &group == &other;
+    }
+
     void wait_until_started()
     {
         if (started_future.wait_for(10s) != std::future_status::ready)
@@ -234,6 +396,8 @@ private:
     std::shared_ptr<mc::DisplayBufferCompositorFactory> const compositor_factory;
     mg::DisplaySyncGroup& group;
     std::shared_ptr<mc::Scene> const scene;
+    /// The scene's interface for leaving out what can't appear in a compositor's area, if it has one
+    std::shared_ptr<mc::CompositorAreas> const scene_areas;
     bool running;
     int frames_scheduled;
     std::chrono::milliseconds force_sleep{-1};
@@ -241,6 +405,8 @@ private:
     std::condition_variable run_cv;
     std::shared_ptr<DisplayListener> const display_listener;
     std::shared_ptr<CompositorReport> const report;
+    std::shared_ptr<time::Clock> const frame_timing_clock;
+    std::function<OutputFrameTiming(geometry::Rectangle const&)> const frame_timing_for;
     std::promise<void> started;
     std::future<void> started_future;
     bool not_posted_yet = true;
@@ -256,7 +422,8 @@ mc::MultiThreadedCompositor::MultiThreadedCompositor(
     std::shared_ptr<DisplayListener> const& display_listener,
     std::shared_ptr<CompositorReport> const& compositor_report,
     std::chrono::milliseconds fixed_composite_delay,
-    bool compose_on_start)
+    bool compose_on_start,
+    std::shared_ptr<time::Clock> const& frame_timing_clock)
     : display{display},
       scene{scene},
       display_buffer_compositor_factory{db_compositor_factory},
@@ -265,6 +432,7 @@ mc::MultiThreadedCompositor::MultiThreadedCompositor(
       state{CompositorState::stopped},
       fixed_composite_delay{fixed_composite_delay},
       compose_on_start{compose_on_start},
+      frame_timing_clock{frame_timing_clock},
       thread_pool{1}
 {
     observer = std::make_shared<ms::LegacySceneChangeNotification>(
@@ -286,6 +454,7 @@ mc::MultiThreadedCompositor::~MultiThreadedCompositor()
 void mc::MultiThreadedCompositor::schedule_compositing(int num)
 {
     report->scheduled();
+    std::lock_guard<std::mutex> lock{thread_functors_mutex};
     for (auto& f : thread_functors)
         f->schedule_compositing(num);
 }
@@ -293,6 +462,7 @@ void mc::MultiThreadedCompositor::schedule_compositing(int num)
 void mc::MultiThreadedCompositor::schedule_compositing(int num, geometry::Rectangle const& damage) const
 {
     report->scheduled();
+    std::lock_guard<std::mutex> lock{thread_functors_mutex};
     for (auto& f : thread_functors)
         f->schedule_compositing(num, damage);
 }
@@ -361,18 +531,108 @@ void mc::MultiThreadedCompositor::stop()
     state = CompositorState::stopped;
 }
 
+void mc::MultiThreadedCompositor::stop_compositing_to(mg::DisplaySyncGroup& group)
+{
+    std::unique_ptr<CompositingFunctor> functor;
+    std::future<void> future;
+    {
+        std::lock_guard<std::mutex> lock{thread_functors_mutex};
+        for (size_t i = 0; i != thread_functors.size(); ++i)
+        {
+            if (thread_functors[i]->composites_to(group))
+            {
+                functor = std::move(thread_functors[i]);
+                future = std::move(futures[i]);
+                thread_functors.erase(thread_functors.begin() + i);
+                futures.erase(futures.begin() + i);
+                break;
+            }
+        }
+    }
+
+    // Without holding the lock, as compositing may schedule more compositing
+    if (functor)
+    {
+        functor->stop();
+        future.wait();
+        thread_pool.shrink();
+    }
+}
+
+void mc::MultiThreadedCompositor::start_compositing_to(mg::DisplaySyncGroup& group)
+{
+    if (state != CompositorState::started)
+        return;
+
+    auto& functor = create_compositing_thread(group, frame_timing_lookup());
+    functor.wait_until_started();
+
+    // The group's outputs have nothing on them yet
+    functor.schedule_compositing(1);
+}
+
+auto mc::MultiThreadedCompositor::frame_timing_lookup() const
+-> std::function<OutputFrameTiming(geometry::Rectangle const&)>
+{
+    /* Missed deadlines are judged against each output's refresh rate and page flips */
+    std::vector<std::pair<geometry::Rectangle, OutputFrameTiming>> output_timings;
+    if (frame_timing_clock)
+    {
+        display->configuration()->for_each_output(
+            [this, &output_timings](mg::DisplayConfigurationOutput const& output)
+            {
+                if (output.used && output.current_mode_index < output.modes.size())
+                {
+                    auto const hz = output.modes[output.current_mode_index].vrefresh_hz;
+                    if (hz > 0)
+                    {
+                        output_timings.emplace_back(
+                            output.extents(),
+                            OutputFrameTiming{
+                                std::chrono::duration_cast<time::Duration>(std::chrono::duration<double>{1.0 / hz}),
+                                last_vblank_on(display, frame_timing_clock, output.id)});
+                    }
+                }
+            });
+    }
+
+    return [output_timings](geometry::Rectangle const& view_area) -> OutputFrameTiming
+        {
+            for (auto const& timing : output_timings)
+            {
+                if (timing.first == view_area)
+                    return timing.second;
+            }
+            return {default_frame_budget, []{ return time::Timestamp{}; }};
+        };
+}
+
+auto mc::MultiThreadedCompositor::create_compositing_thread(
+    mg::DisplaySyncGroup& group,
+    std::function<OutputFrameTiming(geometry::Rectangle const&)> const& frame_timing_for) -> CompositingFunctor&
+{
+    auto thread_functor = std::make_unique<mc::CompositingFunctor>(
+        display_buffer_compositor_factory, group, scene, display_listener,
+        fixed_composite_delay, report, frame_timing_clock, frame_timing_for);
+    auto& functor = *thread_functor;
+
+    auto future = thread_pool.run(std::ref(functor), &group);
+
+    std::lock_guard<std::mutex> lock{thread_functors_mutex};
+    futures.push_back(std::move(future));
+    thread_functors.push_back(std::move(thread_functor));
+    return functor;
+}
+
 void mc::MultiThreadedCompositor::create_compositing_threads()
 {
     /* Start the display buffer compositing threads */
-    display->for_each_display_sync_group([this](mg::DisplaySyncGroup& group)
-    {
-        auto thread_functor = std::make_unique<mc::CompositingFunctor>(
-            display_buffer_compositor_factory, group, scene, display_listener,
-            fixed_composite_delay, report);
+    auto const frame_timing_for = frame_timing_lookup();
 
-        futures.push_back(thread_pool.run(std::ref(*thread_functor), &group));
-        thread_functors.push_back(std::move(thread_functor));
-    });
+    display->for_each_display_sync_group([this, &frame_timing_for](mg::DisplaySyncGroup& group)
+        {
+            create_compositing_thread(group, frame_timing_for);
+        });
 
     thread_pool.shrink();
 
@@ -388,6 +648,7 @@ void mc::MultiThreadedCompositor::destroy_compositing_threads()
     for (auto& f : futures)
         f.wait();
 
+    std::lock_guard<std::mutex> lock{thread_functors_mutex};
     thread_functors.clear();
     futures.clear();
 }
@@ -20,11 +20,13 @@
 #define MIR_COMPOSITOR_MULTI_THREADED_COMPOSITOR_H_
 
 #include "mir/compositor/compositor.h"
+#include "mir/compositor/sync_group_compositor.h"
 #include "mir/thread/basic_thread_pool.h"
 
 #include <mutex>
 #include <memory>
 #include <vector>
+#include <functional>
 #include <future>
 #include <chrono>
 #include <atomic>
@@ -35,11 +37,16 @@ namespace geometry { struct Rectangle; }
 namespace graphics
 {
 class Display;
+class DisplaySyncGroup;
 }
 namespace scene
 {
 class Observer;
 }
+namespace time
+{
+class Clock;
+}
 
 namespace compositor
 {
@@ -47,6 +54,7 @@ namespace compositor
 class DisplayBufferCompositorFactory;
 class DisplayListener;
 class CompositingFunctor;
+struct OutputFrameTiming;
 class Scene;
 class CompositorReport;
 
@@ -58,7 +66,7 @@ enum class CompositorState
     stopping
 };
 
-class MultiThreadedCompositor : public Compositor
+class MultiThreadedCompositor : public Compositor, public SyncGroupCompositor
 {
 public:
     MultiThreadedCompositor(
@@ -68,15 +76,23 @@ public:
         std::shared_ptr<DisplayListener> const& display_listener,
         std::shared_ptr<CompositorReport> const& compositor_report,
         std::chrono::milliseconds fixed_composite_delay,  // -1 = automatic
-        bool compose_on_start);
+        bool compose_on_start,
+        std::shared_ptr<time::Clock> const& frame_timing_clock = nullptr); // nullptr = no frame timing
     ~MultiThreadedCompositor();
 
     void start();
     void stop();
 
+    void stop_compositing_to(graphics::DisplaySyncGroup& group) override;
+    void start_compositing_to(graphics::DisplaySyncGroup& group) override;
+
 private:
     void create_compositing_threads();
     void destroy_compositing_threads();
+    auto create_compositing_thread(
+        graphics::DisplaySyncGroup& group,
+        std::function<OutputFrameTiming(geometry::Rectangle const&)> const& frame_timing_for) -> CompositingFunctor&;
+    auto frame_timing_lookup() const -> std::function<OutputFrameTiming(geometry::Rectangle const&)>;
 
     std::shared_ptr<graphics::Display> const display;
     std::shared_ptr<Scene> const scene;
@@ -84,12 +100,15 @@ private:
     std::shared_ptr<DisplayListener> const display_listener;
     std::shared_ptr<CompositorReport> const report;
 
+    /// Changed by the thread starting and stopping compositing, while the scene may be scheduling it
+    mutable std::mutex thread_functors_mutex;
     std::vector<std::unique_ptr<CompositingFunctor>> thread_functors;
     std::vector<std::future<void>> futures;
 
     std::atomic<CompositorState> state;
     std::chrono::milliseconds fixed_composite_delay;
     bool compose_on_start;
+    std::shared_ptr<time::Clock> const frame_timing_clock;
 
     void schedule_compositing(int number_composites);
     void schedule_compositing(int number_composites, geometry::Rectangle const& damage) const;
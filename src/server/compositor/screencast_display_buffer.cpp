@@ -25,6 +25,7 @@
 #include "mir/renderer/gl/context.h"
 #include "mir/renderer/gl/texture_target.h"
 #include "mir/renderer/gl/context_source.h"
+#include "mir/renderer/sw/pixel_source.h"
 #include "mir/raii.h"
 
 #include <boost/throw_exception.hpp>
@@ -32,6 +33,7 @@
 namespace mc = mir::compositor;
 namespace mg = mir::graphics;
 namespace mrgl = mir::renderer::gl;
+namespace mrs = mir::renderer::software;
 namespace geom = mir::geometry;
 
 namespace
@@ -44,6 +46,15 @@ auto as_texture_target(mg::Buffer* buffer)
     return tex;
 }
 
+auto as_pixel_source(mg::Buffer* buffer)
+{
+    auto const format = buffer->pixel_format();
+    auto const pixels = dynamic_cast<mrs::PixelSource*>(buffer->native_buffer_base());
+    if (!pixels || (format != mir_pixel_format_argb_8888 && format != mir_pixel_format_xrgb_8888))
+        BOOST_THROW_EXCEPTION(std::invalid_argument("Buffer does not support being drawn into by the CPU"));
+    return pixels;
+}
+
 auto as_context_source(mg::Display* display)
 {
     auto const ctx = dynamic_cast<mrgl::ContextSource*>(display->native_display());
@@ -197,6 +208,83 @@ mg::NativeDisplayBuffer* mc::ScreencastDisplayBuffer::native_display_buffer()
     return this;
 }
 
+unsigned char* mc::ScreencastDisplayBuffer::map_pixels()
+{
+    pixels.resize(stride().as_int() * rect.size.height.as_int());
+    return pixels.data();
+}
+
+geom::Size mc::ScreencastDisplayBuffer::size() const
+{
+    return rect.size;
+}
+
+geom::Stride mc::ScreencastDisplayBuffer::stride() const
+{
+    return geom::Stride{rect.size.width.as_int() * 4};
+}
+
+unsigned mc::ScreencastDisplayBuffer::buffer_age() const
+{
+    return frame_committed ? 1 : 0;
+}
+
+bool mc::ScreencastDisplayBuffer::applies_transformation() const
+{
+    return true;
+}
+
+void mc::ScreencastDisplayBuffer::commit(geom::Rectangles const&)
+{
+    if (!current_buffer)
+        current_buffer = free_queue.next_buffer();
+
+    auto const target = as_pixel_source(current_buffer.get());
+    frame_committed = true;
+
+    /*
+     * Match what GL produces: the frame drawn through transform, then read
+     * back bottom row first (so without a vertical flip it is upside down).
+     */
+    bool const mirror_x{transform[0][0] < 0};
+    bool const mirror_y{transform[1][1] > 0};
+
+    if (current_size == rect.size && !mirror_x && !mirror_y)
+    {
+        // Each capture may be into a different buffer, so the whole frame is written
+        target->write(pixels.data(), pixels.size());
+    }
+    else
+    {
+        auto const from_width = rect.size.width.as_int();
+        auto const from_height = rect.size.height.as_int();
+        auto const width = current_size.width.as_int();
+        auto const height = current_size.height.as_int();
+
+        // Nearest neighbour, which is enough for a screencast
+        scaled.resize(width * height);
+        for (int y = 0; y != height; ++y)
+        {
+            auto from_y = static_cast<int>(int64_t{y} * from_height / height);
+            if (mirror_y)
+                from_y = from_height - 1 - from_y;
+
+            auto const from_row = reinterpret_cast<uint32_t const*>(pixels.data()) + from_y * from_width;
+            auto const row = scaled.data() + y * width;
+            for (int x = 0; x != width; ++x)
+            {
+                auto const from_x = static_cast<int>(int64_t{x} * from_width / width);
+                row[x] = from_row[mirror_x ? from_width - 1 - from_x : from_x];
+            }
+        }
+
+        target->write(reinterpret_cast<unsigned char const*>(scaled.data()), scaled.size() * sizeof scaled[0]);
+    }
+
+    ready_queue.schedule(current_buffer);
+    current_buffer = nullptr;
+}
+
 geom::Size mc::ScreencastDisplayBuffer::renderbuffer_size()
 {
     return current_size;
@@ -218,6 +306,7 @@ void mc::ScreencastDisplayBuffer::set_renderbuffer_size(geom::Size size)
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         BOOST_THROW_EXCEPTION(std::runtime_error("Failed to create FBO for buffer"));
     depth_rbo =  std::move(depth_buffer);
+    current_size = size;
 }
 
 void mc::ScreencastDisplayBuffer::set_transformation(glm::mat2 const& t)
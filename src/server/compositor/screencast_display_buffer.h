@@ -21,6 +21,9 @@
 
 #include "mir/graphics/display_buffer.h"
 #include "mir/renderer/gl/render_target.h"
+#include "mir/renderer/sw/pixel_target.h"
+
+#include <vector>
 
 #include MIR_SERVER_GL_H
 #include MIR_SERVER_GLEXT_H
@@ -88,7 +91,8 @@ private:
 class Schedule;
 class ScreencastDisplayBuffer : public graphics::DisplayBuffer,
                                 public graphics::NativeDisplayBuffer,
-                                public renderer::gl::RenderTarget
+                                public renderer::gl::RenderTarget,
+                                public renderer::software::PixelTarget
 {
 public:
     ScreencastDisplayBuffer(
@@ -116,6 +120,15 @@ public:
 
     NativeDisplayBuffer* native_display_buffer() override;
 
+    // PixelTarget implementation: frames of the whole region are drawn into a copy,
+    // then scaled and mirrored into a software buffer
+    unsigned char* map_pixels() override;
+    geometry::Size size() const override;
+    geometry::Stride stride() const override;
+    unsigned buffer_age() const override;
+    bool applies_transformation() const override;
+    void commit(geometry::Rectangles const& damage) override;
+
     geometry::Size renderbuffer_size();
     void set_renderbuffer_size(geometry::Size);
     void set_transformation(glm::mat2 const& transform);
@@ -138,6 +151,10 @@ private:
     detail::GLResource<glDeleteFramebuffers> fbo;
 
     geometry::Size current_size;
+
+    std::vector<unsigned char> pixels;  ///< The last frame drawn by the CPU, at the region's size
+    bool frame_committed{false};
+    std::vector<uint32_t> scaled;
 };
 
 }
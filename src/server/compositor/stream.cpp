@@ -42,6 +42,7 @@ mc::Stream::Stream(
     size(size),
     pf(pf),
     first_frame_posted(false),
+    submissions(0),
     frame_callback{[](auto){}}
 {
 }
@@ -56,6 +57,7 @@ void mc::Stream::submit_buffer(std::shared_ptr<mg::Buffer> const& buffer)
     {
         std::lock_guard<decltype(mutex)> lk(mutex); 
         first_frame_posted = true;
+        ++submissions;
         pf = buffer->pixel_format();
         size = buffer->size();
         schedule->schedule(buffer);
@@ -158,6 +160,12 @@ bool mc::Stream::has_submitted_buffer() const
     return first_frame_posted;
 }
 
+uint64_t mc::Stream::submission_count() const
+{
+    std::lock_guard<decltype(mutex)> lk(mutex);
+    return submissions;
+}
+
 void mc::Stream::set_scale(float)
 {
 }
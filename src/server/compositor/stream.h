@@ -55,6 +55,7 @@ public:
     int buffers_ready_for_compositor(void const* user_id) const override;
     void drop_old_buffers() override;
     bool has_submitted_buffer() const override;
+    uint64_t submission_count() const override;
     void set_scale(float scale) override;
 
 private:
@@ -68,6 +69,7 @@ private:
     geometry::Size size; 
     MirPixelFormat pf;
     bool first_frame_posted;
+    uint64_t submissions;
 
     std::mutex callback_mutex;
     std::function<void(geometry::Size const&)> frame_callback;
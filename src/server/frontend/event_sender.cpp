@@ -18,6 +18,8 @@
 
 #include "event_sender.h"
 #include "mir/events/event.h"
+#include "mir/input/input_event_record_codec.h"
+#include "mir/anonymous_shm_file.h"
 #include "mir/frontend/client_constants.h"
 #include "mir/graphics/display_configuration.h"
 #include "mir/variable_length_array.h"
@@ -42,6 +44,11 @@ namespace mev = mir::events;
 namespace mp = mir::protobuf;
 namespace mi = mir::input;
 
+namespace
+{
+uint32_t const input_event_ring_capacity{256};
+}
+
 mfd::EventSender::EventSender(
     std::shared_ptr<MessageSender> const& socket_sender,
     std::shared_ptr<mg::PlatformIpcOperations> const& buffer_packer) :
@@ -50,11 +57,63 @@ mfd::EventSender::EventSender(
 {
 }
 
+mfd::EventSender::~EventSender() = default;
+
+void mfd::EventSender::enable_input_event_ring(SurfaceId surface)
+{
+    std::lock_guard<decltype(ring_mutex)> lock{ring_mutex};
+
+    if (ring)
+        return;
+
+    auto const size = mi::InputEventRing::size_for(input_event_ring_capacity);
+    ring_file = std::make_unique<AnonymousShmFile>(size);
+    mi::InputEventRing::initialise(ring_file->base_ptr(), input_event_ring_capacity);
+    ring = std::make_unique<mi::InputEventRing>(ring_file->base_ptr(), size);
+    ring_surface = surface;
+
+    mp::EventSequence seq;
+    auto const setup = seq.mutable_input_event_ring();
+    setup->mutable_surface_id()->set_value(surface.as_value());
+    setup->set_size(size);
+    setup->set_fds_on_side_channel(1);
+
+    std::vector<mir::Fd> fds;
+    fds.emplace_back(mir::Fd(IntOwnedFd{ring_file->fd()}));
+    send_event_sequence(seq, {fds});
+}
+
 void mfd::EventSender::handle_event(EventUPtr&& event)
 {
+    mp::EventSequence seq;
+
+    if (event->type() == mir_event_type_input)
+    {
+        std::lock_guard<decltype(ring_mutex)> lock{ring_mutex};
+
+        if (ring)
+        {
+            mi::InputEventRecord record;
+            bool wake_consumer{false};
+
+            if (mi::encode_input_event(*event->to_input(), record) && ring->push(record, wake_consumer))
+            {
+                if (wake_consumer)
+                {
+                    seq.mutable_input_event_ring_doorbell()->set_value(ring_surface.as_value());
+                    send_event_sequence(seq, {});
+                }
+                return;
+            }
+
+            // Events that don't fit the ring go over the socket; the client
+            // drains the ring before handling them, so order is preserved.
+            seq.mutable_input_event_ring_doorbell()->set_value(ring_surface.as_value());
+        }
+    }
+
     // In future we might send multiple events, or insert them into messages
     // containing other responses, but for now we send them individually.
-    mp::EventSequence seq;
     mp::Event *ev = seq.add_event();
     ev->set_raw(MirEvent::serialize(event.get()));
 
@@ -21,11 +21,15 @@
 
 #include "mir/frontend/event_sink.h"
 #include "mir/frontend/fd_sets.h"
+#include "mir/frontend/surface_id.h"
 #include <memory>
+#include <mutex>
 
 namespace mir
 {
+class AnonymousShmFile;
 namespace graphics { class PlatformIpcOperations; }
+namespace input { class InputEventRing; }
 namespace protobuf
 {
 class EventSequence;
@@ -43,6 +47,14 @@ public:
     explicit EventSender(
         std::shared_ptr<MessageSender> const& socket_sender,
         std::shared_ptr<graphics::PlatformIpcOperations> const& buffer_packer);
+    ~EventSender();
+
+    /**
+     * Deliver input events for surface through a shared-memory ring rather
+     * than the socket, which is then only used to wake an idle client.
+     */
+    void enable_input_event_ring(SurfaceId surface);
+
     void handle_event(EventUPtr&& event) override;
     void handle_lifecycle_event(MirLifecycleState state) override;
     void handle_display_config_change(graphics::DisplayConfiguration const& config) override;
@@ -60,6 +72,11 @@ private:
 
     std::shared_ptr<MessageSender> const sender;
     std::shared_ptr<graphics::PlatformIpcOperations> const buffer_packer;
+
+    std::mutex ring_mutex;
+    SurfaceId ring_surface;
+    std::unique_ptr<AnonymousShmFile> ring_file;
+    std::unique_ptr<input::InputEventRing> ring;
 };
 
 }
@@ -27,6 +27,8 @@
 
 #include "mir_protobuf_wire.pb.h"
 
+#include <unordered_map>
+
 namespace mfd = mir::frontend::detail;
 
 namespace
@@ -41,6 +43,96 @@ std::vector<mir::Fd> extract_fds_from(Response* response)
     response->set_fds_on_side_channel(fd.size());
     return fd;
 }
+
+google::protobuf::ArenaOptions arena_options_for(char* block, size_t size)
+{
+    google::protobuf::ArenaOptions options;
+    options.initial_block = block;
+    options.initial_block_size = size;
+    return options;
+}
+
+enum class Method
+{
+    unknown,
+    connect,
+    create_surface,
+    submit_buffer,
+    allocate_buffers,
+    release_buffers,
+    release_surface,
+    platform_operation,
+    configure_display,
+    remove_session_configuration,
+    set_base_display_configuration,
+    configure_surface,
+    modify_surface,
+    create_screencast,
+    screencast_buffer,
+    screencast_to_buffer,
+    release_screencast,
+    create_buffer_stream,
+    release_buffer_stream,
+    configure_cursor,
+    new_fds_for_prompt_providers,
+    start_prompt_session,
+    stop_prompt_session,
+    request_operation,
+    disconnect,
+    pong,
+    configure_buffer_stream,
+    translate_surface_to_screen,
+    request_persistent_surface_id,
+    preview_base_display_configuration,
+    confirm_base_display_configuration,
+    cancel_base_display_configuration_preview,
+    apply_input_configuration,
+    set_base_input_configuration,
+};
+
+// Resolves a method name with a single lookup, rather than comparing it
+// against each name in turn
+Method method_named(std::string const& name)
+{
+    static std::unordered_map<std::string, Method> const methods{
+        {"connect", Method::connect},
+        {"create_surface", Method::create_surface},
+        {"submit_buffer", Method::submit_buffer},
+        {"allocate_buffers", Method::allocate_buffers},
+        {"release_buffers", Method::release_buffers},
+        {"release_surface", Method::release_surface},
+        {"platform_operation", Method::platform_operation},
+        {"configure_display", Method::configure_display},
+        {"remove_session_configuration", Method::remove_session_configuration},
+        {"set_base_display_configuration", Method::set_base_display_configuration},
+        {"configure_surface", Method::configure_surface},
+        {"modify_surface", Method::modify_surface},
+        {"create_screencast", Method::create_screencast},
+        {"screencast_buffer", Method::screencast_buffer},
+        {"screencast_to_buffer", Method::screencast_to_buffer},
+        {"release_screencast", Method::release_screencast},
+        {"create_buffer_stream", Method::create_buffer_stream},
+        {"release_buffer_stream", Method::release_buffer_stream},
+        {"configure_cursor", Method::configure_cursor},
+        {"new_fds_for_prompt_providers", Method::new_fds_for_prompt_providers},
+        {"start_prompt_session", Method::start_prompt_session},
+        {"stop_prompt_session", Method::stop_prompt_session},
+        {"request_operation", Method::request_operation},
+        {"disconnect", Method::disconnect},
+        {"pong", Method::pong},
+        {"configure_buffer_stream", Method::configure_buffer_stream},
+        {"translate_surface_to_screen", Method::translate_surface_to_screen},
+        {"request_persistent_surface_id", Method::request_persistent_surface_id},
+        {"preview_base_display_configuration", Method::preview_base_display_configuration},
+        {"confirm_base_display_configuration", Method::confirm_base_display_configuration},
+        {"cancel_base_display_configuration_preview", Method::cancel_base_display_configuration_preview},
+        {"apply_input_configuration", Method::apply_input_configuration},
+        {"set_base_input_configuration", Method::set_base_input_configuration},
+    };
+
+    auto const method = methods.find(name);
+    return method != methods.end() ? method->second : Method::unknown;
+}
 }
 
 mfd::ProtobufMessageProcessor::ProtobufMessageProcessor(
@@ -49,7 +141,9 @@ mfd::ProtobufMessageProcessor::ProtobufMessageProcessor(
     std::shared_ptr<MessageProcessorReport> const& report) :
     sender(sender),
     display_server(display_server),
-    report(report)
+    report(report),
+    arena_block{new char[arena_block_size]},
+    arena{arena_options_for(arena_block.get(), arena_block_size)}
 {
 }
 
@@ -68,10 +162,10 @@ template<> struct result_ptr_t<mir::protobuf::SocketFD>     { typedef ::mir::pro
 template<> struct result_ptr_t<mir::protobuf::PlatformOperationMessage> { typedef ::mir::protobuf::PlatformOperationMessage* type; };
 
 template<class ParameterMessage>
-ParameterMessage parse_parameter(Invocation const& invocation)
+ParameterMessage* parse_parameter(Invocation const& invocation, google::protobuf::Arena* arena)
 {
-    ParameterMessage request;
-    if (!request.ParseFromString(invocation.parameters()))
+    auto const request = google::protobuf::Arena::CreateMessage<ParameterMessage>(arena);
+    if (!request->ParseFromString(invocation.parameters()))
         BOOST_THROW_EXCEPTION(std::runtime_error("Failed to parse message parameters!"));
     return request;
 }
@@ -146,6 +240,26 @@ void invoke(
     }
 }
 
+// Sends the (empty) response to a submit_buffer invocation
+class SubmitBufferDone : public google::protobuf::Closure
+{
+public:
+    SubmitBufferDone(ProtobufMessageProcessor* self, ::google::protobuf::uint32 invocation_id, protobuf::Void* response)
+    : self{self}, invocation_id{invocation_id}, response{response}
+    {
+    }
+
+    void Run() override
+    {
+        self->send_response(invocation_id, response);
+    }
+
+private:
+    ProtobufMessageProcessor* const self;
+    ::google::protobuf::uint32 const invocation_id;
+    protobuf::Void* const response;
+};
+
 // A partial-specialisation to handle error cases.
 template<class Self, class ServerX, class ParameterMessage, class ResultMessage>
 void invoke(
@@ -197,130 +311,137 @@ bool mfd::ProtobufMessageProcessor::dispatch(
 
     try
     {
-        // TODO comparing strings in an if-else chain isn't efficient.
-        // It is probably possible to generate a Trie at compile time.
-        if ("connect" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &DisplayServer::connect, invocation);
-        }
-        else if ("create_surface" == invocation.method_name())
+        // The request and response of the previous invocation are no longer referenced
+        arena.Reset();
+
+        switch (method_named(invocation.method_name()))
         {
-            invoke(this, display_server.get(), &DisplayServer::create_surface, invocation);
-        }
-        else if ("submit_buffer" == invocation.method_name())
+        case Method::connect:
+            invoke(this, display_server.get(), &DisplayServer::connect, invocation, &arena);
+            break;
+
+        case Method::create_surface:
+            invoke(this, display_server.get(), &DisplayServer::create_surface, invocation, &arena);
+            break;
+
+        case Method::submit_buffer:
         {
-            auto request = parse_parameter<mir::protobuf::BufferRequest>(invocation);
-            request.mutable_buffer()->clear_fd();
+            auto const request = parse_parameter<mir::protobuf::BufferRequest>(invocation, &arena);
+            request->mutable_buffer()->clear_fd();
             for (auto& fd : side_channel_fds)
-                request.mutable_buffer()->add_fd(fd);
-            invoke(shared_from_this(), display_server.get(), &DisplayServer::submit_buffer, invocation.id(), &request);
-        }
-        else if ("allocate_buffers" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &DisplayServer::allocate_buffers, invocation);
-        }
-        else if ("release_buffers" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &DisplayServer::release_buffers, invocation);
-        }
-        else if ("release_surface" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &DisplayServer::release_surface, invocation);
+                request->mutable_buffer()->add_fd(fd);
+            submit_buffer(invocation.id(), request);
+            break;
         }
-        else if ("platform_operation" == invocation.method_name())
+
+        case Method::allocate_buffers:
+            invoke(this, display_server.get(), &DisplayServer::allocate_buffers, invocation, &arena);
+            break;
+
+        case Method::release_buffers:
+            invoke(this, display_server.get(), &DisplayServer::release_buffers, invocation, &arena);
+            break;
+
+        case Method::release_surface:
+            invoke(this, display_server.get(), &DisplayServer::release_surface, invocation, &arena);
+            break;
+
+        case Method::platform_operation:
         {
-            auto request = parse_parameter<mir::protobuf::PlatformOperationMessage>(invocation);
+            auto const request = parse_parameter<mir::protobuf::PlatformOperationMessage>(invocation, &arena);
 
-            request.clear_fd();
+            request->clear_fd();
             for (auto& fd : side_channel_fds)
-                request.add_fd(fd);
+                request->add_fd(fd);
 
             invoke(shared_from_this(), display_server.get(), &DisplayServer::platform_operation,
-                   invocation.id(), &request);
-        }
-        else if ("configure_display" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &DisplayServer::configure_display, invocation);
-        }
-        else if ("remove_session_configuration" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &DisplayServer::remove_session_configuration, invocation);
-        }
-        else if ("set_base_display_configuration" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &DisplayServer::set_base_display_configuration, invocation);
-        }
-        else if ("configure_surface" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &DisplayServer::configure_surface, invocation);
-        }
-        else if ("modify_surface" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &DisplayServer::modify_surface, invocation);
-        }
-        else if ("create_screencast" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &DisplayServer::create_screencast, invocation);
-        }
-        else if ("screencast_buffer" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &DisplayServer::screencast_buffer, invocation);
+                   invocation.id(), request);
+            break;
         }
-        else if ("screencast_to_buffer" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &DisplayServer::screencast_to_buffer, invocation);
-        }
-        else if ("release_screencast" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &DisplayServer::release_screencast, invocation);
-        }
-        else if ("create_buffer_stream" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &DisplayServer::create_buffer_stream, invocation);
-        }
-        else if ("release_buffer_stream" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &DisplayServer::release_buffer_stream, invocation);
-        }
-        else if ("configure_cursor" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &protobuf::DisplayServer::configure_cursor, invocation);
-        }
-        else if ("new_fds_for_prompt_providers" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &protobuf::DisplayServer::new_fds_for_prompt_providers, invocation);
-        }
-        else if ("start_prompt_session" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &protobuf::DisplayServer::start_prompt_session, invocation);
-        }
-        else if ("stop_prompt_session" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &protobuf::DisplayServer::stop_prompt_session, invocation);
-        }
-        else if ("request_operation" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &protobuf::DisplayServer::request_operation, invocation);
-        }
-        else if ("disconnect" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &DisplayServer::disconnect, invocation);
+
+        case Method::configure_display:
+            invoke(this, display_server.get(), &DisplayServer::configure_display, invocation, &arena);
+            break;
+
+        case Method::remove_session_configuration:
+            invoke(this, display_server.get(), &DisplayServer::remove_session_configuration, invocation, &arena);
+            break;
+
+        case Method::set_base_display_configuration:
+            invoke(this, display_server.get(), &DisplayServer::set_base_display_configuration, invocation, &arena);
+            break;
+
+        case Method::configure_surface:
+            invoke(this, display_server.get(), &DisplayServer::configure_surface, invocation, &arena);
+            break;
+
+        case Method::modify_surface:
+            invoke(this, display_server.get(), &DisplayServer::modify_surface, invocation, &arena);
+            break;
+
+        case Method::create_screencast:
+            invoke(this, display_server.get(), &DisplayServer::create_screencast, invocation, &arena);
+            break;
+
+        case Method::screencast_buffer:
+            invoke(this, display_server.get(), &DisplayServer::screencast_buffer, invocation, &arena);
+            break;
+
+        case Method::screencast_to_buffer:
+            invoke(this, display_server.get(), &DisplayServer::screencast_to_buffer, invocation, &arena);
+            break;
+
+        case Method::release_screencast:
+            invoke(this, display_server.get(), &DisplayServer::release_screencast, invocation, &arena);
+            break;
+
+        case Method::create_buffer_stream:
+            invoke(this, display_server.get(), &DisplayServer::create_buffer_stream, invocation, &arena);
+            break;
+
+        case Method::release_buffer_stream:
+            invoke(this, display_server.get(), &DisplayServer::release_buffer_stream, invocation, &arena);
+            break;
+
+        case Method::configure_cursor:
+            invoke(this, display_server.get(), &protobuf::DisplayServer::configure_cursor, invocation, &arena);
+            break;
+
+        case Method::new_fds_for_prompt_providers:
+            invoke(this, display_server.get(), &protobuf::DisplayServer::new_fds_for_prompt_providers, invocation, &arena);
+            break;
+
+        case Method::start_prompt_session:
+            invoke(this, display_server.get(), &protobuf::DisplayServer::start_prompt_session, invocation, &arena);
+            break;
+
+        case Method::stop_prompt_session:
+            invoke(this, display_server.get(), &protobuf::DisplayServer::stop_prompt_session, invocation, &arena);
+            break;
+
+        case Method::request_operation:
+            invoke(this, display_server.get(), &protobuf::DisplayServer::request_operation, invocation, &arena);
+            break;
+
+        case Method::disconnect:
+            invoke(this, display_server.get(), &DisplayServer::disconnect, invocation, &arena);
             result = false;
-        }
-        else if ("pong" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &DisplayServer::pong, invocation);
-        }
-        else if ("configure_buffer_stream" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &DisplayServer::configure_buffer_stream, invocation);
-        }
-        else if ("translate_surface_to_screen" == invocation.method_name())
+            break;
+
+        case Method::pong:
+            invoke(this, display_server.get(), &DisplayServer::pong, invocation, &arena);
+            break;
+
+        case Method::configure_buffer_stream:
+            invoke(this, display_server.get(), &DisplayServer::configure_buffer_stream, invocation, &arena);
+            break;
+
+        case Method::translate_surface_to_screen:
         {
             try
             {
                 auto debug_interface = dynamic_cast<mir::protobuf::DisplayServerDebug*>(display_server.get());
-                invoke(this, debug_interface, &mir::protobuf::DisplayServerDebug::translate_surface_to_screen, invocation);
+                invoke(this, debug_interface, &mir::protobuf::DisplayServerDebug::translate_surface_to_screen, invocation, &arena);
             }
             catch (std::runtime_error const&)
             {
@@ -332,35 +453,37 @@ bool mfd::ProtobufMessageProcessor::dispatch(
                 std::runtime_error err{"Client attempted to use unavailable debug interface"};
                 report->exception_handled(display_server.get(), invocation.id(), err);
             }
+            break;
         }
-        else if ("request_persistent_surface_id" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &protobuf::DisplayServer::request_persistent_surface_id, invocation);
-        }
-        else if ("preview_base_display_configuration" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &protobuf::DisplayServer::preview_base_display_configuration, invocation);
-        }
-        else if ("confirm_base_display_configuration" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &protobuf::DisplayServer::confirm_base_display_configuration, invocation);
-        }
-        else if ("cancel_base_display_configuration_preview" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &protobuf::DisplayServer::cancel_base_display_configuration_preview, invocation);
-        }
-        else if ("apply_input_configuration" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &protobuf::DisplayServer::apply_input_configuration, invocation);
-        }
-        else if ("set_base_input_configuration" == invocation.method_name())
-        {
-            invoke(this, display_server.get(), &protobuf::DisplayServer::set_base_input_configuration, invocation);
-        }
-        else
-        {
+
+        case Method::request_persistent_surface_id:
+            invoke(this, display_server.get(), &protobuf::DisplayServer::request_persistent_surface_id, invocation, &arena);
+            break;
+
+        case Method::preview_base_display_configuration:
+            invoke(this, display_server.get(), &protobuf::DisplayServer::preview_base_display_configuration, invocation, &arena);
+            break;
+
+        case Method::confirm_base_display_configuration:
+            invoke(this, display_server.get(), &protobuf::DisplayServer::confirm_base_display_configuration, invocation, &arena);
+            break;
+
+        case Method::cancel_base_display_configuration_preview:
+            invoke(this, display_server.get(), &protobuf::DisplayServer::cancel_base_display_configuration_preview, invocation, &arena);
+            break;
+
+        case Method::apply_input_configuration:
+            invoke(this, display_server.get(), &protobuf::DisplayServer::apply_input_configuration, invocation, &arena);
+            break;
+
+        case Method::set_base_input_configuration:
+            invoke(this, display_server.get(), &protobuf::DisplayServer::set_base_input_configuration, invocation, &arena);
+            break;
+
+        case Method::unknown:
             report->unknown_method(display_server.get(), invocation.id(), invocation.method_name());
             result = false;
+            break;
         }
     }
     catch (std::exception const& error)
@@ -374,6 +497,40 @@ bool mfd::ProtobufMessageProcessor::dispatch(
     return result;
 }
 
+void mfd::ProtobufMessageProcessor::submit_buffer(
+    ::google::protobuf::uint32 id,
+    protobuf::BufferRequest const* request)
+{
+    // The hot path for legacy clients. SessionMediator::submit_buffer()
+    // completes before returning, so the response can live on the arena and
+    // be sent without the shared ownership the generic asynchronous path needs.
+    auto const response = google::protobuf::Arena::CreateMessage<protobuf::Void>(&arena);
+    SubmitBufferDone done{this, id, response};
+
+    try
+    {
+        display_server->submit_buffer(request, response, &done);
+    }
+    catch (mir::cookie::SecurityCheckError const& /*err*/)
+    {
+        throw;
+    }
+    catch (mir::ClientVisibleError const& error)
+    {
+        auto client_error = response->mutable_structured_error();
+        client_error->set_code(error.code());
+        client_error->set_domain(error.domain());
+        done.Run();
+    }
+    catch (std::exception const& x)
+    {
+        using namespace std::literals;
+        response->set_error("Error processing request: "s +
+            x.what() + "\nInternal error details: " + boost::diagnostic_information(x));
+        done.Run();
+    }
+}
+
 void mfd::ProtobufMessageProcessor::send_response(::google::protobuf::uint32 id, ::google::protobuf::MessageLite* response)
 {
     sender->send_response(id, response, {});
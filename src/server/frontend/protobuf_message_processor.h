@@ -23,6 +23,7 @@
 #include "mir/frontend/message_processor.h"
 #include "mir_protobuf.pb.h"
 #include <google/protobuf/stubs/common.h>
+#include <google/protobuf/arena.h>
 
 #include <memory>
 
@@ -63,10 +64,18 @@ public:
 
 private:
     bool dispatch(Invocation const& invocation, std::vector<mir::Fd> const& side_channel_fds) override;
+    void submit_buffer(google::protobuf::uint32 id, protobuf::BufferRequest const* request);
 
     std::shared_ptr<ProtobufMessageSender> const sender;
     std::shared_ptr<DisplayServer> const display_server;
     std::shared_ptr<MessageProcessorReport> const report;
+
+    // Requests and responses of the invocation being dispatched. Invocations
+    // on a connection are dispatched one at a time, so this is Reset() for each
+    // and, for typical messages, never needs more than the initial block.
+    static size_t const arena_block_size = 4096;
+    std::unique_ptr<char[]> const arena_block;
+    google::protobuf::Arena arena;
 };
 }
 }
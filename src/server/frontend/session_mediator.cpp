@@ -19,6 +19,7 @@
 #include "session_mediator.h"
 #include "reordering_message_sender.h"
 #include "event_sink_factory.h"
+#include "event_sender.h"
 
 #include "mir/frontend/session_mediator_observer.h"
 #include "mir/frontend/shell.h"
@@ -62,6 +63,7 @@
 #include "mir/module_properties.h"
 #include "mir/graphics/graphic_buffer_allocator.h"
 #include "mir/executor.h"
+#include "mir/log.h"
 
 #include "mir/geometry/rectangles.h"
 #include "protobuf_buffer_packer.h"
@@ -147,6 +149,13 @@ mf::SessionMediator::~SessionMediator() noexcept
         shell->close_session(mir_client_session);
     }
     destroy_screencast_sessions();
+
+    if (peak_buffer_cache_bytes)
+    {
+        mir::log_debug(
+            "Client (pid %d) held at most %zu KiB of buffers (%zu KiB at disconnect)",
+            client_pid_, peak_buffer_cache_bytes / 1024, buffer_cache_bytes / 1024);
+    }
 }
 
 void mf::SessionMediator::client_pid(int pid)
@@ -355,6 +364,13 @@ void mf::SessionMediator::create_surface(
 
     auto const surf_id = shell->create_surface(mir_client_session, params, sink);
 
+    // The ring's setup message is corked along with the other surface events
+    if (request->input_event_ring())
+    {
+        if (auto const sender = std::dynamic_pointer_cast<detail::EventSender>(sink))
+            sender->enable_input_event_ring(surf_id);
+    }
+
     auto surface = mir_client_session->frontend_surface(surf_id);
     auto const& content_size = surface->content_size();
     response->mutable_id()->set_value(surf_id.as_value());
@@ -543,8 +559,7 @@ void mf::SessionMediator::allocate_buffers(
                 stream_associated_buffers.insert(std::make_pair(stream_id, buffer->id()));
             }
 
-            // TODO: Throw if insert fails (duplicate ID)?
-            buffer_cache.insert(std::make_pair(buffer->id(), buffer));
+            cache_buffer(buffer);
             event_sink->add_buffer(*buffer);
         }
         catch (std::exception const& err)
@@ -596,11 +611,40 @@ void mf::SessionMediator::release_buffers(
     }
     for (auto const& buffer_id : to_release)
     {
-        buffer_cache.erase(buffer_id);
+        uncache_buffer(buffer_id);
     }
    done->Run();
 }
 
+namespace
+{
+auto bytes_for(mg::Buffer const& buffer) -> size_t
+{
+    auto const size = buffer.size();
+    return MIR_BYTES_PER_PIXEL(buffer.pixel_format()) * size.width.as_uint32_t() * size.height.as_uint32_t();
+}
+}
+
+void mf::SessionMediator::cache_buffer(std::shared_ptr<mg::Buffer> const& buffer)
+{
+    // TODO: Throw if insert fails (duplicate ID)?
+    if (buffer_cache.insert(std::make_pair(buffer->id(), buffer)).second)
+    {
+        buffer_cache_bytes += bytes_for(*buffer);
+        peak_buffer_cache_bytes = std::max(peak_buffer_cache_bytes, buffer_cache_bytes);
+    }
+}
+
+void mf::SessionMediator::uncache_buffer(mg::BufferID id)
+{
+    auto const cached = buffer_cache.find(id);
+    if (cached == buffer_cache.end())
+        return;
+
+    buffer_cache_bytes -= bytes_for(*cached->second);
+    buffer_cache.erase(cached);
+}
+
 void mf::SessionMediator::release_surface(
     const mir::protobuf::SurfaceId* request,
     mir::protobuf::Void*,
@@ -1046,7 +1090,7 @@ void mf::SessionMediator::release_buffer_stream(
     auto const associated_range = stream_associated_buffers.equal_range(id) ;
     for (auto match = associated_range.first; match != associated_range.second; ++match)
     {
-        buffer_cache.erase(match->second);
+        uncache_buffer(match->second);
     }
     stream_associated_buffers.erase(id);
 
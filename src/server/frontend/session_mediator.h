@@ -285,6 +285,9 @@ private:
 
     void destroy_screencast_sessions();
 
+    void cache_buffer(std::shared_ptr<graphics::Buffer> const& buffer);
+    void uncache_buffer(graphics::BufferID id);
+
     pid_t client_pid_;
     std::shared_ptr<Shell> const shell;
     std::shared_ptr<graphics::PlatformIpcOperations> const ipc_operations;
@@ -306,6 +309,8 @@ private:
     std::shared_ptr<InputConfigurationChanger> const input_changer;
     std::vector<mir::ExtensionDescription> const extensions;
     std::unordered_map<graphics::BufferID, std::shared_ptr<graphics::Buffer>> buffer_cache;
+    size_t buffer_cache_bytes{0};       ///< Approximate pixel storage held in buffer_cache
+    size_t peak_buffer_cache_bytes{0};
     std::unordered_multimap<BufferStreamId, graphics::BufferID> stream_associated_buffers;
     std::shared_ptr<graphics::GraphicBufferAllocator> const allocator;
     mir::Executor& executor;
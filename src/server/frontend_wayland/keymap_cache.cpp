@@ -0,0 +1,222 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "keymap_cache.h"
+
+#include "mir/anonymous_shm_file.h"
+#include "mir/input/keymap.h"
+#include "mir/log.h"
+
+#include <xkbcommon/xkbcommon.h>
+#include <boost/throw_exception.hpp>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <linux/memfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace mf = mir::frontend;
+namespace mi = mir::input;
+
+namespace
+{
+/// A read-only copy of text that can safely be shared with every client, or an invalid Fd
+auto sealed_file_holding(std::string const& text) -> mir::Fd
+{
+    mir::Fd fd{static_cast<int>(syscall(SYS_memfd_create, "mir-keymap", MFD_CLOEXEC | MFD_ALLOW_SEALING))};
+    if (fd == mir::Fd::invalid)
+    {
+        mir::log_info("Keymaps can't be shared between clients: failed to create sealable file (%s)", strerror(errno));
+        return {};
+    }
+
+    for (size_t written = 0; written != text.size();)
+    {
+        auto const result = pwrite(fd, text.data() + written, text.size() - written, written);
+        if (result < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            mir::log_warning("Failed to write shared keymap (%s)", strerror(errno));
+            return {};
+        }
+        written += result;
+    }
+
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0)
+    {
+        mir::log_info("Keymaps can't be shared between clients: failed to seal file (%s)", strerror(errno));
+        return {};
+    }
+
+    return fd;
+}
+
+auto compile_failure(char const* what) -> std::runtime_error
+{
+    return std::runtime_error{std::string{"Failed to compile keymap from "} + what};
+}
+}
+
+mf::CompiledKeymap::CompiledKeymap(xkb_keymap* keymap, std::string&& text, Fd const& sealed_fd)
+    : keymap_{keymap},
+      text_{std::move(text)},
+      sealed_fd_{sealed_fd}
+{
+}
+
+mf::CompiledKeymap::~CompiledKeymap()
+{
+    xkb_keymap_unref(keymap_);
+}
+
+auto mf::CompiledKeymap::fd_for_client() const -> Fd
+{
+    // Clients map the keymap read-only, so a sealed file can be shared by all of them
+    if (sealed_fd_ != Fd::invalid)
+        return sealed_fd_;
+
+    AnonymousShmFile copy{text_.size()};
+    memcpy(copy.base_ptr(), text_.data(), text_.size());
+    return Fd{dup(copy.fd())};
+}
+
+mf::KeymapCache::KeymapCache()
+    : KeymapCache{&::sealed_file_holding}
+{
+}
+
+mf::KeymapCache::KeymapCache(SealedFileFactory const& sealed_file_factory)
+    : sealed_file_holding{sealed_file_factory},
+      context{xkb_context_new(XKB_CONTEXT_NO_FLAGS), &xkb_context_unref}
+{
+}
+
+mf::KeymapCache::~KeymapCache() = default;
+
+auto mf::KeymapCache::keymap_for(mi::Keymap const& names) -> std::shared_ptr<CompiledKeymap const>
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    auto const key = Names{names.model, names.layout, names.variant, names.options};
+    if (auto const cached = by_names[key].lock())
+        return cached;
+
+    xkb_rule_names const rule_names = {
+        "evdev",
+        names.model.c_str(),
+        names.layout.c_str(),
+        names.variant.c_str(),
+        names.options.c_str()
+    };
+
+    auto const keymap = xkb_keymap_new_from_names(context.get(), &rule_names, XKB_KEYMAP_COMPILE_NO_FLAGS);
+    if (!keymap)
+        BOOST_THROW_EXCEPTION(compile_failure("names"));
+
+    std::unique_ptr<char, void(*)(void*)> buffer{xkb_keymap_get_as_string(keymap, XKB_KEYMAP_FORMAT_TEXT_V1), free};
+    std::string text{buffer.get()};
+    auto const hash = std::hash<std::string>{}(text);
+
+    // Different names can produce the same keymap (e.g. an explicit default)
+    auto compiled = cached_text(text, hash);
+    if (compiled)
+    {
+        xkb_keymap_unref(keymap);
+    }
+    else
+    {
+        prune();
+        auto const sealed_fd = sealed_file_holding(text);
+        compiled = std::make_shared<CompiledKeymap const>(keymap, std::move(text), sealed_fd);
+        by_text_hash.emplace(hash, compiled);
+    }
+
+    by_names[key] = compiled;
+    return compiled;
+}
+
+auto mf::KeymapCache::keymap_for(char const* buffer, size_t length) -> std::shared_ptr<CompiledKeymap const>
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    std::string text{buffer, length};
+    auto const hash = std::hash<std::string>{}(text);
+
+    if (auto const cached = cached_text(text, hash))
+        return cached;
+
+    auto const keymap = xkb_keymap_new_from_buffer(
+        context.get(),
+        buffer,
+        length,
+        XKB_KEYMAP_FORMAT_TEXT_V1,
+        XKB_KEYMAP_COMPILE_NO_FLAGS);
+    if (!keymap)
+        BOOST_THROW_EXCEPTION(compile_failure("buffer"));
+
+    prune();
+    auto const sealed_fd = sealed_file_holding(text);
+    auto const compiled = std::make_shared<CompiledKeymap const>(keymap, std::move(text), sealed_fd);
+    by_text_hash.emplace(hash, compiled);
+    return compiled;
+}
+
+auto mf::KeymapCache::cached_text(std::string const& text, size_t hash) const -> std::shared_ptr<CompiledKeymap const>
+{
+    auto const range = by_text_hash.equal_range(hash);
+    for (auto entry = range.first; entry != range.second; ++entry)
+    {
+        if (auto const cached = entry->second.lock())
+        {
+            if (cached->text() == text)
+                return cached;
+        }
+    }
+
+    return {};
+}
+
+auto mf::KeymapCache::entries() const -> size_t
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return by_names.size() + by_text_hash.size();
+}
+
+void mf::KeymapCache::prune()
+{
+    for (auto entry = by_names.begin(); entry != by_names.end();)
+    {
+        if (entry->second.expired())
+            entry = by_names.erase(entry);
+        else
+            ++entry;
+    }
+
+    for (auto entry = by_text_hash.begin(); entry != by_text_hash.end();)
+    {
+        if (entry->second.expired())
+            entry = by_text_hash.erase(entry);
+        else
+            ++entry;
+    }
+}
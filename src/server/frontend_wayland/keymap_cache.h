@@ -0,0 +1,109 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_FRONTEND_KEYMAP_CACHE_H
+#define MIR_FRONTEND_KEYMAP_CACHE_H
+
+#include "mir/fd.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+
+// from <xkbcommon/xkbcommon.h>
+struct xkb_keymap;
+struct xkb_context;
+
+namespace mir
+{
+namespace input
+{
+class Keymap;
+}
+namespace frontend
+{
+/// An immutable compiled keymap, and its text as sent to clients
+class CompiledKeymap
+{
+public:
+    CompiledKeymap(xkb_keymap* keymap, std::string&& text, Fd const& sealed_fd);
+    ~CompiledKeymap();
+
+    auto keymap() const -> xkb_keymap* { return keymap_; }
+    auto text() const -> std::string const& { return text_; }
+
+    /// A sealed memfd holding text(), which every client can be sent. Invalid if the kernel can't seal files.
+    auto sealed_fd() const -> Fd const& { return sealed_fd_; }
+
+    /// A file holding text() to send a client: sealed_fd() if valid, otherwise a private copy
+    auto fd_for_client() const -> Fd;
+
+private:
+    CompiledKeymap(CompiledKeymap const&) = delete;
+    CompiledKeymap& operator=(CompiledKeymap const&) = delete;
+
+    xkb_keymap* const keymap_;
+    std::string const text_;
+    Fd const sealed_fd_;
+};
+
+/**
+ * Compiles each distinct keymap once, whether named by RMLVO or given as text,
+ * and shares it for as long as any keyboard uses it.
+ *
+ * xkbcommon's reference counts are not atomic: the compiled keymaps (and any
+ * xkb_state created from them) should only be used on the Wayland thread.
+ */
+class KeymapCache
+{
+public:
+    /// Makes a sealed file holding a keymap's text, or returns an invalid Fd if it can't
+    using SealedFileFactory = std::function<Fd(std::string const& text)>;
+
+    KeymapCache();
+    explicit KeymapCache(SealedFileFactory const& sealed_file_factory);
+    ~KeymapCache();
+
+    auto keymap_for(input::Keymap const& names) -> std::shared_ptr<CompiledKeymap const>;
+    auto keymap_for(char const* buffer, size_t length) -> std::shared_ptr<CompiledKeymap const>;
+
+    /// The entries held, by names and by text, including any expired ones not yet pruned
+    auto entries() const -> size_t;
+
+private:
+    KeymapCache(KeymapCache const&) = delete;
+    KeymapCache& operator=(KeymapCache const&) = delete;
+
+    using Names = std::tuple<std::string, std::string, std::string, std::string>;
+
+    auto cached_text(std::string const& text, size_t hash) const -> std::shared_ptr<CompiledKeymap const>;
+    void prune();
+
+    SealedFileFactory const sealed_file_holding;
+
+    std::mutex mutable mutex;
+    std::unique_ptr<xkb_context, void(*)(xkb_context*)> const context;
+    std::map<Names, std::weak_ptr<CompiledKeymap const>> by_names;
+    std::unordered_multimap<size_t, std::weak_ptr<CompiledKeymap const>> by_text_hash;
+};
+}
+}
+
+#endif // MIR_FRONTEND_KEYMAP_CACHE_H
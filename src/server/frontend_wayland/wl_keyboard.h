@@ -24,11 +24,10 @@
 #include <vector>
 #include <functional>
 #include <chrono>
+#include <memory>
 
 // from <xkbcommon/xkbcommon.h>
-struct xkb_keymap;
 struct xkb_state;
-struct xkb_context;
 
 namespace mir
 {
@@ -43,6 +42,8 @@ class Keymap;
 namespace frontend
 {
 class WlSurface;
+class CompiledKeymap;
+class KeymapCache;
 
 class WlKeyboard : public wayland::Keyboard
 {
@@ -50,6 +51,7 @@ public:
     WlKeyboard(
         wl_resource* new_resource,
         mir::input::Keymap const& initial_keymap,
+        std::shared_ptr<KeymapCache> const& keymaps,
         std::function<void(WlKeyboard*)> const& on_destroy,
         std::function<std::vector<uint32_t>()> const& acquire_current_keyboard_state);
 
@@ -64,10 +66,11 @@ public:
 private:
     void update_modifier_state();
     void update_keyboard_state(std::vector<uint32_t> const& keyboard_state);
+    void send_keymap(CompiledKeymap const& compiled);
 
-    std::unique_ptr<xkb_keymap, void (*)(xkb_keymap *)> keymap;
+    std::shared_ptr<KeymapCache> const keymaps;
+    std::shared_ptr<CompiledKeymap const> keymap;
     std::unique_ptr<xkb_state, void (*)(xkb_state *)> state;
-    std::unique_ptr<xkb_context, void (*)(xkb_context *)> const context;
 
     std::function<void(WlKeyboard*)> on_destroy;
     std::function<std::vector<uint32_t>()> const acquire_current_keyboard_state;
@@ -45,6 +45,7 @@ namespace frontend
 {
 class WlPointer;
 class WlKeyboard;
+class KeymapCache;
 class WlTouch;
 
 class WlSeat : public wayland::Seat::Global
@@ -104,6 +105,7 @@ private:
     class Instance;
 
     std::unique_ptr<mir::input::Keymap> const keymap;
+    std::shared_ptr<KeymapCache> const keymaps;   ///< Shared by all keyboards, so each keymap is compiled once
     std::shared_ptr<ConfigObserver> const config_observer;
 
     // listener list are shared pointers so devices can keep them around long enough to remove themselves
@@ -29,6 +29,7 @@
 #include "null_cursor.h"
 #include "offscreen/display.h"
 #include "software_cursor.h"
+#include "recycling_buffer_allocator.h"
 #include "platform_probe.h"
 
 #include "mir/graphics/gl_config.h"
@@ -48,6 +49,7 @@
 
 #include <boost/throw_exception.hpp>
 
+#include <chrono>
 #include <map>
 #include <sstream>
 
@@ -78,6 +80,7 @@ std::shared_ptr<mg::Platform> mir::DefaultServerConfiguration::the_graphics_plat
     return graphics_platform(
         [this]()->std::shared_ptr<mg::Platform>
         {
+            auto const start = std::chrono::steady_clock::now();
             std::shared_ptr<mir::SharedLibrary> platform_library;
             std::stringstream error_report;
             try
@@ -120,7 +123,18 @@ std::shared_ptr<mg::Platform> mir::DefaultServerConfiguration::the_graphics_plat
                         auto msg = "Failed to find any platform plugins in: " + path;
                         throw std::runtime_error(msg.c_str());
                     }
-                    platform_library = mir::graphics::module_for_device(platforms, dynamic_cast<mir::options::ProgramOption&>(*the_options()), the_console_services());
+                    std::unique_ptr<mg::ProbeCache> probe_cache;
+                    if (the_options()->is_set(options::platform_probe_cache))
+                    {
+                        probe_cache = std::make_unique<mg::ProbeCache>(
+                            the_options()->get<std::string>(options::platform_probe_cache),
+                            mg::ProbeCache::current_environment());
+                    }
+                    platform_library = mir::graphics::module_for_device(
+                        platforms,
+                        dynamic_cast<mir::options::ProgramOption&>(*the_options()),
+                        the_console_services(),
+                        probe_cache.get());
                 }
                 auto create_host_platform =
                     [platform_library]() -> std::function<std::remove_pointer<mg::CreateHostPlatform>::type>
@@ -166,12 +180,17 @@ std::shared_ptr<mg::Platform> mir::DefaultServerConfiguration::the_graphics_plat
                               description->minor_version,
                               description->micro_version);
 
-                return create_host_platform(
+                std::shared_ptr<mg::Platform> const platform = create_host_platform(
                     the_options(),
                     the_emergency_cleanup(),
                     the_console_services(),
                     the_display_report(),
                     the_logger());
+
+                mir::log_info("Graphics platform ready %lld ms after probing started",
+                              static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                  std::chrono::steady_clock::now() - start).count()));
+                return platform;
             }
             catch(...)
             {
@@ -193,6 +212,22 @@ mir::DefaultServerConfiguration::the_buffer_allocator()
         });
 }
 
+std::shared_ptr<mg::GraphicBufferAllocator>
+mir::DefaultServerConfiguration::the_recycling_buffer_allocator()
+{
+    return recycling_buffer_allocator(
+        [this]()
+        {
+            // Enough for the decorations of several large windows
+            size_t const max_idle_bytes{32 * 1024 * 1024};
+            return std::make_shared<mg::RecyclingBufferAllocator>(
+                the_buffer_allocator(),
+                the_main_loop(),
+                max_idle_bytes,
+                std::chrono::seconds{5});
+        });
+}
+
 std::shared_ptr<mg::Display>
 mir::DefaultServerConfiguration::the_display()
 {
@@ -254,7 +289,7 @@ mir::DefaultServerConfiguration::the_cursor()
             {
                 mir::log_info("Using software cursor");
                 primary_cursor = std::make_shared<mg::SoftwareCursor>(
-                    the_buffer_allocator(),
+                    the_recycling_buffer_allocator(),
                     the_main_loop(),
                     the_input_scene());
             }
@@ -164,3 +164,36 @@ mg::NativeDisplayBuffer* mgo::DisplayBuffer::native_display_buffer()
 {
     return this;
 }
+
+unsigned char* mgo::DisplayBuffer::map_pixels()
+{
+    if (pixels.empty())
+        pixels.resize(stride().as_int() * area.size.height.as_int());
+
+    return pixels.data();
+}
+
+geom::Size mgo::DisplayBuffer::size() const
+{
+    return area.size;
+}
+
+geom::Stride mgo::DisplayBuffer::stride() const
+{
+    return geom::Stride{area.size.width.as_int() * 4};
+}
+
+unsigned mgo::DisplayBuffer::buffer_age() const
+{
+    return pixels_committed ? 1 : 0;
+}
+
+bool mgo::DisplayBuffer::applies_transformation() const
+{
+    return false;
+}
+
+void mgo::DisplayBuffer::commit(geom::Rectangles const&)
+{
+    pixels_committed = true;
+}
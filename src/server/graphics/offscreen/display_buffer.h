@@ -25,6 +25,9 @@
 #include "mir/geometry/size.h"
 #include "mir/geometry/rectangle.h"
 #include "mir/renderer/gl/render_target.h"
+#include "mir/renderer/sw/pixel_target.h"
+
+#include <vector>
 
 #include <EGL/egl.h>
 
@@ -59,7 +62,8 @@ private:
 
 class DisplayBuffer : public graphics::DisplayBuffer,
                       public graphics::NativeDisplayBuffer,
-                      public renderer::gl::RenderTarget
+                      public renderer::gl::RenderTarget,
+                      public renderer::software::PixelTarget
 {
 public:
     DisplayBuffer(SurfacelessEGLContext egl_context,
@@ -73,10 +77,20 @@ public:
     void bind() override;
     void release_current() override;
     void swap_buffers() override;
+
+    // The pixels are only allocated if a software renderer draws into them
+    unsigned char* map_pixels() override;
+    geometry::Size size() const override;
+    geometry::Stride stride() const override;
+    unsigned buffer_age() const override;
+    bool applies_transformation() const override;
+    void commit(geometry::Rectangles const& damage) override;
 private:
     SurfacelessEGLContext const egl_context;
     detail::GLFramebufferObject const fbo;
     geometry::Rectangle const area;
+    std::vector<unsigned char> pixels;
+    bool pixels_committed{false};
 };
 
 }
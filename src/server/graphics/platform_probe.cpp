@@ -22,6 +22,24 @@
 
 #include <boost/throw_exception.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <sstream>
+#include <system_error>
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <elf.h>
+#include <link.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+namespace mg = mir::graphics;
+
 auto mir::graphics::probe_module(
     mir::SharedLibrary& module,
     mir::options::ProgramOption const& options,
@@ -89,32 +107,388 @@ auto mir::graphics::probe_module(
 }
 
 
+class mg::ExclusiveDeviceConsoleServices::Reservations
+{
+public:
+    void reserve(dev_t device)
+    {
+        std::unique_lock<decltype(mutex)> lock{mutex};
+        released.wait(lock, [&] { return held.count(device) == 0; });
+        held.insert(device);
+    }
+
+    void release(dev_t device)
+    {
+        {
+            std::lock_guard<decltype(mutex)> lock{mutex};
+            held.erase(device);
+        }
+        released.notify_all();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable released;
+    std::set<dev_t> held;
+};
+
+namespace
+{
+/// Releases the reservation once the device it was made for is done with
+struct Reservation
+{
+    Reservation(std::shared_ptr<mg::ExclusiveDeviceConsoleServices::Reservations> const& reservations, dev_t device);
+    ~Reservation();
+
+    std::shared_ptr<mg::ExclusiveDeviceConsoleServices::Reservations> const reservations;
+    dev_t const device;
+};
+
+class ReservedDevice : public mir::Device
+{
+public:
+    ReservedDevice(std::unique_ptr<Reservation> reservation, std::unique_ptr<mir::Device> device) :
+        reservation{std::move(reservation)},
+        device{std::move(device)}
+    {
+    }
+
+private:
+    // Declared first so it is released after the device
+    std::unique_ptr<Reservation> const reservation;
+    std::unique_ptr<mir::Device> const device;
+};
+}
+
+Reservation::Reservation(
+    std::shared_ptr<mg::ExclusiveDeviceConsoleServices::Reservations> const& reservations,
+    dev_t device) :
+    reservations{reservations},
+    device{device}
+{
+    reservations->reserve(device);
+}
+
+Reservation::~Reservation()
+{
+    reservations->release(device);
+}
+
+mg::ExclusiveDeviceConsoleServices::ExclusiveDeviceConsoleServices(std::shared_ptr<ConsoleServices> const& wrapped) :
+    wrapped{wrapped},
+    reservations{std::make_shared<Reservations>()}
+{
+}
+
+void mg::ExclusiveDeviceConsoleServices::register_switch_handlers(
+    EventHandlerRegister& handlers,
+    std::function<bool()> const& switch_away,
+    std::function<bool()> const& switch_back)
+{
+    wrapped->register_switch_handlers(handlers, switch_away, switch_back);
+}
+
+void mg::ExclusiveDeviceConsoleServices::restore()
+{
+    wrapped->restore();
+}
+
+auto mg::ExclusiveDeviceConsoleServices::create_vt_switcher() -> std::unique_ptr<VTSwitcher>
+{
+    return wrapped->create_vt_switcher();
+}
+
+auto mg::ExclusiveDeviceConsoleServices::acquire_device(
+    int major, int minor,
+    std::unique_ptr<Device::Observer> observer) -> std::future<std::unique_ptr<Device>>
+{
+    auto reservation = std::make_unique<Reservation>(reservations, makedev(major, minor));
+    auto device = wrapped->acquire_device(major, minor, std::move(observer));
+
+    return std::async(
+        std::launch::deferred,
+        [reservation = std::move(reservation), device = std::move(device)]() mutable -> std::unique_ptr<Device>
+        {
+            return std::make_unique<ReservedDevice>(std::move(reservation), device.get());
+        });
+}
+
 std::shared_ptr<mir::SharedLibrary>
 mir::graphics::module_for_device(
     std::vector<std::shared_ptr<SharedLibrary>> const& modules,
     mir::options::ProgramOption const& options,
-    std::shared_ptr<ConsoleServices> const& console)
+    std::shared_ptr<ConsoleServices> const& console,
+    ProbeCache* cache)
 {
+    auto const start = std::chrono::steady_clock::now();
+
+    // Probes run concurrently, but those after the same DRM device must take turns with it
+    auto const exclusive_console = console ? std::make_shared<ExclusiveDeviceConsoleServices>(console) : console;
+
+    auto const try_probe =
+        [&](SharedLibrary& module)
+        {
+            try
+            {
+                return probe_module(module, options, exclusive_console);
+            }
+            catch (std::runtime_error const&)
+            {
+                return mir::graphics::unsupported;
+            }
+        };
+
+    std::vector<optional_value<PlatformPriority>> cached(modules.size());
+    std::vector<std::future<PlatformPriority>> probes(modules.size());
+    size_t cache_hits{0};
+
+    for (size_t i = 0; i != modules.size(); ++i)
+    {
+        if (cache && (cached[i] = cache->priority_of(*modules[i])).is_set())
+        {
+            ++cache_hits;
+            continue;
+        }
+
+        auto const module = modules[i];
+        probes[i] = std::async(std::launch::async, [&try_probe, module] { return try_probe(*module); });
+    }
+
     mir::graphics::PlatformPriority best_priority_so_far = mir::graphics::unsupported;
     std::shared_ptr<mir::SharedLibrary> best_module_so_far;
-    for (auto& module : modules)
+    bool best_was_cached{false};
+
+    for (size_t i = 0; i != modules.size(); ++i)
+    {
+        auto const module_priority = cached[i].is_set() ? cached[i].value() : probes[i].get();
+
+        if (cache && !cached[i].is_set())
+            cache->store(*modules[i], module_priority);
+
+        if (module_priority > best_priority_so_far)
+        {
+            best_priority_so_far = module_priority;
+            best_module_so_far = modules[i];
+            best_was_cached = cached[i].is_set();
+        }
+    }
+
+    if (best_was_cached && try_probe(*best_module_so_far) != best_priority_so_far)
+    {
+        mir::log_info("Cached graphics platform probe results are stale; probing all platforms");
+        cache->clear();
+        return module_for_device(modules, options, console, cache);
+    }
+
+    mir::log_info("Probed %zu graphics platform(s) (%zu cached) in %lld ms",
+                  modules.size(),
+                  cache_hits,
+                  static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::steady_clock::now() - start).count()));
+
+    if (cache)
     {
         try
         {
-            auto module_priority = probe_module(*module, options, console);
-            if (module_priority > best_priority_so_far)
-            {
-                best_priority_so_far = module_priority;
-                best_module_so_far = module;
-            }
+            cache->save();
         }
-        catch (std::runtime_error const&)
+        catch (std::exception const& error)
         {
+            mir::log_warning("Failed to save graphics platform probe results: %s", error.what());
         }
     }
+
     if (best_priority_so_far > mir::graphics::unsupported)
     {
         return best_module_so_far;
     }
     BOOST_THROW_EXCEPTION((std::runtime_error{"Failed to find platform for current system"}));
 }
+
+namespace
+{
+struct ModuleSearch
+{
+    void const* symbol;
+    std::string build_id;
+};
+
+int find_build_id(dl_phdr_info* info, size_t, void* context)
+{
+    auto const search = static_cast<ModuleSearch*>(context);
+    auto const symbol = reinterpret_cast<ElfW(Addr)>(search->symbol);
+
+    bool contains_symbol{false};
+    for (auto i = 0; i != info->dlpi_phnum; ++i)
+    {
+        auto const& segment = info->dlpi_phdr[i];
+        auto const begin = info->dlpi_addr + segment.p_vaddr;
+        if (segment.p_type == PT_LOAD && begin <= symbol && symbol < begin + segment.p_memsz)
+            contains_symbol = true;
+    }
+
+    if (!contains_symbol)
+        return 0;
+
+    for (auto i = 0; i != info->dlpi_phnum; ++i)
+    {
+        auto const& segment = info->dlpi_phdr[i];
+        if (segment.p_type != PT_NOTE)
+            continue;
+
+        auto note = reinterpret_cast<char const*>(info->dlpi_addr + segment.p_vaddr);
+        auto const end = note + segment.p_memsz;
+        auto const aligned = [](size_t size) { return (size + 3) & ~size_t{3}; };
+
+        while (note + sizeof(ElfW(Nhdr)) <= end)
+        {
+            auto const header = reinterpret_cast<ElfW(Nhdr) const*>(note);
+            auto const name = note + sizeof(ElfW(Nhdr));
+            auto const desc = name + aligned(header->n_namesz);
+
+            if (header->n_type == NT_GNU_BUILD_ID && header->n_namesz == 4 && strncmp(name, "GNU", 4) == 0)
+            {
+                std::ostringstream id;
+                id << std::hex << std::setfill('0');
+                for (auto byte = 0u; byte != header->n_descsz; ++byte)
+                    id << std::setw(2) << static_cast<unsigned>(static_cast<unsigned char>(desc[byte]));
+                search->build_id = id.str();
+                return 1;
+            }
+
+            note = desc + aligned(header->n_descsz);
+        }
+    }
+
+    return 1;
+}
+
+/// A key that changes whenever the module is rebuilt
+auto identify(mir::SharedLibrary const& module) -> std::string
+{
+    void const* symbol{nullptr};
+    for (auto const version : {MIR_SERVER_GRAPHICS_PLATFORM_VERSION, mg::obsolete_0_27::symbol_version})
+    {
+        try
+        {
+            symbol = reinterpret_cast<void const*>(
+                module.load_function<mg::DescribeModule>("describe_graphics_module", version));
+            break;
+        }
+        catch (std::runtime_error const&)
+        {
+        }
+    }
+
+    Dl_info info;
+    if (!symbol || !dladdr(symbol, &info))
+        return {};
+
+    ModuleSearch search{symbol, {}};
+    dl_iterate_phdr(&find_build_id, &search);
+    if (!search.build_id.empty())
+        return "build-id:" + search.build_id;
+
+    struct stat file;
+    if (stat(info.dli_fname, &file) != 0)
+        return {};
+
+    std::ostringstream id;
+    id << "file:" << info.dli_fname << ':' << file.st_size << ':' << file.st_mtim.tv_sec << '.' << file.st_mtim.tv_nsec;
+    return id.str();
+}
+}
+
+mg::ProbeCache::ProbeCache(std::string const& path, std::string const& environment) :
+    path{path},
+    environment{environment}
+{
+    std::ifstream in{path};
+    std::string saved_environment;
+
+    if (!std::getline(in, saved_environment) || saved_environment != "environment " + environment)
+        return;
+
+    std::string module;
+    uint32_t priority;
+    while (in >> module >> priority)
+        priorities[module] = static_cast<PlatformPriority>(priority);
+}
+
+auto mg::ProbeCache::priority_of(SharedLibrary const& module) const -> optional_value<PlatformPriority>
+{
+    auto const id = identify(module);
+    auto const found = priorities.find(id);
+
+    if (id.empty() || found == priorities.end())
+        return {};
+
+    return found->second;
+}
+
+void mg::ProbeCache::store(SharedLibrary const& module, PlatformPriority priority)
+{
+    auto const id = identify(module);
+
+    if (!id.empty())
+        priorities[id] = priority;
+}
+
+void mg::ProbeCache::clear()
+{
+    priorities.clear();
+}
+
+void mg::ProbeCache::save() const
+{
+    // Write a new file and rename it over the old, so a concurrent reader never sees half a file
+    auto const temporary = path + ".new";
+    {
+        std::ofstream out{temporary, std::ios::trunc};
+        out << "environment " << environment << '\n';
+        for (auto const& entry : priorities)
+            out << entry.first << ' ' << static_cast<uint32_t>(entry.second) << '\n';
+
+        if (!out.flush())
+            BOOST_THROW_EXCEPTION((std::system_error{errno, std::system_category(), "Failed to write " + temporary}));
+    }
+
+    if (rename(temporary.c_str(), path.c_str()) != 0)
+        BOOST_THROW_EXCEPTION((std::system_error{errno, std::system_category(), "Failed to replace " + path}));
+}
+
+auto mg::ProbeCache::current_environment() -> std::string
+{
+    std::ostringstream properties;
+
+    if (auto const devices = opendir("/sys/class/drm"))
+    {
+        std::vector<std::string> cards;
+        while (auto const entry = readdir(devices))
+        {
+            std::string const name{entry->d_name};
+            if (name.compare(0, 4, "card") == 0 && name.find('-') == std::string::npos)
+                cards.push_back(name);
+        }
+        closedir(devices);
+
+        std::sort(cards.begin(), cards.end());
+        for (auto const& card : cards)
+        {
+            std::ifstream uevent{"/sys/class/drm/" + card + "/device/uevent"};
+            properties << card << '\n';
+            if (uevent)
+                properties << uevent.rdbuf();
+        }
+    }
+
+    for (auto const variable : {"DISPLAY", "WAYLAND_DISPLAY", "MIR_SERVER_HOST_SOCKET", "XDG_SESSION_TYPE"})
+    {
+        if (auto const value = getenv(variable))
+            properties << variable << '=' << value << '\n';
+    }
+
+    std::ostringstream hash;
+    hash << std::hex << std::hash<std::string>{}(properties.str());
+    return hash.str();
+}
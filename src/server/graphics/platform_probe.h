@@ -19,16 +19,21 @@
 #ifndef MIR_GRAPHICS_PLATFORM_PROBE_H_
 #define MIR_GRAPHICS_PLATFORM_PROBE_H_
 
+#include <condition_variable>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include "mir/console_services.h"
+#include "mir/optional_value.h"
 #include "mir/shared_library.h"
 #include "mir/options/program_option.h"
 #include "mir/graphics/platform.h"
 
 namespace mir
 {
-class ConsoleServices;
-
 namespace graphics
 {
 class Platform;
@@ -38,10 +43,81 @@ auto probe_module(
     options::ProgramOption const& options,
     std::shared_ptr<ConsoleServices> const& console) -> PlatformPriority;
 
+/**
+ * Remembers the priority each platform module reported, so that later runs
+ * of the same module builds on unchanged hardware needn't probe them again.
+ *
+ * Modules are identified by their GNU build-id (falling back to file size and
+ * modification time); the results are discarded wholesale if the environment
+ * they were probed in changes.
+ */
+class ProbeCache
+{
+public:
+    /// Loads any results saved at path from a run in the same environment
+    ProbeCache(std::string const& path, std::string const& environment);
+
+    auto priority_of(SharedLibrary const& module) const -> optional_value<PlatformPriority>;
+    void store(SharedLibrary const& module, PlatformPriority priority);
+    void clear();
+
+    /// Writes the results back to path
+    void save() const;
+
+    /// The DRM devices' udev properties and any display servers we might be nested in
+    static auto current_environment() -> std::string;
+
+private:
+    std::string const path;
+    std::string const environment;
+    std::unordered_map<std::string, PlatformPriority> priorities;  ///< by module identity
+};
+
+/**
+ * Hands out each device to one holder at a time, so that concurrent probes
+ * take turns with a device (and its DRM master) rather than racing for it.
+ */
+class ExclusiveDeviceConsoleServices : public ConsoleServices
+{
+public:
+    explicit ExclusiveDeviceConsoleServices(std::shared_ptr<ConsoleServices> const& wrapped);
+
+    void register_switch_handlers(
+        EventHandlerRegister& handlers,
+        std::function<bool()> const& switch_away,
+        std::function<bool()> const& switch_back) override;
+    void restore() override;
+    std::unique_ptr<VTSwitcher> create_vt_switcher() override;
+
+    /// Waits until no other holder has the device before acquiring it
+    std::future<std::unique_ptr<Device>> acquire_device(
+        int major, int minor,
+        std::unique_ptr<Device::Observer> observer) override;
+
+    /// The devices currently held
+    class Reservations;
+
+private:
+    std::shared_ptr<ConsoleServices> const wrapped;
+    std::shared_ptr<Reservations> const reservations;
+};
+
+/**
+ * Probes modules concurrently, returning the one claiming the highest
+ * priority (the first of them, in the order given, if several tie).
+ *
+ * Probes acquire devices through an ExclusiveDeviceConsoleServices, so
+ * those probing the same device do so one after another.
+ *
+ * If a cache is supplied modules with a cached result are not probed, except
+ * that the winner is re-probed to confirm it; should that disagree the cache
+ * is cleared and every module probed afresh.
+ */
 std::shared_ptr<SharedLibrary> module_for_device(
     std::vector<std::shared_ptr<SharedLibrary>> const& modules,
     options::ProgramOption const& options,
-    std::shared_ptr<ConsoleServices> const& console);
+    std::shared_ptr<ConsoleServices> const& console,
+    ProbeCache* cache = nullptr);
 
 }
 }
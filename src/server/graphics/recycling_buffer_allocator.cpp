@@ -0,0 +1,186 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "recycling_buffer_allocator.h"
+
+#include "mir/graphics/buffer.h"
+#include "mir/graphics/buffer_properties.h"
+#include "mir/time/alarm.h"
+#include "mir/time/alarm_factory.h"
+
+#include <list>
+#include <mutex>
+#include <vector>
+
+namespace mg = mir::graphics;
+namespace geom = mir::geometry;
+
+class mg::RecyclingBufferAllocator::Pool
+{
+public:
+    Pool(time::AlarmFactory& alarm_factory, size_t max_idle_bytes, time::Duration idle_timeout);
+
+    /// An idle buffer of the given size and format, or nullptr
+    auto take(geom::Size size, MirPixelFormat format) -> std::shared_ptr<Buffer>;
+    void give_back(std::shared_ptr<Buffer>&& buffer);
+    auto idle_bytes() const -> size_t;
+
+private:
+    struct Idle
+    {
+        geom::Size size;
+        MirPixelFormat format;
+        size_t bytes;
+        std::shared_ptr<Buffer> buffer;
+    };
+
+    void release_all_idle();
+
+    size_t const max_idle_bytes;
+    time::Duration const idle_timeout;
+
+    std::mutex mutable mutex;
+    std::list<Idle> idle;   ///< Least recently given back first
+    size_t total_idle_bytes{0};
+
+    std::unique_ptr<time::Alarm> const idle_alarm;
+};
+
+mg::RecyclingBufferAllocator::Pool::Pool(
+    time::AlarmFactory& alarm_factory,
+    size_t max_idle_bytes,
+    time::Duration idle_timeout)
+    : max_idle_bytes{max_idle_bytes},
+      idle_timeout{idle_timeout},
+      idle_alarm{alarm_factory.create_alarm([this] { release_all_idle(); })}
+{
+}
+
+auto mg::RecyclingBufferAllocator::Pool::take(geom::Size size, MirPixelFormat format) -> std::shared_ptr<Buffer>
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    // Prefer the most recently used buffer: its pages are the most likely to still be resident
+    for (auto i = idle.rbegin(); i != idle.rend(); ++i)
+    {
+        if (i->size == size && i->format == format)
+        {
+            auto buffer = std::move(i->buffer);
+            total_idle_bytes -= i->bytes;
+            idle.erase(std::next(i).base());
+            return buffer;
+        }
+    }
+
+    return nullptr;
+}
+
+void mg::RecyclingBufferAllocator::Pool::give_back(std::shared_ptr<Buffer>&& buffer)
+{
+    auto const size = buffer->size();
+    auto const format = buffer->pixel_format();
+    size_t const bytes = MIR_BYTES_PER_PIXEL(format) * size.width.as_uint32_t() * size.height.as_uint32_t();
+
+    if (bytes > max_idle_bytes)
+        return;
+
+    // Buffers are destroyed once we've released the lock
+    std::vector<std::shared_ptr<Buffer>> evicted;
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        idle.push_back({size, format, bytes, std::move(buffer)});
+        total_idle_bytes += bytes;
+
+        while (total_idle_bytes > max_idle_bytes)
+        {
+            evicted.push_back(std::move(idle.front().buffer));
+            total_idle_bytes -= idle.front().bytes;
+            idle.pop_front();
+        }
+    }
+
+    idle_alarm->reschedule_in(std::chrono::duration_cast<std::chrono::milliseconds>(idle_timeout));
+}
+
+auto mg::RecyclingBufferAllocator::Pool::idle_bytes() const -> size_t
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return total_idle_bytes;
+}
+
+void mg::RecyclingBufferAllocator::Pool::release_all_idle()
+{
+    std::list<Idle> released;
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        released.swap(idle);
+        total_idle_bytes = 0;
+    }
+}
+
+mg::RecyclingBufferAllocator::RecyclingBufferAllocator(
+    std::shared_ptr<GraphicBufferAllocator> const& wrapped,
+    std::shared_ptr<time::AlarmFactory> const& alarm_factory,
+    size_t max_idle_bytes,
+    time::Duration idle_timeout)
+    : wrapped{wrapped},
+      pool{std::make_shared<Pool>(*alarm_factory, max_idle_bytes, idle_timeout)}
+{
+}
+
+mg::RecyclingBufferAllocator::~RecyclingBufferAllocator() = default;
+
+std::shared_ptr<mg::Buffer> mg::RecyclingBufferAllocator::alloc_buffer(BufferProperties const& buffer_properties)
+{
+    if (buffer_properties.usage == BufferUsage::software)
+        return alloc_software_buffer(buffer_properties.size, buffer_properties.format);
+
+    return wrapped->alloc_buffer(buffer_properties);
+}
+
+std::vector<MirPixelFormat> mg::RecyclingBufferAllocator::supported_pixel_formats()
+{
+    return wrapped->supported_pixel_formats();
+}
+
+std::shared_ptr<mg::Buffer> mg::RecyclingBufferAllocator::alloc_buffer(
+    geom::Size size, uint32_t native_format, uint32_t native_flags)
+{
+    return wrapped->alloc_buffer(size, native_format, native_flags);
+}
+
+std::shared_ptr<mg::Buffer> mg::RecyclingBufferAllocator::alloc_software_buffer(
+    geom::Size size, MirPixelFormat format)
+{
+    auto buffer = pool->take(size, format);
+    if (!buffer)
+        buffer = wrapped->alloc_software_buffer(size, format);
+
+    auto const raw_buffer = buffer.get();
+    return std::shared_ptr<Buffer>{
+        raw_buffer,
+        [buffer = std::move(buffer), weak_pool = std::weak_ptr<Pool>{pool}](Buffer*) mutable
+        {
+            if (auto const pool = weak_pool.lock())
+                pool->give_back(std::move(buffer));
+        }};
+}
+
+auto mg::RecyclingBufferAllocator::idle_bytes() const -> size_t
+{
+    return pool->idle_bytes();
+}
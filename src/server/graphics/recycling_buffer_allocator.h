@@ -0,0 +1,77 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_GRAPHICS_RECYCLING_BUFFER_ALLOCATOR_H_
+#define MIR_GRAPHICS_RECYCLING_BUFFER_ALLOCATOR_H_
+
+#include "mir/graphics/graphic_buffer_allocator.h"
+#include "mir/time/types.h"
+
+#include <memory>
+
+namespace mir
+{
+namespace time
+{
+class AlarmFactory;
+}
+namespace graphics
+{
+
+/**
+ * Keeps software buffers the server allocated for itself once it has finished
+ * with them, and hands them out again for later requests of the same size and
+ * format.
+ *
+ * Idle buffers are released once more than max_idle_bytes of them are kept
+ * (oldest first), and all of them once none have been returned for
+ * idle_timeout.
+ *
+ * Recycled buffers keep their previous contents, so this is only for users
+ * that write() all of a buffer before use (cursors, decorations, touchspots)
+ * and never for client buffers, which clients may still have mapped.
+ * Hardware buffers are passed through unpooled.
+ */
+class RecyclingBufferAllocator : public GraphicBufferAllocator
+{
+public:
+    RecyclingBufferAllocator(
+        std::shared_ptr<GraphicBufferAllocator> const& wrapped,
+        std::shared_ptr<time::AlarmFactory> const& alarm_factory,
+        size_t max_idle_bytes,
+        time::Duration idle_timeout);
+    ~RecyclingBufferAllocator();
+
+    std::shared_ptr<Buffer> alloc_buffer(BufferProperties const& buffer_properties) override;
+    std::vector<MirPixelFormat> supported_pixel_formats() override;
+    std::shared_ptr<Buffer> alloc_buffer(
+        geometry::Size size, uint32_t native_format, uint32_t native_flags) override;
+    std::shared_ptr<Buffer> alloc_software_buffer(geometry::Size size, MirPixelFormat format) override;
+
+    /// The total size of the buffers being kept for reuse
+    auto idle_bytes() const -> size_t;
+
+private:
+    class Pool;
+
+    std::shared_ptr<GraphicBufferAllocator> const wrapped;
+    std::shared_ptr<Pool> const pool;
+};
+
+}
+}
+
+#endif /* MIR_GRAPHICS_RECYCLING_BUFFER_ALLOCATOR_H_ */
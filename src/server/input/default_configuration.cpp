@@ -32,6 +32,9 @@
 #include "surface_input_dispatcher.h"
 #include "basic_seat.h"
 #include "seat_observer_multiplexer.h"
+#include "input_latency_stats.h"
+#include "latency_recording_dispatcher.h"
+#include "../report/logging/input_latency_report.h"
 #include "../graphics/nested/input_platform.h"
 
 #include "mir/input/touch_visualizer.h"
@@ -98,9 +101,16 @@ mir::DefaultServerConfiguration::the_event_filter_chain_dispatcher()
                     }
                     return {default_filter};
                 };
+            std::shared_ptr<mi::InputDispatcher> next_dispatcher = the_surface_input_dispatcher();
+            if (auto const stats = the_input_latency_stats())
+            {
+                next_dispatcher = std::make_shared<mi::LatencyRecordingDispatcher>(
+                    next_dispatcher, stats, mi::InputLatencyStage::surface_dispatch, mi::InputLatencyStage::delivered);
+            }
+
             return std::make_shared<mi::EventFilterChainDispatcher>(
                 make_default_filter_list(),
-                the_surface_input_dispatcher());
+                next_dispatcher);
         });
 }
 
@@ -142,9 +152,25 @@ mir::DefaultServerConfiguration::the_input_dispatcher()
             auto enable_repeat = options->get<bool>(options::enable_key_repeat_opt) &&
                 !options->is_set(options::host_socket_opt);
 
-            return std::make_shared<mi::KeyRepeatDispatcher>(
-                the_event_filter_chain_dispatcher(), the_main_loop(), the_cookie_authority(),
+            std::shared_ptr<mi::InputDispatcher> next_dispatcher = the_event_filter_chain_dispatcher();
+            auto const stats = the_input_latency_stats();
+            if (stats)
+            {
+                next_dispatcher = std::make_shared<mi::LatencyRecordingDispatcher>(
+                    next_dispatcher, stats, mi::InputLatencyStage::filter_chain);
+            }
+
+            auto const key_repeater = std::make_shared<mi::KeyRepeatDispatcher>(
+                next_dispatcher, the_main_loop(), the_cookie_authority(),
                 enable_repeat, key_repeat_timeout, key_repeat_delay, false);
+            key_repeat_dispatcher = key_repeater;
+
+            std::shared_ptr<mi::InputDispatcher> dispatcher = key_repeater;
+
+            if (stats)
+                dispatcher = std::make_shared<mi::LatencyRecordingDispatcher>(dispatcher, stats, mi::InputLatencyStage::seat);
+
+            return dispatcher;
         });
 }
 
@@ -175,7 +201,7 @@ mir::DefaultServerConfiguration::the_touch_visualizer()
     return touch_visualizer(
         [this]() -> std::shared_ptr<mi::TouchVisualizer>
         {
-            auto visualizer = std::make_shared<mi::TouchspotController>(the_buffer_allocator(),
+            auto visualizer = std::make_shared<mi::TouchspotController>(the_recycling_buffer_allocator(),
                 the_input_scene());
 
             // The visualizer is disabled by default and can be enabled statically via
@@ -315,7 +341,10 @@ std::shared_ptr<mi::DefaultInputDeviceHub> mir::DefaultServerConfiguration::the_
        [this]()
        {
            auto input_dispatcher = the_input_dispatcher();
-           auto key_repeater = std::dynamic_pointer_cast<mi::KeyRepeatDispatcher>(input_dispatcher);
+           // The repeater we built may sit behind the latency recorder; a replacement dispatcher may be one itself
+           auto key_repeater = key_repeat_dispatcher.lock();
+           if (!key_repeater)
+               key_repeater = std::dynamic_pointer_cast<mi::KeyRepeatDispatcher>(input_dispatcher);
            auto hub = std::make_shared<mi::DefaultInputDeviceHub>(
                the_seat(),
                the_input_reading_multiplexer(),
@@ -331,6 +360,31 @@ std::shared_ptr<mi::DefaultInputDeviceHub> mir::DefaultServerConfiguration::the_
        });
 }
 
+std::shared_ptr<mi::InputLatencyStats> mir::DefaultServerConfiguration::the_input_latency_stats()
+{
+    return input_latency_stats(
+        [this]() -> std::shared_ptr<mi::InputLatencyStats>
+        {
+            auto const report_opt = the_options()->get<std::string>(options::input_latency_report_opt);
+
+            if (report_opt == options::off_opt_value)
+                return nullptr;
+
+            if (report_opt != options::log_opt_value)
+            {
+                throw AbnormalExit(std::string("Invalid ") + options::input_latency_report_opt +
+                    " option: " + report_opt + " (valid options are: \"off\" and \"log\")");
+            }
+
+            std::chrono::minutes const report_period{1};
+
+            auto const stats = std::make_shared<mi::InputLatencyStats>(the_clock());
+            input_latency_report = std::make_shared<mir::report::logging::InputLatencyReport>(
+                stats, the_logger(), *the_main_loop(), report_period);
+            return stats;
+        });
+}
+
 std::shared_ptr<mi::KeyMapper> mir::DefaultServerConfiguration::the_key_mapper()
 {
     return key_mapper(
@@ -17,49 +17,166 @@
  */
 
 #include "event_filter_chain_dispatcher.h"
+#include "mir/input/selective_event_filter.h"
+
+#include <algorithm>
+#include <atomic>
 
 namespace mi = mir::input;
 
+struct mi::EventFilterChainDispatcher::Filter
+{
+    explicit Filter(std::weak_ptr<EventFilter> const& filter);
+
+    bool interested_in(MirEvent const& event) const;
+
+    std::weak_ptr<EventFilter> const filter;
+    EventInterest const interest;
+
+    std::atomic<uint64_t> offered{0};
+    std::atomic<uint64_t> consumed{0};
+    std::atomic<int64_t> nanoseconds{0};
+};
+
+namespace
+{
+auto interest_of(std::weak_ptr<mi::EventFilter> const& filter) -> mi::EventInterest
+{
+    if (auto const selective = std::dynamic_pointer_cast<mi::SelectiveEventFilter>(filter.lock()))
+        return selective->interest();
+
+    return {};
+}
+}
+
+mi::EventFilterChainDispatcher::Filter::Filter(std::weak_ptr<EventFilter> const& filter)
+    : filter{filter},
+      interest{interest_of(filter)}
+{
+}
+
+bool mi::EventFilterChainDispatcher::Filter::interested_in(MirEvent const& event) const
+{
+    if (mir_event_get_type(&event) != mir_event_type_input)
+        return interest.other_events;
+
+    auto const input_event = mir_event_get_input_event(&event);
+
+    if (!(interest.input_types & EventInterest::bit_for(mir_input_event_get_type(input_event))))
+        return false;
+
+    return interest.devices.empty() ||
+        std::find(interest.devices.begin(), interest.devices.end(), mir_input_event_get_device_id(input_event)) !=
+            interest.devices.end();
+}
+
 mi::EventFilterChainDispatcher::EventFilterChainDispatcher(
     std::vector<std::weak_ptr<mi::EventFilter>> initial_filters,
     std::shared_ptr<mi::InputDispatcher> const& next_dispatcher)
-    : filters(std::move(initial_filters)),
-      next_dispatcher(next_dispatcher)
+    : next_dispatcher(next_dispatcher)
 {
+    auto initial_chain = std::make_shared<Chain>();
+    initial_chain->reserve(initial_filters.size());
+    for (auto const& filter : initial_filters)
+        initial_chain->push_back(std::make_shared<Filter>(filter));
+
+    chain = std::move(initial_chain);
 }
 
 // TODO: It probably makes sense to provide keymapped events.
 bool mi::EventFilterChainDispatcher::handle(MirEvent const& event)
 {
-    std::lock_guard<std::mutex> lg(filter_guard);
-    
-    auto it = filters.begin();
-    while (it != filters.end())
+    auto const current_chain = std::atomic_load(&chain);
+    bool found_expired{false};
+    bool handled{false};
+
+    for (auto const& entry : *current_chain)
     {
-        auto filter = (*it).lock();
+        if (!entry->interested_in(event))
+            continue;
+
+        auto const filter = entry->filter.lock();
         if (!filter)
         {
-            it = filters.erase(it);
+            found_expired = true;
             continue;
         }
-        if (filter->handle(event)) return true;
-        ++it;
+
+        auto const start = std::chrono::steady_clock::now();
+        handled = filter->handle(event);
+        auto const elapsed = std::chrono::steady_clock::now() - start;
+
+        entry->offered.fetch_add(1, std::memory_order_relaxed);
+        entry->nanoseconds.fetch_add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+            std::memory_order_relaxed);
+
+        if (handled)
+        {
+            entry->consumed.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
     }
-    return false;
+
+    if (found_expired)
+        remove_expired_filters();
+
+    return handled;
 }
 
 void mi::EventFilterChainDispatcher::append(std::weak_ptr<EventFilter> const& filter)
 {
-    std::lock_guard<std::mutex> lg(filter_guard);
-
-    filters.push_back(filter);
+    auto const entry = std::make_shared<Filter>(filter);
+    replace_chain([&](Chain& filters) { filters.push_back(entry); });
 }
 
 void mi::EventFilterChainDispatcher::prepend(std::weak_ptr<EventFilter> const& filter)
 {
-    std::lock_guard<std::mutex> lg(filter_guard);
-        
-    filters.insert(filters.begin(), filter);
+    auto const entry = std::make_shared<Filter>(filter);
+    replace_chain([&](Chain& filters) { filters.insert(filters.begin(), entry); });
+}
+
+void mi::EventFilterChainDispatcher::replace_chain(std::function<void(Chain& filters)> const& modify)
+{
+    std::lock_guard<std::mutex> lg(modification_guard);
+
+    auto new_chain = std::make_shared<Chain>(*std::atomic_load(&chain));
+    modify(*new_chain);
+    std::atomic_store(&chain, std::shared_ptr<Chain const>{std::move(new_chain)});
+}
+
+void mi::EventFilterChainDispatcher::remove_expired_filters()
+{
+    // Not worth blocking event handling for: whoever is modifying the chain can tidy up next time
+    std::unique_lock<std::mutex> lock(modification_guard, std::try_to_lock);
+    if (!lock.owns_lock())
+        return;
+
+    auto new_chain = std::make_shared<Chain>(*std::atomic_load(&chain));
+    new_chain->erase(
+        std::remove_if(new_chain->begin(), new_chain->end(),
+            [](std::shared_ptr<Filter> const& entry) { return entry->filter.expired(); }),
+        new_chain->end());
+    std::atomic_store(&chain, std::shared_ptr<Chain const>{std::move(new_chain)});
+}
+
+auto mi::EventFilterChainDispatcher::statistics() const -> std::vector<EventFilterStatistics>
+{
+    auto const current_chain = std::atomic_load(&chain);
+
+    std::vector<EventFilterStatistics> result;
+    result.reserve(current_chain->size());
+
+    for (auto const& entry : *current_chain)
+    {
+        result.push_back({
+            entry->filter,
+            entry->offered.load(std::memory_order_relaxed),
+            entry->consumed.load(std::memory_order_relaxed),
+            std::chrono::nanoseconds{entry->nanoseconds.load(std::memory_order_relaxed)}});
+    }
+
+    return result;
 }
 
 bool mi::EventFilterChainDispatcher::dispatch(std::shared_ptr<MirEvent const> const& event)
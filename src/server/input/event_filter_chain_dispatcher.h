@@ -22,6 +22,8 @@
 #include "mir/input/composite_event_filter.h"
 #include "mir/input/input_dispatcher.h"
 
+#include <functional>
+#include <chrono>
 #include <vector>
 #include <mutex>
 
@@ -30,6 +32,23 @@ namespace mir
 namespace input
 {
 
+/// How much use a filter in the chain has had
+struct EventFilterStatistics
+{
+    std::weak_ptr<EventFilter> filter;
+    uint64_t events_offered;
+    uint64_t events_consumed;
+    std::chrono::nanoseconds time_handling;
+};
+
+/**
+ * Offers events to each filter in turn, then dispatches those that no filter consumes.
+ *
+ * The chain is immutable once built: append() and prepend() replace it, so
+ * handling events takes no lock and filters may modify the chain from handle().
+ * Filters that are SelectiveEventFilters are only offered events they are
+ * interested in.
+ */
 class EventFilterChainDispatcher : public CompositeEventFilter, public mir::input::InputDispatcher
 {
 public:
@@ -46,11 +65,19 @@ public:
     bool dispatch(std::shared_ptr<MirEvent const> const& event) override;
     void start() override;
     void stop() override;
-    
+
+    /// In chain order
+    auto statistics() const -> std::vector<EventFilterStatistics>;
+
 private:
-    std::mutex filter_guard;
-    
-    std::vector<std::weak_ptr<EventFilter>> filters;
+    struct Filter;
+    using Chain = std::vector<std::shared_ptr<Filter>>;
+
+    void replace_chain(std::function<void(Chain& filters)> const& modify);
+    void remove_expired_filters();
+
+    std::mutex modification_guard; ///< Serialises replacing the chain
+    std::shared_ptr<Chain const> chain; ///< Only accessed with std::atomic_load()/atomic_store()
     std::shared_ptr<InputDispatcher> const next_dispatcher;
 };
 
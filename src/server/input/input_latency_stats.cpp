@@ -0,0 +1,160 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "input_latency_stats.h"
+
+#include "mir/events/input_event.h"
+#include "mir/time/clock.h"
+
+#include <iomanip>
+#include <limits>
+#include <ostream>
+
+namespace mi = mir::input;
+
+namespace
+{
+MirInputDeviceId const unused_slot{std::numeric_limits<MirInputDeviceId>::min()};
+
+size_t index_of(mi::InputLatencyStage stage)
+{
+    return static_cast<size_t>(stage);
+}
+
+void dump_histogram(std::ostream& out, char const* stage, char const* device, mi::LatencyHistogram const& histogram)
+{
+    auto const us = [](std::chrono::nanoseconds ns) { return ns.count() / 1000.0; };
+
+    out << "stage=" << stage
+        << " device=" << device
+        << " count=" << histogram.count()
+        << std::fixed << std::setprecision(1)
+        << " mean=" << us(histogram.mean())
+        << " p50=" << us(histogram.percentile(50))
+        << " p90=" << us(histogram.percentile(90))
+        << " p99=" << us(histogram.percentile(99))
+        << " p99.9=" << us(histogram.percentile(99.9))
+        << " max=" << us(histogram.max())
+        << " (us)\n";
+}
+}
+
+char const* mi::name_of(InputLatencyStage stage)
+{
+    switch (stage)
+    {
+    case InputLatencyStage::seat: return "seat";
+    case InputLatencyStage::filter_chain: return "filter_chain";
+    case InputLatencyStage::surface_dispatch: return "surface_dispatch";
+    case InputLatencyStage::delivered: return "delivered";
+    }
+
+    return "unknown";
+}
+
+mi::InputLatencyStats::InputLatencyStats(std::shared_ptr<time::Clock> const& clock) :
+    clock{clock}
+{
+    for (auto& device : devices)
+        device.id.store(unused_slot, std::memory_order_relaxed);
+}
+
+void mi::InputLatencyStats::record(InputLatencyStage stage, MirInputEvent const& event)
+{
+    auto const now = std::chrono::duration_cast<std::chrono::nanoseconds>(clock->now().time_since_epoch());
+    record(stage, event.device_id(), now - event.event_time());
+}
+
+void mi::InputLatencyStats::record(InputLatencyStage stage, MirInputDeviceId device, std::chrono::nanoseconds latency)
+{
+    seat[index_of(stage)].record(latency);
+
+    if (auto const histograms = histograms_for(device))
+        histograms->stages[index_of(stage)].record(latency);
+}
+
+auto mi::InputLatencyStats::histograms_for(MirInputDeviceId device) -> DeviceHistograms*
+{
+    for (auto& slot : devices)
+    {
+        auto id = slot.id.load(std::memory_order_acquire);
+
+        // If we lose a race to claim the slot id is updated to the winner's
+        if (id == unused_slot &&
+            slot.id.compare_exchange_strong(id, device, std::memory_order_acq_rel))
+        {
+            return &slot;
+        }
+
+        if (id == device)
+            return &slot;
+    }
+
+    // More devices than slots: only the seat-wide histograms are kept
+    return nullptr;
+}
+
+mi::LatencyHistogram const& mi::InputLatencyStats::seat_histogram(InputLatencyStage stage) const
+{
+    return seat[index_of(stage)];
+}
+
+mi::LatencyHistogram const* mi::InputLatencyStats::device_histogram(
+    InputLatencyStage stage, MirInputDeviceId device) const
+{
+    for (auto const& slot : devices)
+    {
+        auto const id = slot.id.load(std::memory_order_acquire);
+        if (id == unused_slot)
+            break;
+        if (id == device)
+            return &slot.stages[index_of(stage)];
+    }
+
+    return nullptr;
+}
+
+void mi::InputLatencyStats::dump(std::ostream& out) const
+{
+    for (auto i = 0u; i != stage_count; ++i)
+    {
+        auto const stage = static_cast<InputLatencyStage>(i);
+
+        if (seat[i].count())
+            dump_histogram(out, name_of(stage), "all", seat[i]);
+
+        for (auto const& slot : devices)
+        {
+            auto const id = slot.id.load(std::memory_order_acquire);
+            if (id == unused_slot)
+                break;
+            if (slot.stages[i].count())
+                dump_histogram(out, name_of(stage), std::to_string(id).c_str(), slot.stages[i]);
+        }
+    }
+}
+
+void mi::InputLatencyStats::reset()
+{
+    for (auto& histogram : seat)
+        histogram.reset();
+
+    for (auto& slot : devices)
+    {
+        for (auto& histogram : slot.stages)
+            histogram.reset();
+    }
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_INPUT_INPUT_LATENCY_STATS_H_
+#define MIR_INPUT_INPUT_LATENCY_STATS_H_
+
+#include "latency_histogram.h"
+
+#include "mir_toolkit/mir_input_device_types.h"
+
+#include <array>
+#include <atomic>
+#include <iosfwd>
+#include <memory>
+
+struct MirInputEvent;
+
+namespace mir
+{
+namespace time
+{
+class Clock;
+}
+namespace input
+{
+/// The points in the input pipeline at which an event's latency is sampled
+enum class InputLatencyStage
+{
+    seat,               ///< reached the input dispatcher (after platform conversion and the seat)
+    filter_chain,       ///< reached the event filter chain (after key repeat)
+    surface_dispatch,   ///< passed the event filters
+    delivered,          ///< handed to the client surface
+};
+
+/**
+ * Aggregates the latency of input events, measured from the event's kernel
+ * timestamp, at each InputLatencyStage: seat-wide and for each of up to
+ * max_devices devices.
+ *
+ * Recording is lock-free, so may be done on the input thread unconditionally.
+ */
+class InputLatencyStats
+{
+public:
+    static size_t const max_devices = 16;
+    static size_t const stage_count = static_cast<size_t>(InputLatencyStage::delivered) + 1;
+
+    explicit InputLatencyStats(std::shared_ptr<time::Clock> const& clock);
+
+    /// Sample the latency of event at stage
+    void record(InputLatencyStage stage, MirInputEvent const& event);
+
+    void record(InputLatencyStage stage, MirInputDeviceId device, std::chrono::nanoseconds latency);
+
+    LatencyHistogram const& seat_histogram(InputLatencyStage stage) const;
+
+    /// The device's histogram, or nullptr if nothing has been recorded for the device
+    LatencyHistogram const* device_histogram(InputLatencyStage stage, MirInputDeviceId device) const;
+
+    /// Write a human readable summary of every non-empty histogram
+    void dump(std::ostream& out) const;
+
+    void reset();
+
+private:
+    struct DeviceHistograms
+    {
+        std::atomic<MirInputDeviceId> id;
+        std::array<LatencyHistogram, stage_count> stages;
+    };
+
+    DeviceHistograms* histograms_for(MirInputDeviceId device);
+
+    std::shared_ptr<time::Clock> const clock;
+    std::array<LatencyHistogram, stage_count> seat;
+    std::array<DeviceHistograms, max_devices> devices;
+};
+
+char const* name_of(InputLatencyStage stage);
+}
+}
+
+#endif /* MIR_INPUT_INPUT_LATENCY_STATS_H_ */
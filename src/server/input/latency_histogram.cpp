@@ -0,0 +1,125 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mi = mir::input;
+
+namespace
+{
+unsigned most_significant_bit(uint64_t value)
+{
+    return 63 - __builtin_clzll(value);
+}
+}
+
+mi::LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+unsigned mi::LatencyHistogram::bucket_for(uint64_t value)
+{
+    auto const linear_buckets = 1u << sub_bucket_bits;
+    auto const half_buckets = linear_buckets / 2;
+
+    value = std::min(value, (uint64_t{1} << max_magnitude) - 1);
+
+    if (value < linear_buckets)
+        return value;
+
+    auto const shift = most_significant_bit(value) - (sub_bucket_bits - 1);
+    auto const sub_bucket = (value >> shift) - half_buckets;
+
+    return linear_buckets + (shift - 1) * half_buckets + sub_bucket;
+}
+
+uint64_t mi::LatencyHistogram::highest_value_in(unsigned bucket)
+{
+    auto const linear_buckets = 1u << sub_bucket_bits;
+    auto const half_buckets = linear_buckets / 2;
+
+    if (bucket < linear_buckets)
+        return bucket;
+
+    auto const shift = (bucket - linear_buckets) / half_buckets + 1;
+    uint64_t const sub_bucket = (bucket - linear_buckets) % half_buckets + half_buckets;
+
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+void mi::LatencyHistogram::record(std::chrono::nanoseconds latency)
+{
+    uint64_t const value = std::max<int64_t>(latency.count(), 0);
+
+    buckets[bucket_for(value)].fetch_add(1, std::memory_order_relaxed);
+    total_count.fetch_add(1, std::memory_order_relaxed);
+    total_ns.fetch_add(value, std::memory_order_relaxed);
+
+    auto current_max = max_ns.load(std::memory_order_relaxed);
+    while (value > current_max &&
+           !max_ns.compare_exchange_weak(current_max, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+uint64_t mi::LatencyHistogram::count() const
+{
+    return total_count.load(std::memory_order_relaxed);
+}
+
+std::chrono::nanoseconds mi::LatencyHistogram::max() const
+{
+    return std::chrono::nanoseconds{max_ns.load(std::memory_order_relaxed)};
+}
+
+std::chrono::nanoseconds mi::LatencyHistogram::mean() const
+{
+    auto const n = count();
+    return std::chrono::nanoseconds{n ? total_ns.load(std::memory_order_relaxed) / n : 0};
+}
+
+std::chrono::nanoseconds mi::LatencyHistogram::percentile(double percent) const
+{
+    auto const n = count();
+    if (n == 0)
+        return std::chrono::nanoseconds{0};
+
+    auto const wanted = std::max<uint64_t>(1, std::ceil(std::min(percent, 100.0) / 100.0 * n));
+
+    uint64_t seen{0};
+    for (auto i = 0u; i != bucket_count; ++i)
+    {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= wanted)
+            return std::chrono::nanoseconds{std::min<uint64_t>(highest_value_in(i), max_ns.load(std::memory_order_relaxed))};
+    }
+
+    return max();
+}
+
+void mi::LatencyHistogram::reset()
+{
+    for (auto& bucket : buckets)
+        bucket.store(0, std::memory_order_relaxed);
+
+    total_count.store(0, std::memory_order_relaxed);
+    total_ns.store(0, std::memory_order_relaxed);
+    max_ns.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_INPUT_LATENCY_HISTOGRAM_H_
+#define MIR_INPUT_LATENCY_HISTOGRAM_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace mir
+{
+namespace input
+{
+/**
+ * A lock-free histogram of latencies with a bounded relative error.
+ *
+ * Buckets are log-linear (in the style of HdrHistogram): each power-of-two
+ * range is split into 16 linear sub-buckets, so any recorded value is
+ * reported to within ~6% from 32ns up to ~68s; longer latencies saturate.
+ *
+ * record() may be called concurrently from any number of threads; queries
+ * see a consistent-enough view for reporting but are not atomic snapshots.
+ */
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(std::chrono::nanoseconds latency);
+
+    uint64_t count() const;
+    std::chrono::nanoseconds max() const;
+    std::chrono::nanoseconds mean() const;
+
+    /// The smallest value that percent% of recorded values are no greater than
+    std::chrono::nanoseconds percentile(double percent) const;
+
+    void reset();
+
+private:
+    static unsigned const sub_bucket_bits = 5;
+    static unsigned const max_magnitude = 36;
+    static unsigned const bucket_count =
+        (1u << sub_bucket_bits) + (max_magnitude - sub_bucket_bits) * (1u << (sub_bucket_bits - 1));
+
+    static unsigned bucket_for(uint64_t value);
+    static uint64_t highest_value_in(unsigned bucket);
+
+    std::array<std::atomic<uint64_t>, bucket_count> buckets;
+    std::atomic<uint64_t> total_count;
+    std::atomic<uint64_t> total_ns;
+    std::atomic<uint64_t> max_ns;
+};
+}
+}
+
+#endif /* MIR_INPUT_LATENCY_HISTOGRAM_H_ */
@@ -0,0 +1,61 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "latency_recording_dispatcher.h"
+
+#include "mir/events/event.h"
+#include "mir/events/input_event.h"
+
+namespace mi = mir::input;
+
+mi::LatencyRecordingDispatcher::LatencyRecordingDispatcher(
+    std::shared_ptr<InputDispatcher> const& next_dispatcher,
+    std::shared_ptr<InputLatencyStats> const& stats,
+    InputLatencyStage on_entry,
+    optional_value<InputLatencyStage> on_dispatched) :
+    next_dispatcher{next_dispatcher},
+    stats{stats},
+    on_entry{on_entry},
+    on_dispatched{on_dispatched}
+{
+}
+
+bool mi::LatencyRecordingDispatcher::dispatch(std::shared_ptr<MirEvent const> const& event)
+{
+    if (event->type() != mir_event_type_input)
+        return next_dispatcher->dispatch(event);
+
+    auto const& input_event = *event->to_input();
+
+    stats->record(on_entry, input_event);
+
+    auto const dispatched = next_dispatcher->dispatch(event);
+
+    if (dispatched && on_dispatched.is_set())
+        stats->record(on_dispatched.value(), input_event);
+
+    return dispatched;
+}
+
+void mi::LatencyRecordingDispatcher::start()
+{
+    next_dispatcher->start();
+}
+
+void mi::LatencyRecordingDispatcher::stop()
+{
+    next_dispatcher->stop();
+}
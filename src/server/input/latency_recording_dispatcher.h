@@ -0,0 +1,56 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_INPUT_LATENCY_RECORDING_DISPATCHER_H_
+#define MIR_INPUT_LATENCY_RECORDING_DISPATCHER_H_
+
+#include "mir/input/input_dispatcher.h"
+#include "mir/optional_value.h"
+#include "input_latency_stats.h"
+
+#include <memory>
+
+namespace mir
+{
+namespace input
+{
+/**
+ * Decorates an InputDispatcher, sampling the latency of input events as
+ * they enter it and, optionally, once it has dispatched them.
+ */
+class LatencyRecordingDispatcher : public InputDispatcher
+{
+public:
+    LatencyRecordingDispatcher(
+        std::shared_ptr<InputDispatcher> const& next_dispatcher,
+        std::shared_ptr<InputLatencyStats> const& stats,
+        InputLatencyStage on_entry,
+        optional_value<InputLatencyStage> on_dispatched = {});
+
+    bool dispatch(std::shared_ptr<MirEvent const> const& event) override;
+    void start() override;
+    void stop() override;
+
+private:
+    std::shared_ptr<InputDispatcher> const next_dispatcher;
+    std::shared_ptr<InputLatencyStats> const stats;
+    InputLatencyStage const on_entry;
+    optional_value<InputLatencyStage> const on_dispatched;
+};
+}
+}
+
+#endif /* MIR_INPUT_LATENCY_RECORDING_DISPATCHER_H_ */
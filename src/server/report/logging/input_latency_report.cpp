@@ -0,0 +1,66 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "input_latency_report.h"
+#include "../../input/input_latency_stats.h"
+
+#include "mir/logging/logger.h"
+#include "mir/time/alarm_factory.h"
+#include "mir/time/alarm.h"
+
+#include <sstream>
+
+namespace mrl = mir::report::logging;
+namespace ml = mir::logging;
+
+namespace
+{
+char const* const component = "input-latency";
+}
+
+mrl::InputLatencyReport::InputLatencyReport(
+    std::shared_ptr<input::InputLatencyStats> const& stats,
+    std::shared_ptr<ml::Logger> const& logger,
+    time::AlarmFactory& alarm_factory,
+    std::chrono::milliseconds period) :
+    stats{stats},
+    logger{logger},
+    period{period},
+    alarm{alarm_factory.create_alarm(
+        [this]
+        {
+            log_summary();
+            alarm->reschedule_in(this->period);
+        })}
+{
+    alarm->reschedule_in(period);
+}
+
+mrl::InputLatencyReport::~InputLatencyReport()
+{
+    alarm->cancel();
+    log_summary();
+}
+
+void mrl::InputLatencyReport::log_summary()
+{
+    std::stringstream summary;
+    stats->dump(summary);
+
+    std::string line;
+    while (std::getline(summary, line))
+        logger->log(ml::Severity::informational, line, component);
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_REPORT_LOGGING_INPUT_LATENCY_REPORT_H_
+#define MIR_REPORT_LOGGING_INPUT_LATENCY_REPORT_H_
+
+#include <chrono>
+#include <memory>
+
+namespace mir
+{
+namespace logging
+{
+class Logger;
+}
+namespace input
+{
+class InputLatencyStats;
+}
+namespace time
+{
+class Alarm;
+class AlarmFactory;
+}
+namespace report
+{
+namespace logging
+{
+/// Periodically logs a summary of the input latency histograms
+class InputLatencyReport
+{
+public:
+    InputLatencyReport(
+        std::shared_ptr<input::InputLatencyStats> const& stats,
+        std::shared_ptr<mir::logging::Logger> const& logger,
+        time::AlarmFactory& alarm_factory,
+        std::chrono::milliseconds period);
+    ~InputLatencyReport();
+
+    /// Log the current histograms immediately
+    void log_summary();
+
+private:
+    std::shared_ptr<input::InputLatencyStats> const stats;
+    std::shared_ptr<mir::logging::Logger> const logger;
+    std::chrono::milliseconds const period;
+    std::unique_ptr<time::Alarm> const alarm;
+};
+}
+}
+}
+
+#endif /* MIR_REPORT_LOGGING_INPUT_LATENCY_REPORT_H_ */
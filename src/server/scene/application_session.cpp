@@ -129,7 +129,7 @@ auto ms::ApplicationSession::create_surface(
 
     {
         std::unique_lock<std::mutex> lock(surfaces_and_streams_mutex);
-        surfaces.push_back(surface);
+        surface_index[surface.get()] = surfaces.insert(surfaces.end(), surface);
         default_content_map[surface] = buffer_stream;
     }
 
@@ -160,14 +160,15 @@ void ms::ApplicationSession::destroy_surface(std::shared_ptr<Surface> const& sur
         std::unique_lock<std::mutex> lock(surfaces_and_streams_mutex);
 
         auto default_content_map_iter = default_content_map.find(surface);
-        auto surface_iter = std::find(surfaces.begin(), surfaces.end(), surface);
+        auto surface_iter = surface_index.find(surface.get());
 
-        if (default_content_map_iter == default_content_map.end() || surface_iter == surfaces.end())
+        if (default_content_map_iter == default_content_map.end() || surface_iter == surface_index.end())
             BOOST_THROW_EXCEPTION(std::runtime_error("Invalid surface"));
 
         session_listener->destroying_surface(*this, surface);
         default_content_map.erase(default_content_map_iter);
-        surfaces.erase(surface_iter);
+        surfaces.erase(surface_iter->second);
+        surface_index.erase(surface_iter);
     }
 
     surface_stack->remove_surface(surface);
@@ -176,16 +177,13 @@ void ms::ApplicationSession::destroy_surface(std::shared_ptr<Surface> const& sur
 std::shared_ptr<ms::Surface> ms::ApplicationSession::surface_after(std::shared_ptr<ms::Surface> const& before) const
 {
     std::lock_guard<std::mutex> lock(surfaces_and_streams_mutex);
-    auto current = surfaces.begin();
-    for (; current != surfaces.end(); ++current)
-    {
-        if (*current == before)
-            break;
-    }
+    auto const position = surface_index.find(before.get());
 
-    if (current == surfaces.end())
+    if (position == surface_index.end())
         BOOST_THROW_EXCEPTION(std::runtime_error("surface_after: surface is not a member of this session"));
 
+    Surfaces::const_iterator current = position->second;
+
     auto const can_take_focus = [](std::shared_ptr<scene::Surface> const &s)
         {
             switch (s->type())
@@ -208,12 +206,12 @@ std::shared_ptr<ms::Surface> ms::ApplicationSession::surface_after(std::shared_p
             }
         };
 
-    auto next = std::find_if(++current, end(surfaces), can_take_focus);
+    auto next = std::find_if(std::next(current), surfaces.cend(), can_take_focus);
 
-    if (next == surfaces.end())
-        next = std::find_if(begin(surfaces), current, can_take_focus);
+    if (next == surfaces.cend())
+        next = std::find_if(surfaces.cbegin(), std::next(current), can_take_focus);
 
-    if (next == end(surfaces))
+    if (next == surfaces.cend())
         return {};
 
     return *next;
@@ -224,20 +222,23 @@ void ms::ApplicationSession::take_snapshot(SnapshotCallback const& snapshot_take
     //TODO: taking a snapshot of a session doesn't make much sense. Snapshots can be on surfaces
     //or bufferstreams, as those represent some content. A multi-surface session doesn't have enough
     //info to cobble together a snapshot buffer without WM info.
-    for(auto const& surface_it : surfaces)
+    std::shared_ptr<compositor::BufferStream> content;
     {
-        if (default_surface() == surface_it)
+        std::unique_lock<std::mutex> lock(surfaces_and_streams_mutex);
+
+        if (!surfaces.empty())
         {
-            auto content = default_content_map[surface_it].lock();
+            content = default_content_map[surfaces.front()].lock();
             if (!content)
                 BOOST_THROW_EXCEPTION(std::logic_error(
                     "Buffer was dropped without being removed from default_content_map"));
-            snapshot_strategy->take_snapshot_of(content, snapshot_taken);
-            return;
         }
     }
 
-    snapshot_taken(Snapshot());
+    if (content)
+        snapshot_strategy->take_snapshot_of(content, snapshot_taken);
+    else
+        snapshot_taken(Snapshot());
 }
 
 std::shared_ptr<ms::Surface> ms::ApplicationSession::default_surface() const
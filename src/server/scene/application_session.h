@@ -24,9 +24,11 @@
 #include "mir/observer_registrar.h"
 
 #include <atomic>
+#include <list>
 #include <set>
 #include <map>
 #include <mutex>
+#include <unordered_map>
 
 namespace mir
 {
@@ -113,7 +115,9 @@ private:
     std::shared_ptr<frontend::EventSink> const event_sink;
     std::shared_ptr<graphics::GraphicBufferAllocator> const gralloc;
 
-    std::vector<std::shared_ptr<Surface>> surfaces;
+    using Surfaces = std::list<std::shared_ptr<Surface>>;
+    Surfaces surfaces;  ///< In creation order
+    std::unordered_map<Surface const*, Surfaces::iterator> surface_index;
     std::set<std::shared_ptr<compositor::BufferStream>> streams;
     std::map<
         std::weak_ptr<Surface>,
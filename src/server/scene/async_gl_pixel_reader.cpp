@@ -0,0 +1,436 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "async_gl_pixel_reader.h"
+#include "mir/graphics/buffer.h"
+#include "mir/renderer/gl/context.h"
+#include "mir/renderer/gl/texture_source.h"
+
+#include <EGL/egl.h>
+#include MIR_SERVER_GL_H
+#include MIR_SERVER_GLEXT_H
+
+#include <boost/throw_exception.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace ms = mir::scene;
+namespace mg = mir::graphics;
+namespace geom = mir::geometry;
+
+namespace
+{
+/*
+ * The GLES3 (or desktop GL 3.2) entry points we need. We're built against the
+ * GLES2 headers, so these are looked up at runtime and the enums spelled out.
+ */
+GLenum const pixel_pack_buffer{0x88EB};
+GLenum const stream_read{0x88E1};
+GLbitfield const map_read_bit{0x0001};
+GLenum const sync_gpu_commands_complete{0x9117};
+GLbitfield const sync_flush_commands_bit{0x00000001};
+GLenum const already_signaled{0x911A};
+GLenum const condition_satisfied{0x911C};
+GLenum const wait_failed{0x911D};
+uint64_t const forever{0xFFFFFFFFFFFFFFFFull};
+
+using GLSync = struct __GLsync*;
+
+bool supports_pbo_and_fences()
+{
+    auto const version = reinterpret_cast<char const*>(glGetString(GL_VERSION));
+    if (!version)
+        return false;
+
+    int major{0};
+    int minor{0};
+    if (sscanf(version, "OpenGL ES %d.%d", &major, &minor) == 2)
+        return major >= 3;
+
+    if (sscanf(version, "%d.%d", &major, &minor) == 2)
+        return major > 3 || (major == 3 && minor >= 2);
+
+    return false;
+}
+
+inline uint32_t abgr_to_argb(uint32_t p)
+{
+    return ((p << 16) & 0x00ff0000) | /* Move R to new position */
+           ((p) & 0x0000ff00) |       /* G remains at same position */
+           ((p >> 16) & 0x000000ff) | /* Move B to new position */
+           ((p) & 0xff000000);        /* A remains at same position */
+}
+
+size_t bytes_for(std::vector<geom::Rectangle> const& regions)
+{
+    size_t bytes{0};
+    for (auto const& r : regions)
+        bytes += r.size.width.as_uint32_t() * r.size.height.as_uint32_t() * 4;
+    return bytes;
+}
+}
+
+struct ms::AsyncGLPixelReader::Extensions
+{
+    typedef void* (*MapBufferRange)(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+    typedef GLboolean (*UnmapBuffer)(GLenum target);
+    typedef GLSync (*FenceSync)(GLenum condition, GLbitfield flags);
+    typedef GLenum (*ClientWaitSync)(GLSync sync, GLbitfield flags, uint64_t timeout);
+    typedef void (*DeleteSync)(GLSync sync);
+
+    Extensions() :
+        glMapBufferRange{reinterpret_cast<MapBufferRange>(eglGetProcAddress("glMapBufferRange"))},
+        glUnmapBuffer{reinterpret_cast<UnmapBuffer>(eglGetProcAddress("glUnmapBuffer"))},
+        glFenceSync{reinterpret_cast<FenceSync>(eglGetProcAddress("glFenceSync"))},
+        glClientWaitSync{reinterpret_cast<ClientWaitSync>(eglGetProcAddress("glClientWaitSync"))},
+        glDeleteSync{reinterpret_cast<DeleteSync>(eglGetProcAddress("glDeleteSync"))}
+    {
+    }
+
+    bool available() const
+    {
+        return glMapBufferRange && glUnmapBuffer && glFenceSync && glClientWaitSync && glDeleteSync;
+    }
+
+    MapBufferRange const glMapBufferRange;
+    UnmapBuffer const glUnmapBuffer;
+    FenceSync const glFenceSync;
+    ClientWaitSync const glClientWaitSync;
+    DeleteSync const glDeleteSync;
+};
+
+struct ms::AsyncGLPixelReader::Staging
+{
+    GLuint pbo{0};
+    size_t capacity{0};
+    GLSync fence{nullptr};
+    geom::Size size;
+    GLenum format{0};
+    std::vector<geom::Rectangle> regions;
+    SnapshotCallback done;
+};
+
+ms::AsyncGLPixelReader::AsyncGLPixelReader(
+    std::unique_ptr<renderer::gl::Context> gl_context,
+    unsigned int ring_size) :
+    gl_context{std::move(gl_context)},
+    ext{std::make_unique<Extensions>()},
+    ring(std::max(ring_size, 1u)),
+    next_slot{0},
+    tex{0},
+    fbo{0},
+    gl_pixel_format{0}
+{
+    this->gl_context->make_current();
+
+    if (!supports_pbo_and_fences() || !ext->available())
+        ring.clear();
+
+    /* Reads are usually made from another thread (e.g. the snapshot thread) */
+    this->gl_context->release_current();
+}
+
+ms::AsyncGLPixelReader::~AsyncGLPixelReader() noexcept
+{
+    gl_context->make_current();
+
+    for (auto& staging : ring)
+    {
+        if (staging.fence)
+            ext->glDeleteSync(staging.fence);
+        if (staging.pbo != 0)
+            glDeleteBuffers(1, &staging.pbo);
+    }
+
+    if (tex != 0)
+        glDeleteTextures(1, &tex);
+    if (fbo != 0)
+        glDeleteFramebuffers(1, &fbo);
+}
+
+void ms::AsyncGLPixelReader::read(mg::Buffer& buffer, SnapshotCallback const& done)
+{
+    issue(buffer, {geom::Rectangle{{0, 0}, buffer.size()}}, done);
+}
+
+void ms::AsyncGLPixelReader::read(
+    mg::Buffer& buffer,
+    std::vector<geom::Rectangle> const& damage,
+    SnapshotCallback const& done)
+{
+    geom::Rectangle const extents{{0, 0}, buffer.size()};
+
+    /*
+     * Reads still in flight will update frame, so we can only rely on frame
+     * as a base when its size matches (the in-flight reads then being the
+     * same size too).
+     */
+    bool const have_base =
+        frame_size == buffer.size() ||
+        std::any_of(ring.begin(), ring.end(), [&](Staging const& s) { return s.done && s.size == buffer.size(); });
+
+    if (!have_base)
+    {
+        issue(buffer, {extents}, done);
+        return;
+    }
+
+    std::vector<geom::Rectangle> regions;
+    for (auto const& rect : damage)
+    {
+        auto const clipped = rect.intersection_with(extents);
+        if (clipped.size.width.as_int() > 0 && clipped.size.height.as_int() > 0)
+            regions.push_back(clipped);
+    }
+
+    issue(buffer, regions, done);
+}
+
+void ms::AsyncGLPixelReader::prepare()
+{
+    gl_context->make_current();
+
+    if (tex == 0)
+        glGenTextures(1, &tex);
+
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glActiveTexture(GL_TEXTURE0);
+
+    if (fbo == 0)
+        glGenFramebuffers(1, &fbo);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+}
+
+void ms::AsyncGLPixelReader::issue(
+    mg::Buffer& buffer,
+    std::vector<geom::Rectangle> const& regions,
+    SnapshotCallback const& done)
+{
+    auto const texture_source =
+        dynamic_cast<mir::renderer::gl::TextureSource*>(buffer.native_buffer_base());
+    if (!texture_source)
+        BOOST_THROW_EXCEPTION(std::logic_error("Buffer does not support GL rendering"));
+
+    prepare();
+
+    texture_source->gl_bind_to_texture();
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+
+    auto const height = buffer.size().height.as_int();
+    /* With a pixel-pack buffer bound the "pointer" is an offset into it */
+    auto const read_regions = [&](char* base)
+        {
+            size_t offset{0};
+            for (auto const& r : regions)
+            {
+                auto const w = r.size.width.as_int();
+                auto const h = r.size.height.as_int();
+
+                /* GL rows run bottom to top */
+                glReadPixels(r.top_left.x.as_int(), height - r.top_left.y.as_int() - h, w, h,
+                             gl_pixel_format, GL_UNSIGNED_BYTE,
+                             base ? static_cast<void*>(base + offset) : reinterpret_cast<void*>(offset));
+                offset += w * h * 4;
+            }
+        };
+
+    /* Learn, once, whether the implementation can give us BGRA */
+    if (gl_pixel_format == 0)
+    {
+        std::vector<char> probe(4);
+        glGetError();
+        glReadPixels(0, 0, 1, 1, GL_BGRA_EXT, GL_UNSIGNED_BYTE, probe.data());
+        gl_pixel_format = (glGetError() == GL_NO_ERROR) ? GL_BGRA_EXT : GL_RGBA;
+    }
+
+    if (ring.empty())
+    {
+        Staging staging;
+        staging.size = buffer.size();
+        staging.format = gl_pixel_format;
+        staging.regions = regions;
+        staging.done = done;
+
+        sync_staging.resize(bytes_for(regions));
+        read_regions(sync_staging.data());
+        merge(sync_staging.data(), staging);
+        done(Snapshot{frame_size, geom::Stride{frame_size.width.as_uint32_t() * 4}, frame.data()});
+        return;
+    }
+
+    auto& staging = ring[next_slot];
+    next_slot = (next_slot + 1) % ring.size();
+
+    /* The ring is full: we have to wait for the oldest read */
+    if (staging.done)
+        complete(staging, true);
+
+    auto const bytes = bytes_for(regions);
+
+    if (staging.pbo == 0)
+        glGenBuffers(1, &staging.pbo);
+
+    glBindBuffer(pixel_pack_buffer, staging.pbo);
+    if (staging.capacity < bytes)
+    {
+        glBufferData(pixel_pack_buffer, bytes, nullptr, stream_read);
+        staging.capacity = bytes;
+    }
+
+    read_regions(nullptr);
+
+    staging.fence = ext->glFenceSync(sync_gpu_commands_complete, 0);
+    staging.size = buffer.size();
+    staging.format = gl_pixel_format;
+    staging.regions = regions;
+    staging.done = done;
+
+    glBindBuffer(pixel_pack_buffer, 0);
+}
+
+void ms::AsyncGLPixelReader::dispatch_completed()
+{
+    if (!has_pending())
+        return;
+
+    gl_context->make_current();
+
+    /* Deliver in issue order, stopping at the first incomplete read */
+    for (auto i = 0u; i != ring.size(); ++i)
+    {
+        auto& staging = ring[(next_slot + i) % ring.size()];
+        if (staging.done && !complete(staging, false))
+            break;
+    }
+}
+
+void ms::AsyncGLPixelReader::flush()
+{
+    if (!has_pending())
+        return;
+
+    gl_context->make_current();
+
+    for (auto i = 0u; i != ring.size(); ++i)
+    {
+        auto& staging = ring[(next_slot + i) % ring.size()];
+        if (staging.done)
+            complete(staging, true);
+    }
+}
+
+void ms::AsyncGLPixelReader::wait_for_slot()
+{
+    if (ring.empty() || !ring[next_slot].done)
+        return;
+
+    gl_context->make_current();
+    complete(ring[next_slot], true);
+}
+
+bool ms::AsyncGLPixelReader::has_pending() const
+{
+    return std::any_of(ring.begin(), ring.end(), [](Staging const& s) { return !!s.done; });
+}
+
+bool ms::AsyncGLPixelReader::is_asynchronous() const
+{
+    return !ring.empty();
+}
+
+bool ms::AsyncGLPixelReader::complete(Staging& staging, bool wait)
+{
+    auto const status = ext->glClientWaitSync(staging.fence, sync_flush_commands_bit, wait ? forever : 0);
+
+    if (status != already_signaled && status != condition_satisfied && status != wait_failed)
+        return false;
+
+    ext->glDeleteSync(staging.fence);
+    staging.fence = nullptr;
+
+    auto const done = std::move(staging.done);
+    staging.done = nullptr;
+
+    if (status == wait_failed)
+        BOOST_THROW_EXCEPTION(std::runtime_error("Failed waiting for pixel readback to complete"));
+
+    glBindBuffer(pixel_pack_buffer, staging.pbo);
+    auto const bytes = bytes_for(staging.regions);
+    if (bytes)
+    {
+        auto const mapped = ext->glMapBufferRange(pixel_pack_buffer, 0, bytes, map_read_bit);
+        if (!mapped)
+        {
+            glBindBuffer(pixel_pack_buffer, 0);
+            BOOST_THROW_EXCEPTION(std::runtime_error("Failed to map pixel readback buffer"));
+        }
+
+        merge(static_cast<char const*>(mapped), staging);
+        ext->glUnmapBuffer(pixel_pack_buffer);
+    }
+    else
+    {
+        merge(nullptr, staging);
+    }
+    glBindBuffer(pixel_pack_buffer, 0);
+
+    done(Snapshot{frame_size, geom::Stride{frame_size.width.as_uint32_t() * 4}, frame.data()});
+    return true;
+}
+
+void ms::AsyncGLPixelReader::merge(char const* src, Staging const& staging)
+{
+    if (frame_size != staging.size)
+    {
+        frame_size = staging.size;
+        frame.assign(frame_size.width.as_uint32_t() * frame_size.height.as_uint32_t() * 4, 0);
+    }
+
+    auto const stride = frame_size.width.as_uint32_t() * 4;
+
+    for (auto const& r : staging.regions)
+    {
+        auto const x = r.top_left.x.as_uint32_t();
+        auto const y = r.top_left.y.as_uint32_t();
+        auto const w = r.size.width.as_uint32_t();
+        auto const h = r.size.height.as_uint32_t();
+
+        for (uint32_t row = 0; row != h; ++row)
+        {
+            /* Flip while copying: the first row read is the bottom one */
+            auto const line = src + row * w * 4;
+            auto const dst = frame.data() + (y + h - 1 - row) * stride + x * 4;
+
+            if (staging.format == GL_RGBA)
+            {
+                auto const pixels_src = reinterpret_cast<uint32_t const*>(line);
+                auto const pixels_dst = reinterpret_cast<uint32_t*>(dst);
+                for (uint32_t n = 0; n != w; ++n)
+                    pixels_dst[n] = abgr_to_argb(pixels_src[n]);
+            }
+            else
+            {
+                memcpy(dst, line, w * 4);
+            }
+        }
+
+        src += w * h * 4;
+    }
+}
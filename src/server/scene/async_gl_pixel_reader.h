@@ -0,0 +1,117 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_SCENE_ASYNC_GL_PIXEL_READER_H_
+#define MIR_SCENE_ASYNC_GL_PIXEL_READER_H_
+
+#include "mir/scene/snapshot.h"
+#include "mir/geometry/rectangle.h"
+
+#include <memory>
+#include <vector>
+
+#include MIR_SERVER_GL_H
+
+namespace mir
+{
+namespace graphics
+{
+class Buffer;
+}
+namespace renderer
+{
+namespace gl
+{
+class Context;
+}
+}
+
+namespace scene
+{
+/**
+ * Reads the pixels of graphics::Buffers back to the CPU without stalling
+ * the GL pipeline.
+ *
+ * Each read is issued into one of a small ring of pixel-pack buffer objects
+ * and fenced; the result is delivered (as 0xAARRGGBB, top row first) to the
+ * read's callback once the GPU has finished the copy. The pixels passed to
+ * the callback are only valid for the duration of the call. Where pixel-pack
+ * buffers or fences are unavailable reads complete synchronously.
+ *
+ * When a read is given the damaged region of the buffer only that region is
+ * transferred and merged into the previous result, so an instance should be
+ * dedicated to a single client (snapshot consumer, screencast session, ...).
+ *
+ * Not thread safe: all calls must be made on the same thread (which needn't
+ * be the one that constructed the reader).
+ */
+class AsyncGLPixelReader
+{
+public:
+    AsyncGLPixelReader(std::unique_ptr<renderer::gl::Context> gl_context, unsigned int ring_size = 3);
+    ~AsyncGLPixelReader() noexcept;
+
+    /// Read the whole of buffer; done is invoked from a later dispatch_completed() or flush()
+    void read(graphics::Buffer& buffer, SnapshotCallback const& done);
+
+    /**
+     * Read the parts of buffer within damage, merging them into the previous
+     * result. A full read is made if there is no previous result of the same size.
+     */
+    void read(graphics::Buffer& buffer, std::vector<geometry::Rectangle> const& damage, SnapshotCallback const& done);
+
+    /// Deliver every read the GPU has completed, without blocking
+    void dispatch_completed();
+
+    /// Block until every outstanding read has been delivered
+    void flush();
+
+    /// Block until the next read can be issued without waiting for an earlier one
+    void wait_for_slot();
+
+    /// Whether there are reads not yet delivered
+    bool has_pending() const;
+
+    /// Whether reads are asynchronous (false if the GL implementation lacks PBOs or fences)
+    bool is_asynchronous() const;
+
+private:
+    struct Extensions;
+    struct Staging;
+
+    void prepare();
+    void issue(graphics::Buffer& buffer, std::vector<geometry::Rectangle> const& regions, SnapshotCallback const& done);
+    bool complete(Staging& staging, bool wait);
+    void merge(char const* src, Staging const& staging);
+
+    std::unique_ptr<renderer::gl::Context> const gl_context;
+    std::unique_ptr<Extensions> const ext;
+    std::vector<Staging> ring;
+    unsigned int next_slot;
+    GLuint tex;
+    GLuint fbo;
+    GLenum gl_pixel_format;
+
+    /* The most recent result; damaged reads are merged into this */
+    geometry::Size frame_size;
+    std::vector<char> frame;
+    std::vector<char> sync_staging;
+};
+
+}
+}
+
+#endif /* MIR_SCENE_ASYNC_GL_PIXEL_READER_H_ */
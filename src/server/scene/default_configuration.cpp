@@ -28,6 +28,7 @@
 #include "mir/scene/session_container.h"
 #include "mir/shell/display_configuration_controller.h"
 
+#include "async_gl_pixel_reader.h"
 #include "broadcasting_session_event_sink.h"
 #include "gl_pixel_buffer.h"
 #include "mediating_display_changer.h"
@@ -45,6 +46,10 @@
 #include "mir/graphics/display_configuration.h"
 #include "mir/frontend/display_changer.h"
 
+#include <boost/throw_exception.hpp>
+
+#include <sstream>
+
 namespace mc = mir::compositor;
 namespace mf = mir::frontend;
 namespace mi = mir::input;
@@ -212,8 +217,37 @@ mir::DefaultServerConfiguration::the_snapshot_strategy()
     return snapshot_strategy(
         [this]()
         {
+            mir::optional_value<mir::geometry::Size> thumbnail_size;
+
+            if (the_options()->is_set(options::snapshot_thumbnail_size_opt))
+            {
+                auto const value = the_options()->get<std::string>(options::snapshot_thumbnail_size_opt);
+                int width{0}, height{0};
+                char separator{0};
+                std::istringstream in{value};
+
+                if (!(in >> width >> separator >> height) || separator != 'x' || width <= 0 || height <= 0)
+                {
+                    BOOST_THROW_EXCEPTION(mir::AbnormalExit(
+                        std::string{"Invalid "} + options::snapshot_thumbnail_size_opt + " value: " + value));
+                }
+
+                thumbnail_size = mir::geometry::Size{width, height};
+            }
+
+            /* Full size snapshots are read back without holding up the stream, where GL allows */
+            std::shared_ptr<ms::AsyncGLPixelReader> reader;
+            if (auto const context_source =
+                    dynamic_cast<renderer::gl::ContextSource*>(the_display()->native_display()))
+            {
+                reader = std::make_shared<ms::AsyncGLPixelReader>(context_source->create_gl_context());
+            }
+
             return std::make_shared<ms::ThreadedSnapshotStrategy>(
-                the_pixel_buffer());
+                the_pixel_buffer(),
+                thumbnail_size,
+                ms::ThreadedSnapshotStrategy::default_cache_budget,
+                reader);
         });
 }
 
@@ -20,7 +20,9 @@
 #include "mir/graphics/buffer.h"
 #include "mir/renderer/gl/context.h"
 #include "mir/renderer/gl/texture_source.h"
+#include "mir/gl/program.h"
 
+#include <algorithm>
 #include <stdexcept>
 #include <boost/throw_exception.hpp>
 #include MIR_SERVER_GL_H
@@ -28,6 +30,7 @@
 
 namespace mg = mir::graphics;
 namespace ms = mir::scene;
+namespace mgl = mir::gl;
 namespace geom = mir::geometry;
 
 namespace
@@ -47,11 +50,54 @@ inline uint32_t abgr_to_argb(uint32_t p)
            ((p) & 0xff000000);        /* A remains at same position */
 }
 
+/* Texture coordinates and vertex positions share the unit square, so the
+ * scaled image has the same (bottom-up) row order as reading the buffer directly */
+GLchar const* const scaling_vertex_shader = R"(
+attribute vec2 position;
+varying vec2 v_texcoord;
+void main()
+{
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+    v_texcoord = position;
+}
+)";
+
+GLchar const* const scaling_fragment_shader = R"(
+#ifdef GL_ES
+precision mediump float;
+#endif
+uniform sampler2D tex;
+varying vec2 v_texcoord;
+void main()
+{
+    gl_FragColor = texture2D(tex, v_texcoord);
+}
+)";
+
+GLfloat const unit_square[] = {0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f};
+
+geom::Size fit_within(geom::Size const& size, geom::Size const& max_size)
+{
+    auto const width = size.width.as_int();
+    auto const height = size.height.as_int();
+    auto const max_width = max_size.width.as_int();
+    auto const max_height = max_size.height.as_int();
+
+    if (width <= max_width && height <= max_height)
+        return size;
+
+    /* Compare max_width/width with max_height/height without rounding */
+    if (int64_t{max_width} * height <= int64_t{max_height} * width)
+        return {max_width, static_cast<int>(std::max<int64_t>(1, int64_t{height} * max_width / width))};
+    else
+        return {static_cast<int>(std::max<int64_t>(1, int64_t{width} * max_height / height)), max_height};
+}
+
 }
 
 ms::GLPixelBuffer::GLPixelBuffer(std::unique_ptr<renderer::gl::Context> gl_context)
     : gl_context{std::move(gl_context)},
-      tex{0}, fbo{0}, gl_pixel_format{0}, pixels_need_y_flip{false}
+      tex{0}, fbo{0}, scaled_tex{0}, gl_pixel_format{0}, pixels_need_y_flip{false}
 {
     /*
      * TODO: Handle systems that are big-endian, and therefore GL_BGRA doesn't
@@ -73,6 +119,10 @@ ms::GLPixelBuffer::~GLPixelBuffer() noexcept
     if (tex != 0 || fbo != 0)
         gl_context->make_current();
 
+    scaler.reset();
+
+    if (scaled_tex != 0)
+        glDeleteTextures(1, &scaled_tex);
     if (tex != 0)
         glDeleteTextures(1, &tex);
     if (fbo != 0)
@@ -97,35 +147,100 @@ void ms::GLPixelBuffer::prepare()
 
 void ms::GLPixelBuffer::fill_from(graphics::Buffer& buffer)
 {
-    auto width = buffer.size().width.as_uint32_t();
-    auto height = buffer.size().height.as_uint32_t();
+    prepare();
+    bind_buffer_to_texture(buffer);
 
-    pixels.resize(width * height * 4);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+
+    read_pixels(buffer.size());
+}
+
+void ms::GLPixelBuffer::fill_scaled_from(graphics::Buffer& buffer, geom::Size max_size)
+{
+    auto const scaled_size = fit_within(buffer.size(), max_size);
+
+    if (scaled_size == buffer.size())
+    {
+        fill_from(buffer);
+        return;
+    }
+
+    auto const width = scaled_size.width.as_int();
+    auto const height = scaled_size.height.as_int();
 
     prepare();
+    bind_buffer_to_texture(buffer);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    /* Render the buffer into a texture of the scaled size, so only that is read back */
+    if (scaled_tex == 0)
+        glGenTextures(1, &scaled_tex);
+
+    glBindTexture(GL_TEXTURE_2D, scaled_tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, scaled_tex, 0);
+    glBindTexture(GL_TEXTURE_2D, tex);
+
+    if (!scaler)
+        scaler = std::make_unique<mgl::SimpleProgram>(scaling_vertex_shader, scaling_fragment_shader);
+
+    GLuint const program = *scaler;
+    auto const position = glGetAttribLocation(program, "position");
+
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "tex"), 0);
+    glViewport(0, 0, width, height);
+    glDisable(GL_BLEND);
 
+    glVertexAttribPointer(position, 2, GL_FLOAT, GL_FALSE, 0, unit_square);
+    glEnableVertexAttribArray(position);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glDisableVertexAttribArray(position);
+
+    read_pixels(scaled_size);
+}
+
+void ms::GLPixelBuffer::bind_buffer_to_texture(graphics::Buffer& buffer)
+{
     auto const texture_source =
         dynamic_cast<mir::renderer::gl::TextureSource*>(
             buffer.native_buffer_base());
     if (!texture_source)
         BOOST_THROW_EXCEPTION(std::logic_error("Buffer does not support GL rendering"));
     texture_source->gl_bind_to_texture();
+}
 
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+void ms::GLPixelBuffer::read_pixels(geom::Size const& size)
+{
+    auto width = size.width.as_uint32_t();
+    auto height = size.height.as_uint32_t();
 
-    /* First try to get pixels as BGRA */
-    glGetError();
-    gl_pixel_format = GL_BGRA_EXT;
-    glReadPixels(0, 0, width, height, gl_pixel_format, GL_UNSIGNED_BYTE, pixels.data());
+    pixels.resize(width * height * 4);
 
-    /* If getting pixels as BGRA failed, fall back to RGBA */
-    if (glGetError() != GL_NO_ERROR)
+    if (gl_pixel_format != 0)
     {
-        gl_pixel_format = GL_RGBA;
+        /* We already know which format works, so read only once */
         glReadPixels(0, 0, width, height, gl_pixel_format, GL_UNSIGNED_BYTE, pixels.data());
     }
+    else
+    {
+        /* First try to get pixels as BGRA */
+        glGetError();
+        gl_pixel_format = GL_BGRA_EXT;
+        glReadPixels(0, 0, width, height, gl_pixel_format, GL_UNSIGNED_BYTE, pixels.data());
+
+        /* If getting pixels as BGRA failed, fall back to RGBA */
+        if (glGetError() != GL_NO_ERROR)
+        {
+            gl_pixel_format = GL_RGBA;
+            glReadPixels(0, 0, width, height, gl_pixel_format, GL_UNSIGNED_BYTE, pixels.data());
+        }
+    }
 
-    size_ = buffer.size();
+    size_ = size;
     pixels_need_y_flip = true;
 }
 
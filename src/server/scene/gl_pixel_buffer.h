@@ -32,6 +32,10 @@ namespace graphics
 {
 class Buffer;
 }
+namespace gl
+{
+class Program;
+}
 namespace renderer
 {
 namespace gl
@@ -50,17 +54,22 @@ public:
     ~GLPixelBuffer() noexcept;
 
     void fill_from(graphics::Buffer& buffer);
+    void fill_scaled_from(graphics::Buffer& buffer, geometry::Size max_size);
     void const* as_argb_8888();
     geometry::Size size() const;
     geometry::Stride stride() const;
 
 private:
     void prepare();
+    void bind_buffer_to_texture(graphics::Buffer& buffer);
+    void read_pixels(geometry::Size const& size);
     void copy_and_convert_pixel_line(char* src, char* dst);
 
     std::unique_ptr<renderer::gl::Context> const gl_context;
     GLuint tex;
     GLuint fbo;
+    GLuint scaled_tex;
+    std::unique_ptr<gl::Program> scaler;
     std::vector<char> pixels;
     GLuint gl_pixel_format;
     bool pixels_need_y_flip;
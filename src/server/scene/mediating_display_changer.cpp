@@ -18,14 +18,17 @@
 
 #include <condition_variable>
 #include <boost/throw_exception.hpp>
-#include <unordered_set>
+#include <algorithm>
+#include <unordered_map>
 #include "mediating_display_changer.h"
 #include "mir/scene/session_container.h"
 #include "mir/scene/session.h"
 #include "mir/scene/session_event_handler_register.h"
 #include "mir/scene/session_event_sink.h"
 #include "mir/graphics/display.h"
+#include "mir/graphics/per_output_reconfiguration.h"
 #include "mir/compositor/compositor.h"
+#include "mir/compositor/sync_group_compositor.h"
 #include "mir/geometry/rectangles.h"
 #include "mir/graphics/display_configuration_policy.h"
 #include "mir/graphics/display_configuration.h"
@@ -439,29 +442,62 @@ void ms::MediatingDisplayChanger::resume_display_config_processing()
 
 namespace
 {
-bool configuration_has_new_outputs_enabled(
-    mg::DisplayConfiguration const& existing,
-    mg::DisplayConfiguration const& updated)
+/// The cheapest way of getting the display from one configuration to another
+enum class ConfigurationChange
 {
-    std::unordered_set<mg::DisplayConfigurationOutputId> currently_enabled_outputs;
+    none,       ///< Nothing to apply
+    in_place,   ///< Might be applied to the existing display buffers, if the platform supports it
+    full        ///< Enables new outputs, so needs new display buffers (and compositing to them stopped)
+};
+
+bool identical(mg::DisplayConfigurationOutput const& lhs, mg::DisplayConfigurationOutput const& rhs)
+{
+    // Unlike operator==() this considers everything applying the configuration would change
+    return lhs == rhs &&
+           lhs.current_format == rhs.current_format &&
+           lhs.power_mode == rhs.power_mode &&
+           lhs.subpixel_arrangement == rhs.subpixel_arrangement &&
+           lhs.gamma.red == rhs.gamma.red &&
+           lhs.gamma.green == rhs.gamma.green &&
+           lhs.gamma.blue == rhs.gamma.blue;
+}
+
+auto change_between(mg::DisplayConfiguration const& existing, mg::DisplayConfiguration const& updated)
+    -> ConfigurationChange
+{
+    std::unordered_map<mg::DisplayConfigurationOutputId, mg::DisplayConfigurationOutput> existing_outputs;
     existing.for_each_output(
-        [&currently_enabled_outputs](auto const& output)
+        [&existing_outputs](mg::DisplayConfigurationOutput const& output)
         {
-            if (output.used)
-            {
-                currently_enabled_outputs.insert(output.id);
-            }
+            existing_outputs.emplace(output.id, output);
         });
-    bool has_new_output{false};
+
+    auto change = ConfigurationChange::none;
+    size_t updated_output_count{0};
     updated.for_each_output(
-        [&currently_enabled_outputs, &has_new_output](auto const& output)
+        [&](mg::DisplayConfigurationOutput const& output)
         {
-            if (output.used)
+            ++updated_output_count;
+
+            auto const previous = existing_outputs.find(output.id);
+            if (previous == existing_outputs.end())
             {
-                has_new_output |= (currently_enabled_outputs.count(output.id) == 0);
+                change = output.used ? ConfigurationChange::full : std::max(change, ConfigurationChange::in_place);
+            }
+            else if (output.used && !previous->second.used)
+            {
+                change = ConfigurationChange::full;
+            }
+            else if (!identical(output, previous->second))
+            {
+                change = std::max(change, ConfigurationChange::in_place);
             }
         });
-    return has_new_output;
+
+    if (updated_output_count != existing_outputs.size())
+        change = std::max(change, ConfigurationChange::in_place);
+
+    return change;
 }
 }
 
@@ -471,13 +507,30 @@ void ms::MediatingDisplayChanger::apply_config(
     auto existing_configuration = display->configuration();
     try
     {
-        if (configuration_has_new_outputs_enabled(*display->configuration(), *conf) ||
-            !display->apply_if_configuration_preserves_display_buffers(*conf))
+        auto const change = change_between(*existing_configuration, *conf);
+
+        if (change == ConfigurationChange::full ||
+            (change == ConfigurationChange::in_place &&
+             !display->apply_if_configuration_preserves_display_buffers(*conf)))
         {
-            ApplyNowAndRevertOnScopeExit comp{
-                [this] { compositor->stop(); },
-                [this] { compositor->start(); }};
-            display->configure(*conf);
+            auto const per_output = dynamic_cast<mg::PerOutputReconfiguration*>(display->native_display());
+            auto const per_group = std::dynamic_pointer_cast<mc::SyncGroupCompositor>(compositor);
+
+            if (per_output && per_group)
+            {
+                // Only the outputs the change affects stop being composited to
+                per_output->configure_changed_outputs(
+                    *conf,
+                    [&](mg::DisplaySyncGroup& group) { per_group->stop_compositing_to(group); },
+                    [&](mg::DisplaySyncGroup& group) { per_group->start_compositing_to(group); });
+            }
+            else
+            {
+                ApplyNowAndRevertOnScopeExit comp{
+                    [this] { compositor->stop(); },
+                    [this] { compositor->start(); }};
+                display->configure(*conf);
+            }
         }
 
         observer->configuration_applied(conf);
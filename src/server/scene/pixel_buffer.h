@@ -45,6 +45,16 @@ public:
      */
     virtual void fill_from(graphics::Buffer& buffer) = 0;
 
+    /**
+     * Fills the PixelBuffer with the contents of a graphics::Buffer scaled
+     * down, preserving the aspect ratio, to fit within max_size. Buffers
+     * already fitting within max_size are not scaled.
+     *
+     * \param [in] buffer   the buffer to get the pixels of
+     * \param [in] max_size the largest size to read back
+     */
+    virtual void fill_scaled_from(graphics::Buffer& buffer, geometry::Size max_size) = 0;
+
     /**
      * The pixels in 0xAARRGGBB format.
      *
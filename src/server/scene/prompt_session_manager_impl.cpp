@@ -122,16 +122,7 @@ std::shared_ptr<ms::PromptSession> ms::PromptSessionManagerImpl::start_prompt_se
     PromptSessionCreationParameters const& params) const
 {
     auto prompt_session = std::make_shared<PromptSessionImpl>();
-    std::shared_ptr<Session> application_session;
-
-    app_container->for_each(
-    [&](std::shared_ptr<Session> const& session)
-    {
-        if (session->process_id() == params.application_pid)
-        {
-            application_session = session;
-        }
-    });
+    auto const application_session = app_container->session_for_process(params.application_pid);
 
     if (!application_session)
         BOOST_THROW_EXCEPTION(std::runtime_error("Could not identify application session"));
@@ -39,7 +39,8 @@ class RenderingTracker
 public:
     RenderingTracker(std::weak_ptr<Surface> const& weak_surface);
 
-    void rendered_in(compositor::CompositorID cid);
+    /// Returns whether the surface had been occluded in cid
+    bool rendered_in(compositor::CompositorID cid);
     void occluded_in(compositor::CompositorID cid);
     void active_compositors(std::set<compositor::CompositorID> const& cids);
     bool is_exposed_in(compositor::CompositorID cid) const;
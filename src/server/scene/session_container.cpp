@@ -17,6 +17,7 @@
  */
 
 #include "mir/scene/session_container.h"
+#include "mir/scene/session.h"
 
 #include <boost/throw_exception.hpp>
 
@@ -32,78 +33,105 @@ void ms::SessionContainer::insert_session(std::shared_ptr<Session> const& sessio
 {
     std::unique_lock<std::mutex> lk(guard);
 
-    apps.push_back(session);
+    if (index.count(session.get()))
+        BOOST_THROW_EXCEPTION(std::logic_error("Session already inserted"));
+
+    auto const pid = session->process_id();
+    index[session.get()] = Entry{apps.insert(apps.end(), session), pid};
+    by_process[pid].push_back(session.get());
+    snapshot.reset();
 }
 
 void ms::SessionContainer::remove_session(std::shared_ptr<Session> const& session)
 {
     std::unique_lock<std::mutex> lk(guard);
 
-    auto it = std::find(apps.begin(), apps.end(), session);
-    if (it != apps.end())
-    {
-        apps.erase(it);
-    }
-    else
-    {
+    auto const entry = index.find(session.get());
+    if (entry == index.end())
         BOOST_THROW_EXCEPTION(std::logic_error("Invalid Session"));
+
+    auto const pid = entry->second.pid;
+    apps.erase(entry->second.position);
+    index.erase(entry);
+
+    auto const process = by_process.find(pid);
+    if (process != by_process.end())
+    {
+        auto& sessions = process->second;
+        sessions.erase(std::remove(sessions.begin(), sessions.end(), session.get()), sessions.end());
+        if (sessions.empty())
+            by_process.erase(process);
     }
+
+    snapshot.reset();
 }
 
 void ms::SessionContainer::for_each(std::function<void(std::shared_ptr<Session> const&)> f) const
 {
-    std::unique_lock<std::mutex> lk(guard);
+    std::shared_ptr<Snapshot const> sessions;
+    {
+        std::unique_lock<std::mutex> lk(guard);
+
+        if (!snapshot)
+            snapshot = std::make_shared<Snapshot const>(apps.begin(), apps.end());
+
+        sessions = snapshot;
+    }
 
-    for (auto const& ptr : apps)
+    for (auto const& ptr : *sessions)
     {
         f(ptr);
     }
 }
 
+auto ms::SessionContainer::session_for_process(pid_t pid) const -> std::shared_ptr<Session>
+{
+    std::unique_lock<std::mutex> lk(guard);
+
+    auto const process = by_process.find(pid);
+    if (process == by_process.end())
+        return {};
+
+    return *index.at(process->second.back()).position;
+}
+
+auto ms::SessionContainer::position_of(std::shared_ptr<Session> const& session) const -> Sessions::const_iterator
+{
+    auto const entry = index.find(session.get());
+    if (entry == index.end())
+        BOOST_THROW_EXCEPTION(std::logic_error("Invalid session"));
+
+    return entry->second.position;
+}
+
 auto ms::SessionContainer::successor_of(std::shared_ptr<Session> const& session) const
     -> std::shared_ptr<ms::Session>
 {
-    std::shared_ptr<Session> result, first;
+    std::unique_lock<std::mutex> lk(guard);
 
     if (!session && apps.size())
         return apps.back();
     else if(!session)
         return std::shared_ptr<Session>();
 
-    for (auto it = apps.begin(); it != apps.end(); it++)
-    {
-        if (*it == session)
-        {
-            auto successor = ++it;
-            if (successor == apps.end())
-                return *apps.begin();
-            else return *successor;
-        }
-    }
-
-    BOOST_THROW_EXCEPTION(std::logic_error("Invalid session"));
+    auto successor = std::next(position_of(session));
+    if (successor == apps.end())
+        return *apps.begin();
+    else return *successor;
 }
 
 auto mir::scene::SessionContainer::predecessor_of(std::shared_ptr<Session> const& session) const
     -> std::shared_ptr<Session>
 {
-    std::shared_ptr<Session> result, first;
+    std::unique_lock<std::mutex> lk(guard);
 
     if (!session && apps.size())
         return apps.front();
     else if(!session)
         return std::shared_ptr<Session>();
 
-    for (auto it = apps.rbegin(); it != apps.rend(); it++)
-    {
-        if (*it == session)
-        {
-            auto successor = ++it;
-            if (successor == apps.rend())
-                return *apps.rbegin();
-            else return *successor;
-        }
-    }
-
-    BOOST_THROW_EXCEPTION(std::logic_error("Invalid session"));
+    auto const position = position_of(session);
+    if (position == apps.begin())
+        return *apps.rbegin();
+    else return *std::prev(position);
 }
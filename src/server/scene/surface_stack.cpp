@@ -25,6 +25,7 @@
 #include "mir/scene/scene_report.h"
 #include "mir/compositor/scene_element.h"
 #include "mir/graphics/renderable.h"
+#include "mir/geometry/rectangles.h"
 #include "mir/depth_layer.h"
 
 #include <boost/throw_exception.hpp>
@@ -32,8 +33,12 @@
 #include <algorithm>
 #include <cassert>
 #include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <stdexcept>
+#include <unordered_map>
 
 namespace ms = mir::scene;
 namespace mc = mir::compositor;
@@ -41,6 +46,249 @@ namespace mg = mir::graphics;
 namespace mi = mir::input;
 namespace geom = mir::geometry;
 
+/**
+ * The surfaces that may have frames pending for each compositor.
+ *
+ * A surface becomes a candidate when something could give it a frame to
+ * composite - being added, posting a buffer, being shown, having its streams
+ * replaced or becoming exposed - and remains one until frames_pending() finds
+ * it has none. So idle surfaces cost nothing per frame.
+ */
+class ms::FrameCandidates
+{
+public:
+    void add(Surface const* surface)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        for (auto& compositor : candidates)
+            compositor.second.insert(surface);
+    }
+
+    void add(Surface const* surface, mc::CompositorID id)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        auto const compositor = candidates.find(id);
+        if (compositor != candidates.end())
+            compositor->second.insert(surface);
+    }
+
+    void remove(Surface const* surface)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        for (auto& compositor : candidates)
+            compositor.second.erase(surface);
+    }
+
+    void add_compositor(mc::CompositorID id, std::set<Surface const*>&& surfaces)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        candidates[id] = std::move(surfaces);
+    }
+
+    void remove_compositor(mc::CompositorID id)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        candidates.erase(id);
+    }
+
+    /// Removes the candidates for id (those still with frames pending must be added back)
+    auto take(mc::CompositorID id) -> std::set<Surface const*>
+    {
+        std::set<Surface const*> taken;
+
+        std::lock_guard<std::mutex> lock{mutex};
+        auto const compositor = candidates.find(id);
+        if (compositor != candidates.end())
+            taken.swap(compositor->second);
+        return taken;
+    }
+
+private:
+    std::mutex mutex;
+    std::map<mc::CompositorID, std::set<Surface const*>> candidates;
+};
+
+/**
+ * Where on screen each surface could be drawn, so that a compositor needn't
+ * snapshot the surfaces that can't appear in its area.
+ *
+ * Surface observers can't call back into the surface, so they just mark it
+ * dirty when it moves, resizes, is transformed or posts a frame of a new
+ * size; its extent is recomputed by update() before the next snapshot. A
+ * surface whose extent isn't known may appear anywhere.
+ */
+class ms::OutputMembership
+{
+public:
+    void mark_dirty(Surface const* surface)
+    {
+        std::lock_guard<std::mutex> lock{dirty_mutex};
+        dirty.insert(surface);
+    }
+
+    void frame_posted(Surface const* surface, geom::Size const& size)
+    {
+        std::lock_guard<std::mutex> lock{dirty_mutex};
+        auto& posted = posted_size[surface];
+        if (posted != size)
+        {
+            posted = size;
+            dirty.insert(surface);
+        }
+    }
+
+    void remove(Surface const* surface)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        extents.erase(surface);
+        for (auto& compositor : departed)
+            compositor.second.erase(surface);
+
+        std::lock_guard<std::mutex> dirty_lock{dirty_mutex};
+        dirty.erase(surface);
+        posted_size.erase(surface);
+    }
+
+    void set_area(mc::CompositorID id, geom::Rectangle const& area)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        areas[id] = area;
+
+        auto& departures = departed[id];
+        departures.clear();
+        for (auto const& extent : extents)
+        {
+            if (!extent.second.overlaps(area))
+                departures.insert(extent.first);
+        }
+    }
+
+    void remove_compositor(mc::CompositorID id)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        areas.erase(id);
+        departed.erase(id);
+    }
+
+    /// Recomputes the extents of dirty surfaces, skipping those no longer in_scene
+    void update(std::function<bool(Surface const*)> const& in_scene)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        std::set<Surface const*> updating;
+        {
+            std::lock_guard<std::mutex> dirty_lock{dirty_mutex};
+            updating.swap(dirty);
+        }
+
+        for (auto const surface : updating)
+        {
+            if (!in_scene(surface))
+                continue;
+
+            auto const found = extents.find(surface);
+            auto const before = found != extents.end() ? found->second : Extent{};
+            auto const after = extent_of(*surface);
+            extents[surface] = after;
+
+            for (auto const& area : areas)
+            {
+                if (!after.overlaps(area.second))
+                {
+                    if (before.overlaps(area.second))
+                        departed[area.first].insert(surface);
+                }
+                else
+                {
+                    departed[area.first].erase(surface);
+                }
+            }
+        }
+    }
+
+    /// The surfaces that have left id's area since last asked (so should be treated as occluded there)
+    auto take_departed(mc::CompositorID id) -> std::set<Surface const*>
+    {
+        std::set<Surface const*> taken;
+
+        std::lock_guard<std::mutex> lock{mutex};
+        auto const compositor = departed.find(id);
+        if (compositor != departed.end())
+            taken.swap(compositor->second);
+        return taken;
+    }
+
+    /// Those of surface_layers that may appear in id's area, in stacking order
+    auto members_of(
+        mc::CompositorID id,
+        std::vector<std::vector<std::shared_ptr<Surface>>> const& surface_layers) const -> std::vector<Surface*>
+    {
+        std::vector<Surface*> members;
+
+        std::lock_guard<std::mutex> lock{mutex};
+        auto const area = areas.find(id);
+        for (auto const& layer : surface_layers)
+        {
+            for (auto const& surface : layer)
+            {
+                if (area == areas.end())
+                {
+                    members.push_back(surface.get());
+                    continue;
+                }
+
+                auto const extent = extents.find(surface.get());
+                if (extent == extents.end() || extent->second.overlaps(area->second))
+                    members.push_back(surface.get());
+            }
+        }
+        return members;
+    }
+
+private:
+    struct Extent
+    {
+        bool anywhere{true};
+        geom::Rectangle bounds;
+
+        bool overlaps(geom::Rectangle const& area) const
+        {
+            return anywhere || bounds.overlaps(area);
+        }
+    };
+
+    auto extent_of(Surface const& surface) const -> Extent
+    {
+        static glm::mat4 const identity(1);
+
+        geom::Rectangles positions;
+        for (auto const& renderable : surface.generate_renderables(this))
+        {
+            // Like filter_occlusions_from(), don't try to work out where transformed renderables end up
+            if (renderable->transformation() != identity)
+                return Extent{};
+
+            positions.add(renderable->screen_position());
+        }
+
+        // Nothing posted yet, or clipped away: we won't be told when that changes
+        if (positions.size() == 0)
+            return Extent{};
+
+        return Extent{false, positions.bounding_rectangle()};
+    }
+
+    std::mutex mutable mutex;
+    std::map<mc::CompositorID, geom::Rectangle> areas;
+    std::unordered_map<Surface const*, Extent> extents;
+    std::map<mc::CompositorID, std::set<Surface const*>> departed;
+
+    // Locked after mutex, if both are needed; observers only lock this
+    std::mutex dirty_mutex;
+    std::set<Surface const*> dirty;
+    std::unordered_map<Surface const*, geom::Size> posted_size;
+};
+
 namespace
 {
 
@@ -48,14 +296,17 @@ class SurfaceSceneElement : public mc::SceneElement
 {
 public:
     SurfaceSceneElement(
-        std::string name,
+        ms::Surface const* surface,
         std::shared_ptr<mg::Renderable> const& renderable,
         std::shared_ptr<ms::RenderingTracker> const& tracker,
+        std::shared_ptr<ms::FrameCandidates> const& frame_candidates,
         mc::CompositorID id)
         : renderable_{renderable},
           tracker{tracker},
+          frame_candidates{frame_candidates},
           cid{id},
-          surface_name(name)
+          surface{surface},
+          surface_name(surface->name())
     {
     }
 
@@ -66,7 +317,9 @@ public:
 
     void rendered() override
     {
-        tracker->rendered_in(cid);
+        // Frames posted while the surface was occluded count from now on
+        if (tracker->rendered_in(cid))
+            frame_candidates->add(surface, cid);
     }
 
     void occluded() override
@@ -77,7 +330,9 @@ public:
 private:
     std::shared_ptr<mg::Renderable> const renderable_;
     std::shared_ptr<ms::RenderingTracker> const tracker;
+    std::shared_ptr<ms::FrameCandidates> const frame_candidates;
     mc::CompositorID cid;
+    ms::Surface const* const surface;
     std::string const surface_name;
 };
 
@@ -128,13 +383,83 @@ private:
     ms::SurfaceStack* stack;
 };
 
+/// Makes a surface a frame candidate when it might have a new frame to composite
+struct FrameCandidateObserver : ms::NullSurfaceObserver
+{
+    FrameCandidateObserver(std::shared_ptr<ms::FrameCandidates> const& frame_candidates)
+        : frame_candidates{frame_candidates}
+    {
+    }
+
+    void frame_posted(ms::Surface const* surface, int /*frames_available*/, geom::Size const& /*size*/) override
+    {
+        frame_candidates->add(surface);
+    }
+
+    void hidden_set_to(ms::Surface const* surface, bool hide) override
+    {
+        if (!hide)
+            frame_candidates->add(surface);
+    }
+
+    void moved_to(ms::Surface const* surface, geom::Point const& /*top_left*/) override
+    {
+        // BasicSurface::set_streams() notifies this, and the new streams may have frames
+        frame_candidates->add(surface);
+    }
+
+private:
+    std::shared_ptr<ms::FrameCandidates> const frame_candidates;
+};
+
+/// Marks a surface's extent for recomputing when it might have changed
+struct OutputMembershipObserver : ms::NullSurfaceObserver
+{
+    OutputMembershipObserver(std::shared_ptr<ms::OutputMembership> const& output_membership)
+        : output_membership{output_membership}
+    {
+    }
+
+    void moved_to(ms::Surface const* surface, geom::Point const& /*top_left*/) override
+    {
+        output_membership->mark_dirty(surface);
+    }
+
+    void window_resized_to(ms::Surface const* surface, geom::Size const& /*window_size*/) override
+    {
+        output_membership->mark_dirty(surface);
+    }
+
+    void content_resized_to(ms::Surface const* surface, geom::Size const& /*content_size*/) override
+    {
+        output_membership->mark_dirty(surface);
+    }
+
+    void transformation_set_to(ms::Surface const* surface, glm::mat4 const& /*t*/) override
+    {
+        output_membership->mark_dirty(surface);
+    }
+
+    void frame_posted(ms::Surface const* surface, int /*frames_available*/, geom::Size const& size) override
+    {
+        output_membership->frame_posted(surface, size);
+    }
+
+private:
+    std::shared_ptr<ms::OutputMembership> const output_membership;
+};
+
 }
 
 ms::SurfaceStack::SurfaceStack(
     std::shared_ptr<SceneReport> const& report) :
     report{report},
+    frame_candidates{std::make_shared<FrameCandidates>()},
+    output_membership{std::make_shared<OutputMembership>()},
     scene_changed{false},
-    surface_observer{std::make_shared<SurfaceDepthLayerObserver>(this)}
+    surface_observer{std::make_shared<SurfaceDepthLayerObserver>(this)},
+    frame_candidate_observer{std::make_shared<FrameCandidateObserver>(frame_candidates)},
+    output_membership_observer{std::make_shared<OutputMembershipObserver>(output_membership)}
 {
 }
 
@@ -146,6 +471,8 @@ ms::SurfaceStack::~SurfaceStack() noexcept(true)
         for (auto const& surface : layer)
         {
             surface->remove_observer(surface_observer);
+            surface->remove_observer(frame_candidate_observer);
+            surface->remove_observer(output_membership_observer);
         }
     }
 }
@@ -155,22 +482,35 @@ mc::SceneElementSequence ms::SurfaceStack::scene_elements_for(mc::CompositorID i
     RecursiveReadLock lg(guard);
 
     scene_changed = false;
+
+    output_membership->update(
+        [this](Surface const* surface)
+        {
+            return rendering_trackers.find(const_cast<Surface*>(surface)) != rendering_trackers.end();
+        });
+
+    // The compositor won't be given these to occlude, so we do
+    for (auto const surface : output_membership->take_departed(id))
+    {
+        auto const tracker = rendering_trackers.find(const_cast<Surface*>(surface));
+        if (tracker != rendering_trackers.end())
+            tracker->second->occluded_in(id);
+    }
+
     mc::SceneElementSequence elements;
-    for (auto const& layer : surface_layers)
+    for (auto const surface : output_membership->members_of(id, surface_layers))
     {
-        for (auto const& surface : layer)
+        if (surface->visible())
         {
-            if (surface->visible())
+            for (auto& renderable : surface->generate_renderables(id))
             {
-                for (auto& renderable : surface->generate_renderables(id))
-                {
-                    elements.emplace_back(
-                        std::make_shared<SurfaceSceneElement>(
-                            surface->name(),
-                            renderable,
-                            rendering_trackers[surface.get()],
-                            id));
-                }
+                elements.emplace_back(
+                    std::make_shared<SurfaceSceneElement>(
+                        surface,
+                        renderable,
+                        rendering_trackers[surface],
+                        frame_candidates,
+                        id));
             }
         }
     }
@@ -186,23 +526,26 @@ int ms::SurfaceStack::frames_pending(mc::CompositorID id) const
     RecursiveReadLock lg(guard);
 
     int result = scene_changed ? 1 : 0;
-    for (auto const& layer : surface_layers)
+
+    // The candidates are checked without frame_candidates locked, so that a
+    // frame posted meanwhile makes its surface a candidate again
+    for (auto const surface : frame_candidates->take(id))
     {
-        for (auto const& surface : layer)
+        // A frame posted as its surface was removed can leave it a candidate
+        auto const tracker = rendering_trackers.find(const_cast<Surface*>(surface));
+        if (tracker == rendering_trackers.end())
+            continue;
+
+        if (surface->visible() && tracker->second->is_exposed_in(id))
         {
-            if (surface->visible())
-            {
-                auto const tracker = rendering_trackers.find(surface.get());
-                if (tracker != rendering_trackers.end() && tracker->second->is_exposed_in(id))
-                {
-                    // Note that we ask the surface and not a Renderable.
-                    // This is because we don't want to waste time and resources
-                    // on a snapshot till we're sure we need it...
-                    int ready = surface->buffers_ready_for_compositor(id);
-                    if (ready > result)
-                        result = ready;
-                }
-            }
+            // Note that we ask the surface and not a Renderable.
+            // This is because we don't want to waste time and resources
+            // on a snapshot till we're sure we need it...
+            int ready = surface->buffers_ready_for_compositor(id);
+            if (ready > 0)
+                frame_candidates->add(surface, id);
+            if (ready > result)
+                result = ready;
         }
     }
     return result;
@@ -215,6 +558,14 @@ void ms::SurfaceStack::register_compositor(mc::CompositorID cid)
     registered_compositors.insert(cid);
 
     update_rendering_tracker_compositors();
+
+    std::set<Surface const*> surfaces;
+    for (auto const& layer : surface_layers)
+    {
+        for (auto const& surface : layer)
+            surfaces.insert(surface.get());
+    }
+    frame_candidates->add_compositor(cid, std::move(surfaces));
 }
 
 void ms::SurfaceStack::unregister_compositor(mc::CompositorID cid)
@@ -224,6 +575,16 @@ void ms::SurfaceStack::unregister_compositor(mc::CompositorID cid)
     registered_compositors.erase(cid);
 
     update_rendering_tracker_compositors();
+
+    frame_candidates->remove_compositor(cid);
+    output_membership->remove_compositor(cid);
+}
+
+void ms::SurfaceStack::set_compositor_area(mc::CompositorID cid, geom::Rectangle const& area)
+{
+    RecursiveWriteLock lg(guard);
+
+    output_membership->set_area(cid, area);
 }
 
 void ms::SurfaceStack::add_input_visualization(
@@ -271,6 +632,10 @@ void ms::SurfaceStack::add_surface(
         insert_surface_at_top_of_depth_layer(surface);
         create_rendering_tracker_for(surface);
         surface->add_observer(surface_observer);
+        surface->add_observer(frame_candidate_observer);
+        surface->add_observer(output_membership_observer);
+        frame_candidates->add(surface.get());
+        output_membership->mark_dirty(surface.get());
     }
     surface->set_reception_mode(input_mode);
     observers.surface_added(surface);
@@ -295,6 +660,10 @@ void ms::SurfaceStack::remove_surface(std::weak_ptr<Surface> const& surface)
                 layer.erase(surface);
                 rendering_trackers.erase(keep_alive.get());
                 keep_alive->remove_observer(surface_observer);
+                keep_alive->remove_observer(frame_candidate_observer);
+                keep_alive->remove_observer(output_membership_observer);
+                frame_candidates->remove(keep_alive.get());
+                output_membership->remove(keep_alive.get());
                 found_surface = true;
                 break;
             }
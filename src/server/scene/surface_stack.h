@@ -23,6 +23,7 @@
 #include "mir/frontend/surface_stack.h"
 
 #include "mir/compositor/scene.h"
+#include "mir/compositor/compositor_areas.h"
 #include "mir/scene/observer.h"
 #include "mir/input/scene.h"
 #include "mir/recursive_read_write_mutex.h"
@@ -50,6 +51,8 @@ namespace scene
 class BasicSurface;
 class SceneReport;
 class RenderingTracker;
+class FrameCandidates;
+class OutputMembership;
 
 class Observers : public Observer, BasicObservers<Observer>
 {
@@ -68,6 +71,7 @@ public:
 
 class SurfaceStack :
     public compositor::Scene,
+    public compositor::CompositorAreas,
     public input::Scene,
     public shell::SurfaceStack,
     public frontend::SurfaceStack
@@ -83,6 +87,9 @@ public:
     void register_compositor(compositor::CompositorID id) override;
     void unregister_compositor(compositor::CompositorID id) override;
 
+    // From CompositorAreas
+    void set_compositor_area(compositor::CompositorID id, geometry::Rectangle const& area) override;
+
     // From Scene
     void for_each(std::function<void(std::shared_ptr<input::Surface> const&)> const& callback) override;
 
@@ -128,12 +135,18 @@ private:
     std::vector<std::vector<std::shared_ptr<Surface>>> surface_layers;
     std::map<Surface*,std::shared_ptr<RenderingTracker>> rendering_trackers;
     std::set<compositor::CompositorID> registered_compositors;
+    /// The surfaces frames_pending() need check, as most won't have posted anything since last time
+    std::shared_ptr<FrameCandidates> const frame_candidates;
+    /// Which surfaces may appear in each compositor's area
+    std::shared_ptr<OutputMembership> const output_membership;
     
     std::vector<std::shared_ptr<graphics::Renderable>> overlays;
 
     Observers observers;
     std::atomic<bool> scene_changed;
     std::shared_ptr<SurfaceObserver> surface_observer;
+    std::shared_ptr<SurfaceObserver> frame_candidate_observer;
+    std::shared_ptr<SurfaceObserver> output_membership_observer;
 };
 
 }
@@ -18,14 +18,21 @@
 
 #include "threaded_snapshot_strategy.h"
 #include "pixel_buffer.h"
+#include "async_gl_pixel_reader.h"
 #include "mir/compositor/buffer_stream.h"
+#include "mir/graphics/buffer.h"
 #include "mir/thread_name.h"
+#include "mir/raii.h"
 
+#include <algorithm>
 #include <deque>
 #include <mutex>
 #include <condition_variable>
+#include <unordered_map>
+#include <vector>
 
 namespace geom = mir::geometry;
+namespace mg = mir::graphics;
 namespace ms = mir::scene;
 
 namespace mir
@@ -36,14 +43,31 @@ namespace scene
 struct WorkItem
 {
     std::shared_ptr<compositor::BufferStream> const stream;
-    ms::SnapshotCallback const snapshot_taken;
+    std::vector<ms::SnapshotCallback> snapshots_taken;
+};
+
+/// The last snapshot of a stream, reused until the stream has new content
+struct CachedSnapshot
+{
+    std::weak_ptr<compositor::BufferStream> stream;
+    mg::BufferID buffer_id;
+    uint64_t submission;
+    geom::Size size;
+    geom::Stride stride;
+    std::vector<char> pixels;
+    uint64_t last_used;
 };
 
 class SnapshottingFunctor
 {
 public:
-    SnapshottingFunctor(std::shared_ptr<PixelBuffer> const& pixels)
-        : running{true}, pixels{pixels}
+    SnapshottingFunctor(
+        std::shared_ptr<PixelBuffer> const& pixels,
+        std::shared_ptr<AsyncGLPixelReader> const& reader,
+        optional_value<geom::Size> const& thumbnail_size,
+        size_t cache_budget)
+        : running{true}, pixels{pixels}, reader{reader}, thumbnail_size{thumbnail_size},
+          cache_budget{cache_budget}, cached_bytes{0}, snapshots_taken{0}
     {
     }
 
@@ -55,7 +79,18 @@ public:
         while (running)
         {
             while (running && work.empty())
+            {
+                /* Nothing else to issue, so wait for the reads in flight */
+                if (reader && reader->has_pending())
+                {
+                    lock.unlock();
+                    reader->flush();
+                    lock.lock();
+                    continue;
+                }
+
                 work_cv.wait(lock);
+            }
 
             if (running)
             {
@@ -65,6 +100,8 @@ public:
                 lock.unlock();
 
                 take_snapshot(wi);
+                if (reader)
+                    reader->dispatch_completed();
 
                 lock.lock();
             }
@@ -73,21 +110,94 @@ public:
 
     void take_snapshot(WorkItem const& wi)
     {
-        wi.stream->with_most_recent_buffer_do([this](mir::graphics::Buffer& buffer) {
-            pixels->fill_from(buffer);
-        });
-
-        wi.snapshot_taken(
-            ms::Snapshot{pixels->size(),
-                     pixels->stride(),
-                     pixels->as_argb_8888()});
+        bool const asynchronous{reader && reader->is_asynchronous() && !thumbnail_size.is_set()};
+
+        /*
+         * Waiting for a slot can complete an earlier read, and delivering
+         * that evicts from the cache. So only look up our entry after it.
+         */
+        if (asynchronous)
+            reader->wait_for_slot();
+
+        // Until stored, our entry has no stream, so would otherwise count as expired
+        snapshotting = wi.stream.get();
+        auto const done_snapshotting = raii::paired_calls([]{}, [this]{ snapshotting = nullptr; });
+
+        auto& cached = cache[wi.stream.get()];
+        cached.last_used = ++snapshots_taken;
+
+        /*
+         * Buffers are reused by clients, so the id alone doesn't identify the
+         * content. The submission count is read first so that, if the stream
+         * advances meanwhile, we err on the side of another readback.
+         */
+        auto const submission = wi.stream->submission_count();
+
+        /*
+         * The stream is locked while we have its buffer, so rather than wait
+         * for the GPU there we only issue the read, and deliver it later.
+         */
+        if (asynchronous)
+        {
+            bool reading{false};
+            wi.stream->with_most_recent_buffer_do([&, this](mg::Buffer& buffer)
+                {
+                    if (is_current(cached, wi.stream, buffer.id(), submission))
+                        return;
+
+                    auto const buffer_id = buffer.id();
+                    reader->read(buffer, [this, wi, buffer_id, submission](ms::Snapshot const& snapshot)
+                        {
+                            store(
+                                cache[wi.stream.get()], wi.stream, buffer_id, submission,
+                                snapshot.size, snapshot.stride, static_cast<char const*>(snapshot.pixels));
+                            deliver(wi);
+                        });
+                    reading = true;
+                });
+
+            if (!reading)
+                deliver(wi);
+            return;
+        }
+
+        wi.stream->with_most_recent_buffer_do([&, this](mg::Buffer& buffer)
+            {
+                if (is_current(cached, wi.stream, buffer.id(), submission))
+                    return;
+
+                if (thumbnail_size.is_set())
+                    pixels->fill_scaled_from(buffer, thumbnail_size.value());
+                else
+                    pixels->fill_from(buffer);
+
+                store(
+                    cached, wi.stream, buffer.id(), submission,
+                    pixels->size(), pixels->stride(), static_cast<char const*>(pixels->as_argb_8888()));
+            });
+
+        deliver(wi);
     }
 
-    void schedule_snapshot(WorkItem const& wi)
+    void schedule_snapshot(
+        std::shared_ptr<compositor::BufferStream> const& stream,
+        SnapshotCallback const& snapshot_taken)
     {
         std::lock_guard<std::mutex> lg{work_mutex};
-        work.push_back(wi);
-        work_cv.notify_one();
+
+        // Any snapshot already queued for the stream will do for this request too
+        auto const queued = std::find_if(work.begin(), work.end(),
+            [&](WorkItem const& wi) { return wi.stream == stream; });
+
+        if (queued != work.end())
+        {
+            queued->snapshots_taken.push_back(snapshot_taken);
+        }
+        else
+        {
+            work.push_back(WorkItem{stream, {snapshot_taken}});
+            work_cv.notify_one();
+        }
     }
 
     void stop()
@@ -98,20 +208,108 @@ public:
     }
 
 private:
+    static bool is_current(
+        CachedSnapshot const& cached,
+        std::shared_ptr<compositor::BufferStream> const& stream,
+        mg::BufferID buffer_id,
+        uint64_t submission)
+    {
+        return cached.stream.lock() == stream &&
+            cached.buffer_id == buffer_id &&
+            cached.submission == submission;
+    }
+
+    void store(
+        CachedSnapshot& cached,
+        std::shared_ptr<compositor::BufferStream> const& stream,
+        mg::BufferID buffer_id,
+        uint64_t submission,
+        geom::Size size,
+        geom::Stride stride,
+        char const* data)
+    {
+        auto const length = stride.as_uint32_t() * size.height.as_uint32_t();
+
+        cached_bytes -= cached.pixels.size();
+        cached.stream = stream;
+        cached.buffer_id = buffer_id;
+        cached.submission = submission;
+        cached.size = size;
+        cached.stride = stride;
+        cached.pixels.assign(data, data + length);
+        cached_bytes += cached.pixels.size();
+    }
+
+    void deliver(WorkItem const& wi)
+    {
+        auto const& cached = cache[wi.stream.get()];
+
+        for (auto const& snapshot_taken : wi.snapshots_taken)
+            snapshot_taken(ms::Snapshot{cached.size, cached.stride, cached.pixels.data()});
+
+        evict_from_cache(wi.stream.get());
+    }
+
+    /// Drops snapshots of streams that have gone, then least recently used ones while over budget
+    void evict_from_cache(compositor::BufferStream const* keep)
+    {
+        for (auto i = cache.begin(); i != cache.end();)
+        {
+            if (i->second.stream.expired() && i->first != snapshotting)
+            {
+                cached_bytes -= i->second.pixels.size();
+                i = cache.erase(i);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        while (cached_bytes > cache_budget)
+        {
+            auto lru = cache.end();
+            for (auto i = cache.begin(); i != cache.end(); ++i)
+            {
+                if (i->first != keep && i->first != snapshotting && (lru == cache.end() || i->second.last_used < lru->second.last_used))
+                    lru = i;
+            }
+
+            if (lru == cache.end())
+                break;
+
+            cached_bytes -= lru->second.pixels.size();
+            cache.erase(lru);
+        }
+    }
+
     bool running;
     std::shared_ptr<PixelBuffer> const pixels;
+    std::shared_ptr<AsyncGLPixelReader> const reader;
+    optional_value<geom::Size> const thumbnail_size;
     std::mutex work_mutex;
     std::condition_variable work_cv;
     std::deque<WorkItem> work;
+
+    /* Only touched by the snapshot thread */
+    size_t const cache_budget;
+    size_t cached_bytes;
+    uint64_t snapshots_taken;
+    compositor::BufferStream const* snapshotting{nullptr};  ///< Whose entry mustn't be evicted
+    std::unordered_map<compositor::BufferStream const*, CachedSnapshot> cache;
 };
 
 }
 }
 
 ms::ThreadedSnapshotStrategy::ThreadedSnapshotStrategy(
-    std::shared_ptr<PixelBuffer> const& pixels)
+    std::shared_ptr<PixelBuffer> const& pixels,
+    optional_value<geometry::Size> const& thumbnail_size,
+    size_t cache_budget,
+    std::shared_ptr<AsyncGLPixelReader> const& reader)
     : pixels{pixels},
-      functor{new SnapshottingFunctor{pixels}},
+      reader{reader},
+      functor{new SnapshottingFunctor{pixels, reader, thumbnail_size, cache_budget}},
       thread{std::ref(*functor)}
 {
 }
@@ -126,5 +324,5 @@ void ms::ThreadedSnapshotStrategy::take_snapshot_of(
     std::shared_ptr<compositor::BufferStream> const& surface_buffer_access,
     SnapshotCallback const& snapshot_taken)
 {
-    functor->schedule_snapshot(WorkItem{surface_buffer_access, snapshot_taken});
+    functor->schedule_snapshot(surface_buffer_access, snapshot_taken);
 }
@@ -20,6 +20,8 @@
 #define MIR_SCENE_THREADED_SNAPSHOT_STRATEGY_H_
 
 #include "snapshot_strategy.h"
+#include "mir/geometry/size.h"
+#include "mir/optional_value.h"
 
 #include <memory>
 #include <thread>
@@ -30,12 +32,38 @@ namespace mir
 namespace scene
 {
 class PixelBuffer;
+class AsyncGLPixelReader;
 class SnapshottingFunctor;
 
+/**
+ * Takes snapshots on a dedicated thread.
+ *
+ * Requests for a stream that is already queued share its snapshot, and a
+ * stream that hasn't submitted a new buffer since it was last snapshotted is
+ * served from a cache without reading the buffer back again.
+ *
+ * Given an AsyncGLPixelReader, full size snapshots are read back through it
+ * so that the stream isn't held while the GPU finishes the copy; the
+ * PixelBuffer is then only used for thumbnails.
+ */
 class ThreadedSnapshotStrategy : public SnapshotStrategy
 {
 public:
-    ThreadedSnapshotStrategy(std::shared_ptr<PixelBuffer> const& pixels);
+    static size_t const default_cache_budget = 64 * 1024 * 1024;
+
+    /**
+     * \param [in] pixels         used to read back the contents of buffers
+     * \param [in] thumbnail_size if set, snapshots are scaled down to fit within it
+     * \param [in] cache_budget   the most memory (in bytes) to keep snapshots of
+     *                            unchanged streams in
+     * \param [in] reader         if set, used instead of pixels to read back
+     *                            full size snapshots without blocking the stream
+     */
+    ThreadedSnapshotStrategy(
+        std::shared_ptr<PixelBuffer> const& pixels,
+        optional_value<geometry::Size> const& thumbnail_size = {},
+        size_t cache_budget = default_cache_budget,
+        std::shared_ptr<AsyncGLPixelReader> const& reader = {});
     ~ThreadedSnapshotStrategy() noexcept;
 
     void take_snapshot_of(
@@ -44,6 +72,7 @@ public:
 
 private:
     std::shared_ptr<PixelBuffer> const pixels;
+    std::shared_ptr<AsyncGLPixelReader> const reader;
     std::unique_ptr<SnapshottingFunctor> functor;
     std::thread thread;
 };
@@ -75,7 +75,7 @@ auto mir::DefaultServerConfiguration::the_decoration_manager() -> std::shared_pt
                 return std::make_shared<msd::NullManager>();
             else
                 return std::make_shared<msd::BasicManager>(
-                    [buffer_allocator = the_buffer_allocator(),
+                    [buffer_allocator = the_recycling_buffer_allocator(),
                      executor = the_main_loop(),
                      cursor_images = the_cursor_images()](
                         std::shared_ptr<shell::Shell> const& shell,
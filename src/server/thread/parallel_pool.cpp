@@ -0,0 +1,136 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mir/thread/parallel_pool.h"
+#include "mir/thread_name.h"
+
+#include <atomic>
+#include <exception>
+
+namespace mt = mir::thread;
+
+struct mt::ParallelPool::Loop
+{
+    Loop(size_t count, std::function<void(size_t)> const& work) : count{count}, work{work} {}
+
+    size_t const count;
+    std::function<void(size_t)> const& work;
+    std::atomic<size_t> next{0};
+
+    // Guarded by the pool's mutex
+    size_t finished{0};
+    unsigned helping{0};
+    std::exception_ptr error;
+};
+
+mt::ParallelPool::ParallelPool(unsigned helpers)
+{
+    for (auto i = 0u; i != helpers; ++i)
+        this->helpers.emplace_back([this] { help(); });
+}
+
+mt::ParallelPool::~ParallelPool()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stopping = true;
+    }
+    loops_available.notify_all();
+
+    for (auto& helper : helpers)
+        helper.join();
+}
+
+auto mt::ParallelPool::helper_count() const -> unsigned
+{
+    return helpers.size();
+}
+
+void mt::ParallelPool::for_each(size_t count, std::function<void(size_t)> const& work)
+{
+    if (count < 2 || helpers.empty())
+    {
+        for (size_t i = 0; i != count; ++i)
+            work(i);
+        return;
+    }
+
+    Loop loop{count, work};
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        loops.push_back(&loop);
+    }
+    loops_available.notify_all();
+
+    work_through(loop);
+
+    std::unique_lock<std::mutex> lock{mutex};
+    loops.remove(&loop);
+    loop_finished.wait(lock, [&] { return loop.finished == loop.count && loop.helping == 0; });
+
+    if (loop.error)
+        std::rethrow_exception(loop.error);
+}
+
+void mt::ParallelPool::work_through(Loop& loop)
+{
+    size_t finished = 0;
+    std::exception_ptr error;
+
+    for (size_t i; (i = loop.next++) < loop.count; ++finished)
+    {
+        try
+        {
+            loop.work(i);
+        }
+        catch (...)
+        {
+            if (!error)
+                error = std::current_exception();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock{mutex};
+    loop.finished += finished;
+    if (error && !loop.error)
+        loop.error = error;
+}
+
+void mt::ParallelPool::help()
+{
+    mir::set_thread_name("Mir/Parallel");
+
+    std::unique_lock<std::mutex> lock{mutex};
+    for (;;)
+    {
+        loops_available.wait(lock, [this] { return stopping || !loops.empty(); });
+        if (stopping)
+            return;
+
+        // The loop can't finish (and be destroyed) while we're helping
+        auto const loop = loops.front();
+        ++loop->helping;
+
+        lock.unlock();
+        work_through(*loop);
+        lock.lock();
+
+        // Everything has been claimed, so there's no more to help with
+        loops.remove(loop);
+        --loop->helping;
+        loop_finished.notify_all();
+    }
+}
@@ -25,6 +25,8 @@
 #include "mir/input/mir_touchpad_config.h"
 #include "mir/input/mir_input_config.h"
 #include "mir/input/input_device.h"
+#include "mir/input/input_device_hub.h"
+#include "mir/input/device.h"
 #include "mir/input/touchscreen_settings.h"
 
 #include "mir_test_framework/headless_in_process_server.h"
@@ -54,6 +56,7 @@
 #include <chrono>
 #include <atomic>
 #include <mutex>
+#include <thread>
 
 namespace mi = mir::input;
 namespace mt = mir::test;
@@ -867,6 +870,53 @@ TEST_F(TestClientInputKeyRepeat, keys_are_repeated_to_clients)
     first_client.all_events_received.wait_for(10s);
 }
 
+namespace
+{
+struct TestClientInputKeyRepeatWithLatencyReport : public TestClientInputKeyRepeat
+{
+    TestClientInputKeyRepeatWithLatencyReport()
+        : input_latency_report("MIR_SERVER_INPUT_LATENCY_REPORT", "log")
+    {
+    }
+    mtf::TemporaryEnvironmentValue input_latency_report;
+};
+}
+
+// lp:1675357 with the key repeater wrapped by the latency recorder
+TEST_F(TestClientInputKeyRepeatWithLatencyReport, key_repeat_stops_when_keyboard_is_removed)
+{
+    Client first_client(new_connection(), first);
+
+    std::atomic<int> repeats{0};
+    EXPECT_CALL(first_client, handle_input(mt::KeyDownEvent()));
+    EXPECT_CALL(first_client, handle_input(mt::KeyRepeatEvent()))
+        .WillOnce(DoAll(InvokeWithoutArgs([&]{ ++repeats; }), mt::WakeUp(&first_client.all_events_received)))
+        .WillRepeatedly(InvokeWithoutArgs([&]{ ++repeats; }));
+
+    fake_keyboard->emit_event(mis::a_key_down_event().of_scancode(KEY_RIGHTSHIFT));
+    ASSERT_TRUE(first_client.all_events_received.wait_for(10s));
+
+    fake_keyboard.reset();
+
+    auto const hub = server.the_input_device_hub();
+    ASSERT_TRUE(mt::spin_wait_for_condition_or_timeout(
+        [&]
+        {
+            bool keyboard_present = false;
+            hub->for_each_input_device(
+                [&](mi::Device const& device) { keyboard_present |= device.unique_id() == keyboard_unique_id; });
+            return !keyboard_present;
+        },
+        10s));
+
+    // Let repeats already on their way drain, then expect no more
+    std::this_thread::sleep_for(200ms);
+    repeats = 0;
+    std::this_thread::sleep_for(500ms);
+
+    EXPECT_THAT(repeats.load(), Eq(0));
+}
+
 TEST_F(TestClientInput, pointer_events_pass_through_shaped_out_regions_of_client)
 {
     positions[first] = {{0, 0}, {10, 10}};
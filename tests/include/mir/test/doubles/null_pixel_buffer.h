@@ -31,6 +31,7 @@ namespace doubles
 struct NullPixelBuffer : public scene::PixelBuffer
 {
     void fill_from(graphics::Buffer&) {}
+    void fill_scaled_from(graphics::Buffer&, geometry::Size) {}
     void const* as_argb_8888() { return nullptr; }
     geometry::Size size() const { return {}; }
     geometry::Stride stride() const { return {}; }
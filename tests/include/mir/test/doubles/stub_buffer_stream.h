@@ -63,7 +63,11 @@ public:
     void drop_old_buffers() override {}
     void submit_buffer(std::shared_ptr<graphics::Buffer> const& b) override
     {
-        if (b) ++nready;
+        if (b)
+        {
+            ++nready;
+            ++nsubmitted;
+        }
     }
     void with_most_recent_buffer_do(std::function<void(graphics::Buffer&)> const& fn) override
     {
@@ -72,10 +76,12 @@ public:
     MirPixelFormat pixel_format() const override { return mir_pixel_format_abgr_8888; }
     void set_frame_posted_callback(std::function<void(geometry::Size const&)> const&) override {}
     bool has_submitted_buffer() const override { return true; }
+    uint64_t submission_count() const override { return nsubmitted; }
     void set_scale(float) override {}
 
     std::shared_ptr<graphics::Buffer> stub_compositor_buffer;
     int nready = 0;
+    uint64_t nsubmitted = 0;
 };
 
 }
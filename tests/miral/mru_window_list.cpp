@@ -68,6 +68,10 @@ struct MRUWindowList : testing::Test
     miral::Window window_b{app, stub_session->surfaces[1]};
     miral::Window window_c{app, stub_session->surfaces[2]};
 
+    std::shared_ptr<StubSession> const other_session{std::make_shared<StubSession>(1)};
+    miral::Application other_app{other_session};
+    miral::Window other_window{other_app, other_session->surfaces[0]};
+
     void hide_window(int window_id)
     {
         stub_session->surfaces[window_id]->visible_ = false;
@@ -189,3 +193,36 @@ TEST_F(MRUWindowList, hiding_then_showing_windows_retains_order)
     EXPECT_THAT(as_enumerated, ElementsAre(window_c, window_b, window_a));
 }
 
+
+TEST_F(MRUWindowList, enumerating_an_application_visits_only_its_windows_in_mru_order)
+{
+    mru_list.push(window_a);
+    mru_list.push(other_window);
+    mru_list.push(window_b);
+    mru_list.push(window_a);
+
+    std::vector<miral::Window> as_enumerated;
+
+    mru_list.enumerate(app, [&](miral::Window& window)
+       { as_enumerated.push_back(window); return true; });
+
+    EXPECT_THAT(as_enumerated, ElementsAre(window_a, window_b));
+}
+
+TEST_F(MRUWindowList, an_erased_window_is_not_enumerated_for_its_application)
+{
+    mru_list.push(window_a);
+    mru_list.push(window_b);
+    mru_list.push(other_window);
+    mru_list.erase(window_b);
+    mru_list.erase(other_window);
+
+    std::vector<miral::Window> as_enumerated;
+
+    mru_list.enumerate(app, [&](miral::Window& window)
+       { as_enumerated.push_back(window); return true; });
+    mru_list.enumerate(other_app, [&](miral::Window& window)
+       { as_enumerated.push_back(window); return true; });
+
+    EXPECT_THAT(as_enumerated, ElementsAre(window_a));
+}
@@ -230,3 +230,30 @@ TEST_F(OutputUpdates, maximized_window_moved_when_its_output_disconnected)
     ASSERT_THAT(window.top_left(), Eq(display_area_a.top_left));
     ASSERT_THAT(window.size(), Eq(display_area_a.size));
 }
+
+TEST_F(OutputUpdates, maximized_window_not_moved_when_another_output_updated)
+{
+    Rectangle const display_area_c{{620, 0}, {1024, 768}};
+    auto display_config_a_b = create_fake_display_configuration({display_area_a, display_area_b});
+    auto display_config_a_c = create_fake_display_configuration({display_area_a, display_area_c});
+    notify_configuration_applied(display_config_a_b);
+
+    mir::scene::SurfaceCreationParameters creation_parameters;
+    creation_parameters.type = mir_window_type_normal;
+    creation_parameters.state = mir_window_state_maximized;
+    creation_parameters.output_id = mir::graphics::DisplayConfigurationOutputId{1};
+
+    Window window = create_window(creation_parameters);
+
+    ASSERT_THAT(window.top_left(), Eq(display_area_a.top_left));
+    ASSERT_THAT(window.size(), Eq(display_area_a.size));
+
+    EXPECT_CALL(*window_manager_policy, advise_move_to(_, _)).Times(0);
+    EXPECT_CALL(*window_manager_policy, advise_resize(_, _)).Times(0);
+
+    notify_configuration_applied(display_config_a_c);
+    Mock::VerifyAndClearExpectations(window_manager_policy);
+
+    ASSERT_THAT(window.top_left(), Eq(display_area_a.top_left));
+    ASSERT_THAT(window.size(), Eq(display_area_a.size));
+}
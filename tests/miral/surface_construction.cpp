@@ -0,0 +1,111 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_window_manager_tools.h"
+#include "mir/test/doubles/stub_surface.h"
+
+#include <future>
+
+using namespace miral;
+using namespace testing;
+namespace mt = mir::test;
+namespace mtd = mir::test::doubles;
+
+namespace
+{
+Rectangle const display_area{{0, 0}, {1280, 720}};
+
+struct SurfaceConstruction : mt::TestWindowManagerTools
+{
+    void SetUp() override
+    {
+        notify_configuration_applied(create_fake_display_configuration({display_area}));
+        basic_window_manager.add_session(session);
+    }
+
+    mir::scene::SurfaceCreationParameters const creation_parameters;
+};
+
+struct CloseRecordingSurface : mtd::StubSurface
+{
+    void request_client_surface_close() override { close_requested = true; }
+
+    bool close_requested{false};
+};
+}
+
+TEST_F(SurfaceConstruction, window_management_is_not_locked_while_surface_is_built)
+{
+    auto const build = [this](
+        std::shared_ptr<mir::scene::Session> const& session,
+        mir::scene::SurfaceCreationParameters const& params)
+        {
+            auto locked = std::async(std::launch::async, [this] { basic_window_manager.invoke_under_lock([]{}); });
+
+            EXPECT_THAT(locked.wait_for(std::chrono::seconds{5}), Eq(std::future_status::ready));
+            return create_surface(session, params);
+        };
+
+    EXPECT_CALL(*window_manager_policy, advise_new_window(_));
+
+    basic_window_manager.add_surface(session, creation_parameters, build);
+}
+
+TEST_F(SurfaceConstruction, surface_built_after_its_session_is_removed_is_not_managed)
+{
+    auto const build = [this](
+        std::shared_ptr<mir::scene::Session> const& session,
+        mir::scene::SurfaceCreationParameters const& params)
+        {
+            basic_window_manager.remove_session(session);
+            return create_surface(session, params);
+        };
+
+    EXPECT_CALL(*window_manager_policy, advise_new_window(_)).Times(0);
+
+    auto const surface = basic_window_manager.add_surface(session, creation_parameters, build);
+
+    EXPECT_THAT(surface, NotNull());
+    EXPECT_THAT(basic_window_manager.count_applications(), Eq(0u));
+}
+
+TEST_F(SurfaceConstruction, child_whose_parent_is_removed_while_it_is_built_is_asked_to_close)
+{
+    Window parent;
+    EXPECT_CALL(*window_manager_policy, advise_new_window(_))
+        .WillOnce(Invoke([&parent](WindowInfo const& window_info){ parent = window_info.window(); }))
+        .WillOnce(Invoke([](WindowInfo const& window_info){ EXPECT_FALSE(window_info.parent()); }));
+
+    basic_window_manager.add_surface(session, creation_parameters, &create_surface);
+
+    mir::scene::SurfaceCreationParameters child_parameters;
+    child_parameters.type = mir_window_type_menu;
+    child_parameters.parent = parent;
+    child_parameters.size = {100, 100};
+
+    auto const child = std::make_shared<CloseRecordingSurface>();
+    auto const build = [this, &parent, &child](
+        std::shared_ptr<mir::scene::Session> const& session,
+        mir::scene::SurfaceCreationParameters const&) -> std::shared_ptr<mir::scene::Surface>
+        {
+            basic_window_manager.remove_surface(session, parent);
+            return child;
+        };
+
+    basic_window_manager.add_surface(session, child_parameters, build);
+
+    EXPECT_TRUE(child->close_requested);
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/client/rpc/stream_socket_transport.h"
+#include "mir/fd_socket_transmission.h"
+#include "mir/fd.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace mclr = mir::client::rpc;
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+struct StreamTransport : Test
+{
+    StreamTransport()
+    {
+        int socket_fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, socket_fds) != 0)
+            throw std::system_error(errno, std::system_category(), "Failed to create socketpair");
+
+        server = mir::Fd{socket_fds[0]};
+        transport = std::make_unique<mclr::StreamSocketTransport>(mir::Fd{socket_fds[1]});
+    }
+
+    void send(std::string const& data)
+    {
+        ASSERT_THAT(::send(server, data.data(), data.size(), MSG_NOSIGNAL), Eq(static_cast<ssize_t>(data.size())));
+    }
+
+    std::string receive(size_t size)
+    {
+        std::string data(size, '\0');
+        transport->receive_data(&data[0], size);
+        return data;
+    }
+
+    /// A pipe whose read end is sent; reading it back identifies the fd
+    mir::Fd pipe_containing(char tag)
+    {
+        int pipe_fds[2];
+        if (pipe(pipe_fds) != 0)
+            throw std::system_error(errno, std::system_category(), "Failed to create pipe");
+
+        mir::Fd const read_end{pipe_fds[0]}, write_end{pipe_fds[1]};
+        EXPECT_THAT(write(write_end, &tag, 1), Eq(1));
+        return read_end;
+    }
+
+    static char tag_of(mir::Fd const& fd)
+    {
+        char tag{0};
+        EXPECT_THAT(read(fd, &tag, 1), Eq(1));
+        return tag;
+    }
+
+    mir::Fd server;
+    std::unique_ptr<mclr::StreamSocketTransport> transport;
+};
+}
+
+TEST_F(StreamTransport, reads_data_that_arrives_in_pieces)
+{
+    send("head");
+
+    std::thread writer{[this]
+        {
+            std::this_thread::sleep_for(10ms);
+            send("tail");
+        }};
+
+    EXPECT_THAT(receive(8), Eq("headtail"));
+    writer.join();
+}
+
+TEST_F(StreamTransport, serves_a_batch_of_messages_from_one_read)
+{
+    send("firstsecond");
+
+    EXPECT_THAT(receive(5), Eq("first"));
+    EXPECT_THAT(transport->bytes_buffered(), Eq(6u));
+    EXPECT_THAT(receive(6), Eq("second"));
+    EXPECT_THAT(transport->bytes_buffered(), Eq(0u));
+}
+
+TEST_F(StreamTransport, receives_fds_with_the_byte_they_were_sent_with)
+{
+    send("before");
+    mir::send_fds(server, {pipe_containing('a'), pipe_containing('b')});
+    send("after");
+
+    EXPECT_THAT(receive(6), Eq("before"));
+
+    char dummy;
+    std::vector<mir::Fd> fds(2);
+    transport->receive_data(&dummy, 1, fds);
+    EXPECT_THAT(tag_of(fds[0]), Eq('a'));
+    EXPECT_THAT(tag_of(fds[1]), Eq('b'));
+
+    EXPECT_THAT(receive(5), Eq("after"));
+}
+
+TEST_F(StreamTransport, keeps_fds_of_batched_messages_with_their_message)
+{
+    send("one");
+    mir::send_fds(server, {pipe_containing('1')});
+    send("two");
+    mir::send_fds(server, {pipe_containing('2')});
+
+    char dummy;
+    std::vector<mir::Fd> fds(1);
+
+    EXPECT_THAT(receive(3), Eq("one"));
+    transport->receive_data(&dummy, 1, fds);
+    EXPECT_THAT(tag_of(fds[0]), Eq('1'));
+
+    EXPECT_THAT(receive(3), Eq("two"));
+    transport->receive_data(&dummy, 1, fds);
+    EXPECT_THAT(tag_of(fds[0]), Eq('2'));
+}
+
+TEST_F(StreamTransport, rejects_fds_sent_with_data_that_expects_none)
+{
+    mir::send_fds(server, {pipe_containing('x')});
+    send("next");
+
+    char dummy;
+    EXPECT_THROW(transport->receive_data(&dummy, 1), std::runtime_error);
+
+    // The stray fds are dropped rather than handed to a later reader
+    std::vector<mir::Fd> fds(1);
+    EXPECT_THROW(transport->receive_data(&dummy, 1, fds), std::runtime_error);
+}
+
+TEST_F(StreamTransport, rejects_more_fds_than_expected)
+{
+    mir::send_fds(server, {pipe_containing('a'), pipe_containing('b')});
+
+    char dummy;
+    std::vector<mir::Fd> fds(1);
+    EXPECT_THROW(transport->receive_data(&dummy, 1, fds), std::runtime_error);
+}
+
+TEST_F(StreamTransport, rejects_fewer_fds_than_expected)
+{
+    mir::send_fds(server, {pipe_containing('a')});
+
+    char dummy;
+    std::vector<mir::Fd> fds(2);
+    EXPECT_THROW(transport->receive_data(&dummy, 1, fds), std::runtime_error);
+}
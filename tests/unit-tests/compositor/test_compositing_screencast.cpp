@@ -375,6 +375,29 @@ TEST_F(CompositingScreencastTest, allocates_and_uses_buffer_with_provided_size)
     ASSERT_EQ(&stub_buffer, buffer.get());
 }
 
+TEST_F(CompositingScreencastTest, allocates_buffers_with_requested_usage)
+{
+    using namespace testing;
+
+    MockBufferAllocator mock_buffer_allocator;
+    mtd::StubGLBuffer stub_buffer;
+
+    EXPECT_CALL(mock_buffer_allocator,
+                alloc_buffer(Field(&mg::BufferProperties::usage, Eq(mg::BufferUsage::software))))
+        .WillOnce(Return(mt::fake_shared(stub_buffer)));
+
+    mc::CompositingScreencast screencast_local{
+        mt::fake_shared(stub_scene),
+        mt::fake_shared(stub_display),
+        mt::fake_shared(mock_buffer_allocator),
+        mt::fake_shared(stub_db_compositor_factory),
+        mg::BufferUsage::software};
+
+    screencast_local.create_session(
+        default_region, default_size, default_pixel_format,
+        1, default_mirror_mode);
+}
+
 TEST_F(CompositingScreencastTest, allocates_different_buffers_per_session)
 {
     using namespace testing;
@@ -0,0 +1,200 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mir/compositor/frame_timing_recorder.h"
+
+#include "mir/test/doubles/advanceable_clock.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <sstream>
+
+namespace mc = mir::compositor;
+namespace mg = mir::graphics;
+namespace mtd = mir::test::doubles;
+
+using namespace std::chrono;
+using namespace testing;
+
+namespace
+{
+struct FrameTimingRecorder : Test
+{
+    void spend(mc::FrameStage stage, milliseconds time, mg::Renderable::ID surface = nullptr)
+    {
+        mc::FrameTimingRecorder::StageTimer const timer{stage, surface};
+        clock->advance_by(time);
+    }
+
+    std::shared_ptr<mtd::AdvanceableClock> const clock{std::make_shared<mtd::AdvanceableClock>()};
+    std::vector<mc::FrameTiming> missed;
+    mc::FrameTimingRecorder recorder{
+        clock,
+        milliseconds{16},
+        [this](mc::FrameTimingRecorder const&, mc::FrameTiming const& frame) { missed.push_back(frame); },
+        4};
+
+    int const surface_a{0};
+    int const surface_b{0};
+};
+}
+
+TEST_F(FrameTimingRecorder, records_time_in_each_stage)
+{
+    recorder.begin_frame();
+    {
+        mc::FrameTimingRecorder::Scope const scope{&recorder};
+        spend(mc::FrameStage::scene_snapshot, milliseconds{1});
+        spend(mc::FrameStage::occlusion, milliseconds{2});
+    }
+    recorder.record(mc::FrameStage::post, milliseconds{3});
+    recorder.end_frame();
+
+    auto const history = recorder.history();
+    ASSERT_THAT(history.size(), Eq(1u));
+    EXPECT_THAT(history[0].stage_time[static_cast<size_t>(mc::FrameStage::scene_snapshot)], Eq(milliseconds{1}));
+    EXPECT_THAT(history[0].stage_time[static_cast<size_t>(mc::FrameStage::occlusion)], Eq(milliseconds{2}));
+    EXPECT_THAT(history[0].stage_time[static_cast<size_t>(mc::FrameStage::post)], Eq(milliseconds{3}));
+    EXPECT_FALSE(history[0].missed_deadline);
+    EXPECT_THAT(missed, IsEmpty());
+}
+
+TEST_F(FrameTimingRecorder, stage_timers_without_scope_record_nothing)
+{
+    recorder.begin_frame();
+    spend(mc::FrameStage::occlusion, milliseconds{20});
+    recorder.end_frame();
+
+    EXPECT_THAT(recorder.history()[0].stage_time[static_cast<size_t>(mc::FrameStage::occlusion)],
+        Eq(milliseconds{0}));
+}
+
+TEST_F(FrameTimingRecorder, nested_stage_time_is_excluded_from_enclosing_stage)
+{
+    recorder.begin_frame();
+    {
+        mc::FrameTimingRecorder::Scope const scope{&recorder};
+        mc::FrameTimingRecorder::StageTimer const draw{mc::FrameStage::gl_submission, &surface_a};
+        clock->advance_by(milliseconds{1});
+        spend(mc::FrameStage::texture_binding, milliseconds{5}, &surface_a);
+    }
+    recorder.end_frame();
+
+    auto const frame = recorder.history()[0];
+    EXPECT_THAT(frame.stage_time[static_cast<size_t>(mc::FrameStage::gl_submission)], Eq(milliseconds{1}));
+    EXPECT_THAT(frame.stage_time[static_cast<size_t>(mc::FrameStage::texture_binding)], Eq(milliseconds{5}));
+}
+
+TEST_F(FrameTimingRecorder, attributes_missed_deadline_to_slowest_stage_and_surface)
+{
+    recorder.begin_frame();
+    {
+        mc::FrameTimingRecorder::Scope const scope{&recorder};
+        spend(mc::FrameStage::occlusion, milliseconds{2});
+        spend(mc::FrameStage::texture_binding, milliseconds{3}, &surface_a);
+        spend(mc::FrameStage::texture_binding, milliseconds{9}, &surface_b);
+        spend(mc::FrameStage::gl_submission, milliseconds{4}, &surface_a);
+    }
+    recorder.end_frame();
+
+    ASSERT_THAT(missed.size(), Eq(1u));
+    EXPECT_TRUE(missed[0].missed_deadline);
+    EXPECT_THAT(missed[0].blamed_stage, Eq(mc::FrameStage::texture_binding));
+    EXPECT_THAT(missed[0].blamed_surface, Eq(&surface_b));
+    EXPECT_THAT(missed[0].blamed_surface_time, Eq(milliseconds{9}));
+    EXPECT_THAT(recorder.missed_deadlines(), Eq(1u));
+}
+
+TEST_F(FrameTimingRecorder, keeps_only_most_recent_frames)
+{
+    for (auto i = 0; i != 6; ++i)
+    {
+        recorder.begin_frame();
+        recorder.end_frame();
+    }
+
+    auto const history = recorder.history();
+    ASSERT_THAT(history.size(), Eq(4u));
+    EXPECT_THAT(history.front().frame_number, Eq(3u));
+    EXPECT_THAT(history.back().frame_number, Eq(6u));
+}
+
+TEST_F(FrameTimingRecorder, dump_marks_missed_frames)
+{
+    recorder.begin_frame();
+    clock->advance_by(milliseconds{20});
+    recorder.end_frame();
+
+    std::stringstream out;
+    recorder.dump(out);
+
+    EXPECT_THAT(out.str(), HasSubstr("frame=1 total=20.00"));
+    EXPECT_THAT(out.str(), HasSubstr("MISSED"));
+}
+
+TEST_F(FrameTimingRecorder, frame_started_just_after_a_flip_has_until_the_next_vblank)
+{
+    clock->advance_by(milliseconds{1});
+    auto const vblank = clock->now();
+    clock->advance_by(milliseconds{1});
+
+    recorder.begin_frame();
+    {
+        mc::FrameTimingRecorder::Scope const scope{&recorder};
+        spend(mc::FrameStage::gl_submission, milliseconds{2});
+    }
+    // post() waits for the next flip before returning
+    clock->advance_by(milliseconds{14});
+    recorder.record(mc::FrameStage::post, milliseconds{1});
+    recorder.end_frame(vblank + milliseconds{16});
+
+    EXPECT_FALSE(recorder.history()[0].missed_deadline);
+    EXPECT_THAT(recorder.history()[0].deadline, Eq(vblank + milliseconds{32}));
+    EXPECT_THAT(missed, IsEmpty());
+}
+
+TEST_F(FrameTimingRecorder, frames_are_judged_against_the_vblank_after_they_started)
+{
+    clock->advance_by(milliseconds{1});
+    auto const vblank = clock->now();
+    clock->advance_by(milliseconds{10});
+
+    recorder.begin_frame();
+    {
+        mc::FrameTimingRecorder::Scope const scope{&recorder};
+        spend(mc::FrameStage::occlusion, milliseconds{8});
+    }
+    recorder.end_frame(vblank);
+
+    ASSERT_THAT(missed.size(), Eq(1u));
+    EXPECT_THAT(missed[0].deadline, Eq(vblank + milliseconds{16}));
+    EXPECT_THAT(missed[0].blamed_stage, Eq(mc::FrameStage::occlusion));
+}
+
+TEST_F(FrameTimingRecorder, deadline_stays_in_phase_with_an_old_vblank)
+{
+    clock->advance_by(milliseconds{1});
+    auto const vblank = clock->now();
+    clock->advance_by(milliseconds{100});
+
+    recorder.begin_frame();
+    clock->advance_by(milliseconds{10});
+    recorder.end_frame(vblank);
+
+    EXPECT_THAT(recorder.history()[0].deadline, Eq(vblank + milliseconds{112}));
+    EXPECT_FALSE(recorder.history()[0].missed_deadline);
+}
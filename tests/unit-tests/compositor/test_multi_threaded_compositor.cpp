@@ -22,6 +22,7 @@
 #include "mir/compositor/display_listener.h"
 #include "mir/compositor/display_buffer_compositor.h"
 #include "mir/compositor/scene.h"
+#include "mir/compositor/compositor_areas.h"
 #include "mir/compositor/display_buffer_compositor_factory.h"
 #include "mir/scene/observer.h"
 #include "mir/raii.h"
@@ -38,6 +39,7 @@
 
 #include <boost/throw_exception.hpp>
 
+#include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
 #include <thread>
@@ -154,6 +156,41 @@ private:
     bool throw_on_add_observer_;
 };
 
+class AreaRecordingScene : public StubScene, public mc::CompositorAreas
+{
+public:
+    void set_compositor_area(mc::CompositorID, geom::Rectangle const& area) override
+    {
+        std::lock_guard<std::mutex> lock{areas_mutex};
+        areas_given.push_back(area);
+    }
+
+    mc::SceneElementSequence scene_elements_for(mc::CompositorID) override
+    {
+        std::lock_guard<std::mutex> lock{areas_mutex};
+        if (!areas_given.empty())
+            snapshot_areas.push_back(areas_given.back());
+        return {};
+    }
+
+    auto given() -> std::vector<geom::Rectangle>
+    {
+        std::lock_guard<std::mutex> lock{areas_mutex};
+        return areas_given;
+    }
+
+    bool snapshotted_with(geom::Rectangle const& area)
+    {
+        std::lock_guard<std::mutex> lock{areas_mutex};
+        return std::find(snapshot_areas.begin(), snapshot_areas.end(), area) != snapshot_areas.end();
+    }
+
+private:
+    std::mutex areas_mutex;
+    std::vector<geom::Rectangle> areas_given;
+    std::vector<geom::Rectangle> snapshot_areas;  ///< The area the scene had at each snapshot
+};
+
 class RecordingDisplayBufferCompositor : public mc::DisplayBufferCompositor
 {
 public:
@@ -871,6 +908,48 @@ TEST(MultiThreadedCompositor, registers_and_unregisters_with_scene)
     compositor.stop();
 }
 
+TEST(MultiThreadedCompositor, tells_scene_when_a_view_area_changes_without_a_restart)
+{
+    using namespace testing;
+    geom::Rectangle const landscape{{0, 0}, {640, 480}};
+    geom::Rectangle const portrait{{0, 0}, {480, 640}};
+
+    std::mutex area_mutex;
+    auto area = landscape;
+
+    auto display = std::make_shared<StubDisplayWithMockBuffers>(1);
+    display->for_each_mock_buffer([&](mtd::MockDisplayBuffer& mock_buf)
+    {
+        ON_CALL(mock_buf, view_area())
+            .WillByDefault(Invoke([&]
+                {
+                    std::lock_guard<std::mutex> lock{area_mutex};
+                    return area;
+                }));
+    });
+    auto scene = std::make_shared<AreaRecordingScene>();
+    auto db_compositor_factory = std::make_shared<mtd::NullDisplayBufferCompositorFactory>();
+
+    mc::MultiThreadedCompositor compositor{
+        display, scene, db_compositor_factory, null_display_listener, null_report, default_delay, true};
+
+    compositor.start();
+    while (!scene->snapshotted_with(landscape))
+        std::this_thread::yield();
+
+    {
+        std::lock_guard<std::mutex> lock{area_mutex};
+        area = portrait;
+    }
+    scene->emit_change_event();
+    while (!scene->snapshotted_with(portrait))
+        std::this_thread::yield();
+
+    compositor.stop();
+
+    EXPECT_THAT(scene->given(), ElementsAre(landscape, portrait));
+}
+
 TEST(MultiThreadedCompositor, notifies_about_display_additions_and_removals)
 {
     using namespace testing;
@@ -893,6 +972,55 @@ TEST(MultiThreadedCompositor, notifies_about_display_additions_and_removals)
     compositor.stop();
 }
 
+TEST(MultiThreadedCompositor, stops_and_starts_compositing_to_a_single_display_sync_group)
+{
+    using namespace testing;
+    unsigned int const nbuffers{3};
+    auto display = std::make_shared<StubDisplayWithMockBuffers>(nbuffers);
+    auto stub_scene = std::make_shared<NiceMock<StubScene>>();
+    auto mock_display_listener = std::make_shared<NiceMock<MockDisplayListener>>();
+    auto db_compositor_factory = std::make_shared<mtd::NullDisplayBufferCompositorFactory>();
+
+    mc::MultiThreadedCompositor compositor{
+        display, stub_scene, db_compositor_factory, mock_display_listener, null_report, default_delay, true};
+
+    mg::DisplaySyncGroup* first_group{nullptr};
+    display->for_each_display_sync_group(
+        [&](mg::DisplaySyncGroup& group) { if (!first_group) first_group = &group; });
+
+    compositor.start();
+    Mock::VerifyAndClearExpectations(mock_display_listener.get());
+
+    EXPECT_CALL(*mock_display_listener, remove_display(_)).Times(1);
+    compositor.stop_compositing_to(*first_group);
+    Mock::VerifyAndClearExpectations(mock_display_listener.get());
+
+    EXPECT_CALL(*mock_display_listener, add_display(_)).Times(1);
+    compositor.start_compositing_to(*first_group);
+    Mock::VerifyAndClearExpectations(mock_display_listener.get());
+
+    EXPECT_CALL(*mock_display_listener, remove_display(_)).Times(nbuffers);
+    compositor.stop();
+}
+
+TEST(MultiThreadedCompositor, does_not_start_compositing_to_a_display_sync_group_while_stopped)
+{
+    using namespace testing;
+    unsigned int const nbuffers{3};
+    auto display = std::make_shared<StubDisplayWithMockBuffers>(nbuffers);
+    auto stub_scene = std::make_shared<NiceMock<StubScene>>();
+    auto mock_display_listener = std::make_shared<MockDisplayListener>();
+    auto db_compositor_factory = std::make_shared<mtd::NullDisplayBufferCompositorFactory>();
+
+    mc::MultiThreadedCompositor compositor{
+        display, stub_scene, db_compositor_factory, mock_display_listener, null_report, default_delay, true};
+
+    EXPECT_CALL(*mock_display_listener, add_display(_)).Times(0);
+
+    display->for_each_display_sync_group(
+        [&](mg::DisplaySyncGroup& group) { compositor.start_compositing_to(group); });
+}
+
 TEST(MultiThreadedCompositor, when_compositor_thread_fails_start_reports_error)
 {
     using namespace testing;
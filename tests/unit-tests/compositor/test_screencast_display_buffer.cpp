@@ -26,10 +26,15 @@
 #include "mir/test/doubles/mock_gl.h"
 #include "mir/test/doubles/stub_renderable.h"
 #include "mir/test/doubles/stub_display.h"
+#include "mir/test/doubles/stub_buffer.h"
+#include "mir/geometry/rectangles.h"
+#include "mir/graphics/buffer_properties.h"
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <cstring>
+
 namespace mc = mir::compositor;
 namespace mt = mir::test;
 namespace mtd = mir::test::doubles;
@@ -41,6 +46,35 @@ using namespace testing;
 namespace
 {
 
+/// A distinct value for each pixel the CPU draws
+auto pixel_at(int x, int y) -> uint32_t
+{
+    return 0xff000000u | (y << 8) | x;
+}
+
+/// Draws a frame of pixel_at() values and commits it, returning what was drawn
+auto cpu_draw_rows(mir::renderer::software::PixelTarget& target) -> std::vector<uint32_t>
+{
+    auto const size = target.size();
+    std::vector<uint32_t> drawn;
+    for (int y = 0; y != size.height.as_int(); ++y)
+    {
+        for (int x = 0; x != size.width.as_int(); ++x)
+            drawn.push_back(pixel_at(x, y));
+    }
+
+    memcpy(target.map_pixels(), drawn.data(), drawn.size() * sizeof drawn[0]);
+    target.commit(geom::Rectangles{{{0, 0}, size}});
+    return drawn;
+}
+
+auto written_pixels_of(mtd::StubBuffer const& buffer) -> std::vector<uint32_t>
+{
+    std::vector<uint32_t> pixels(buffer.written_pixels.size() / 4);
+    memcpy(pixels.data(), buffer.written_pixels.data(), pixels.size() * 4);
+    return pixels;
+}
+
 struct ScreencastDisplayBufferTest : testing::Test
 {
     void SetUp() override
@@ -236,3 +270,122 @@ TEST_F(ScreencastDisplayBufferTest, uses_requested_mirror_mode)
     EXPECT_THAT(db.transformation(), Eq(expected_transformation));
 }
 
+
+TEST_F(ScreencastDisplayBufferTest, writes_frame_drawn_by_cpu_into_software_buffer)
+{
+    geom::Rectangle const region{{100, 100}, {4, 3}};
+    mtd::StubBuffer software_buffer{
+        mg::BufferProperties{region.size, mir_pixel_format_argb_8888, mg::BufferUsage::software}};
+    mc::QueueingSchedule free_queue;
+    free_queue.schedule(mt::fake_shared(software_buffer));
+
+    mc::ScreencastDisplayBuffer db{region, region.size,
+                                   default_mirror_mode, free_queue,
+                                   ready_queue, stub_display};
+    mir::renderer::software::PixelTarget& target = db;
+
+    ASSERT_THAT(target.size(), Eq(region.size));
+    auto const pixels = cpu_draw_rows(target);
+
+    ASSERT_THAT(ready_queue.num_scheduled(), Eq(1u));
+    EXPECT_THAT(ready_queue.next_buffer(), Eq(mt::fake_shared(software_buffer)));
+    EXPECT_THAT(written_pixels_of(software_buffer), Eq(pixels));
+}
+
+TEST_F(ScreencastDisplayBufferTest, cpu_draws_whole_region_then_scales_it_into_buffer)
+{
+    geom::Rectangle const region{{100, 100}, {8, 6}};
+    geom::Size const buffer_size{4, 3};
+    mtd::StubBuffer software_buffer{
+        mg::BufferProperties{buffer_size, mir_pixel_format_argb_8888, mg::BufferUsage::software}};
+    mc::QueueingSchedule free_queue;
+    free_queue.schedule(mt::fake_shared(software_buffer));
+
+    mc::ScreencastDisplayBuffer db{region, buffer_size,
+                                   default_mirror_mode, free_queue,
+                                   ready_queue, stub_display};
+    mir::renderer::software::PixelTarget& target = db;
+
+    ASSERT_THAT(target.size(), Eq(region.size));
+    cpu_draw_rows(target);
+
+    // Every other row and column of the region
+    auto const written = written_pixels_of(software_buffer);
+    ASSERT_THAT(written.size(), Eq(12u));
+    for (int y = 0; y != 3; ++y)
+    {
+        for (int x = 0; x != 4; ++x)
+            EXPECT_THAT(written[y * 4 + x], Eq(pixel_at(2 * x, 2 * y))) << "x=" << x << ", y=" << y;
+    }
+}
+
+TEST_F(ScreencastDisplayBufferTest, mirrors_cpu_drawn_frame_as_gl_would)
+{
+    geom::Rectangle const region{{100, 100}, {4, 3}};
+    mtd::StubBuffer software_buffer{
+        mg::BufferProperties{region.size, mir_pixel_format_argb_8888, mg::BufferUsage::software}};
+    mc::QueueingSchedule free_queue;
+
+    // As GL reads back, mir_mirror_mode_none is upside down
+    mc::ScreencastDisplayBuffer db{region, region.size,
+                                   mir_mirror_mode_none, free_queue,
+                                   ready_queue, stub_display};
+
+    free_queue.schedule(mt::fake_shared(software_buffer));
+    cpu_draw_rows(db);
+    auto written = written_pixels_of(software_buffer);
+    EXPECT_THAT(written[0], Eq(pixel_at(0, 2)));
+    EXPECT_THAT(written[2 * 4 + 3], Eq(pixel_at(3, 0)));
+
+    // What capturing into a client's buffer uses for mir_mirror_mode_horizontal
+    glm::mat2 horizontal;
+    horizontal[0][0] = -1;
+    horizontal[1][1] = -1;
+    db.set_transformation(horizontal);
+
+    free_queue.schedule(ready_queue.next_buffer());
+    cpu_draw_rows(db);
+    written = written_pixels_of(software_buffer);
+    EXPECT_THAT(written[0], Eq(pixel_at(3, 0)));
+    EXPECT_THAT(written[2 * 4 + 3], Eq(pixel_at(0, 2)));
+}
+
+TEST_F(ScreencastDisplayBufferTest, cpu_drawn_frame_is_kept_whatever_the_buffer_size)
+{
+    mtd::StubBuffer software_buffer{
+        mg::BufferProperties{default_size, mir_pixel_format_xrgb_8888, mg::BufferUsage::software}};
+    mc::QueueingSchedule free_queue;
+    free_queue.schedule(mt::fake_shared(software_buffer));
+
+    mc::ScreencastDisplayBuffer db{default_rect, default_size,
+                                   default_mirror_mode, free_queue,
+                                   ready_queue, stub_display};
+
+    EXPECT_THAT(db.buffer_age(), Eq(0u));
+    db.map_pixels();
+    db.commit(geom::Rectangles{});
+    EXPECT_THAT(db.buffer_age(), Eq(1u));
+
+    db.set_renderbuffer_size({10, 10});
+    EXPECT_THAT(db.buffer_age(), Eq(1u));
+    EXPECT_THAT(db.size(), Eq(default_rect.size));
+}
+
+TEST_F(ScreencastDisplayBufferTest, throws_if_cpu_cannot_draw_into_supplied_buffer)
+{
+    // The CPU draws 0xAARRGGBB pixels
+    testing::NiceMock<mtd::MockGLBuffer> mock_buffer{
+        default_size, geom::Stride{1200}, mir_pixel_format_xbgr_8888};
+
+    mc::QueueingSchedule free_queue;
+    free_queue.schedule(mt::fake_shared(mock_buffer));
+
+    mc::ScreencastDisplayBuffer db{default_rect, default_size,
+                                   default_mirror_mode, free_queue,
+                                   ready_queue, stub_display};
+    db.map_pixels();
+
+    EXPECT_THROW({
+        db.commit(geom::Rectangles{});
+    }, std::invalid_argument);
+}
@@ -135,6 +135,14 @@ TEST_F(Stream, tracks_has_buffer)
     EXPECT_TRUE(stream.has_submitted_buffer());
 }
 
+TEST_F(Stream, counts_submissions_of_the_same_buffer)
+{
+    EXPECT_THAT(stream.submission_count(), Eq(0u));
+    stream.submit_buffer(buffers[0]);
+    stream.submit_buffer(buffers[0]);
+    EXPECT_THAT(stream.submission_count(), Eq(2u));
+}
+
 TEST_F(Stream, calls_frame_callback_after_scheduling_on_submissions)
 {
     int frame_count{0};
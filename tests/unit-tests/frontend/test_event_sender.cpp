@@ -0,0 +1,135 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/frontend/event_sender.h"
+#include "mir/events/event_builders.h"
+#include "mir/events/event_private.h"
+#include "mir/input/input_event_ring.h"
+
+#include "mir/test/doubles/mock_message_sender.h"
+#include "mir/test/doubles/mock_platform_ipc_operations.h"
+#include "mir/test/fake_shared.h"
+
+#include "mir_protobuf.pb.h"
+#include "mir_protobuf_wire.pb.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <sys/mman.h>
+
+namespace mf = mir::frontend;
+namespace mfd = mir::frontend::detail;
+namespace mev = mir::events;
+namespace mi = mir::input;
+namespace mp = mir::protobuf;
+namespace mt = mir::test;
+namespace mtd = mir::test::doubles;
+
+using namespace testing;
+
+namespace
+{
+struct Message
+{
+    mp::EventSequence sequence;
+    mf::FdSets fds;
+};
+
+auto pointer_event_at(float x) -> mir::EventUPtr
+{
+    auto event = mev::make_event(MirInputDeviceId{1}, std::chrono::nanoseconds{1}, std::vector<uint8_t>{},
+        mir_input_event_modifier_none, mir_pointer_action_motion, 0, x, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    mev::set_window_id(*event, 5);
+    return event;
+}
+
+struct EventSenderTest : Test
+{
+    EventSenderTest()
+    {
+        ON_CALL(message_sender, send(_, _, _))
+            .WillByDefault(Invoke([this](char const* data, size_t length, mf::FdSets const& fds)
+                {
+                    mp::wire::Result result;
+                    result.ParseFromArray(data, length);
+
+                    Message message;
+                    message.sequence.ParseFromString(result.events(0));
+                    message.fds = fds;
+                    sent.push_back(message);
+                }));
+    }
+
+    NiceMock<mtd::MockMessageSender> message_sender;
+    NiceMock<mtd::MockPlatformIpcOperations> buffer_packer;
+    mfd::EventSender event_sender{mt::fake_shared(message_sender), mt::fake_shared(buffer_packer)};
+    std::vector<Message> sent;
+};
+}
+
+TEST_F(EventSenderTest, sends_input_events_over_the_socket_by_default)
+{
+    event_sender.handle_event(pointer_event_at(1.0f));
+
+    ASSERT_THAT(sent.size(), Eq(1u));
+    EXPECT_THAT(sent[0].sequence.event_size(), Eq(1));
+    EXPECT_FALSE(sent[0].sequence.has_input_event_ring_doorbell());
+}
+
+TEST_F(EventSenderTest, delivers_input_events_through_the_ring_once_enabled)
+{
+    event_sender.enable_input_event_ring(mf::SurfaceId{5});
+
+    ASSERT_THAT(sent.size(), Eq(1u));
+    auto const& setup = sent[0].sequence.input_event_ring();
+    EXPECT_THAT(setup.surface_id().value(), Eq(5));
+    ASSERT_THAT(setup.fds_on_side_channel(), Eq(1));
+    ASSERT_THAT(sent[0].fds.size(), Eq(1u));
+    ASSERT_THAT(sent[0].fds[0].size(), Eq(1u));
+
+    auto const mapping = mmap(nullptr, setup.size(), PROT_READ | PROT_WRITE, MAP_SHARED, sent[0].fds[0][0], 0);
+    ASSERT_THAT(mapping, Ne(MAP_FAILED));
+    mi::InputEventRing ring{mapping, setup.size()};
+
+    event_sender.handle_event(pointer_event_at(1.0f));
+    event_sender.handle_event(pointer_event_at(2.0f));
+
+    // Only the first event rings the doorbell: the client isn't idle until it drains the ring
+    ASSERT_THAT(sent.size(), Eq(2u));
+    EXPECT_THAT(sent[1].sequence.event_size(), Eq(0));
+    EXPECT_THAT(sent[1].sequence.input_event_ring_doorbell().value(), Eq(5));
+
+    std::vector<float> xs;
+    ring.drain([&](mi::InputEventRecord const& record) { xs.push_back(record.x); });
+    EXPECT_THAT(xs, ElementsAre(1.0f, 2.0f));
+
+    munmap(mapping, setup.size());
+}
+
+TEST_F(EventSenderTest, sends_events_that_dont_fit_the_ring_over_the_socket_with_the_doorbell)
+{
+    event_sender.enable_input_event_ring(mf::SurfaceId{5});
+
+    auto key = mev::make_event(MirInputDeviceId{1}, std::chrono::nanoseconds{1}, std::vector<uint8_t>{},
+        mir_keyboard_action_down, 0x61, 30, mir_input_event_modifier_none);
+    key->to_input()->to_keyboard()->set_text("far too long for a record");
+    event_sender.handle_event(std::move(key));
+
+    ASSERT_THAT(sent.size(), Eq(2u));
+    EXPECT_THAT(sent[1].sequence.event_size(), Eq(1));
+    EXPECT_THAT(sent[1].sequence.input_event_ring_doorbell().value(), Eq(5));
+}
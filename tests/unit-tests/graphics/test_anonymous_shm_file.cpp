@@ -19,6 +19,11 @@
 #include "mir/anonymous_shm_file.h"
 #include <gtest/gtest.h>
 
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <vector>
+
 TEST(AnonymousShmFile, is_created)
 {
     size_t const file_size{100};
@@ -63,3 +68,47 @@ TEST(AnonymousShmFile, writing_to_base_ptr_writes_to_file)
         EXPECT_EQ(base_ptr[i], buffer[i]) << "i=" << i;
     }
 }
+
+TEST(AnonymousShmFile, prefaulted_file_is_mapped_zeroed_and_resident)
+{
+    size_t const file_size{8 * 1024 * 1024};
+    auto const page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    mir::AnonymousShmFile shm_file{file_size, mir::AnonymousShmFile::Paging::prefaulted};
+
+    // Faulted in up front (whether or not the kernel uses huge pages)
+    std::vector<unsigned char> resident((file_size + page_size - 1) / page_size);
+    ASSERT_EQ(0, mincore(shm_file.base_ptr(), file_size, resident.data()));
+    for (auto page : resident)
+        EXPECT_TRUE(page & 1);
+
+    auto base_ptr = reinterpret_cast<uint8_t const*>(shm_file.base_ptr());
+    for (size_t i = 0; i < file_size; i += page_size)
+        EXPECT_EQ(0, base_ptr[i]) << "i=" << i;
+}
+
+TEST(AnonymousShmFile, large_file_is_not_faulted_in_unless_asked)
+{
+    size_t const file_size{8 * 1024 * 1024};
+    auto const page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    mir::AnonymousShmFile shm_file{file_size};
+
+    std::vector<unsigned char> resident((file_size + page_size - 1) / page_size);
+    ASSERT_EQ(0, mincore(shm_file.base_ptr(), file_size, resident.data()));
+    for (auto page : resident)
+        EXPECT_FALSE(page & 1);
+}
+
+TEST(AnonymousShmFile, small_file_is_not_faulted_in_even_if_asked)
+{
+    auto const page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t const file_size{64 * page_size};
+
+    mir::AnonymousShmFile shm_file{file_size, mir::AnonymousShmFile::Paging::prefaulted};
+
+    std::vector<unsigned char> resident((file_size + page_size - 1) / page_size);
+    ASSERT_EQ(0, mincore(shm_file.base_ptr(), file_size, resident.data()));
+    for (auto page : resident)
+        EXPECT_FALSE(page & 1);
+}
@@ -18,6 +18,12 @@
 
 #include <gtest/gtest.h>
 #include <fcntl.h>
+#include <unistd.h>
+#include <sys/sysmacros.h>
+
+#include <map>
+#include <mutex>
+#include <thread>
 #include <boost/throw_exception.hpp>
 
 #include "mir/graphics/platform.h"
@@ -149,6 +155,52 @@ public:
     }
 };
 
+/// Counts how many holders each device has at once
+class CountingConsoleServices : public StubConsoleServices
+{
+public:
+    std::future<std::unique_ptr<mir::Device>> acquire_device(
+        int major, int minor,
+        std::unique_ptr<mir::Device::Observer>) override
+    {
+        std::promise<std::unique_ptr<mir::Device>> promise;
+        promise.set_value(std::make_unique<CountedDevice>(this, makedev(major, minor)));
+        return promise.get_future();
+    }
+
+    int most_holders_of(dev_t device)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return most_holders[device];
+    }
+
+private:
+    struct CountedDevice : mir::Device
+    {
+        CountedDevice(CountingConsoleServices* console, dev_t device) :
+            console{console},
+            device{device}
+        {
+            std::lock_guard<std::mutex> lock{console->mutex};
+            auto const count = ++console->holders[device];
+            console->most_holders[device] = std::max(console->most_holders[device], count);
+        }
+
+        ~CountedDevice()
+        {
+            std::lock_guard<std::mutex> lock{console->mutex};
+            --console->holders[device];
+        }
+
+        CountingConsoleServices* const console;
+        dev_t const device;
+    };
+
+    std::mutex mutex;
+    std::map<dev_t, int> holders;
+    std::map<dev_t, int> most_holders;
+};
+
 class ServerPlatformProbeMockDRM : public ::testing::Test
 {
 #if defined(MIR_BUILD_PLATFORM_MESA_KMS) || defined(MIR_BUILD_PLATFORM_MESA_X11)
@@ -157,6 +209,33 @@ public:
 #endif
 };
 
+class ServerPlatformProbeCache : public ::testing::Test
+{
+public:
+    ServerPlatformProbeCache()
+    {
+        char tmp_name[] = "/tmp/mir_probe_cache_XXXXXX";
+        if (mkdtemp(tmp_name) == NULL)
+        {
+            throw std::system_error{errno, std::system_category(), "Failed to create temporary directory"};
+        }
+        temporary_directory = tmp_name;
+        cache_path = temporary_directory + "/probe-cache";
+    }
+
+    ~ServerPlatformProbeCache()
+    {
+        unlink(cache_path.c_str());
+        rmdir(temporary_directory.c_str());
+    }
+
+    std::string temporary_directory;
+    std::string cache_path;
+    mir::options::ProgramOption options;
+    std::shared_ptr<mir::SharedLibrary> const dummy{
+        std::make_shared<mir::SharedLibrary>(mtf::server_platform("graphics-dummy.so"))};
+};
+
 }
 
 TEST(ServerPlatformProbe, ConstructingWithNoModulesIsAnError)
@@ -274,3 +353,81 @@ TEST_F(ServerPlatformProbeMockDRM, IgnoresNonPlatformModules)
         std::make_shared<StubConsoleServices>());
     EXPECT_NE(nullptr, module);
 }
+
+TEST_F(ServerPlatformProbeCache, saved_results_are_loaded_in_the_same_environment)
+{
+    using namespace testing;
+
+    {
+        mir::graphics::ProbeCache cache{cache_path, "environment-a"};
+        cache.store(*dummy, mir::graphics::supported);
+        cache.save();
+    }
+
+    mir::graphics::ProbeCache same{cache_path, "environment-a"};
+    mir::graphics::ProbeCache different{cache_path, "environment-b"};
+
+    EXPECT_THAT(same.priority_of(*dummy), Eq(mir::graphics::supported));
+    EXPECT_FALSE(different.priority_of(*dummy).is_set());
+}
+
+TEST_F(ServerPlatformProbeCache, records_probed_priorities)
+{
+    using namespace testing;
+    auto block_mesa = ensure_mesa_probing_fails();
+    mir::graphics::ProbeCache cache{cache_path, "environment"};
+
+    auto const module = mir::graphics::module_for_device(
+        {dummy}, options, std::make_shared<mtd::NullConsoleServices>(), &cache);
+
+    EXPECT_THAT(module, Eq(dummy));
+    EXPECT_THAT(mir::graphics::ProbeCache(cache_path, "environment").priority_of(*dummy),
+                Eq(mir::graphics::dummy));
+}
+
+TEST_F(ServerPlatformProbeCache, stale_cached_winner_is_reprobed)
+{
+    using namespace testing;
+    auto block_mesa = ensure_mesa_probing_fails();
+    mir::graphics::ProbeCache cache{cache_path, "environment"};
+    cache.store(*dummy, mir::graphics::best);
+
+    auto const module = mir::graphics::module_for_device(
+        {dummy}, options, std::make_shared<mtd::NullConsoleServices>(), &cache);
+
+    EXPECT_THAT(module, Eq(dummy));
+    EXPECT_THAT(cache.priority_of(*dummy), Eq(mir::graphics::dummy));
+}
+
+TEST(ServerPlatformProbe, probes_take_turns_with_a_device)
+{
+    using namespace testing;
+    auto const counting_console = std::make_shared<CountingConsoleServices>();
+    mir::graphics::ExclusiveDeviceConsoleServices console{counting_console};
+
+    auto const probe =
+        [&]
+        {
+            auto const device = console.acquire_device(226, 0, nullptr).get();
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        };
+
+    std::thread first{probe}, second{probe};
+    first.join();
+    second.join();
+
+    EXPECT_THAT(counting_console->most_holders_of(makedev(226, 0)), Eq(1));
+}
+
+TEST(ServerPlatformProbe, probes_can_hold_different_devices_at_once)
+{
+    using namespace testing;
+    auto const counting_console = std::make_shared<CountingConsoleServices>();
+    mir::graphics::ExclusiveDeviceConsoleServices console{counting_console};
+
+    auto const card0 = console.acquire_device(226, 0, nullptr).get();
+    auto const card1 = console.acquire_device(226, 1, nullptr).get();
+
+    EXPECT_THAT(counting_console->most_holders_of(makedev(226, 0)), Eq(1));
+    EXPECT_THAT(counting_console->most_holders_of(makedev(226, 1)), Eq(1));
+}
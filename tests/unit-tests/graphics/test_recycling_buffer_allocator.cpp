@@ -0,0 +1,108 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/graphics/recycling_buffer_allocator.h"
+
+#include "mir/test/doubles/stub_buffer_allocator.h"
+#include "mir/test/doubles/fake_alarm_factory.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace mg = mir::graphics;
+namespace mtd = mir::test::doubles;
+namespace geom = mir::geometry;
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+struct RecyclingBufferAllocator : Test
+{
+    geom::Size const size{64, 32};
+    MirPixelFormat const format{mir_pixel_format_argb_8888};
+    size_t const buffer_bytes{64 * 32 * 4};
+
+    std::shared_ptr<mtd::FakeAlarmFactory> const alarm_factory{std::make_shared<mtd::FakeAlarmFactory>()};
+    mg::RecyclingBufferAllocator allocator{
+        std::make_shared<mtd::StubBufferAllocator>(),
+        alarm_factory,
+        2 * buffer_bytes,
+        5s};
+};
+}
+
+TEST_F(RecyclingBufferAllocator, reuses_software_buffer_once_released)
+{
+    auto const first_id = allocator.alloc_software_buffer(size, format)->id();
+
+    EXPECT_THAT(allocator.idle_bytes(), Eq(buffer_bytes));
+    EXPECT_THAT(allocator.alloc_software_buffer(size, format)->id(), Eq(first_id));
+}
+
+TEST_F(RecyclingBufferAllocator, does_not_reuse_buffer_still_in_use)
+{
+    auto const first = allocator.alloc_software_buffer(size, format);
+    auto const second = allocator.alloc_software_buffer(size, format);
+
+    EXPECT_THAT(second->id(), Ne(first->id()));
+}
+
+TEST_F(RecyclingBufferAllocator, only_reuses_buffers_of_requested_size_and_format)
+{
+    auto const first_id = allocator.alloc_software_buffer(size, format)->id();
+
+    EXPECT_THAT(allocator.alloc_software_buffer(geom::Size{32, 64}, format)->id(), Ne(first_id));
+    EXPECT_THAT(allocator.alloc_software_buffer(size, mir_pixel_format_xrgb_8888)->id(), Ne(first_id));
+}
+
+TEST_F(RecyclingBufferAllocator, releases_oldest_idle_buffers_beyond_limit)
+{
+    auto first = allocator.alloc_software_buffer(size, format);
+    auto second = allocator.alloc_software_buffer(size, format);
+    auto third = allocator.alloc_software_buffer(size, format);
+    auto const first_id = first->id();
+
+    first.reset();
+    second.reset();
+    third.reset();
+
+    EXPECT_THAT(allocator.idle_bytes(), Eq(2 * buffer_bytes));
+
+    auto const reused1 = allocator.alloc_software_buffer(size, format);
+    auto const reused2 = allocator.alloc_software_buffer(size, format);
+    EXPECT_THAT(reused1->id(), Ne(first_id));
+    EXPECT_THAT(reused2->id(), Ne(first_id));
+}
+
+TEST_F(RecyclingBufferAllocator, releases_idle_buffers_once_idle_for_timeout)
+{
+    allocator.alloc_software_buffer(size, format);
+
+    alarm_factory->advance_by(4s);
+    EXPECT_THAT(allocator.idle_bytes(), Eq(buffer_bytes));
+
+    alarm_factory->advance_by(2s);
+    EXPECT_THAT(allocator.idle_bytes(), Eq(0u));
+}
+
+TEST_F(RecyclingBufferAllocator, does_not_pool_hardware_buffers)
+{
+    allocator.alloc_buffer(size, 0, 0);
+
+    EXPECT_THAT(allocator.idle_bytes(), Eq(0u));
+}
@@ -25,6 +25,7 @@
 #include <gmock/gmock.h>
 #include <GLES2/gl2ext.h>
 #include <endian.h>
+#include <vector>
 
 namespace mg = mir::graphics;
 namespace mgc = mir::graphics::common;
@@ -44,6 +45,16 @@ struct StubShmFile : public mir::ShmFile
     int const fake_fd = 17;
 };
 
+struct MemoryShmFile : public mir::ShmFile
+{
+    explicit MemoryShmFile(size_t size) : memory(size) {}
+
+    void* base_ptr() const { return memory.data(); }
+    int fd() const { return -1; }
+
+    std::vector<unsigned char> mutable memory;
+};
+
 struct PlatformlessShmBuffer : mgc::ShmBuffer
 {
     PlatformlessShmBuffer(
@@ -199,3 +210,17 @@ TEST_F(ShmBufferTest, uploads_abgr_8888_correctly)
     PlatformlessShmBuffer buf(std::make_unique<StubShmFile>(), size, mir_pixel_format_abgr_8888);
     buf.gl_bind_to_texture();
 }
+
+TEST_F(ShmBufferTest, uploads_pixels_again_only_once_they_are_written)
+{
+    size_t const pixels_size = size.width.as_uint32_t() * size.height.as_uint32_t() * 4;
+    std::vector<unsigned char> const pixels(pixels_size);
+    PlatformlessShmBuffer buf(std::make_unique<MemoryShmFile>(pixels_size), size, mir_pixel_format_abgr_8888);
+
+    EXPECT_CALL(mock_gl, glTexImage2D(_, _, _, _, _, _, _, _, _)).Times(2);
+
+    buf.tex_bind();
+    buf.tex_bind();
+    buf.write(pixels.data(), pixels.size());
+    buf.tex_bind();
+}
@@ -101,6 +101,27 @@ TEST_F(InputEventBuilder, makes_valid_touch_event)
    }   
 }
 
+TEST_F(InputEventBuilder, touch_event_with_more_contacts_than_fit_inline_is_cloned_intact)
+{
+    unsigned const touch_count = 64;
+
+    auto ev = mev::make_event(device_id, timestamp, cookie, modifiers);
+    for (unsigned i = 0; i != touch_count; ++i)
+    {
+        mev::add_touch(*ev, i, mir_touch_action_change, mir_touch_tooltype_finger, i, 2*i, 1, 1, 1, 1);
+    }
+
+    auto const clone = mev::clone_event(*ev);
+    auto const tev = mir_input_event_get_touch_event(mir_event_get_input_event(clone.get()));
+
+    ASSERT_EQ(touch_count, mir_touch_event_point_count(tev));
+    for (unsigned i = 0; i != touch_count; ++i)
+    {
+        EXPECT_EQ(static_cast<MirTouchId>(i), mir_touch_event_id(tev, i));
+        EXPECT_EQ(2.0f*i, mir_touch_event_axis_value(tev, i, mir_touch_axis_y));
+    }
+}
+
 TEST_F(InputEventBuilder, makes_valid_pointer_event)
 {
     MirPointerAction action = mir_pointer_action_enter;
@@ -18,6 +18,7 @@
 
 #include "src/server/input/event_filter_chain_dispatcher.h"
 #include "src/server/input/null_input_dispatcher.h"
+#include "mir/input/selective_event_filter.h"
 #include "mir/test/doubles/mock_event_filter.h"
 #include "mir/test/doubles/mock_input_dispatcher.h"
 #include "mir/events/event_builders.h"
@@ -38,11 +39,25 @@ std::shared_ptr<mtd::MockEventFilter> mock_filter()
     return std::make_shared<mtd::MockEventFilter>();
 }
 
+struct MockSelectiveEventFilter : mi::SelectiveEventFilter
+{
+    explicit MockSelectiveEventFilter(mi::EventInterest const& interest) : declared_interest{interest} {}
+
+    MOCK_METHOD1(handle, bool(MirEvent const&));
+    auto interest() const -> mi::EventInterest override { return declared_interest; }
+
+    mi::EventInterest const declared_interest;
+};
+
 struct EventFilterChainDispatcher : public ::testing::Test
 {
     mir::EventUPtr const event = mir::events::make_event(MirInputDeviceId(),
         std::chrono::nanoseconds(0), std::vector<uint8_t>{}, MirKeyboardAction(),
         xkb_keysym_t(), 0, MirInputEventModifiers());
+
+    MirInputDeviceId const touchscreen{7};
+    mir::EventUPtr const touch_event = mir::events::make_event(touchscreen,
+        std::chrono::nanoseconds(0), std::vector<uint8_t>{}, MirInputEventModifiers());
 };
 }
 
@@ -120,3 +135,68 @@ TEST_F(EventFilterChainDispatcher, forwards_start_and_stop)
     filter_chain.start();
     filter_chain.stop();
 }
+
+TEST_F(EventFilterChainDispatcher, offers_selective_filters_only_event_types_of_interest)
+{
+    mi::EventInterest touch_only;
+    touch_only.input_types = mi::EventInterest::bit_for(mir_input_event_type_touch);
+    auto const filter = std::make_shared<MockSelectiveEventFilter>(touch_only);
+
+    mi::EventFilterChainDispatcher filter_chain({filter}, std::make_shared<mi::NullInputDispatcher>());
+
+    EXPECT_CALL(*filter, handle(Ref(*touch_event))).WillOnce(Return(true));
+
+    EXPECT_FALSE(filter_chain.handle(*event));
+    EXPECT_TRUE(filter_chain.handle(*touch_event));
+}
+
+TEST_F(EventFilterChainDispatcher, offers_selective_filters_only_devices_of_interest)
+{
+    mi::EventInterest other_device;
+    other_device.devices = {touchscreen + 1};
+    auto const filter = std::make_shared<MockSelectiveEventFilter>(other_device);
+
+    mi::EventFilterChainDispatcher filter_chain({filter}, std::make_shared<mi::NullInputDispatcher>());
+
+    EXPECT_CALL(*filter, handle(_)).Times(0);
+
+    EXPECT_FALSE(filter_chain.handle(*touch_event));
+}
+
+TEST_F(EventFilterChainDispatcher, filters_can_modify_chain_while_handling_events)
+{
+    auto const filter = mock_filter();
+    auto const added_filter = mock_filter();
+
+    mi::EventFilterChainDispatcher filter_chain({filter}, std::make_shared<mi::NullInputDispatcher>());
+
+    EXPECT_CALL(*filter, handle(_))
+        .WillOnce(Invoke([&](MirEvent const&) { filter_chain.append(added_filter); return false; }))
+        .WillOnce(Return(false));
+    EXPECT_CALL(*added_filter, handle(_)).WillOnce(Return(false));
+
+    // The filter added while handling the first event is only offered the second
+    filter_chain.handle(*event);
+    filter_chain.handle(*event);
+}
+
+TEST_F(EventFilterChainDispatcher, counts_events_offered_to_and_consumed_by_each_filter)
+{
+    auto const filter1 = mock_filter();
+    auto const filter2 = mock_filter();
+
+    mi::EventFilterChainDispatcher filter_chain({filter1, filter2}, std::make_shared<mi::NullInputDispatcher>());
+
+    EXPECT_CALL(*filter1, handle(_)).WillOnce(Return(false)).WillOnce(Return(true));
+    EXPECT_CALL(*filter2, handle(_)).WillOnce(Return(false));
+
+    filter_chain.handle(*event);
+    filter_chain.handle(*event);
+
+    auto const statistics = filter_chain.statistics();
+    ASSERT_THAT(statistics.size(), Eq(2u));
+    EXPECT_THAT(statistics[0].events_offered, Eq(2u));
+    EXPECT_THAT(statistics[0].events_consumed, Eq(1u));
+    EXPECT_THAT(statistics[1].events_offered, Eq(1u));
+    EXPECT_THAT(statistics[1].events_consumed, Eq(0u));
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mir/input/input_event_ring.h"
+#include "mir/input/input_event_record_codec.h"
+#include "mir/events/event_builders.h"
+#include "mir/events/event_private.h"
+#include "mir_toolkit/events/input/input_event.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace mi = mir::input;
+namespace mev = mir::events;
+
+namespace
+{
+std::vector<uint64_t> initialised_ring(uint32_t capacity)
+{
+    std::vector<uint64_t> memory(mi::InputEventRing::size_for(capacity) / sizeof(uint64_t) + 1);
+    mi::InputEventRing::initialise(memory.data(), capacity);
+    return memory;
+}
+
+struct InputEventRingTest : public ::testing::Test
+{
+    mi::InputEventRecord record_with_time(int64_t time)
+    {
+        mi::InputEventRecord record{};
+        record.event_time_ns = time;
+        return record;
+    }
+
+    uint32_t const capacity{4};
+    std::vector<uint64_t> memory{initialised_ring(capacity)};
+    mi::InputEventRing ring{memory.data(), memory.size() * sizeof(uint64_t)};
+};
+}
+
+TEST_F(InputEventRingTest, capacity_must_be_a_power_of_two)
+{
+    std::vector<uint64_t> other(mi::InputEventRing::size_for(3));
+    EXPECT_THROW(mi::InputEventRing::initialise(other.data(), 3), std::logic_error);
+}
+
+TEST_F(InputEventRingTest, rejects_memory_that_is_not_a_ring)
+{
+    std::vector<uint64_t> garbage(mi::InputEventRing::size_for(capacity), 0);
+    EXPECT_THROW((mi::InputEventRing{garbage.data(), garbage.size() * sizeof(uint64_t)}), std::runtime_error);
+}
+
+TEST_F(InputEventRingTest, drains_records_in_order)
+{
+    using namespace testing;
+    bool wake;
+
+    for (int64_t t = 1; t <= 3; ++t)
+        EXPECT_TRUE(ring.push(record_with_time(t), wake));
+
+    std::vector<int64_t> times;
+    auto const count = ring.drain([&](mi::InputEventRecord const& record) { times.push_back(record.event_time_ns); });
+
+    EXPECT_THAT(count, Eq(3u));
+    EXPECT_THAT(times, ElementsAre(1, 2, 3));
+}
+
+TEST_F(InputEventRingTest, push_fails_when_full)
+{
+    bool wake;
+
+    for (auto i = 0u; i != capacity; ++i)
+        EXPECT_TRUE(ring.push(record_with_time(i), wake));
+
+    EXPECT_FALSE(ring.push(record_with_time(capacity), wake));
+
+    ring.drain([](mi::InputEventRecord const&) {});
+    EXPECT_TRUE(ring.push(record_with_time(capacity), wake));
+}
+
+TEST_F(InputEventRingTest, only_wakes_idle_consumer)
+{
+    bool wake{false};
+
+    ring.push(record_with_time(1), wake);
+    EXPECT_TRUE(wake);
+
+    ring.push(record_with_time(2), wake);
+    EXPECT_FALSE(wake);
+
+    ring.drain([](mi::InputEventRecord const&) {});
+
+    ring.push(record_with_time(3), wake);
+    EXPECT_TRUE(wake);
+}
+
+TEST(InputEventRecordCodec, round_trips_touch_event)
+{
+    using namespace testing;
+    std::vector<uint8_t> const cookie{1, 2, 3};
+
+    auto const sent = mev::make_event(MirInputDeviceId{7}, std::chrono::nanoseconds{123}, cookie, mir_input_event_modifier_shift);
+    mev::add_touch(*sent, 3, mir_touch_action_change, mir_touch_tooltype_finger, 10.5f, 20.5f, 0.5f, 6.0f, 4.0f, 6.0f);
+    mev::add_touch(*sent, 4, mir_touch_action_down, mir_touch_tooltype_stylus, 30.0f, 40.0f, 1.0f, 2.0f, 3.0f, 3.0f);
+    mev::set_window_id(*sent, 9);
+
+    mi::InputEventRecord record;
+    ASSERT_TRUE(mi::encode_input_event(*sent->to_input(), record));
+    auto const received = mi::decode_input_event(record);
+    ASSERT_THAT(received, NotNull());
+
+    auto const input = mir_event_get_input_event(received.get());
+    EXPECT_THAT(mir_input_event_get_device_id(input), Eq(7));
+    EXPECT_THAT(mir_input_event_get_event_time(input), Eq(123));
+    EXPECT_THAT(received->to_input()->window_id(), Eq(9));
+    EXPECT_THAT(received->to_input()->modifiers(), Eq(mir_input_event_modifier_shift));
+    EXPECT_THAT(received->to_input()->cookie(), Eq(cookie));
+
+    auto const touch = mir_input_event_get_touch_event(input);
+    ASSERT_THAT(mir_touch_event_point_count(touch), Eq(2u));
+    EXPECT_THAT(mir_touch_event_id(touch, 0), Eq(3));
+    EXPECT_THAT(mir_touch_event_action(touch, 0), Eq(mir_touch_action_change));
+    EXPECT_THAT(mir_touch_event_tooltype(touch, 1), Eq(mir_touch_tooltype_stylus));
+    EXPECT_THAT(mir_touch_event_axis_value(touch, 0, mir_touch_axis_x), Eq(10.5f));
+    EXPECT_THAT(mir_touch_event_axis_value(touch, 0, mir_touch_axis_y), Eq(20.5f));
+    EXPECT_THAT(mir_touch_event_axis_value(touch, 0, mir_touch_axis_pressure), Eq(0.5f));
+    EXPECT_THAT(mir_touch_event_axis_value(touch, 0, mir_touch_axis_touch_major), Eq(6.0f));
+    EXPECT_THAT(mir_touch_event_axis_value(touch, 0, mir_touch_axis_touch_minor), Eq(4.0f));
+    EXPECT_THAT(mir_touch_event_axis_value(touch, 0, mir_touch_axis_size), Eq(6.0f));
+    EXPECT_THAT(mir_touch_event_axis_value(touch, 1, mir_touch_axis_size), Eq(3.0f));
+}
+
+TEST(InputEventRecordCodec, round_trips_key_event_text)
+{
+    using namespace testing;
+
+    auto const sent = mev::make_event(MirInputDeviceId{1}, std::chrono::nanoseconds{5}, std::vector<uint8_t>{},
+        mir_keyboard_action_down, 0x61, 30, mir_input_event_modifier_none);
+    sent->to_input()->to_keyboard()->set_text("a");
+
+    mi::InputEventRecord record;
+    ASSERT_TRUE(mi::encode_input_event(*sent->to_input(), record));
+    auto const received = mi::decode_input_event(record);
+    ASSERT_THAT(received, NotNull());
+
+    auto const key = mir_input_event_get_keyboard_event(mir_event_get_input_event(received.get()));
+    EXPECT_THAT(mir_keyboard_event_action(key), Eq(mir_keyboard_action_down));
+    EXPECT_THAT(mir_keyboard_event_key_code(key), Eq(0x61));
+    EXPECT_THAT(mir_keyboard_event_scan_code(key), Eq(30));
+    EXPECT_THAT(mir_keyboard_event_key_text(key), StrEq("a"));
+}
+
+TEST(InputEventRecordCodec, does_not_encode_events_that_dont_fit)
+{
+    auto const sent = mev::make_event(MirInputDeviceId{1}, std::chrono::nanoseconds{5}, std::vector<uint8_t>{},
+        mir_keyboard_action_down, 0x61, 30, mir_input_event_modifier_none);
+    sent->to_input()->to_keyboard()->set_text("far too long for a record");
+
+    mi::InputEventRecord record;
+    EXPECT_FALSE(mi::encode_input_event(*sent->to_input(), record));
+}
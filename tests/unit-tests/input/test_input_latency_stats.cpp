@@ -0,0 +1,160 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/input/latency_histogram.h"
+#include "src/server/input/input_latency_stats.h"
+#include "src/server/input/latency_recording_dispatcher.h"
+
+#include "mir/events/event_builders.h"
+
+#include "mir/test/doubles/mock_input_dispatcher.h"
+#include "mir/test/doubles/advanceable_clock.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <sstream>
+
+namespace mi = mir::input;
+namespace mev = mir::events;
+namespace mtd = mir::test::doubles;
+
+using namespace std::chrono;
+using namespace testing;
+
+namespace
+{
+struct InputLatencyStats : Test
+{
+    std::shared_ptr<MirEvent const> key_event_from(MirInputDeviceId device, nanoseconds event_time)
+    {
+        return mev::make_event(device, event_time, std::vector<uint8_t>{},
+            mir_keyboard_action_down, 0, 0, mir_input_event_modifier_none);
+    }
+
+    nanoseconds now() const
+    {
+        return duration_cast<nanoseconds>(clock->now().time_since_epoch());
+    }
+
+    std::shared_ptr<mtd::AdvanceableClock> const clock{std::make_shared<mtd::AdvanceableClock>()};
+    std::shared_ptr<mi::InputLatencyStats> const stats{std::make_shared<mi::InputLatencyStats>(clock)};
+    std::shared_ptr<NiceMock<mtd::MockInputDispatcher>> const next_dispatcher{
+        std::make_shared<NiceMock<mtd::MockInputDispatcher>>()};
+    MirInputDeviceId const device{7};
+};
+}
+
+TEST(LatencyHistogram, reports_percentiles_within_precision)
+{
+    mi::LatencyHistogram histogram;
+
+    for (auto i = 1; i <= 100; ++i)
+        histogram.record(microseconds{i});
+
+    EXPECT_THAT(histogram.count(), Eq(100u));
+    EXPECT_THAT(histogram.max(), Eq(microseconds{100}));
+    EXPECT_THAT(histogram.percentile(50).count(), AllOf(Ge(50000), Le(50000 * 1.07)));
+    EXPECT_THAT(histogram.percentile(99).count(), AllOf(Ge(99000), Le(100000)));
+    EXPECT_THAT(histogram.percentile(100), Eq(microseconds{100}));
+}
+
+TEST(LatencyHistogram, small_values_are_exact)
+{
+    mi::LatencyHistogram histogram;
+
+    histogram.record(nanoseconds{3});
+    histogram.record(nanoseconds{17});
+
+    EXPECT_THAT(histogram.percentile(50), Eq(nanoseconds{3}));
+    EXPECT_THAT(histogram.percentile(100), Eq(nanoseconds{17}));
+}
+
+TEST(LatencyHistogram, saturates_rather_than_overflowing)
+{
+    mi::LatencyHistogram histogram;
+
+    histogram.record(hours{24});
+    histogram.record(nanoseconds{-5});
+
+    EXPECT_THAT(histogram.count(), Eq(2u));
+    EXPECT_THAT(histogram.percentile(50), Eq(nanoseconds{0}));
+    EXPECT_THAT(histogram.max(), Eq(hours{24}));
+}
+
+TEST_F(InputLatencyStats, records_seat_wide_and_per_device)
+{
+    stats->record(mi::InputLatencyStage::seat, device, milliseconds{2});
+    stats->record(mi::InputLatencyStage::seat, device + 1, milliseconds{4});
+
+    EXPECT_THAT(stats->seat_histogram(mi::InputLatencyStage::seat).count(), Eq(2u));
+    ASSERT_THAT(stats->device_histogram(mi::InputLatencyStage::seat, device), NotNull());
+    EXPECT_THAT(stats->device_histogram(mi::InputLatencyStage::seat, device)->max(), Eq(milliseconds{2}));
+    EXPECT_THAT(stats->device_histogram(mi::InputLatencyStage::seat, device + 2), IsNull());
+}
+
+TEST_F(InputLatencyStats, keeps_seat_wide_histogram_when_out_of_device_slots)
+{
+    for (MirInputDeviceId id = 0; id != mi::InputLatencyStats::max_devices + 1; ++id)
+        stats->record(mi::InputLatencyStage::delivered, id, milliseconds{1});
+
+    EXPECT_THAT(stats->seat_histogram(mi::InputLatencyStage::delivered).count(),
+        Eq(mi::InputLatencyStats::max_devices + 1));
+    EXPECT_THAT(stats->device_histogram(mi::InputLatencyStage::delivered, mi::InputLatencyStats::max_devices), IsNull());
+}
+
+TEST_F(InputLatencyStats, dump_names_stages_and_devices)
+{
+    stats->record(mi::InputLatencyStage::filter_chain, device, milliseconds{1});
+
+    std::stringstream out;
+    stats->dump(out);
+
+    EXPECT_THAT(out.str(), HasSubstr("stage=filter_chain device=all count=1"));
+    EXPECT_THAT(out.str(), HasSubstr("stage=filter_chain device=7 count=1"));
+    EXPECT_THAT(out.str(), Not(HasSubstr("stage=seat")));
+}
+
+TEST_F(InputLatencyStats, recording_dispatcher_samples_latency_from_event_time)
+{
+    mi::LatencyRecordingDispatcher dispatcher{
+        next_dispatcher, stats, mi::InputLatencyStage::surface_dispatch, mi::InputLatencyStage::delivered};
+
+    ON_CALL(*next_dispatcher, dispatch(_))
+        .WillByDefault(InvokeWithoutArgs([this] { clock->advance_by(milliseconds{3}); return true; }));
+
+    auto const event = key_event_from(device, now() - milliseconds{5});
+
+    EXPECT_CALL(*next_dispatcher, dispatch(event));
+    EXPECT_TRUE(dispatcher.dispatch(event));
+
+    EXPECT_THAT(stats->seat_histogram(mi::InputLatencyStage::surface_dispatch).max(), Eq(milliseconds{5}));
+    EXPECT_THAT(stats->seat_histogram(mi::InputLatencyStage::delivered).max(), Eq(milliseconds{8}));
+}
+
+TEST_F(InputLatencyStats, recording_dispatcher_does_not_sample_undelivered_events)
+{
+    mi::LatencyRecordingDispatcher dispatcher{
+        next_dispatcher, stats, mi::InputLatencyStage::surface_dispatch, mi::InputLatencyStage::delivered};
+
+    ON_CALL(*next_dispatcher, dispatch(_))
+        .WillByDefault(Return(false));
+
+    EXPECT_FALSE(dispatcher.dispatch(key_event_from(device, now())));
+
+    EXPECT_THAT(stats->seat_histogram(mi::InputLatencyStage::surface_dispatch).count(), Eq(1u));
+    EXPECT_THAT(stats->seat_histogram(mi::InputLatencyStage::delivered).count(), Eq(0u));
+}
@@ -0,0 +1,325 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/platforms/wayland/passthrough_surface.h"
+#include "mir/graphics/buffer_properties.h"
+
+#include "mir/test/doubles/stub_buffer.h"
+
+#include <wayland-client.h>
+#include <wayland-server.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <poll.h>
+#include <sys/socket.h>
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace mg = mir::graphics;
+namespace mgw = mir::graphics::wayland;
+namespace mtd = mir::test::doubles;
+namespace geom = mir::geometry;
+
+using namespace testing;
+
+namespace
+{
+/// Just enough of a host compositor to see what a passthrough surface attaches and commits
+struct FakeHost
+{
+    struct Surface
+    {
+        uint32_t id;
+        wl_resource* pending{nullptr};
+        wl_resource* committed{nullptr};
+        int attaches{0};
+    };
+
+    FakeHost()
+    {
+        wl_display_init_shm(display);
+        wl_global_create(display, &wl_compositor_interface, 4, this, &bind_compositor);
+        wl_global_create(display, &wl_subcompositor_interface, 1, this, &bind_subcompositor);
+    }
+
+    ~FakeHost()
+    {
+        wl_display_destroy(display);
+    }
+
+    auto surface_for(wl_surface* client_surface) const -> Surface*
+    {
+        auto const id = wl_proxy_get_id(reinterpret_cast<wl_proxy*>(client_surface));
+        for (auto const& surface : surfaces)
+        {
+            if (surface->id == id)
+                return surface.get();
+        }
+        return nullptr;
+    }
+
+    static void bind_compositor(wl_client* client, void* data, uint32_t version, uint32_t id)
+    {
+        static struct wl_compositor_interface const impl{
+            [](wl_client* client, wl_resource* resource, uint32_t id)
+            {
+                auto const host = static_cast<FakeHost*>(wl_resource_get_user_data(resource));
+                auto const surface = wl_resource_create(client, &wl_surface_interface, 4, id);
+                host->surfaces.push_back(std::make_unique<Surface>(Surface{id}));
+                wl_resource_set_implementation(surface, &surface_impl, host->surfaces.back().get(),
+                    [](wl_resource* resource) { static_cast<Surface*>(wl_resource_get_user_data(resource))->id = 0; });
+            },
+            [](wl_client* client, wl_resource*, uint32_t id)
+            {
+                wl_resource_create(client, &wl_region_interface, 1, id);
+            }
+        };
+
+        auto const resource = wl_resource_create(client, &wl_compositor_interface, version, id);
+        wl_resource_set_implementation(resource, &impl, data, nullptr);
+    }
+
+    static void bind_subcompositor(wl_client* client, void* data, uint32_t version, uint32_t id)
+    {
+        static struct wl_subsurface_interface const subsurface_impl{
+            [](wl_client*, wl_resource* resource) { wl_resource_destroy(resource); },
+            [](wl_client*, wl_resource*, int32_t, int32_t) {},
+            [](wl_client*, wl_resource*, wl_resource*) {},
+            [](wl_client*, wl_resource*, wl_resource*) {},
+            [](wl_client*, wl_resource*) {},
+            [](wl_client*, wl_resource*) {}
+        };
+
+        static struct wl_subcompositor_interface const impl{
+            [](wl_client*, wl_resource* resource) { wl_resource_destroy(resource); },
+            [](wl_client* client, wl_resource*, uint32_t id, wl_resource*, wl_resource*)
+            {
+                auto const subsurface = wl_resource_create(client, &wl_subsurface_interface, 1, id);
+                wl_resource_set_implementation(subsurface, &subsurface_impl, nullptr, nullptr);
+            }
+        };
+
+        auto const resource = wl_resource_create(client, &wl_subcompositor_interface, version, id);
+        wl_resource_set_implementation(resource, &impl, data, nullptr);
+    }
+
+    static struct wl_surface_interface const surface_impl;
+
+    wl_display* const display{wl_display_create()};
+    std::vector<std::unique_ptr<Surface>> surfaces;
+
+    FakeHost(FakeHost const&) = delete;
+    FakeHost& operator=(FakeHost const&) = delete;
+};
+
+auto surface_of(wl_resource* resource) -> FakeHost::Surface*
+{
+    return static_cast<FakeHost::Surface*>(wl_resource_get_user_data(resource));
+}
+
+struct wl_surface_interface const FakeHost::surface_impl{
+    [](wl_client*, wl_resource* resource) { wl_resource_destroy(resource); },
+    [](wl_client*, wl_resource* resource, wl_resource* buffer, int32_t, int32_t)
+    {
+        surface_of(resource)->pending = buffer;
+        ++surface_of(resource)->attaches;
+    },
+    [](wl_client*, wl_resource*, int32_t, int32_t, int32_t, int32_t) {},
+    [](wl_client*, wl_resource*, uint32_t) {},
+    [](wl_client*, wl_resource*, wl_resource*) {},
+    [](wl_client*, wl_resource*, wl_resource*) {},
+    [](wl_client*, wl_resource* resource)
+    {
+        if (auto const buffer = surface_of(resource)->pending)
+            surface_of(resource)->committed = buffer;
+        surface_of(resource)->pending = nullptr;
+    },
+    [](wl_client*, wl_resource*, int32_t) {},
+    [](wl_client*, wl_resource*, int32_t) {},
+    [](wl_client*, wl_resource*, int32_t, int32_t, int32_t, int32_t) {}
+};
+
+struct PassthroughSurfaceTest : Test
+{
+    PassthroughSurfaceTest()
+    {
+        int fds[2];
+        socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds);
+        wl_client_create(host.display, fds[1]);
+        display = wl_display_connect_to_fd(fds[0]);
+
+        static wl_registry_listener const registry_listener{
+            [](void* data, wl_registry* registry, uint32_t name, char const* interface, uint32_t)
+            {
+                auto const self = static_cast<PassthroughSurfaceTest*>(data);
+                if (strcmp(interface, "wl_compositor") == 0)
+                    self->compositor = static_cast<wl_compositor*>(
+                        wl_registry_bind(registry, name, &wl_compositor_interface, 4));
+                else if (strcmp(interface, "wl_subcompositor") == 0)
+                    self->subcompositor = static_cast<wl_subcompositor*>(
+                        wl_registry_bind(registry, name, &wl_subcompositor_interface, 1));
+                else if (strcmp(interface, "wl_shm") == 0)
+                    self->shm = static_cast<wl_shm*>(wl_registry_bind(registry, name, &wl_shm_interface, 1));
+            },
+            [](void*, wl_registry*, uint32_t) {}
+        };
+
+        registry = wl_display_get_registry(display);
+        wl_registry_add_listener(registry, &registry_listener, this);
+        exchange();
+        exchange();
+
+        parent = wl_compositor_create_surface(compositor);
+        passthrough = std::make_unique<mgw::PassthroughSurface>(compositor, subcompositor, parent, 1, nullptr);
+    }
+
+    ~PassthroughSurfaceTest()
+    {
+        passthrough.reset();
+        wl_surface_destroy(parent);
+        wl_shm_destroy(shm);
+        wl_subcompositor_destroy(subcompositor);
+        wl_compositor_destroy(compositor);
+        wl_registry_destroy(registry);
+        exchange();
+        wl_display_disconnect(display);
+    }
+
+    /// Delivers our requests to the host, and its events back to us
+    void exchange()
+    {
+        wl_display_flush(display);
+        wl_event_loop_dispatch(wl_display_get_event_loop(host.display), 0);
+        wl_display_flush_clients(host.display);
+
+        while (wl_display_prepare_read(display) != 0)
+            wl_display_dispatch_pending(display);
+
+        pollfd readable{wl_display_get_fd(display), POLLIN, 0};
+        if (poll(&readable, 1, 0) > 0)
+            wl_display_read_events(display);
+        else
+            wl_display_cancel_read(display);
+
+        wl_display_dispatch_pending(display);
+    }
+
+    auto make_buffer(unsigned char fill) -> std::shared_ptr<mtd::StubBuffer>
+    {
+        auto const buffer = std::make_shared<mtd::StubBuffer>(
+            mg::BufferProperties{size, mir_pixel_format_argb_8888, mg::BufferUsage::software});
+        std::vector<unsigned char> const pixels(size.width.as_int() * size.height.as_int() * 4, fill);
+        buffer->write(pixels.data(), pixels.size());
+        return buffer;
+    }
+
+    void show(mg::Buffer& buffer)
+    {
+        passthrough->update(shm, buffer, geom::Displacement{}, parent);
+        exchange();
+    }
+
+    auto host_surface() const -> FakeHost::Surface*
+    {
+        return host.surface_for(passthrough->surface);
+    }
+
+    auto host_pixels() -> std::vector<unsigned char>
+    {
+        auto const shm_buffer = wl_shm_buffer_get(host_surface()->committed);
+        wl_shm_buffer_begin_access(shm_buffer);
+        auto const data = static_cast<unsigned char const*>(wl_shm_buffer_get_data(shm_buffer));
+        std::vector<unsigned char> pixels{data, data + wl_shm_buffer_get_stride(shm_buffer) * wl_shm_buffer_get_height(shm_buffer)};
+        wl_shm_buffer_end_access(shm_buffer);
+        return pixels;
+    }
+
+    void host_releases_shown_buffer()
+    {
+        wl_buffer_send_release(host_surface()->committed);
+        exchange();
+    }
+
+    geom::Size const size{4, 3};
+
+    FakeHost host;
+    wl_display* display{nullptr};
+    wl_registry* registry{nullptr};
+    wl_compositor* compositor{nullptr};
+    wl_subcompositor* subcompositor{nullptr};
+    wl_shm* shm{nullptr};
+    wl_surface* parent{nullptr};
+
+    std::unique_ptr<mgw::PassthroughSurface> passthrough;
+};
+}
+
+TEST_F(PassthroughSurfaceTest, host_is_shown_a_copy_of_the_client_pixels)
+{
+    auto const buffer = make_buffer(0x5a);
+
+    show(*buffer);
+
+    ASSERT_THAT(host_surface(), NotNull());
+    ASSERT_THAT(host_surface()->committed, NotNull());
+    EXPECT_THAT(host_pixels(), Each(Eq(0x5a)));
+}
+
+TEST_F(PassthroughSurfaceTest, a_buffer_already_shown_is_not_copied_again)
+{
+    auto const buffer = make_buffer(0x5a);
+
+    show(*buffer);
+    show(*buffer);
+
+    EXPECT_THAT(host_surface()->attaches, Eq(1));
+    EXPECT_TRUE(passthrough->can_show(*buffer));
+}
+
+TEST_F(PassthroughSurfaceTest, cannot_show_a_new_buffer_while_the_host_holds_both_copies)
+{
+    auto const first = make_buffer(1);
+    auto const second = make_buffer(2);
+    auto const third = make_buffer(3);
+
+    EXPECT_TRUE(passthrough->can_show(*first));
+    show(*first);
+    EXPECT_TRUE(passthrough->can_show(*second));
+    show(*second);
+
+    EXPECT_FALSE(passthrough->can_show(*third));
+    EXPECT_TRUE(passthrough->can_show(*second));
+}
+
+TEST_F(PassthroughSurfaceTest, can_show_a_new_buffer_once_the_host_releases_a_copy)
+{
+    auto const first = make_buffer(1);
+    auto const second = make_buffer(2);
+    auto const third = make_buffer(3);
+
+    show(*first);
+    host_releases_shown_buffer();
+    show(*second);
+
+    ASSERT_TRUE(passthrough->can_show(*third));
+    show(*third);
+
+    EXPECT_THAT(host_pixels(), Each(Eq(3)));
+}
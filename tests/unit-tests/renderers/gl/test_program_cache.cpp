@@ -0,0 +1,178 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/renderers/gl/program_cache.h"
+
+#include "mir/test/doubles/mock_gl.h"
+#include "mir/test/doubles/mock_egl.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
+
+namespace mrg = mir::renderer::gl;
+namespace mtd = mir::test::doubles;
+
+using namespace testing;
+
+namespace
+{
+GLenum const program_binary_length = 0x8741;
+GLenum const num_program_binary_formats = 0x87FE;
+
+GLenum const stub_format = 0x1234;
+std::string const stub_binary{"linked program"};
+GLuint const saved_program = 3;
+GLuint const loaded_program = 7;
+
+char const* const vertex_src = "vertex";
+char const* const fragment_src = "fragment";
+
+// What the fake glProgramBinaryOES was last given
+GLenum given_format;
+std::string given_binary;
+
+void fake_get_program_binary(GLuint, GLsizei size, GLsizei* length, GLenum* format, void* binary)
+{
+    *length = std::min<GLsizei>(size, stub_binary.size());
+    *format = stub_format;
+    memcpy(binary, stub_binary.data(), *length);
+}
+
+void fake_program_binary(GLuint, GLenum format, void const* binary, GLint length)
+{
+    given_format = format;
+    given_binary.assign(static_cast<char const*>(binary), length);
+}
+
+struct ProgramCache : Test
+{
+    ProgramCache()
+    {
+        char tmp_name[] = "/tmp/mir_program_cache_XXXXXX";
+        if (mkdtemp(tmp_name) == NULL)
+        {
+            throw std::system_error{errno, std::system_category(), "Failed to create temporary directory"};
+        }
+        directory = tmp_name;
+
+        given_format = 0;
+        given_binary.clear();
+
+        ON_CALL(mock_gl, glGetString(GL_EXTENSIONS))
+            .WillByDefault(Return(reinterpret_cast<GLubyte const*>("GL_OES_EGL_image GL_OES_get_program_binary")));
+        ON_CALL(mock_gl, glGetString(GL_VENDOR))
+            .WillByDefault(Return(reinterpret_cast<GLubyte const*>("vendor")));
+        ON_CALL(mock_gl, glGetString(GL_RENDERER))
+            .WillByDefault(Invoke([this](GLenum) { return reinterpret_cast<GLubyte const*>(renderer.c_str()); }));
+        ON_CALL(mock_gl, glGetString(GL_VERSION))
+            .WillByDefault(Return(reinterpret_cast<GLubyte const*>("version")));
+        ON_CALL(mock_gl, glGetIntegerv(num_program_binary_formats, _))
+            .WillByDefault(SetArgPointee<1>(1));
+        ON_CALL(mock_gl, glGetProgramiv(saved_program, program_binary_length, _))
+            .WillByDefault(SetArgPointee<2>(stub_binary.size()));
+        ON_CALL(mock_gl, glCreateProgram())
+            .WillByDefault(Return(loaded_program));
+
+        ON_CALL(mock_egl, eglGetProcAddress(StrEq("glGetProgramBinaryOES")))
+            .WillByDefault(Return(reinterpret_cast<mtd::MockEGL::generic_function_pointer_t>(&fake_get_program_binary)));
+        ON_CALL(mock_egl, eglGetProcAddress(StrEq("glProgramBinaryOES")))
+            .WillByDefault(Return(reinterpret_cast<mtd::MockEGL::generic_function_pointer_t>(&fake_program_binary)));
+    }
+
+    ~ProgramCache()
+    {
+        if (auto const dir = opendir(directory.c_str()))
+        {
+            while (auto const entry = readdir(dir))
+                unlink((directory + "/" + entry->d_name).c_str());
+            closedir(dir);
+        }
+        rmdir(directory.c_str());
+    }
+
+    NiceMock<mtd::MockGL> mock_gl;
+    NiceMock<mtd::MockEGL> mock_egl;
+    std::string directory;
+    std::string renderer{"renderer"};
+};
+}
+
+TEST_F(ProgramCache, links_a_stored_program_from_its_binary_in_a_later_run)
+{
+    mrg::ProgramCache{directory}.store(saved_program, vertex_src, fragment_src);
+
+    mrg::ProgramCache cache{directory};
+
+    EXPECT_THAT(cache.load(vertex_src, fragment_src), Eq(loaded_program));
+    EXPECT_THAT(given_format, Eq(stub_format));
+    EXPECT_THAT(given_binary, Eq(stub_binary));
+}
+
+TEST_F(ProgramCache, misses_for_other_shader_sources)
+{
+    mrg::ProgramCache cache{directory};
+    cache.store(saved_program, vertex_src, fragment_src);
+
+    EXPECT_THAT(cache.load(vertex_src, "other fragment"), Eq(0u));
+}
+
+TEST_F(ProgramCache, misses_for_another_gl_renderer)
+{
+    mrg::ProgramCache{directory}.store(saved_program, vertex_src, fragment_src);
+
+    renderer = "another renderer";
+    mrg::ProgramCache cache{directory};
+
+    EXPECT_CALL(mock_gl, glCreateProgram()).Times(0);
+    EXPECT_THAT(cache.load(vertex_src, fragment_src), Eq(0u));
+}
+
+TEST_F(ProgramCache, forgets_a_binary_the_driver_rejects)
+{
+    mrg::ProgramCache{directory}.store(saved_program, vertex_src, fragment_src);
+
+    {
+        mrg::ProgramCache cache{directory};
+        EXPECT_CALL(mock_gl, glGetProgramiv(loaded_program, GL_LINK_STATUS, _))
+            .WillOnce(SetArgPointee<2>(GL_FALSE));
+        EXPECT_CALL(mock_gl, glDeleteProgram(loaded_program));
+
+        EXPECT_THAT(cache.load(vertex_src, fragment_src), Eq(0u));
+    }
+
+    EXPECT_THAT(mrg::ProgramCache{directory}.load(vertex_src, fragment_src), Eq(0u));
+}
+
+TEST_F(ProgramCache, does_nothing_without_driver_support)
+{
+    ON_CALL(mock_gl, glGetString(GL_EXTENSIONS))
+        .WillByDefault(Return(reinterpret_cast<GLubyte const*>("GL_OES_EGL_image")));
+    mrg::ProgramCache cache{directory};
+
+    EXPECT_CALL(mock_gl, glGetProgramiv(_, _, _)).Times(0);
+    EXPECT_CALL(mock_gl, glCreateProgram()).Times(0);
+
+    cache.store(saved_program, vertex_src, fragment_src);
+    EXPECT_THAT(cache.load(vertex_src, fragment_src), Eq(0u));
+}
@@ -0,0 +1,260 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/renderers/sw/renderer.h"
+#include "mir/renderer/sw/pixel_target.h"
+#include "mir/geometry/rectangles.h"
+#include "mir/graphics/buffer_properties.h"
+#include "mir/thread/parallel_pool.h"
+
+#include "mir/test/doubles/fake_renderable.h"
+#include "mir/test/doubles/stub_buffer.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <mutex>
+
+namespace mg = mir::graphics;
+namespace mrs = mir::renderer::software;
+namespace mtd = mir::test::doubles;
+namespace geom = mir::geometry;
+
+using namespace testing;
+
+namespace
+{
+/// What the target holds where nothing has been drawn
+uint32_t const poison{0xdeadbeef};
+
+struct FakePixelTarget : mrs::PixelTarget
+{
+    FakePixelTarget(geom::Size size) :
+        target_size{size},
+        pixels(size.width.as_int() * size.height.as_int(), poison)
+    {
+    }
+
+    unsigned char* map_pixels() override { return reinterpret_cast<unsigned char*>(pixels.data()); }
+    geom::Size size() const override { return target_size; }
+    geom::Stride stride() const override { return geom::Stride{target_size.width.as_int() * 4}; }
+    unsigned buffer_age() const override { return age; }
+    bool applies_transformation() const override { return false; }
+    void commit(geom::Rectangles const& damage) override { committed_damage = damage; }
+
+    uint32_t pixel_at(int x, int y) const { return pixels[y * target_size.width.as_int() + x]; }
+
+    geom::Size const target_size;
+    std::vector<uint32_t> pixels;
+    unsigned age{1};
+    geom::Rectangles committed_damage;
+};
+
+auto buffer_filled_with(uint32_t pixel, MirPixelFormat format = mir_pixel_format_argb_8888, geom::Size size = {4, 4})
+-> std::shared_ptr<mtd::StubBuffer>
+{
+    auto const buffer = std::make_shared<mtd::StubBuffer>(
+        mg::BufferProperties{size, format, mg::BufferUsage::software});
+    std::vector<uint32_t> const pixels(size.width.as_int() * size.height.as_int(), pixel);
+    buffer->write(reinterpret_cast<unsigned char const*>(pixels.data()), pixels.size() * 4);
+    return buffer;
+}
+
+/// Takes a (non-recursive) lock while its pixels are read, as WlShmBuffer does
+struct LockingBuffer : mtd::StubBuffer
+{
+    LockingBuffer(std::vector<mrs::PixelSource*>& reads) :
+        StubBuffer{mg::BufferProperties{{4, 4}, mir_pixel_format_argb_8888, mg::BufferUsage::software}},
+        reads{reads}
+    {
+    }
+
+    void read(std::function<void(unsigned char const*)> const& do_with_pixels) override
+    {
+        std::unique_lock<std::mutex> lock{mutex, std::try_to_lock};
+        ASSERT_TRUE(lock.owns_lock()) << "buffer read while already being read";
+        reads.push_back(this);
+        StubBuffer::read(do_with_pixels);
+    }
+
+    std::mutex mutex;
+    std::vector<mrs::PixelSource*>& reads;
+};
+
+auto renderable_at(geom::Rectangle const& rect, std::shared_ptr<mg::Buffer> const& buffer, float alpha = 1.0f, bool shaped = false)
+-> std::shared_ptr<mtd::FakeRenderable>
+{
+    auto const renderable = std::make_shared<mtd::FakeRenderable>(rect, alpha, !shaped);
+    renderable->set_buffer(buffer);
+    return renderable;
+}
+
+struct SoftwareRenderer : Test
+{
+    FakePixelTarget target{{16, 16}};
+    mrs::Renderer renderer{target, std::make_shared<mir::thread::ParallelPool>(0)};
+
+    geom::Rectangle const window{{2, 2}, {4, 4}};
+};
+}
+
+TEST_F(SoftwareRenderer, draws_opaque_buffer_at_its_position_over_cleared_output)
+{
+    renderer.render({renderable_at(window, buffer_filled_with(0xff102030))});
+
+    EXPECT_THAT(target.pixel_at(2, 2) & 0x00ffffff, Eq(0x102030u));
+    EXPECT_THAT(target.pixel_at(5, 5) & 0x00ffffff, Eq(0x102030u));
+    EXPECT_THAT(target.pixel_at(6, 6), Eq(0u));
+    EXPECT_THAT(target.pixel_at(0, 0), Eq(0u));
+}
+
+TEST_F(SoftwareRenderer, blends_shaped_buffer_over_what_is_below)
+{
+    renderer.render({
+        renderable_at(window, buffer_filled_with(0xff0000ff)),
+        renderable_at(window, buffer_filled_with(0x80800000), 1.0f, true)});
+
+    // Premultiplied half-transparent red over opaque blue
+    auto const pixel = target.pixel_at(3, 3);
+    EXPECT_THAT((pixel >> 16) & 0xff, Eq(0x80u));
+    EXPECT_THAT(pixel & 0xff, AllOf(Ge(0x7eu), Le(0x7fu)));
+}
+
+TEST_F(SoftwareRenderer, swaps_red_and_blue_of_abgr_buffers)
+{
+    renderer.render({renderable_at(window, buffer_filled_with(0xff102030, mir_pixel_format_abgr_8888))});
+
+    EXPECT_THAT(target.pixel_at(3, 3) & 0x00ffffff, Eq(0x302010u));
+}
+
+TEST_F(SoftwareRenderer, commits_no_damage_and_draws_nothing_when_nothing_changed)
+{
+    mg::RenderableList const scene{renderable_at(window, buffer_filled_with(0xff102030))};
+    renderer.render(scene);
+
+    target.pixels.assign(target.pixels.size(), poison);
+    renderer.render(scene);
+
+    EXPECT_THAT(target.committed_damage.size(), Eq(0u));
+    EXPECT_THAT(target.pixel_at(3, 3), Eq(poison));
+}
+
+TEST_F(SoftwareRenderer, redraws_only_where_a_moved_renderable_was_and_is)
+{
+    auto const buffer = buffer_filled_with(0xff102030);
+    renderer.render({renderable_at(window, buffer)});
+
+    target.pixels.assign(target.pixels.size(), poison);
+    geom::Rectangle const moved{{10, 10}, window.size};
+    renderer.render({renderable_at(moved, buffer)});
+
+    EXPECT_THAT(target.pixel_at(3, 3), Eq(0u));
+    EXPECT_THAT(target.pixel_at(11, 11) & 0x00ffffff, Eq(0x102030u));
+    EXPECT_THAT(target.pixel_at(8, 8), Eq(poison));
+    EXPECT_THAT(target.committed_damage, Eq(geom::Rectangles{window, moved}));
+}
+
+TEST_F(SoftwareRenderer, redraws_renderable_with_new_buffer)
+{
+    auto const renderable = renderable_at(window, buffer_filled_with(0xff102030));
+    mg::RenderableList const scene{renderable};
+    renderer.render(scene);
+
+    renderable->set_buffer(buffer_filled_with(0xff405060));
+    renderer.render(scene);
+
+    EXPECT_THAT(target.pixel_at(3, 3) & 0x00ffffff, Eq(0x405060u));
+    EXPECT_THAT(target.committed_damage, Eq(geom::Rectangles{window}));
+}
+
+TEST_F(SoftwareRenderer, redraws_everything_when_buffer_contents_are_unknown)
+{
+    mg::RenderableList const scene{renderable_at(window, buffer_filled_with(0xff102030))};
+    renderer.render(scene);
+
+    target.pixels.assign(target.pixels.size(), poison);
+    target.age = 0;
+    renderer.render(scene);
+
+    EXPECT_THAT(target.pixel_at(3, 3) & 0x00ffffff, Eq(0x102030u));
+    EXPECT_THAT(target.pixel_at(15, 15), Eq(0u));
+}
+
+TEST_F(SoftwareRenderer, repairs_damage_of_previous_frames_for_older_buffers)
+{
+    auto const buffer = buffer_filled_with(0xff102030);
+    renderer.render({renderable_at(window, buffer)});
+
+    geom::Rectangle const moved{{10, 10}, window.size};
+    renderer.render({renderable_at(moved, buffer)});
+
+    // Back to a buffer last drawn two frames ago, when the window was at its original position
+    target.pixels.assign(target.pixels.size(), poison);
+    target.age = 2;
+    geom::Rectangle const moved_again{{10, 2}, window.size};
+    renderer.render({renderable_at(moved_again, buffer)});
+
+    EXPECT_THAT(target.pixel_at(3, 3), Eq(0u));
+    EXPECT_THAT(target.pixel_at(11, 11), Eq(0u));
+    EXPECT_THAT(target.pixel_at(11, 3) & 0x00ffffff, Eq(0x102030u));
+    EXPECT_THAT(target.pixel_at(0, 15), Eq(poison));
+}
+
+TEST_F(SoftwareRenderer, draws_the_same_in_parallel_bands)
+{
+    FakePixelTarget large_target{{256, 256}};
+    mrs::Renderer parallel_renderer{large_target, std::make_shared<mir::thread::ParallelPool>(3)};
+    FakePixelTarget reference_target{{256, 256}};
+    mrs::Renderer reference_renderer{reference_target, std::make_shared<mir::thread::ParallelPool>(0)};
+
+    mg::RenderableList const scene{
+        renderable_at({{0, 0}, {200, 200}}, buffer_filled_with(0xff0000ff, mir_pixel_format_argb_8888, {200, 200})),
+        renderable_at({{50, 50}, {200, 200}}, buffer_filled_with(0x80800000, mir_pixel_format_argb_8888, {100, 100}), 1.0f, true),
+        renderable_at({{20, 120}, {64, 64}}, buffer_filled_with(0xff00ff00, mir_pixel_format_xbgr_8888, {64, 64}), 0.5f)};
+
+    parallel_renderer.render(scene);
+    reference_renderer.render(scene);
+
+    EXPECT_THAT(large_target.pixels, Eq(reference_target.pixels));
+}
+
+TEST_F(SoftwareRenderer, reads_a_buffer_shown_twice_once)
+{
+    std::vector<mrs::PixelSource*> reads;
+    auto const buffer = std::make_shared<LockingBuffer>(reads);
+
+    renderer.render({
+        renderable_at(window, buffer),
+        renderable_at({{8, 8}, window.size}, buffer)});
+
+    EXPECT_THAT(reads, ElementsAre(buffer.get()));
+}
+
+TEST_F(SoftwareRenderer, reads_buffers_in_the_same_order_whatever_their_stacking)
+{
+    std::vector<mrs::PixelSource*> reads;
+    auto const a = std::make_shared<LockingBuffer>(reads);
+    auto const b = std::make_shared<LockingBuffer>(reads);
+    FakePixelTarget other_target{{16, 16}};
+    mrs::Renderer other_renderer{other_target, std::make_shared<mir::thread::ParallelPool>(0)};
+
+    renderer.render({renderable_at(window, a), renderable_at({{8, 8}, window.size}, b)});
+    auto const order = reads;
+    reads.clear();
+    other_renderer.render({renderable_at(window, b), renderable_at({{8, 8}, window.size}, a)});
+
+    EXPECT_THAT(reads, Eq(order));
+}
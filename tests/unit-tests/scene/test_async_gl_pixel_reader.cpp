@@ -0,0 +1,210 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/scene/async_gl_pixel_reader.h"
+#include "mir/renderer/gl/context.h"
+
+#include "mir/test/doubles/mock_gl_buffer.h"
+#include "mir/test/doubles/mock_gl.h"
+#include "mir/test/doubles/mock_egl.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <GLES2/gl2ext.h>
+
+namespace geom = mir::geometry;
+namespace ms = mir::scene;
+namespace mtd = mir::test::doubles;
+namespace mrgl = mir::renderer::gl;
+
+namespace
+{
+GLenum const pixel_pack_buffer{0x88EB};
+GLenum const already_signaled{0x911A};
+GLenum const timeout_expired{0x911B};
+
+GLenum fence_status{already_signaled};
+std::vector<uint32_t> pbo_contents;
+
+void* fake_glMapBufferRange(GLenum, GLintptr, GLsizeiptr, GLbitfield)
+{
+    return pbo_contents.data();
+}
+
+GLboolean fake_glUnmapBuffer(GLenum)
+{
+    return GL_TRUE;
+}
+
+void* fake_glFenceSync(GLenum, GLbitfield)
+{
+    static int fence;
+    return &fence;
+}
+
+GLenum fake_glClientWaitSync(void*, GLbitfield, uint64_t)
+{
+    return fence_status;
+}
+
+void fake_glDeleteSync(void*)
+{
+}
+
+struct StubGLContext : public mrgl::Context
+{
+    void make_current() const override {}
+    void release_current() const override {}
+};
+
+struct AsyncGLPixelReaderTest : public ::testing::Test
+{
+    AsyncGLPixelReaderTest()
+    {
+        using namespace testing;
+
+        fence_status = already_signaled;
+        pbo_contents.clear();
+
+        ON_CALL(mock_buffer, size())
+            .WillByDefault(Return(size));
+    }
+
+    void provide_pbos_and_fences()
+    {
+        using namespace testing;
+        typedef mtd::MockEGL::generic_function_pointer_t func_ptr_t;
+
+        static GLubyte const version[] = "OpenGL ES 3.0 Mesa";
+        ON_CALL(mock_gl, glGetString(GL_VERSION))
+            .WillByDefault(Return(version));
+
+        ON_CALL(mock_egl, eglGetProcAddress(StrEq("glMapBufferRange")))
+            .WillByDefault(Return(reinterpret_cast<func_ptr_t>(&fake_glMapBufferRange)));
+        ON_CALL(mock_egl, eglGetProcAddress(StrEq("glUnmapBuffer")))
+            .WillByDefault(Return(reinterpret_cast<func_ptr_t>(&fake_glUnmapBuffer)));
+        ON_CALL(mock_egl, eglGetProcAddress(StrEq("glFenceSync")))
+            .WillByDefault(Return(reinterpret_cast<func_ptr_t>(&fake_glFenceSync)));
+        ON_CALL(mock_egl, eglGetProcAddress(StrEq("glClientWaitSync")))
+            .WillByDefault(Return(reinterpret_cast<func_ptr_t>(&fake_glClientWaitSync)));
+        ON_CALL(mock_egl, eglGetProcAddress(StrEq("glDeleteSync")))
+            .WillByDefault(Return(reinterpret_cast<func_ptr_t>(&fake_glDeleteSync)));
+    }
+
+    geom::Size const size{4, 4};
+    testing::NiceMock<mtd::MockGL> mock_gl;
+    testing::NiceMock<mtd::MockEGL> mock_egl;
+    testing::NiceMock<mtd::MockGLBuffer> mock_buffer;
+};
+}
+
+TEST_F(AsyncGLPixelReaderTest, without_pbos_reads_complete_synchronously)
+{
+    using namespace testing;
+
+    EXPECT_CALL(mock_gl, glReadPixels(_, _, _, _, _, _, _)).Times(AnyNumber());
+    EXPECT_CALL(mock_gl, glReadPixels(0, 0, 4, 4, _, GL_UNSIGNED_BYTE, NotNull()));
+
+    ms::AsyncGLPixelReader reader{std::make_unique<StubGLContext>()};
+    EXPECT_FALSE(reader.is_asynchronous());
+
+    bool delivered{false};
+    reader.read(mock_buffer, [&](ms::Snapshot const& snapshot)
+        {
+            delivered = true;
+            EXPECT_THAT(snapshot.size, Eq(size));
+            EXPECT_THAT(snapshot.stride, Eq(geom::Stride{16}));
+        });
+
+    EXPECT_TRUE(delivered);
+    EXPECT_FALSE(reader.has_pending());
+}
+
+TEST_F(AsyncGLPixelReaderTest, reads_into_pixel_pack_buffer_and_delivers_when_fence_signals)
+{
+    using namespace testing;
+    provide_pbos_and_fences();
+    GLuint const pbo{7};
+
+    ON_CALL(mock_gl, glGenBuffers(1, _))
+        .WillByDefault(SetArgPointee<1>(pbo));
+
+    EXPECT_CALL(mock_gl, glBindBuffer(_, _)).Times(AnyNumber());
+    EXPECT_CALL(mock_gl, glBindBuffer(pixel_pack_buffer, pbo)).Times(AtLeast(1));
+    EXPECT_CALL(mock_gl, glReadPixels(_, _, _, _, _, _, _)).Times(AnyNumber());
+    EXPECT_CALL(mock_gl, glReadPixels(0, 0, 4, 4, _, GL_UNSIGNED_BYTE, nullptr));
+
+    ms::AsyncGLPixelReader reader{std::make_unique<StubGLContext>()};
+    EXPECT_TRUE(reader.is_asynchronous());
+
+    pbo_contents.assign(16, 0);
+    for (auto i = 0u; i != pbo_contents.size(); ++i)
+        pbo_contents[i] = i;
+
+    bool delivered{false};
+    uint32_t top_left{0};
+    reader.read(mock_buffer, [&](ms::Snapshot const& snapshot)
+        {
+            delivered = true;
+            top_left = static_cast<uint32_t const*>(snapshot.pixels)[0];
+        });
+
+    EXPECT_FALSE(delivered);
+    EXPECT_TRUE(reader.has_pending());
+
+    fence_status = timeout_expired;
+    reader.dispatch_completed();
+    EXPECT_FALSE(delivered);
+
+    fence_status = already_signaled;
+    reader.dispatch_completed();
+    EXPECT_TRUE(delivered);
+    EXPECT_FALSE(reader.has_pending());
+
+    /* The first row read is the bottom row of the image */
+    EXPECT_THAT(top_left, Eq(12u));
+}
+
+TEST_F(AsyncGLPixelReaderTest, damaged_read_only_transfers_damaged_region)
+{
+    using namespace testing;
+    provide_pbos_and_fences();
+
+    ms::AsyncGLPixelReader reader{std::make_unique<StubGLContext>()};
+
+    pbo_contents.assign(16, 0);
+    reader.read(mock_buffer, [](ms::Snapshot const&){});
+    reader.flush();
+
+    /* Rows run bottom to top for GL, so y=1,h=2 of 4 starts at GL row 1 */
+    EXPECT_CALL(mock_gl, glReadPixels(_, _, _, _, _, _, _)).Times(0);
+    EXPECT_CALL(mock_gl, glReadPixels(2, 1, 1, 2, _, GL_UNSIGNED_BYTE, nullptr));
+
+    pbo_contents.assign({0xaa, 0xbb});
+    std::vector<uint32_t> result;
+    reader.read(mock_buffer, {geom::Rectangle{{2, 1}, {1, 2}}}, [&](ms::Snapshot const& snapshot)
+        {
+            auto const pixels = static_cast<uint32_t const*>(snapshot.pixels);
+            result.assign(pixels, pixels + 16);
+        });
+    reader.flush();
+
+    ASSERT_THAT(result.size(), Eq(16u));
+    EXPECT_THAT(result[1*4 + 2], Eq(0xbbu));
+    EXPECT_THAT(result[2*4 + 2], Eq(0xaau));
+    EXPECT_THAT(result[0], Eq(0u));
+}
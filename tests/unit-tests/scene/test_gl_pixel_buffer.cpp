@@ -225,3 +225,68 @@ TEST_F(GLPixelBufferTest, returns_data_from_rgba_buffer_texture)
     EXPECT_EQ(width - 1,
               static_cast<uint32_t const*>(data)[width * height - 1]);
 }
+
+TEST_F(GLPixelBufferTest, remembers_working_read_format)
+{
+    using namespace testing;
+    uint32_t const width{mock_buffer.size().width.as_uint32_t()};
+    uint32_t const height{mock_buffer.size().height.as_uint32_t()};
+
+    EXPECT_CALL(mock_context, make_current()).Times(AnyNumber());
+    EXPECT_CALL(mock_gl, glGetError())
+        .WillOnce(Return(GL_NO_ERROR))
+        .WillOnce(Return(GL_INVALID_ENUM));
+    EXPECT_CALL(mock_gl, glReadPixels(0, 0, width, height,
+                                      GL_BGRA_EXT, GL_UNSIGNED_BYTE, _))
+        .Times(1);
+    EXPECT_CALL(mock_gl, glReadPixels(0, 0, width, height,
+                                      GL_RGBA, GL_UNSIGNED_BYTE, _))
+        .Times(2);
+
+    ms::GLPixelBuffer pixels{std::move(context)};
+
+    pixels.fill_from(mock_buffer);
+    pixels.fill_from(mock_buffer);
+}
+
+TEST_F(GLPixelBufferTest, scales_buffer_down_on_gpu_before_reading)
+{
+    using namespace testing;
+    GLuint const tex{10};
+    GLuint const scaled_tex{11};
+    geom::Size const max_size{17, 50};
+    geom::Size const scaled_size{17, 23};
+
+    EXPECT_CALL(mock_context, make_current()).Times(AnyNumber());
+    EXPECT_CALL(mock_gl, glGenTextures(_,_))
+        .WillOnce(SetArgPointee<1>(tex))
+        .WillOnce(SetArgPointee<1>(scaled_tex));
+    EXPECT_CALL(mock_gl, glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 17, 23, 0, GL_RGBA, GL_UNSIGNED_BYTE, _));
+    EXPECT_CALL(mock_gl, glFramebufferTexture2D(_,_,_,scaled_tex,0));
+    EXPECT_CALL(mock_gl, glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+    EXPECT_CALL(mock_gl, glReadPixels(0, 0, 17, 23, _, GL_UNSIGNED_BYTE, _));
+
+    ms::GLPixelBuffer pixels{std::move(context)};
+
+    pixels.fill_scaled_from(mock_buffer, max_size);
+
+    EXPECT_EQ(scaled_size, pixels.size());
+    EXPECT_EQ(geom::Stride{17 * 4}, pixels.stride());
+}
+
+TEST_F(GLPixelBufferTest, does_not_scale_buffer_that_fits)
+{
+    using namespace testing;
+    uint32_t const width{mock_buffer.size().width.as_uint32_t()};
+    uint32_t const height{mock_buffer.size().height.as_uint32_t()};
+
+    EXPECT_CALL(mock_context, make_current()).Times(AnyNumber());
+    EXPECT_CALL(mock_gl, glDrawArrays(_,_,_)).Times(0);
+    EXPECT_CALL(mock_gl, glReadPixels(0, 0, width, height, _, GL_UNSIGNED_BYTE, _));
+
+    ms::GLPixelBuffer pixels{std::move(context)};
+
+    pixels.fill_scaled_from(mock_buffer, geom::Size{width, height});
+
+    EXPECT_EQ(mock_buffer.size(), pixels.size());
+}
@@ -18,13 +18,16 @@
 
 #include "src/server/scene/mediating_display_changer.h"
 #include "mir/scene/session_container.h"
+#include "mir/compositor/sync_group_compositor.h"
 #include "mir/graphics/display_configuration_policy.h"
+#include "mir/graphics/per_output_reconfiguration.h"
 #include "mir/geometry/rectangles.h"
 #include "src/server/scene/broadcasting_session_event_sink.h"
 #include "mir/server_action_queue.h"
 
 #include "mir/test/doubles/mock_display.h"
 #include "mir/test/doubles/mock_compositor.h"
+#include "mir/test/doubles/null_display_sync_group.h"
 #include "mir/test/doubles/null_display_configuration.h"
 #include "mir/test/doubles/stub_display_configuration.h"
 #include "mir/test/doubles/mock_scene_session.h"
@@ -45,6 +48,7 @@ namespace mtd = mir::test::doubles;
 namespace mf = mir::frontend;
 namespace ms = mir::scene;
 namespace mg = mir::graphics;
+namespace mc = mir::compositor;
 namespace geom = mir::geometry;
 
 using namespace testing;
@@ -77,6 +81,20 @@ struct MockDisplay : public mtd::MockDisplay
     std::unique_ptr<mg::DisplayConfiguration> config;
 };
 
+struct MockPerOutputReconfiguration : mg::NativeDisplay, mg::PerOutputReconfiguration
+{
+    MOCK_METHOD3(configure_changed_outputs, void(
+        mg::DisplayConfiguration const&,
+        std::function<void(mg::DisplaySyncGroup&)> const&,
+        std::function<void(mg::DisplaySyncGroup&)> const&));
+};
+
+struct MockSyncGroupCompositor : mtd::MockCompositor, mc::SyncGroupCompositor
+{
+    MOCK_METHOD1(stop_compositing_to, void(mg::DisplaySyncGroup&));
+    MOCK_METHOD1(start_compositing_to, void(mg::DisplaySyncGroup&));
+};
+
 struct StubServerActionQueue : mir::ServerActionQueue
 {
     void enqueue(void const* /*owner*/, mir::ServerAction const& action) override
@@ -183,6 +201,21 @@ TEST_F(MediatingDisplayChangerTest, does_not_pause_system_when_applying_new_conf
                        mt::fake_shared(conf));
 }
 
+TEST_F(MediatingDisplayChangerTest, does_not_touch_display_when_configuration_is_unchanged)
+{
+    using namespace testing;
+    std::shared_ptr<mg::DisplayConfiguration> const conf = mock_display.configuration();
+    auto session = std::make_shared<mtd::StubSession>();
+
+    EXPECT_CALL(mock_display, apply_if_configuration_preserves_display_buffers(_)).Times(0);
+    EXPECT_CALL(mock_compositor, stop()).Times(0);
+    EXPECT_CALL(mock_compositor, start()).Times(0);
+    EXPECT_CALL(mock_display, configure(_)).Times(0);
+
+    session_event_sink.handle_focus_change(session);
+    changer->configure(session, conf);
+}
+
 TEST_F(MediatingDisplayChangerTest, sends_error_when_applying_new_configuration_for_focused_session_fails)
 {
     using namespace testing;
@@ -323,8 +356,8 @@ TEST_F(MediatingDisplayChangerTest, handles_hardware_change_when_display_buffers
     EXPECT_CALL(mock_conf_policy, apply_to(Ref(*conf)));
 
     /*
-     * Currently we have to tear down and recreate the compositor in order to add
-     * a new output. This is not an inherent limitation, and we might do better later.
+     * Unless the display can reconfigure just the changed outputs we have to tear
+     * down and recreate the compositor in order to add a new output.
      */
     EXPECT_CALL(mock_compositor, stop()).Times(1);
     EXPECT_CALL(mock_display, configure(Ref(*conf)));
@@ -333,6 +366,48 @@ TEST_F(MediatingDisplayChangerTest, handles_hardware_change_when_display_buffers
     changer->configure_for_hardware_change(conf);
 }
 
+TEST_F(MediatingDisplayChangerTest, only_recomposites_changed_outputs_when_display_and_compositor_support_it)
+{
+    using namespace testing;
+
+    NiceMock<MockPerOutputReconfiguration> per_output_display;
+    NiceMock<MockSyncGroupCompositor> sync_group_compositor;
+    mtd::NullDisplaySyncGroup retired_group;
+    mtd::NullDisplaySyncGroup added_group;
+
+    ON_CALL(mock_display, native_display()).WillByDefault(Return(&per_output_display));
+
+    ms::MediatingDisplayChanger changer{
+        mt::fake_shared(mock_display),
+        mt::fake_shared(sync_group_compositor),
+        mt::fake_shared(mock_conf_policy),
+        mt::fake_shared(session_container),
+        mt::fake_shared(session_event_sink),
+        mt::fake_shared(server_action_queue),
+        mt::fake_shared(display_configuration_observer),
+        mt::fake_shared(alarm_factory)};
+
+    auto conf = changer.base_configuration();
+    conf->for_each_output([](mg::UserDisplayConfigurationOutput& output) { output.used = true; });
+
+    EXPECT_CALL(sync_group_compositor, stop()).Times(0);
+    EXPECT_CALL(mock_display, configure(_)).Times(0);
+    EXPECT_CALL(sync_group_compositor, start()).Times(0);
+
+    InSequence s;
+    EXPECT_CALL(per_output_display, configure_changed_outputs(Ref(*conf), _, _))
+        .WillOnce(Invoke(
+            [&](auto const&, auto const& retiring, auto const& added)
+            {
+                retiring(retired_group);
+                added(added_group);
+            }));
+    EXPECT_CALL(sync_group_compositor, stop_compositing_to(Ref(retired_group)));
+    EXPECT_CALL(sync_group_compositor, start_compositing_to(Ref(added_group)));
+
+    changer.configure_for_hardware_change(conf);
+}
+
 TEST_F(MediatingDisplayChangerTest, hardware_change_doesnt_apply_base_config_if_per_session_config_is_active)
 {
     using namespace testing;
@@ -451,8 +526,8 @@ TEST_F(MediatingDisplayChangerTest, focusing_a_session_with_db_preserving_but_ou
     changer->configure(session1, conf);
 
     /*
-     * Currently we have to tear down and recreate the compositor in order to add
-     * a new output. This is not an inherent limitation, and we might do better later.
+     * Unless the display can reconfigure just the changed outputs we have to tear
+     * down and recreate the compositor in order to add a new output.
      */
     InSequence s;
     EXPECT_CALL(mock_compositor, stop()).Times(1);
@@ -894,7 +969,11 @@ TEST_F(MediatingDisplayChangerTest, reverts_to_previous_configuration_on_timeout
     auto applied_config = old_config->clone();
 
     ON_CALL(mock_display, configure(_))
-        .WillByDefault(Invoke([&applied_config](auto& conf) { applied_config = conf.clone(); }));
+        .WillByDefault(Invoke([this, &applied_config](auto& conf)
+            {
+                applied_config = conf.clone();
+                mock_display.config = conf.clone();
+            }));
 
     auto mock_session = std::make_shared<NiceMock<mtd::MockSceneSession>>();
 
@@ -987,7 +1066,11 @@ TEST_F(MediatingDisplayChangerTest, confirmed_configuration_doesnt_revert_after_
     ASSERT_THAT(applied_config, Not(Eq(nullptr)));
 
     ON_CALL(mock_display, configure(_))
-        .WillByDefault(Invoke([&applied_config](auto& conf) { applied_config = conf.clone(); }));
+        .WillByDefault(Invoke([this, &applied_config](auto& conf)
+            {
+                applied_config = conf.clone();
+                mock_display.config = conf.clone();
+            }));
 
     auto mock_session = std::make_shared<NiceMock<mtd::MockSceneSession>>();
 
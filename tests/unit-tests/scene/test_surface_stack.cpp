@@ -337,6 +337,173 @@ TEST_F(SurfaceStack, scene_doesnt_count_pending_frames_from_partially_exposed_su
     EXPECT_EQ(0, stack.frames_pending(comp2));
 }
 
+TEST_F(SurfaceStack, scene_doesnt_recheck_idle_surfaces_for_pending_frames)
+{
+    using namespace testing;
+
+    ms::SurfaceStack stack{report};
+    stack.register_compositor(this);
+    auto stream = std::make_shared<NiceMock<mtd::MockBufferStream>>();
+    auto surface = std::make_shared<ms::BasicSurface>(
+        nullptr /* session */,
+        std::string("stub"),
+        geom::Rectangle{{},{}},
+        mir_pointer_unconfined,
+        std::list<ms::StreamInfo> { { stream, {}, {} } },
+        std::shared_ptr<mg::CursorImage>(),
+        report);
+    stack.add_surface(surface, default_params.input_mode);
+
+    EXPECT_CALL(*stream, buffers_ready_for_compositor(_)).Times(1);
+
+    EXPECT_EQ(0, stack.frames_pending(this));
+    EXPECT_EQ(0, stack.frames_pending(this));
+    EXPECT_EQ(0, stack.frames_pending(this));
+}
+
+TEST_F(SurfaceStack, scene_counts_frames_posted_while_occluded_once_exposed_again)
+{
+    using namespace testing;
+
+    ms::SurfaceStack stack{report};
+    stack.register_compositor(this);
+    auto stream = std::make_shared<mc::Stream>(geom::Size{ 1, 1 }, mir_pixel_format_abgr_8888);
+    auto surface = std::make_shared<ms::BasicSurface>(
+        nullptr /* session */,
+        std::string("stub"),
+        geom::Rectangle{{},{}},
+        mir_pointer_unconfined,
+        std::list<ms::StreamInfo> { { stream, {}, {} } },
+        std::shared_ptr<mg::CursorImage>(),
+        report);
+    stack.add_surface(surface, default_params.input_mode);
+    post_a_frame(*stream);
+
+    for (auto const& elem : stack.scene_elements_for(this))
+        elem->occluded();
+    post_a_frame(*stream);
+    ASSERT_EQ(0, stack.frames_pending(this));
+
+    for (auto const& elem : stack.scene_elements_for(this))
+        elem->rendered();
+    EXPECT_EQ(1, stack.frames_pending(this));
+}
+
+TEST_F(SurfaceStack, scene_counts_frames_posted_while_hidden_once_shown)
+{
+    using namespace testing;
+
+    ms::SurfaceStack stack{report};
+    stack.register_compositor(this);
+    auto stream = std::make_shared<mc::Stream>(geom::Size{ 1, 1 }, mir_pixel_format_abgr_8888);
+    auto surface = std::make_shared<ms::BasicSurface>(
+        nullptr /* session */,
+        std::string("stub"),
+        geom::Rectangle{{},{}},
+        mir_pointer_unconfined,
+        std::list<ms::StreamInfo> { { stream, {}, {} } },
+        std::shared_ptr<mg::CursorImage>(),
+        report);
+    stack.add_surface(surface, default_params.input_mode);
+
+    surface->hide();
+    post_a_frame(*stream);
+    ASSERT_EQ(0, stack.frames_pending(this));
+
+    surface->show();
+    EXPECT_EQ(1, stack.frames_pending(this));
+}
+
+TEST_F(SurfaceStack, scene_elements_omit_surfaces_outside_the_compositor_area)
+{
+    using namespace testing;
+
+    ms::SurfaceStack stack{report};
+    auto const comp1 = reinterpret_cast<mc::CompositorID>(0);
+    auto const comp2 = reinterpret_cast<mc::CompositorID>(1);
+    stack.register_compositor(comp1);
+    stack.register_compositor(comp2);
+    stack.set_compositor_area(comp1, {{0, 0}, {100, 100}});
+    stack.set_compositor_area(comp2, {{100, 0}, {100, 100}});
+
+    auto stream = std::make_shared<mtd::StubBufferStream>();
+    auto surface = std::make_shared<ms::BasicSurface>(
+        nullptr /* session */,
+        std::string("stub"),
+        geom::Rectangle{{10, 10}, {10, 10}},
+        mir_pointer_unconfined,
+        std::list<ms::StreamInfo> { { stream, {}, geom::Size{10, 10} } },
+        std::shared_ptr<mg::CursorImage>(),
+        report);
+    stack.add_surface(surface, default_params.input_mode);
+
+    EXPECT_THAT(stack.scene_elements_for(comp1), ElementsAre(SceneElementForStream(stream)));
+    EXPECT_THAT(stack.scene_elements_for(comp2), IsEmpty());
+}
+
+TEST_F(SurfaceStack, scene_elements_include_surfaces_moved_into_the_compositor_area)
+{
+    using namespace testing;
+
+    ms::SurfaceStack stack{report};
+    auto const comp1 = reinterpret_cast<mc::CompositorID>(0);
+    auto const comp2 = reinterpret_cast<mc::CompositorID>(1);
+    stack.register_compositor(comp1);
+    stack.register_compositor(comp2);
+    stack.set_compositor_area(comp1, {{0, 0}, {100, 100}});
+    stack.set_compositor_area(comp2, {{100, 0}, {100, 100}});
+
+    auto stream = std::make_shared<mtd::StubBufferStream>();
+    auto surface = std::make_shared<ms::BasicSurface>(
+        nullptr /* session */,
+        std::string("stub"),
+        geom::Rectangle{{10, 10}, {10, 10}},
+        mir_pointer_unconfined,
+        std::list<ms::StreamInfo> { { stream, {}, geom::Size{10, 10} } },
+        std::shared_ptr<mg::CursorImage>(),
+        report);
+    stack.add_surface(surface, default_params.input_mode);
+    ASSERT_THAT(stack.scene_elements_for(comp2), IsEmpty());
+
+    surface->move_to({110, 10});
+
+    EXPECT_THAT(stack.scene_elements_for(comp1), IsEmpty());
+    EXPECT_THAT(stack.scene_elements_for(comp2), ElementsAre(SceneElementForStream(stream)));
+}
+
+TEST_F(SurfaceStack, scene_doesnt_count_pending_frames_for_a_compositor_area_the_surface_left)
+{
+    using namespace testing;
+
+    ms::SurfaceStack stack{report};
+    auto const comp1 = reinterpret_cast<mc::CompositorID>(0);
+    auto const comp2 = reinterpret_cast<mc::CompositorID>(1);
+    stack.register_compositor(comp1);
+    stack.register_compositor(comp2);
+    stack.set_compositor_area(comp1, {{0, 0}, {100, 100}});
+    stack.set_compositor_area(comp2, {{100, 0}, {100, 100}});
+
+    auto stream = std::make_shared<mtd::StubBufferStream>();
+    auto surface = std::make_shared<ms::BasicSurface>(
+        nullptr /* session */,
+        std::string("stub"),
+        geom::Rectangle{{10, 10}, {10, 10}},
+        mir_pointer_unconfined,
+        std::list<ms::StreamInfo> { { stream, {}, geom::Size{10, 10} } },
+        std::shared_ptr<mg::CursorImage>(),
+        report);
+    stack.add_surface(surface, default_params.input_mode);
+    for (auto const& elem : stack.scene_elements_for(comp1))
+        elem->rendered();
+
+    surface->move_to({110, 10});
+    stack.scene_elements_for(comp1);
+    post_a_frame(*stream);
+
+    EXPECT_EQ(0, stack.frames_pending(comp1));
+    EXPECT_EQ(1, stack.frames_pending(comp2));
+}
+
 TEST_F(SurfaceStack, surfaces_are_emitted_by_layer)
 {
     using namespace testing;
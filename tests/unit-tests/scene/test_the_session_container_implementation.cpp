@@ -85,3 +85,66 @@ TEST(SessionContainer, invalid_session_throw_behavior)
         container.remove_session(std::make_shared<mtd::StubSession>());
     }, std::logic_error);
 }
+
+TEST(SessionContainer, predecessor_of)
+{
+    using namespace ::testing;
+    ms::SessionContainer container;
+
+    auto session1 = std::make_shared<mtd::StubSession>();
+    auto session2 = std::make_shared<mtd::StubSession>();
+    auto session3 = std::make_shared<mtd::StubSession>();
+
+    container.insert_session(session1);
+    container.insert_session(session2);
+    container.insert_session(session3);
+    container.remove_session(session2);
+
+    EXPECT_EQ(session3, container.predecessor_of(session1));
+    EXPECT_EQ(session1, container.predecessor_of(session3));
+    EXPECT_THROW(container.predecessor_of(session2), std::logic_error);
+}
+
+TEST(SessionContainer, finds_most_recent_session_for_process)
+{
+    using namespace ::testing;
+    ms::SessionContainer container;
+
+    auto session1 = std::make_shared<mtd::StubSession>(__LINE__);
+    auto session2 = std::make_shared<mtd::StubSession>(session1->process_id());
+    auto other = std::make_shared<mtd::StubSession>(__LINE__);
+
+    container.insert_session(session1);
+    container.insert_session(session2);
+    container.insert_session(other);
+
+    EXPECT_EQ(session2, container.session_for_process(session1->process_id()));
+
+    container.remove_session(session2);
+    EXPECT_EQ(session1, container.session_for_process(session1->process_id()));
+
+    container.remove_session(session1);
+    EXPECT_EQ(nullptr, container.session_for_process(session1->process_id()));
+}
+
+TEST(SessionContainer, sessions_can_be_removed_while_iterating)
+{
+    using namespace ::testing;
+    ms::SessionContainer container;
+
+    auto session1 = std::make_shared<mtd::StubSession>();
+    auto session2 = std::make_shared<mtd::StubSession>();
+
+    container.insert_session(session1);
+    container.insert_session(session2);
+
+    std::vector<std::shared_ptr<ms::Session>> seen;
+    container.for_each([&](std::shared_ptr<ms::Session> const& session)
+        {
+            seen.push_back(session);
+            container.remove_session(session);
+        });
+
+    EXPECT_THAT(seen, ElementsAre(session1, session2));
+    EXPECT_EQ(nullptr, container.successor_of(nullptr));
+}
@@ -18,11 +18,16 @@
 
 #include "src/server/scene/threaded_snapshot_strategy.h"
 #include "src/server/scene/pixel_buffer.h"
+#include "src/server/scene/async_gl_pixel_reader.h"
 #include "mir/graphics/buffer.h"
+#include "mir/renderer/gl/context.h"
 
 #include "mir/test/doubles/stub_buffer.h"
 #include "mir/test/doubles/null_pixel_buffer.h"
 #include "mir/test/doubles/stub_buffer_stream.h"
+#include "mir/test/doubles/mock_gl_buffer.h"
+#include "mir/test/doubles/mock_gl.h"
+#include "mir/test/doubles/mock_egl.h"
 #include "mir/test/fake_shared.h"
 #include "mir/test/signal.h"
 #include "mir/test/current_thread_name.h"
@@ -33,6 +38,7 @@
 #include <chrono>
 #include <thread>
 #include <atomic>
+#include <vector>
 
 namespace mg = mir::graphics;
 namespace ms = mir::scene;
@@ -49,6 +55,7 @@ public:
     ~MockPixelBuffer() noexcept {}
 
     MOCK_METHOD1(fill_from, void(mg::Buffer& buffer));
+    MOCK_METHOD2(fill_scaled_from, void(mg::Buffer& buffer, geom::Size max_size));
     MOCK_METHOD0(as_argb_8888, void const*());
     MOCK_CONST_METHOD0(size, geom::Size());
     MOCK_CONST_METHOD0(stride, geom::Stride());
@@ -66,9 +73,100 @@ struct NamedThreadBufferStream : mtd::StubBufferStream
     std::string thread_name;
 };
 
+struct BlockingBufferStream : mtd::StubBufferStream
+{
+    void with_most_recent_buffer_do(std::function<void(mg::Buffer & )> const& fn) override
+    {
+        entered.raise();
+        release.wait_for(std::chrono::seconds{5});
+        StubBufferStream::with_most_recent_buffer_do(fn);
+    }
+
+    mt::Signal entered;
+    mt::Signal release;
+};
+
+/* Just enough of GLES3 for AsyncGLPixelReader to read asynchronously */
+std::vector<uint32_t> pbo_contents(16, 0xff102030);
+
+void* fake_glMapBufferRange(GLenum, GLintptr, GLsizeiptr, GLbitfield) { return pbo_contents.data(); }
+GLboolean fake_glUnmapBuffer(GLenum) { return GL_TRUE; }
+void* fake_glFenceSync(GLenum, GLbitfield) { static int fence; return &fence; }
+GLenum fake_glClientWaitSync(void*, GLbitfield, uint64_t) { return 0x911A; /* GL_ALREADY_SIGNALED */ }
+/* Reads only complete when waited for, so they stay in flight across snapshots */
+GLenum fake_glClientWaitSync_when_waited(void*, GLbitfield, uint64_t timeout)
+{
+    return timeout ? 0x911A /* GL_ALREADY_SIGNALED */ : 0x911B; /* GL_TIMEOUT_EXPIRED */
+}
+void fake_glDeleteSync(void*) {}
+
+void use_gles3_async_reads(
+    mtd::MockGL& mock_gl,
+    mtd::MockEGL& mock_egl,
+    GLenum (*client_wait_sync)(void*, GLbitfield, uint64_t) = &fake_glClientWaitSync)
+{
+    using namespace testing;
+    typedef mtd::MockEGL::generic_function_pointer_t func_ptr_t;
+
+    static GLubyte const version[] = "OpenGL ES 3.0 Mesa";
+    ON_CALL(mock_gl, glGetString(GL_VERSION))
+        .WillByDefault(Return(version));
+    ON_CALL(mock_egl, eglGetProcAddress(StrEq("glMapBufferRange")))
+        .WillByDefault(Return(reinterpret_cast<func_ptr_t>(&fake_glMapBufferRange)));
+    ON_CALL(mock_egl, eglGetProcAddress(StrEq("glUnmapBuffer")))
+        .WillByDefault(Return(reinterpret_cast<func_ptr_t>(&fake_glUnmapBuffer)));
+    ON_CALL(mock_egl, eglGetProcAddress(StrEq("glFenceSync")))
+        .WillByDefault(Return(reinterpret_cast<func_ptr_t>(&fake_glFenceSync)));
+    ON_CALL(mock_egl, eglGetProcAddress(StrEq("glClientWaitSync")))
+        .WillByDefault(Return(reinterpret_cast<func_ptr_t>(client_wait_sync)));
+    ON_CALL(mock_egl, eglGetProcAddress(StrEq("glDeleteSync")))
+        .WillByDefault(Return(reinterpret_cast<func_ptr_t>(&fake_glDeleteSync)));
+}
+
+struct StubGLContext : mir::renderer::gl::Context
+{
+    void make_current() const override {}
+    void release_current() const override {}
+};
+
+struct GLBufferStream : mtd::StubBufferStream
+{
+    GLBufferStream()
+    {
+        ON_CALL(*gl_buffer, size())
+            .WillByDefault(testing::Return(geom::Size{4, 4}));
+        stub_compositor_buffer = gl_buffer;
+    }
+
+    std::shared_ptr<mtd::MockGLBuffer> const gl_buffer{std::make_shared<testing::NiceMock<mtd::MockGLBuffer>>()};
+};
+
 struct ThreadedSnapshotStrategyTest : testing::Test
 {
+    ThreadedSnapshotStrategyTest()
+    {
+        using namespace testing;
+
+        ON_CALL(pixel_buffer, as_argb_8888())
+            .WillByDefault(Return(pixels.data()));
+        ON_CALL(pixel_buffer, size())
+            .WillByDefault(Return(size));
+        ON_CALL(pixel_buffer, stride())
+            .WillByDefault(Return(stride));
+    }
+
+    void snapshot_and_wait(ms::ThreadedSnapshotStrategy& strategy, std::shared_ptr<mir::compositor::BufferStream> const& stream)
+    {
+        mt::Signal snapshot_taken;
+        strategy.take_snapshot_of(stream, [&](ms::Snapshot const&) { snapshot_taken.raise(); });
+        EXPECT_TRUE(snapshot_taken.wait_for(std::chrono::seconds{5}));
+    }
+
     NamedThreadBufferStream buffer_access;
+    geom::Size const size{10, 11};
+    geom::Stride const stride{40};
+    std::vector<char> const pixels = std::vector<char>(stride.as_int() * size.height.as_int(), 'p');
+    testing::NiceMock<MockPixelBuffer> pixel_buffer;
 };
 
 }
@@ -77,31 +175,22 @@ TEST_F(ThreadedSnapshotStrategyTest, takes_snapshot)
 {
     using namespace testing;
 
-    void const* pixels{reinterpret_cast<void*>(0xabcd)};
-    geom::Size size{10, 11};
-    geom::Stride stride{123};
-
-    MockPixelBuffer pixel_buffer;
-
     EXPECT_CALL(pixel_buffer, fill_from(Ref(*buffer_access.stub_compositor_buffer)));
-    EXPECT_CALL(pixel_buffer, as_argb_8888())
-        .WillOnce(Return(pixels));
-    EXPECT_CALL(pixel_buffer, size())
-        .WillOnce(Return(size));
-    EXPECT_CALL(pixel_buffer, stride())
-        .WillOnce(Return(stride));
 
     ms::ThreadedSnapshotStrategy strategy{mt::fake_shared(pixel_buffer)};
 
     mt::Signal snapshot_taken;
 
     ms::Snapshot snapshot;
+    std::vector<char> snapshot_pixels;
 
     strategy.take_snapshot_of(
         mt::fake_shared(buffer_access),
         [&](ms::Snapshot const& s)
         {
             snapshot = s;
+            auto const data = static_cast<char const*>(s.pixels);
+            snapshot_pixels.assign(data, data + pixels.size());
             snapshot_taken.raise();
         });
 
@@ -109,7 +198,171 @@ TEST_F(ThreadedSnapshotStrategyTest, takes_snapshot)
 
     EXPECT_EQ(size,   snapshot.size);
     EXPECT_EQ(stride, snapshot.stride);
-    EXPECT_EQ(pixels, snapshot.pixels);
+    EXPECT_EQ(pixels, snapshot_pixels);
+}
+
+TEST_F(ThreadedSnapshotStrategyTest, reuses_snapshot_of_unchanged_stream)
+{
+    using namespace testing;
+
+    auto const stream = mt::fake_shared(buffer_access);
+
+    EXPECT_CALL(pixel_buffer, fill_from(_)).Times(1);
+
+    ms::ThreadedSnapshotStrategy strategy{mt::fake_shared(pixel_buffer)};
+
+    snapshot_and_wait(strategy, stream);
+    snapshot_and_wait(strategy, stream);
+}
+
+TEST_F(ThreadedSnapshotStrategyTest, takes_new_snapshot_once_buffer_is_resubmitted)
+{
+    using namespace testing;
+
+    auto const stream = mt::fake_shared(buffer_access);
+
+    EXPECT_CALL(pixel_buffer, fill_from(_)).Times(2);
+
+    ms::ThreadedSnapshotStrategy strategy{mt::fake_shared(pixel_buffer)};
+
+    snapshot_and_wait(strategy, stream);
+    // The same buffer, but with new content
+    stream->submit_buffer(stream->stub_compositor_buffer);
+    snapshot_and_wait(strategy, stream);
+}
+
+TEST_F(ThreadedSnapshotStrategyTest, coalesces_queued_requests_for_a_stream)
+{
+    using namespace testing;
+
+    BlockingBufferStream busy_stream;
+    int snapshots_taken{0};
+    mt::Signal all_taken;
+
+    EXPECT_CALL(pixel_buffer, fill_from(_)).Times(2);
+
+    ms::ThreadedSnapshotStrategy strategy{mt::fake_shared(pixel_buffer)};
+
+    strategy.take_snapshot_of(mt::fake_shared(busy_stream), [](ms::Snapshot const&) {});
+    ASSERT_TRUE(busy_stream.entered.wait_for(std::chrono::seconds{5}));
+
+    for (auto i = 0; i != 3; ++i)
+    {
+        strategy.take_snapshot_of(
+            mt::fake_shared(buffer_access),
+            [&](ms::Snapshot const&) { if (++snapshots_taken == 3) all_taken.raise(); });
+    }
+
+    busy_stream.release.raise();
+
+    EXPECT_TRUE(all_taken.wait_for(std::chrono::seconds{5}));
+}
+
+TEST_F(ThreadedSnapshotStrategyTest, scales_snapshots_to_thumbnail_size)
+{
+    using namespace testing;
+
+    geom::Size const thumbnail_size{64, 48};
+
+    EXPECT_CALL(pixel_buffer, fill_from(_)).Times(0);
+    EXPECT_CALL(pixel_buffer, fill_scaled_from(Ref(*buffer_access.stub_compositor_buffer), thumbnail_size));
+
+    ms::ThreadedSnapshotStrategy strategy{mt::fake_shared(pixel_buffer), thumbnail_size};
+
+    snapshot_and_wait(strategy, mt::fake_shared(buffer_access));
+}
+
+TEST_F(ThreadedSnapshotStrategyTest, reads_full_size_snapshots_back_through_async_reader)
+{
+    using namespace testing;
+
+    NiceMock<mtd::MockGL> mock_gl;
+    NiceMock<mtd::MockEGL> mock_egl;
+    use_gles3_async_reads(mock_gl, mock_egl);
+
+    GLBufferStream gl_stream;
+
+    EXPECT_CALL(pixel_buffer, fill_from(_)).Times(0);
+    /* Into a pixel-pack buffer, rather than client memory */
+    EXPECT_CALL(mock_gl, glReadPixels(_, _, _, _, _, _, _)).Times(AnyNumber());
+    EXPECT_CALL(mock_gl, glReadPixels(0, 0, 4, 4, _, GL_UNSIGNED_BYTE, nullptr));
+
+    ms::ThreadedSnapshotStrategy strategy{
+        mt::fake_shared(pixel_buffer),
+        {},
+        ms::ThreadedSnapshotStrategy::default_cache_budget,
+        std::make_shared<ms::AsyncGLPixelReader>(std::make_unique<StubGLContext>())};
+
+    mt::Signal snapshot_taken;
+    ms::Snapshot snapshot;
+    uint32_t top_left{0};
+
+    strategy.take_snapshot_of(
+        mt::fake_shared(gl_stream),
+        [&](ms::Snapshot const& s)
+        {
+            snapshot = s;
+            top_left = static_cast<uint32_t const*>(s.pixels)[0];
+            snapshot_taken.raise();
+        });
+
+    ASSERT_TRUE(snapshot_taken.wait_for(std::chrono::seconds{5}));
+
+    EXPECT_THAT(snapshot.size, Eq(geom::Size{4, 4}));
+    EXPECT_THAT(snapshot.stride, Eq(geom::Stride{16}));
+    EXPECT_THAT(top_left, Eq(0xff102030u));
+}
+
+TEST_F(ThreadedSnapshotStrategyTest, snapshots_a_stream_while_completing_an_earlier_read_over_budget)
+{
+    using namespace testing;
+
+    NiceMock<mtd::MockGL> mock_gl;
+    NiceMock<mtd::MockEGL> mock_egl;
+    use_gles3_async_reads(mock_gl, mock_egl, &fake_glClientWaitSync_when_waited);
+
+    struct BlockingGLBufferStream : GLBufferStream
+    {
+        void with_most_recent_buffer_do(std::function<void(mg::Buffer&)> const& fn) override
+        {
+            release.wait_for(std::chrono::seconds{5});
+            GLBufferStream::with_most_recent_buffer_do(fn);
+        }
+
+        mt::Signal release;
+    };
+
+    BlockingGLBufferStream first;
+    GLBufferStream second;
+
+    /*
+     * With a single slot and nothing to spare in the cache, snapshotting the
+     * second stream must first complete (and deliver) the read of the first,
+     * which evicts from the cache.
+     */
+    ms::ThreadedSnapshotStrategy strategy{
+        mt::fake_shared(pixel_buffer),
+        {},
+        0,
+        std::make_shared<ms::AsyncGLPixelReader>(std::make_unique<StubGLContext>(), 1)};
+
+    mt::Signal first_taken;
+    mt::Signal second_taken;
+    ms::Snapshot second_snapshot;
+
+    strategy.take_snapshot_of(mt::fake_shared(first), [&](ms::Snapshot const&) { first_taken.raise(); });
+    strategy.take_snapshot_of(
+        mt::fake_shared(second),
+        [&](ms::Snapshot const& s)
+        {
+            second_snapshot = s;
+            second_taken.raise();
+        });
+    first.release.raise();
+
+    EXPECT_TRUE(first_taken.wait_for(std::chrono::seconds{5}));
+    ASSERT_TRUE(second_taken.wait_for(std::chrono::seconds{5}));
+    EXPECT_THAT(second_snapshot.size, Eq(geom::Size{4, 4}));
 }
 
 #ifndef MIR_DONT_USE_PTHREAD_GETNAME_NP
@@ -117,9 +370,9 @@ TEST_F(ThreadedSnapshotStrategyTest, names_snapshot_thread)
 {
     using namespace testing;
 
-    mtd::NullPixelBuffer pixel_buffer;
+    mtd::NullPixelBuffer null_pixel_buffer;
 
-    ms::ThreadedSnapshotStrategy strategy{mt::fake_shared(pixel_buffer)};
+    ms::ThreadedSnapshotStrategy strategy{mt::fake_shared(null_pixel_buffer)};
 
     mt::Signal snapshot_taken;
 
@@ -0,0 +1,126 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mir/thread/parallel_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <stdexcept>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace mth = mir::thread;
+
+using namespace testing;
+
+namespace
+{
+size_t const iterations{1000};
+
+/// Calls each index of a for_each() at most once, and records which thread did
+struct Recorder
+{
+    Recorder() : calls(iterations) {}
+
+    void operator()(size_t i)
+    {
+        ++calls[i];
+
+        std::lock_guard<std::mutex> lock{mutex};
+        threads.insert(std::this_thread::get_id());
+    }
+
+    std::vector<std::atomic<int>> calls;
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+};
+}
+
+TEST(ParallelPool, calls_work_once_for_each_index)
+{
+    mth::ParallelPool pool{3};
+    Recorder recorder;
+
+    pool.for_each(iterations, std::ref(recorder));
+
+    for (auto const& calls : recorder.calls)
+        EXPECT_THAT(calls.load(), Eq(1));
+}
+
+TEST(ParallelPool, shares_work_with_helpers)
+{
+    mth::ParallelPool pool{3};
+    Recorder recorder;
+
+    // Slow enough iterations that the helpers will have woken before they run out
+    pool.for_each(
+        iterations,
+        [&](size_t i)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds{100});
+            recorder(i);
+        });
+
+    EXPECT_THAT(recorder.threads.size(), Gt(1u));
+}
+
+TEST(ParallelPool, without_helpers_runs_work_on_calling_thread)
+{
+    mth::ParallelPool pool{0};
+    Recorder recorder;
+
+    pool.for_each(iterations, std::ref(recorder));
+
+    EXPECT_THAT(recorder.threads, ElementsAre(std::this_thread::get_id()));
+    EXPECT_THAT(recorder.calls.back().load(), Eq(1));
+}
+
+TEST(ParallelPool, runs_loops_from_several_threads_at_once)
+{
+    mth::ParallelPool pool{2};
+    Recorder first, second;
+
+    std::thread other{[&] { pool.for_each(iterations, std::ref(second)); }};
+    pool.for_each(iterations, std::ref(first));
+    other.join();
+
+    for (auto const* recorder : {&first, &second})
+    {
+        for (auto const& calls : recorder->calls)
+            EXPECT_THAT(calls.load(), Eq(1));
+    }
+}
+
+TEST(ParallelPool, rethrows_exception_once_all_work_has_finished)
+{
+    mth::ParallelPool pool{3};
+    std::atomic<size_t> finished{0};
+
+    EXPECT_THROW(
+        pool.for_each(
+            iterations,
+            [&](size_t i)
+            {
+                if (i == 10)
+                    throw std::runtime_error{"failed"};
+                ++finished;
+            }),
+        std::runtime_error);
+
+    EXPECT_THAT(finished.load(), Eq(iterations - 1));
+}
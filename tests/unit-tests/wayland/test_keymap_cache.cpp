@@ -0,0 +1,145 @@
+/*
+ * Copyright © 2020 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/frontend_wayland/keymap_cache.h"
+#include "mir/input/keymap.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+
+namespace mf = mir::frontend;
+namespace mi = mir::input;
+
+using namespace testing;
+
+namespace
+{
+auto contents_of(mir::Fd const& fd) -> std::string
+{
+    std::string contents;
+    char buffer[4096];
+    for (off_t offset = 0;;)
+    {
+        auto const result = pread(fd, buffer, sizeof buffer, offset);
+        if (result <= 0)
+            return contents;
+        contents.append(buffer, result);
+        offset += result;
+    }
+}
+
+auto inode_of(mir::Fd const& fd) -> ino_t
+{
+    struct stat info;
+    fstat(fd, &info);
+    return info.st_ino;
+}
+
+struct KeymapCacheTest : Test
+{
+    mi::Keymap const us{"pc105", "us", "", ""};
+    mi::Keymap const gb{"pc105", "gb", "", ""};
+
+    mf::KeymapCache cache;
+};
+}
+
+TEST_F(KeymapCacheTest, keyboards_with_the_same_names_share_a_keymap)
+{
+    auto const first = cache.keymap_for(us);
+    auto const second = cache.keymap_for(mi::Keymap{us});
+
+    EXPECT_THAT(second, Eq(first));
+}
+
+TEST_F(KeymapCacheTest, keyboards_with_different_names_get_different_keymaps)
+{
+    auto const first = cache.keymap_for(us);
+    auto const second = cache.keymap_for(gb);
+
+    EXPECT_THAT(second, Ne(first));
+    EXPECT_THAT(second->text(), Ne(first->text()));
+}
+
+TEST_F(KeymapCacheTest, keyboards_with_the_same_text_share_a_keymap)
+{
+    auto const text = cache.keymap_for(us)->text();
+
+    auto const first = cache.keymap_for(text.data(), text.size());
+    auto const second = cache.keymap_for(text.data(), text.size());
+
+    EXPECT_THAT(second, Eq(first));
+    EXPECT_THAT(first->text(), Eq(text));
+}
+
+TEST_F(KeymapCacheTest, text_of_a_keymap_compiled_from_names_shares_that_keymap)
+{
+    auto const by_names = cache.keymap_for(us);
+
+    auto const by_text = cache.keymap_for(by_names->text().data(), by_names->text().size());
+
+    EXPECT_THAT(by_text, Eq(by_names));
+}
+
+TEST_F(KeymapCacheTest, keymaps_are_not_kept_once_unused)
+{
+    std::weak_ptr<mf::CompiledKeymap const> const unused = cache.keymap_for(us);
+
+    EXPECT_TRUE(unused.expired());
+    EXPECT_THAT(cache.keymap_for(us), NotNull());
+}
+
+TEST_F(KeymapCacheTest, entries_for_unused_keymaps_are_pruned_when_compiling)
+{
+    cache.keymap_for(us);
+    auto const entries_for_one_keymap = cache.entries();
+
+    auto const kept = cache.keymap_for(gb);
+
+    EXPECT_THAT(cache.entries(), Eq(entries_for_one_keymap));
+}
+
+TEST_F(KeymapCacheTest, keymaps_are_shared_through_a_sealed_file)
+{
+    auto const keymap = cache.keymap_for(us);
+    auto const& fd = keymap->sealed_fd();
+
+    ASSERT_THAT(fd, Ne(mir::Fd::invalid));
+    EXPECT_THAT(fcntl(fd, F_GET_SEALS) & (F_SEAL_WRITE | F_SEAL_SHRINK | F_SEAL_GROW),
+        Eq(F_SEAL_WRITE | F_SEAL_SHRINK | F_SEAL_GROW));
+    EXPECT_THAT(contents_of(fd), Eq(keymap->text()));
+    EXPECT_THAT(inode_of(keymap->fd_for_client()), Eq(inode_of(keymap->fd_for_client())));
+}
+
+TEST_F(KeymapCacheTest, when_files_cant_be_sealed_each_client_gets_a_copy)
+{
+    mf::KeymapCache unsealable{[](std::string const&) { return mir::Fd{}; }};
+
+    auto const keymap = unsealable.keymap_for(us);
+    auto const first = keymap->fd_for_client();
+    auto const second = keymap->fd_for_client();
+
+    EXPECT_THAT(keymap->sealed_fd(), Eq(mir::Fd::invalid));
+    EXPECT_THAT(contents_of(first), Eq(keymap->text()));
+    EXPECT_THAT(contents_of(second), Eq(keymap->text()));
+    EXPECT_THAT(inode_of(second), Ne(inode_of(first)));
+}